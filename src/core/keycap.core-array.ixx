@@ -1,13 +1,154 @@
 module;
 
+#include "simd.hpp"
+
+#include <fmt/format.h>
+
 #include <array>
+#include <bit>
+#include <compare>
+#include <concepts>
+#include <cstddef>
 #include <cstring>
+#include <expected>
+#include <iterator>
+#include <ranges>
+#include <span>
+#include <type_traits>
 #include <vector>
 
 export module keycap.core:array;
 
+import :error;
+import :fragments;
+import :result;
+import :simd;
 import :types;
 
+namespace impl
+{
+    template <typename T>
+    [[nodiscard]] constexpr T byteswap_any(T value) noexcept
+    {
+        if constexpr (sizeof(T) == 1)
+        {
+            return value;
+        }
+        else
+        {
+            using unsigned_type = std::conditional_t<sizeof(T) == 2, u16, std::conditional_t<sizeof(T) == 4, u32, u64>>;
+            return std::bit_cast<T>(std::byteswap(std::bit_cast<unsigned_type>(value)));
+        }
+    }
+
+    template <sz Size>
+    void copy_swapped_scalar(u8* destination, u8 const* source, sz count) noexcept
+    {
+        using unsigned_type = std::conditional_t<Size == 2, u16, std::conditional_t<Size == 4, u32, u64>>;
+        for (sz i = 0; i < count; ++i)
+        {
+            unsigned_type value;
+            std::memcpy(&value, source + i * Size, Size);
+            value = std::byteswap(value);
+            std::memcpy(destination + i * Size, &value, Size);
+        }
+    }
+
+#if KEYCAP_SIMD_X86
+    template <sz Size>
+    KEYCAP_TARGET("sse2")
+    __m128i byteswap_m128(__m128i value) noexcept
+    {
+        // Swap the bytes within every 16-bit word, then reverse the order of the words within every element
+        value = _mm_or_si128(_mm_slli_epi16(value, 8), _mm_srli_epi16(value, 8));
+        if constexpr (Size == 4)
+        {
+            value = _mm_shufflehi_epi16(_mm_shufflelo_epi16(value, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+        }
+        else if constexpr (Size == 8)
+        {
+            value = _mm_shufflehi_epi16(_mm_shufflelo_epi16(value, _MM_SHUFFLE(0, 1, 2, 3)), _MM_SHUFFLE(0, 1, 2, 3));
+        }
+        return value;
+    }
+
+    template <sz Size>
+    KEYCAP_TARGET("sse2")
+    void copy_swapped_sse2(u8* destination, u8 const* source, sz count) noexcept
+    {
+        constexpr sz per_step = 16 / Size;
+
+        sz i = 0;
+        for (; i + per_step <= count; i += per_step)
+        {
+            auto const value = _mm_loadu_si128(reinterpret_cast<__m128i const*>(source + i * Size));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * Size), byteswap_m128<Size>(value));
+        }
+        copy_swapped_scalar<Size>(destination + i * Size, source + i * Size, count - i);
+    }
+
+    template <sz Size>
+    KEYCAP_TARGET("avx2")
+    void copy_swapped_avx2(u8* destination, u8 const* source, sz count) noexcept
+    {
+        constexpr sz per_step = 32 / Size;
+
+        // Reverses the bytes of every element within each 128-bit lane
+        alignas(32) std::array<char, 32> mask{};
+        for (sz i = 0; i < mask.size(); ++i)
+        {
+            mask[i] = static_cast<char>((i % 16) - (i % Size) + (Size - 1 - i % Size));
+        }
+        auto const shuffle = _mm256_load_si256(reinterpret_cast<__m256i const*>(mask.data()));
+
+        sz i = 0;
+        for (; i + per_step <= count; i += per_step)
+        {
+            auto const value = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(source + i * Size));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i * Size), _mm256_shuffle_epi8(value, shuffle));
+        }
+        copy_swapped_sse2<Size>(destination + i * Size, source + i * Size, count - i);
+    }
+#endif
+
+    /// <summary>
+    /// Copies count elements of the given size from source to destination, reversing the bytes of every element
+    /// </summary>
+    template <sz Size>
+    void copy_swapped(u8* destination, u8 const* source, sz count) noexcept
+    {
+        if constexpr (Size == 1)
+        {
+            std::memcpy(destination, source, count);
+        }
+        else
+        {
+#if KEYCAP_SIMD_X86
+            switch (keycap::simd::max_instruction_set())
+            {
+                case keycap::simd::instruction_set::avx512:
+                case keycap::simd::instruction_set::avx2:
+                    return copy_swapped_avx2<Size>(destination, source, count);
+                case keycap::simd::instruction_set::sse2:
+                    return copy_swapped_sse2<Size>(destination, source, count);
+                case keycap::simd::instruction_set::scalar:
+                    break;
+            }
+#endif
+            copy_swapped_scalar<Size>(destination, source, count);
+        }
+    }
+
+    template <std::endian Endian, typename T>
+    void copy_ordered(u8* destination, u8 const* source, sz count) noexcept
+    {
+        if constexpr (Endian == std::endian::native || sizeof(T) == 1)
+            std::memcpy(destination, source, count * sizeof(T));
+        else
+            copy_swapped<sizeof(T)>(destination, source, count);
+    }
+}
+
 namespace keycap
 {
     template <typename PTR, typename T>
@@ -108,16 +249,586 @@ namespace keycap
 
     /// <summary>
     /// Converts a vector of bytes to the given RESULT_TYPE. This does not do any-type checking and will invoke
-    /// undefined behaviour, if invoked with an incorrect type!
+    /// undefined behaviour, if invoked with an incorrect type! Accepts vectors with any allocator, e.g. a
+    /// std::pmr::vector.
     /// </summary>
     /// <typeparam name="RESULT_TYPE">The type to convert to</typeparam>
     /// <param name="vector">The vector of bytes to convert</param>
     /// <returns>The converted bytes in the required format</returns>
-    export template <typename RESULT_TYPE>
-    [[nodiscard]] RESULT_TYPE from_byte_vector(std::vector<u8> const& vector)
+    export template <typename RESULT_TYPE, typename Allocator>
+    [[nodiscard]] RESULT_TYPE from_byte_vector(std::vector<u8, Allocator> const& vector)
     {
         RESULT_TYPE value = 0;
         std::memcpy(&value, vector.data(), std::min(vector.size(), sizeof(RESULT_TYPE)));
         return value;
     }
-}
\ No newline at end of file
+
+    /// <summary>
+    /// Types that byte_writer and byte_reader can serialize: arithmetic types and enums
+    /// </summary>
+    export template <typename T>
+    concept byte_serializable = (std::is_arithmetic_v<T> || std::is_enum_v<T>) && !std::is_const_v<T>;
+
+    /// <summary>
+    /// Contiguous ranges of byte_serializable elements
+    /// </summary>
+    export template <typename R>
+    concept byte_serializable_range =
+        std::ranges::contiguous_range<R> && std::ranges::sized_range<R> &&
+        byte_serializable<std::remove_cv_t<std::ranges::range_value_t<R>>>;
+
+    /// <summary>
+    /// Serializes values into a fixed buffer in the given byte order. Writing past the end of the buffer throws a
+    /// keycap::exception with error_code::buffer_overflow, try_write returns it instead. Arrays in non-native byte
+    /// order are converted in bulk.
+    /// </summary>
+    /// <typeparam name="Endian">The byte order to write in</typeparam>
+    export template <std::endian Endian = std::endian::little>
+    class byte_writer
+    {
+      public:
+        explicit byte_writer(std::span<u8> buffer) noexcept
+          : buffer_{buffer}
+        {
+        }
+
+        /// <summary>
+        /// Writes the given value
+        /// </summary>
+        template <byte_serializable T>
+        byte_writer& write(T value)
+        {
+            auto* destination = claim(sizeof(T));
+            if constexpr (Endian != std::endian::native)
+                value = impl::byteswap_any(value);
+
+            std::memcpy(destination, &value, sizeof(T));
+            return *this;
+        }
+
+        /// <summary>
+        /// Writes all elements of the given contiguous range, e.g. a std::vector, std::array or std::span
+        /// </summary>
+        template <byte_serializable_range R>
+        byte_writer& write(R const& values)
+        {
+            using T = std::remove_cv_t<std::ranges::range_value_t<R>>;
+            auto const count = static_cast<sz>(std::ranges::size(values));
+
+            auto* destination = claim(count * sizeof(T));
+            impl::copy_ordered<Endian, T>(destination, reinterpret_cast<u8 const*>(std::ranges::data(values)), count);
+            return *this;
+        }
+
+        /// <summary>
+        /// Writes the given bytes as they are
+        /// </summary>
+        byte_writer& write_bytes(std::span<u8 const> bytes)
+        {
+            std::memcpy(claim(bytes.size()), bytes.data(), bytes.size());
+            return *this;
+        }
+
+        /// <summary>
+        /// Writes the given value or returns error_code::buffer_overflow, leaving the buffer untouched, if it does not
+        /// fit
+        /// </summary>
+        template <byte_serializable T>
+        [[nodiscard]] result<void> try_write(T value) noexcept
+        {
+            if (sizeof(T) > remaining())
+                return overflow();
+
+            write(value);
+            return {};
+        }
+
+        /// <summary>
+        /// Writes all elements of the given contiguous range or returns error_code::buffer_overflow, leaving the
+        /// buffer untouched, if they do not fit
+        /// </summary>
+        template <byte_serializable_range R>
+        [[nodiscard]] result<void> try_write(R const& values) noexcept
+        {
+            if (std::ranges::size(values) * sizeof(std::ranges::range_value_t<R>) > remaining())
+                return overflow();
+
+            write(values);
+            return {};
+        }
+
+        /// <summary>
+        /// Returns the number of bytes written so far
+        /// </summary>
+        [[nodiscard]] sz position() const noexcept
+        {
+            return position_;
+        }
+
+        /// <summary>
+        /// Returns the number of bytes that can still be written
+        /// </summary>
+        [[nodiscard]] sz remaining() const noexcept
+        {
+            return buffer_.size() - position_;
+        }
+
+        /// <summary>
+        /// Returns the part of the buffer that has been written to
+        /// </summary>
+        [[nodiscard]] std::span<u8> written() const noexcept
+        {
+            return buffer_.first(position_);
+        }
+
+      private:
+        [[nodiscard]] static std::unexpected<error_record> overflow() noexcept
+        {
+            return make_error(error_code::buffer_overflow, module::core, fragment::array, __LINE__,
+                              "Can not write past the end of the buffer");
+        }
+
+        [[nodiscard]] u8* claim(sz size)
+        {
+            if (size > remaining())
+            {
+                throw exception{error_code::buffer_overflow, module::core, fragment::array, __LINE__,
+                                fmt::format("Can not write {} bytes at position {}, the buffer holds only {} bytes",
+                                            size, position_, buffer_.size())};
+            }
+
+            auto* destination = buffer_.data() + position_;
+            position_ += size;
+            return destination;
+        }
+
+        std::span<u8> buffer_;
+        sz position_ = 0;
+    };
+
+    /// <summary>
+    /// Deserializes values from a buffer in the given byte order. Reading past the end of the buffer throws a
+    /// keycap::exception with error_code::buffer_overflow, try_read returns it instead. Arrays in non-native byte
+    /// order are converted in bulk.
+    /// </summary>
+    /// <typeparam name="Endian">The byte order to read in</typeparam>
+    export template <std::endian Endian = std::endian::little>
+    class byte_reader
+    {
+      public:
+        explicit byte_reader(std::span<u8 const> buffer) noexcept
+          : buffer_{buffer}
+        {
+        }
+
+        /// <summary>
+        /// Reads a value of the given type
+        /// </summary>
+        template <byte_serializable T>
+        [[nodiscard]] T read()
+        {
+            T value;
+            std::memcpy(&value, claim(sizeof(T)), sizeof(T));
+            if constexpr (Endian != std::endian::native)
+                value = impl::byteswap_any(value);
+
+            return value;
+        }
+
+        /// <summary>
+        /// Fills the given contiguous range, e.g. a std::vector, std::array or std::span, with values read from the
+        /// buffer
+        /// </summary>
+        template <byte_serializable_range R>
+            requires(!std::is_const_v<std::remove_reference_t<std::ranges::range_reference_t<R>>>)
+        void read(R&& destination)
+        {
+            using T = std::ranges::range_value_t<R>;
+            auto const count = static_cast<sz>(std::ranges::size(destination));
+
+            auto const* source = claim(count * sizeof(T));
+            impl::copy_ordered<Endian, T>(reinterpret_cast<u8*>(std::ranges::data(destination)), source, count);
+        }
+
+        /// <summary>
+        /// Returns a view of the next given number of bytes
+        /// </summary>
+        [[nodiscard]] std::span<u8 const> read_bytes(sz size)
+        {
+            return {claim(size), size};
+        }
+
+        /// <summary>
+        /// Reads a value of the given type or returns error_code::buffer_overflow, without advancing, if the buffer
+        /// is too short
+        /// </summary>
+        template <byte_serializable T>
+        [[nodiscard]] result<T> try_read() noexcept
+        {
+            if (sizeof(T) > remaining())
+                return overflow();
+
+            return read<T>();
+        }
+
+        /// <summary>
+        /// Fills the given contiguous range with values read from the buffer or returns error_code::buffer_overflow,
+        /// without advancing, if the buffer is too short
+        /// </summary>
+        template <byte_serializable_range R>
+            requires(!std::is_const_v<std::remove_reference_t<std::ranges::range_reference_t<R>>>)
+        [[nodiscard]] result<void> try_read(R&& destination) noexcept
+        {
+            if (std::ranges::size(destination) * sizeof(std::ranges::range_value_t<R>) > remaining())
+                return overflow();
+
+            read(std::forward<R>(destination));
+            return {};
+        }
+
+        /// <summary>
+        /// Returns the number of bytes read so far
+        /// </summary>
+        [[nodiscard]] sz position() const noexcept
+        {
+            return position_;
+        }
+
+        /// <summary>
+        /// Returns the number of bytes that can still be read
+        /// </summary>
+        [[nodiscard]] sz remaining() const noexcept
+        {
+            return buffer_.size() - position_;
+        }
+
+      private:
+        [[nodiscard]] static std::unexpected<error_record> overflow() noexcept
+        {
+            return make_error(error_code::buffer_overflow, module::core, fragment::array, __LINE__,
+                              "Can not read past the end of the buffer");
+        }
+
+        [[nodiscard]] u8 const* claim(sz size)
+        {
+            if (size > remaining())
+            {
+                throw exception{error_code::buffer_overflow, module::core, fragment::array, __LINE__,
+                                fmt::format("Can not read {} bytes at position {}, the buffer holds only {} bytes",
+                                            size, position_, buffer_.size())};
+            }
+
+            auto const* source = buffer_.data() + position_;
+            position_ += size;
+            return source;
+        }
+
+        std::span<u8 const> buffer_;
+        sz position_ = 0;
+    };
+
+    /// <summary>
+    /// Decodes a value of the given type from the start of the given bytes in the given byte order. Unlike
+    /// from_byte_vector, short input is not padded but throws a keycap::exception with error_code::buffer_overflow.
+    /// </summary>
+    /// <typeparam name="T">The type to decode</typeparam>
+    /// <typeparam name="Endian">The byte order the value is stored in</typeparam>
+    /// <param name="bytes">The bytes to decode</param>
+    export template <byte_serializable T, std::endian Endian = std::endian::little>
+    [[nodiscard]] T from_bytes(std::span<std::byte const> bytes)
+    {
+        if (bytes.size() < sizeof(T))
+        {
+            throw exception{error_code::buffer_overflow, module::core, fragment::array, __LINE__,
+                            fmt::format("Can not decode {} bytes from a buffer of {} bytes", sizeof(T), bytes.size())};
+        }
+
+        T value;
+        std::memcpy(&value, bytes.data(), sizeof(T));
+        if constexpr (Endian != std::endian::native)
+            value = impl::byteswap_any(value);
+
+        return value;
+    }
+
+    /// <summary>
+    /// Decodes a value of the given type from the start of the given bytes in the given byte order, or returns
+    /// error_code::buffer_overflow if there are fewer bytes than the type's size
+    /// </summary>
+    /// <typeparam name="T">The type to decode</typeparam>
+    /// <typeparam name="Endian">The byte order the value is stored in</typeparam>
+    /// <param name="bytes">The bytes to decode</param>
+    export template <byte_serializable T, std::endian Endian = std::endian::little>
+    [[nodiscard]] result<T> try_from_bytes(std::span<std::byte const> bytes) noexcept
+    {
+        if (bytes.size() < sizeof(T))
+        {
+            return make_error(error_code::buffer_overflow, module::core, fragment::array, __LINE__,
+                              "Can not decode a value from fewer bytes than its size");
+        }
+
+        return from_bytes<T, Endian>(bytes);
+    }
+
+    /// <summary>
+    /// A non-owning, random-access view of values of type T packed into a byte buffer, e.g. a memory-mapped file or
+    /// a pooled network buffer. Elements are decoded on access; decode_into converts many elements at once.
+    /// Elements may be strided to view a single field of an array of records. The buffer is checked once on
+    /// construction, a buffer too short for the requested elements throws error_code::buffer_overflow.
+    /// </summary>
+    /// <typeparam name="T">The type of the elements</typeparam>
+    /// <typeparam name="Endian">The byte order the elements are stored in</typeparam>
+    export template <byte_serializable T, std::endian Endian = std::endian::little>
+    class packed_view : public std::ranges::view_interface<packed_view<T, Endian>>
+    {
+      public:
+        class iterator
+        {
+          public:
+            using iterator_concept = std::random_access_iterator_tag;
+            using iterator_category = std::input_iterator_tag;
+            using value_type = T;
+            using difference_type = std::ptrdiff_t;
+
+            iterator() = default;
+
+            iterator(std::byte const* position, sz stride) noexcept
+              : position_{position}
+              , stride_{stride}
+            {
+            }
+
+            [[nodiscard]] T operator*() const noexcept
+            {
+                return decode(position_);
+            }
+
+            [[nodiscard]] T operator[](difference_type offset) const noexcept
+            {
+                return *(*this + offset);
+            }
+
+            iterator& operator++() noexcept
+            {
+                position_ += stride_;
+                return *this;
+            }
+
+            iterator operator++(int) noexcept
+            {
+                auto copy = *this;
+                ++*this;
+                return copy;
+            }
+
+            iterator& operator--() noexcept
+            {
+                position_ -= stride_;
+                return *this;
+            }
+
+            iterator operator--(int) noexcept
+            {
+                auto copy = *this;
+                --*this;
+                return copy;
+            }
+
+            iterator& operator+=(difference_type offset) noexcept
+            {
+                position_ += offset * static_cast<difference_type>(stride_);
+                return *this;
+            }
+
+            iterator& operator-=(difference_type offset) noexcept
+            {
+                position_ -= offset * static_cast<difference_type>(stride_);
+                return *this;
+            }
+
+            [[nodiscard]] friend iterator operator+(iterator itr, difference_type offset) noexcept
+            {
+                return itr += offset;
+            }
+
+            [[nodiscard]] friend iterator operator+(difference_type offset, iterator itr) noexcept
+            {
+                return itr += offset;
+            }
+
+            [[nodiscard]] friend iterator operator-(iterator itr, difference_type offset) noexcept
+            {
+                return itr -= offset;
+            }
+
+            [[nodiscard]] friend difference_type operator-(iterator const& lhs, iterator const& rhs) noexcept
+            {
+                return (lhs.position_ - rhs.position_) / static_cast<difference_type>(lhs.stride_);
+            }
+
+            [[nodiscard]] friend bool operator==(iterator const& lhs, iterator const& rhs) noexcept
+            {
+                return lhs.position_ == rhs.position_;
+            }
+
+            [[nodiscard]] friend auto operator<=>(iterator const& lhs, iterator const& rhs) noexcept
+            {
+                return std::compare_three_way{}(lhs.position_, rhs.position_);
+            }
+
+          private:
+            std::byte const* position_ = nullptr;
+            sz stride_ = sizeof(T);
+        };
+
+        packed_view() = default;
+
+        /// <summary>
+        /// Views the given bytes as tightly packed elements. The size of the buffer must be a multiple of sizeof(T)
+        /// </summary>
+        explicit packed_view(std::span<std::byte const> bytes)
+          : packed_view{bytes, bytes.size() / sizeof(T)}
+        {
+            if (bytes.size() % sizeof(T) != 0)
+            {
+                throw exception{error_code::buffer_overflow, module::core, fragment::array, __LINE__,
+                                fmt::format("A buffer of {} bytes is truncated, expected a multiple of {} bytes",
+                                            bytes.size(), sizeof(T))};
+            }
+        }
+
+        /// <summary>
+        /// Views the given number of elements at the start of the given bytes, each stride bytes apart
+        /// </summary>
+        /// <param name="bytes">The buffer to view</param>
+        /// <param name="count">The number of elements</param>
+        /// <param name="stride">The distance in bytes between the start of two elements, at least sizeof(T)</param>
+        packed_view(std::span<std::byte const> bytes, sz count, sz stride = sizeof(T))
+          : data_{bytes.data()}
+          , size_{count}
+          , stride_{stride}
+        {
+            if (stride < sizeof(T))
+            {
+                throw exception{error_code::invalid_argument, module::core, fragment::array, __LINE__,
+                                fmt::format("A stride of {} bytes is smaller than the element size of {} bytes",
+                                            stride, sizeof(T))};
+            }
+
+            auto const required = count == 0 ? 0 : (count - 1) * stride + sizeof(T);
+            if (required > bytes.size())
+            {
+                throw exception{error_code::buffer_overflow, module::core, fragment::array, __LINE__,
+                                fmt::format("{} elements require {} bytes, the buffer holds only {} bytes", count,
+                                            required, bytes.size())};
+            }
+        }
+
+        [[nodiscard]] iterator begin() const noexcept
+        {
+            return {data_, stride_};
+        }
+
+        [[nodiscard]] iterator end() const noexcept
+        {
+            return {data_ + size_ * stride_, stride_};
+        }
+
+        [[nodiscard]] sz size() const noexcept
+        {
+            return size_;
+        }
+
+        [[nodiscard]] sz stride() const noexcept
+        {
+            return stride_;
+        }
+
+        /// <summary>
+        /// Decodes the element at the given index without checking bounds
+        /// </summary>
+        [[nodiscard]] T operator[](sz index) const noexcept
+        {
+            return decode(data_ + index * stride_);
+        }
+
+        /// <summary>
+        /// Decodes the element at the given index. Throws error_code::buffer_overflow if the index is out of bounds
+        /// </summary>
+        [[nodiscard]] T at(sz index) const
+        {
+            if (index >= size_)
+            {
+                throw exception{error_code::buffer_overflow, module::core, fragment::array, __LINE__,
+                                fmt::format("Index {} is out of bounds for a view of {} elements", index, size_)};
+            }
+
+            return (*this)[index];
+        }
+
+        /// <summary>
+        /// Returns a view of count elements starting at the given index
+        /// </summary>
+        [[nodiscard]] packed_view subview(sz offset, sz count) const
+        {
+            if (offset > size_ || count > size_ - offset)
+            {
+                throw exception{error_code::buffer_overflow, module::core, fragment::array, __LINE__,
+                                fmt::format("Elements [{}, {}) are out of bounds for a view of {} elements", offset,
+                                            offset + count, size_)};
+            }
+
+            packed_view view;
+            view.data_ = data_ + offset * stride_;
+            view.size_ = count;
+            view.stride_ = stride_;
+            return view;
+        }
+
+        /// <summary>
+        /// Decodes all elements into the given destination, which must hold at least size() elements. Tightly packed
+        /// elements in non-native byte order are converted using SIMD.
+        /// </summary>
+        /// <returns>The part of the destination that has been written to</returns>
+        std::span<T> decode_into(std::span<T> destination) const
+        {
+            if (destination.size() < size_)
+            {
+                throw exception{error_code::buffer_overflow, module::core, fragment::array, __LINE__,
+                                fmt::format("Can not decode {} elements into a buffer of {} elements", size_,
+                                            destination.size())};
+            }
+
+            if (stride_ == sizeof(T))
+            {
+                impl::copy_ordered<Endian, T>(reinterpret_cast<u8*>(destination.data()),
+                                              reinterpret_cast<u8 const*>(data_), size_);
+            }
+            else
+            {
+                for (sz i = 0; i < size_; ++i)
+                    destination[i] = (*this)[i];
+            }
+
+            return destination.first(size_);
+        }
+
+      private:
+        [[nodiscard]] static T decode(std::byte const* position) noexcept
+        {
+            T value;
+            std::memcpy(&value, position, sizeof(T));
+            if constexpr (Endian != std::endian::native)
+                value = impl::byteswap_any(value);
+
+            return value;
+        }
+
+        std::byte const* data_ = nullptr;
+        sz size_ = 0;
+        sz stride_ = sizeof(T);
+    };
+}
+
+template <typename T, std::endian Endian>
+inline constexpr bool std::ranges::enable_borrowed_range<keycap::packed_view<T, Endian>> = true;
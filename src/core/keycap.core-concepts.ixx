@@ -2,6 +2,8 @@ module;
 
 #include <concepts>
 #include <iterator>
+#include <ranges>
+#include <string_view>
 
 export module keycap.core : concepts;
 
@@ -38,4 +40,11 @@ namespace keycap
         { a.empty() } -> std::same_as<bool>;
             // clang-format on
         };
+
+    /// <summary>
+    /// This concept requires that a given type T is a range whose elements can be viewed as std::string_view
+    /// </summary>
+    export template <typename T>
+    concept string_view_range =
+        std::ranges::input_range<T> && std::convertible_to<std::ranges::range_reference_t<T>, std::string_view>;
 }
@@ -10,16 +10,34 @@ module;
 
 #include <fmt/format.h>
 
-#include <fstream>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <span>
 #include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__GLIBC__) || defined(__APPLE__)
+#include <execinfo.h>
+#endif
+
+#if defined(_MSC_VER)
+#define KEYCAP_NOINLINE __declspec(noinline)
+#else
+#define KEYCAP_NOINLINE __attribute__((noinline))
+#endif
 
 export module keycap.core : error;
 
+import : source;
 import : types;
 
 namespace impl
 {
-    [[nodiscard]] std::string generate_stack_trace();
+    [[nodiscard]] KEYCAP_NOINLINE sz capture_stack_trace(std::span<void*> frames, sz skip) noexcept;
+    [[nodiscard]] std::string resolve_stack_trace(std::span<void* const> frames);
 }
 
 namespace keycap
@@ -86,6 +104,398 @@ namespace keycap
         crypto,
     };
 
+    /// <summary>
+    /// The number of error_codes and modules, i.e. one past their last enumerators. Checked against name_of below.
+    /// </summary>
+    constexpr sz error_code_count = static_cast<sz>(error_code::buffer_overflow) + 1;
+    constexpr sz module_count = static_cast<sz>(module::crypto) + 1;
+}
+
+namespace impl
+{
+    [[nodiscard]] constexpr std::string_view name_of(keycap::error_code error) noexcept
+    {
+        using enum keycap::error_code;
+        switch (error)
+        {
+            case external_api_error:
+                return "external_api_error";
+            case bad_file_path:
+                return "bad_file_path";
+            case bad_file_content:
+                return "bad_file_content";
+            case not_implemented:
+                return "not_implemented";
+            case invalid_argument:
+                return "invalid_argument";
+            case logic_error:
+                return "logic_error";
+            case buffer_overflow:
+                return "buffer_overflow";
+        }
+        return "unknown";
+    }
+
+    [[nodiscard]] constexpr std::string_view name_of(keycap::module module) noexcept
+    {
+        using enum keycap::module;
+        switch (module)
+        {
+            case core:
+                return "core";
+            case window:
+                return "window";
+            case crypto:
+                return "crypto";
+        }
+        return "unknown";
+    }
+
+    // name_of has to name every enumerator, so an enumerator appended after the last counted one shows up here
+    static_assert(name_of(static_cast<keycap::error_code>(keycap::error_code_count - 1)) != "unknown");
+    static_assert(name_of(static_cast<keycap::error_code>(keycap::error_code_count)) == "unknown",
+                  "error_code_count has to be derived from the last error_code");
+    static_assert(name_of(static_cast<keycap::module>(keycap::module_count - 1)) != "unknown");
+    static_assert(name_of(static_cast<keycap::module>(keycap::module_count)) == "unknown",
+                  "module_count has to be derived from the last module");
+
+    /// <summary>
+    /// Maps (module, fragment, error_code) to a counter, the last one counting everything out of range
+    /// </summary>
+    struct error_counter_index
+    {
+        static constexpr sz max_fragments = 32;
+        static constexpr sz unclassified = keycap::module_count * max_fragments * keycap::error_code_count;
+        static constexpr sz size = unclassified + 1;
+
+        [[nodiscard]] static constexpr sz of(keycap::module module, u64 fragment, keycap::error_code error) noexcept
+        {
+            auto const m = static_cast<u64>(module);
+            auto const e = static_cast<u64>(error);
+            if (m >= keycap::module_count || fragment >= max_fragments || e >= keycap::error_code_count)
+                return unclassified;
+
+            return static_cast<sz>((m * max_fragments + fragment) * keycap::error_code_count + e);
+        }
+    };
+
+    /// <summary>
+    /// The error counters of a single thread. Only the owning thread increments them, so they never contend.
+    /// </summary>
+    struct alignas(64) error_counter_shard
+    {
+        std::array<std::atomic<u64>, error_counter_index::size> counts{};
+
+        // Links the shards of all running threads, so that registering a thread does not allocate
+        error_counter_shard* previous = nullptr;
+        error_counter_shard* next = nullptr;
+    };
+
+    /// <summary>
+    /// Keeps track of the shards of all running threads and the sum of the shards of exited ones
+    /// </summary>
+    class error_counter_registry
+    {
+      public:
+        [[nodiscard]] static error_counter_registry& global() noexcept
+        {
+            static error_counter_registry registry;
+            return registry;
+        }
+
+        void attach(error_counter_shard& shard) noexcept
+        {
+            std::scoped_lock lock{mutex_};
+            shard.next = shards_;
+            if (shards_ != nullptr)
+                shards_->previous = &shard;
+            shards_ = &shard;
+        }
+
+        void detach(error_counter_shard& shard) noexcept
+        {
+            std::scoped_lock lock{mutex_};
+            for (sz i = 0; i < shard.counts.size(); ++i)
+            {
+                auto const count = shard.counts[i].load(std::memory_order_relaxed);
+                retired_.counts[i].fetch_add(count, std::memory_order_relaxed);
+            }
+
+            (shard.previous != nullptr ? shard.previous->next : shards_) = shard.next;
+            if (shard.next != nullptr)
+                shard.next->previous = shard.previous;
+        }
+
+        /// <summary>
+        /// Sums up the counters of all shards, zeroing them if requested. No increment is lost when resetting.
+        /// </summary>
+        void collect(std::span<u64, error_counter_index::size> totals, bool reset)
+        {
+            std::scoped_lock lock{mutex_};
+            auto const add = [&](error_counter_shard& shard) {
+                for (sz i = 0; i < totals.size(); ++i)
+                {
+                    totals[i] += reset ? shard.counts[i].exchange(0, std::memory_order_relaxed)
+                                       : shard.counts[i].load(std::memory_order_relaxed);
+                }
+            };
+
+            add(retired_);
+            for (auto* shard = shards_; shard != nullptr; shard = shard->next)
+                add(*shard);
+        }
+
+      private:
+        std::mutex mutex_;
+        error_counter_shard* shards_ = nullptr;
+        error_counter_shard retired_;
+    };
+
+    /// <summary>
+    /// Registers itself on a thread's first error and folds its counts into the registry when the thread exits
+    /// </summary>
+    struct thread_error_counters : error_counter_shard
+    {
+        thread_error_counters() noexcept
+        {
+            error_counter_registry::global().attach(*this);
+        }
+
+        thread_error_counters(thread_error_counters const&) = delete;
+        thread_error_counters& operator=(thread_error_counters const&) = delete;
+
+        ~thread_error_counters()
+        {
+            error_counter_registry::global().detach(*this);
+        }
+    };
+
+    [[nodiscard]] thread_error_counters& local_error_counters() noexcept
+    {
+        thread_local thread_error_counters counters;
+        return counters;
+    }
+}
+
+namespace keycap
+{
+    export class error_telemetry;
+
+    /// <summary>
+    /// How often an error of a given kind occurred
+    /// </summary>
+    export struct error_count
+    {
+        keycap::module module;
+        u64 fragment;
+        error_code error;
+        u64 count;
+    };
+
+    /// <summary>
+    /// A snapshot of the error counters of all threads
+    /// </summary>
+    export class error_counts
+    {
+      public:
+        /// <summary>
+        /// The number of fragments that are counted per module. Errors of higher fragments are only counted as
+        /// unclassified.
+        /// </summary>
+        static constexpr sz max_fragments = impl::error_counter_index::max_fragments;
+
+        /// <summary>
+        /// Returns how often the given error occurred
+        /// </summary>
+        [[nodiscard]] u64 count(keycap::module module, u64 fragment, error_code error) const noexcept
+        {
+            auto const index = impl::error_counter_index::of(module, fragment, error);
+            return index == impl::error_counter_index::unclassified ? 0 : counts_[index];
+        }
+
+        /// <summary>
+        /// Returns how often errors with an unknown module, error_code or a fragment above max_fragments occurred
+        /// </summary>
+        [[nodiscard]] u64 unclassified() const noexcept
+        {
+            return counts_[impl::error_counter_index::unclassified];
+        }
+
+        /// <summary>
+        /// Returns the number of all errors, including unclassified ones
+        /// </summary>
+        [[nodiscard]] u64 total() const noexcept
+        {
+            u64 sum = 0;
+            for (auto const count : counts_)
+                sum += count;
+            return sum;
+        }
+
+        /// <summary>
+        /// Returns all errors that occurred at least once, ordered by module, fragment and error_code
+        /// </summary>
+        [[nodiscard]] std::vector<error_count> entries() const
+        {
+            std::vector<error_count> entries;
+            for (u64 module = 0; module < module_count; ++module)
+            {
+                for (u64 fragment = 0; fragment < max_fragments; ++fragment)
+                {
+                    for (u64 error = 0; error < error_code_count; ++error)
+                    {
+                        auto const m = static_cast<keycap::module>(module);
+                        auto const e = static_cast<error_code>(error);
+                        if (auto const n = count(m, fragment, e); n != 0)
+                            entries.push_back({m, fragment, e, n});
+                    }
+                }
+            }
+            return entries;
+        }
+
+        /// <summary>
+        /// Formats the counts in the Prometheus text exposition format, one line per error that occurred
+        /// </summary>
+        [[nodiscard]] std::string to_text() const
+        {
+            std::string buffer = "# TYPE keycap_errors_total counter\n";
+            for (auto const& entry : entries())
+            {
+                buffer += fmt::format("keycap_errors_total{{module=\"{}\",fragment=\"{}\",error=\"{}\"}} {}\n",
+                                      impl::name_of(entry.module), entry.fragment, impl::name_of(entry.error),
+                                      entry.count);
+            }
+
+            if (auto const n = unclassified(); n != 0)
+                buffer += fmt::format("keycap_errors_total{{module=\"unclassified\"}} {}\n", n);
+
+            return buffer;
+        }
+
+        /// <summary>
+        /// Formats the counts as a JSON object: {"total":n,"unclassified":n,"errors":[{"module":...},...]}
+        /// </summary>
+        [[nodiscard]] std::string to_json() const
+        {
+            auto buffer = fmt::format("{{\"total\":{},\"unclassified\":{},\"errors\":[", total(), unclassified());
+            auto separator = "";
+            for (auto const& entry : entries())
+            {
+                buffer += fmt::format("{}{{\"module\":\"{}\",\"fragment\":{},\"error\":\"{}\",\"count\":{}}}",
+                                      separator, impl::name_of(entry.module), entry.fragment,
+                                      impl::name_of(entry.error), entry.count);
+                separator = ",";
+            }
+            buffer += "]}";
+            return buffer;
+        }
+
+      private:
+        friend class error_telemetry;
+
+        std::array<u64, impl::error_counter_index::size> counts_{};
+    };
+
+    /// <summary>
+    /// Process-wide counters of how often each (module, fragment, error_code) occurred. Every keycap::exception is
+    /// counted on construction. Each thread increments its own counters without locking; snapshots sum up the
+    /// counters of all threads, including those that have exited.
+    /// </summary>
+    export class error_telemetry
+    {
+      public:
+        error_telemetry() = delete;
+
+        /// <summary>
+        /// Counts one occurrence of the given error
+        /// </summary>
+        static void record(keycap::module module, u64 fragment, error_code error) noexcept
+        {
+            auto& counter = impl::local_error_counters().counts[impl::error_counter_index::of(module, fragment, error)];
+            counter.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        /// <summary>
+        /// Returns the current counts. Increments that happen concurrently may or may not be included.
+        /// </summary>
+        [[nodiscard]] static error_counts snapshot()
+        {
+            error_counts counts;
+            impl::error_counter_registry::global().collect(counts.counts_, false);
+            return counts;
+        }
+
+        /// <summary>
+        /// Returns the current counts and starts counting from zero. Every increment is either part of the returned
+        /// snapshot or of the next one.
+        /// </summary>
+        static error_counts snapshot_and_reset()
+        {
+            error_counts counts;
+            impl::error_counter_registry::global().collect(counts.counts_, true);
+            return counts;
+        }
+
+        /// <summary>
+        /// Starts counting from zero
+        /// </summary>
+        static void reset()
+        {
+            (void)snapshot_and_reset();
+        }
+    };
+
+    /// <summary>
+    /// The raw return addresses of a call stack. Capturing them is cheap and does not allocate; symbols and source
+    /// lines are only looked up when the trace is turned into a string.
+    /// </summary>
+    export class captured_stack_trace
+    {
+      public:
+        /// <summary>
+        /// The maximum number of frames that are kept; deeper frames are cut off
+        /// </summary>
+        static constexpr sz max_frames = 32;
+
+        /// <summary>
+        /// Captures the call stack of the caller, skipping the given number of its innermost frames
+        /// </summary>
+        KEYCAP_NOINLINE explicit captured_stack_trace(sz skip = 0) noexcept
+          : size_{impl::capture_stack_trace(frames_, skip + 1)}
+        {
+        }
+
+        /// <summary>
+        /// Returns the captured return addresses, the innermost frame first
+        /// </summary>
+        [[nodiscard]] std::span<void* const> addresses() const noexcept
+        {
+            return std::span{frames_}.first(size_);
+        }
+
+        /// <summary>
+        /// Returns the number of captured frames
+        /// </summary>
+        [[nodiscard]] sz size() const noexcept
+        {
+            return size_;
+        }
+
+        /// <summary>
+        /// Resolves the captured frames to function names and source locations, starting at main. The innermost
+        /// frames are followed by the source lines around their location.
+        /// </summary>
+        [[nodiscard]] std::string to_string() const
+        {
+            return impl::resolve_stack_trace(addresses());
+        }
+
+      private:
+        std::array<void*, max_frames> frames_{};
+        sz size_;
+    };
+
     /// <summary>
     /// An extensive exception providing ample information for error-reporting and debugging
     /// </summary>
@@ -95,17 +505,22 @@ namespace keycap
         keycap::module module;
         u64 fragment;
         u32 line_number;
+
+        // Captured before error_message is moved in, so that the constructor does not tail-call the capture and
+        // thereby vanish from the trace
+        captured_stack_trace stack_trace;
         std::string error_message;
-        std::string stack_trace;
 
-        exception(error_code error, keycap::module module, u64 fragment, u32 line_number, std::string error_message)
+        KEYCAP_NOINLINE exception(error_code error, keycap::module module, u64 fragment, u32 line_number,
+                                  std::string error_message)
           : error{error}
           , module{module}
           , fragment{fragment}
           , line_number{line_number}
+          , stack_trace{1}
           , error_message{std::move(error_message)}
-          , stack_trace(impl::generate_stack_trace())
         {
+            error_telemetry::record(module, fragment, error);
         }
 
         [[nodiscard]] std::string to_string(bool include_stacktrace = false) const
@@ -113,7 +528,7 @@ namespace keycap
             if (include_stacktrace)
             {
                 return fmt::format("Error [{}-{}-{}-{}]: \"{}\"\nStack-trace:\n{}", static_cast<u64>(error), static_cast<u64>(module),
-                                   fragment, line_number, error_message, stack_trace);
+                                   fragment, line_number, error_message, stack_trace.to_string());
             }
             else
             {
@@ -128,48 +543,66 @@ namespace impl
 {
     [[nodiscard]] std::string generate_lines(int num_lines, std::string_view filename, u32 line)
     {
-        std::ifstream file(filename.data());
-        if (!file)
+        // Frames without line information point at line 0
+        if (line == 0)
             return "";
 
-        std::string buffer;
-
-        u32 i = 0;
-        u32 begin_at_line = line - num_lines - 1;
-        u32 end_at_line = line + num_lines + 2;
-
-        for (std::string line_str; std::getline(file, line_str);)
-        {
-            ++i;
-            if (i <= begin_at_line || i >= end_at_line)
-                continue;
-
-            char c = ' ';
-            if (i == line)
-            {
-                c = '>';
-            }
-            buffer += fmt::format("   {} {}:    {}\n", c, i, line_str);
-        }
+        auto const file = keycap::source_cache::global().get(filename);
+        if (!file)
+            return "";
 
-        return buffer;
+        return file->excerpt(line, static_cast<u32>(num_lines));
     }
 
-    [[nodiscard]] std::string generate_stack_trace()
+    sz capture_stack_trace(std::span<void*> frames, sz skip) noexcept
     {
+        // Skip this function as well
+        ++skip;
+
+#if defined(_WIN32)
+        return RtlCaptureStackBackTrace(static_cast<DWORD>(skip), static_cast<DWORD>(frames.size()), frames.data(),
+                                        nullptr);
+#elif defined(__GLIBC__) || defined(__APPLE__)
+        std::array<void*, keycap::captured_stack_trace::max_frames + 8> buffer;
+        auto const captured = static_cast<sz>(::backtrace(buffer.data(), static_cast<int>(buffer.size())));
+        if (captured <= skip)
+            return 0;
+
+        auto const size = std::min(captured - skip, frames.size());
+        std::copy_n(buffer.begin() + skip, size, frames.begin());
+        return size;
+#else
+        // Falls back to backward's unwinder, which allocates
         backward::StackTrace st;
+        st.load_here(frames.size() + skip);
+        if (st.size() <= skip)
+            return 0;
+
+        auto const size = std::min(st.size() - skip, frames.size());
+        for (sz i = 0; i < size; ++i)
+            frames[i] = st[i + skip].addr;
+        return size;
+#endif
+    }
+
+    [[nodiscard]] std::string resolve_stack_trace(std::span<void* const> frames)
+    {
+        // Return addresses point behind the call, which may already belong to the next source line
+        std::array<void*, keycap::captured_stack_trace::max_frames> call_sites;
+        for (sz i = 0; i < frames.size(); ++i)
+            call_sites[i] = static_cast<char*>(frames[i]) - 1;
+
         backward::TraceResolver resolver;
-        st.load_here();
-        resolver.load_stacktrace(st);
+        resolver.load_addresses(call_sites.data(), static_cast<int>(frames.size()));
 
         bool skip = true;
 
         std::string stack_trace_buffer;
         stack_trace_buffer.reserve(512);
 
-        for (size_t i = st.size() - 1; i > 2; --i)
+        for (sz i = frames.size(); i-- > 0;)
         {
-            auto const trace = resolver.resolve(st[i]);
+            auto const trace = resolver.resolve(backward::ResolvedTrace{backward::Trace{call_sites[i], i}});
 
             if (trace.object_function == "main")
             {
@@ -181,13 +614,13 @@ namespace impl
                 continue;
             }
 
-            stack_trace_buffer += fmt::format("#{} at {} ({}:{})\n", i - 3, trace.object_function,
+            stack_trace_buffer += fmt::format("#{} at {} ({}:{})\n", i, trace.object_function,
                                               trace.source.filename, trace.source.line);
 
             int lines_to_print = 0;
-            if (i >= 4 && i <= 5)
+            if (i >= 1 && i <= 2)
                 lines_to_print = 2;
-            if (i == 3)
+            if (i == 0)
                 lines_to_print = 5;
 
             if (lines_to_print > 0)
@@ -0,0 +1,1160 @@
+module;
+
+#include "simd.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+export module keycap.core : flatmap;
+
+import : error;
+import : fragments;
+import : simd;
+import : string;
+import : types;
+
+namespace impl
+{
+    // A control byte per slot: the lower 7 bits of the hash for full slots, or one of the negative markers below
+    using ctrl_t = i8;
+
+    constexpr ctrl_t ctrl_empty = -128;
+    constexpr ctrl_t ctrl_deleted = -2;
+    constexpr ctrl_t ctrl_sentinel = -1;
+
+    constexpr sz group_width = 16;
+
+    // What an empty table points to, so that lookups need no special case for it
+    alignas(group_width) constexpr ctrl_t empty_group[group_width] = {
+        ctrl_sentinel, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty,
+        ctrl_empty,    ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty,
+    };
+
+    /// <summary>
+    /// Matches the control bytes of a group one byte at a time. Each function returns a bitmask with bit i set if the
+    /// i-th control byte matches.
+    /// </summary>
+    struct scalar_group
+    {
+        [[nodiscard]] static u32 match(ctrl_t const* ctrl, ctrl_t h2) noexcept
+        {
+            u32 mask = 0;
+            for (sz i = 0; i < group_width; ++i)
+                mask |= static_cast<u32>(ctrl[i] == h2) << i;
+            return mask;
+        }
+
+        [[nodiscard]] static u32 match_empty(ctrl_t const* ctrl) noexcept
+        {
+            return match(ctrl, ctrl_empty);
+        }
+
+        [[nodiscard]] static u32 match_empty_or_deleted(ctrl_t const* ctrl) noexcept
+        {
+            u32 mask = 0;
+            for (sz i = 0; i < group_width; ++i)
+                mask |= static_cast<u32>(ctrl[i] < ctrl_sentinel) << i;
+            return mask;
+        }
+    };
+
+#if KEYCAP_SIMD_X86
+    /// <summary>
+    /// Matches all control bytes of a group at once
+    /// </summary>
+    struct sse2_group
+    {
+        KEYCAP_TARGET("sse2")
+        [[nodiscard]] static u32 match(ctrl_t const* ctrl, ctrl_t h2) noexcept
+        {
+            auto const group = _mm_loadu_si128(reinterpret_cast<__m128i const*>(ctrl));
+            return static_cast<u32>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), group)));
+        }
+
+        KEYCAP_TARGET("sse2")
+        [[nodiscard]] static u32 match_empty(ctrl_t const* ctrl) noexcept
+        {
+            return match(ctrl, ctrl_empty);
+        }
+
+        KEYCAP_TARGET("sse2")
+        [[nodiscard]] static u32 match_empty_or_deleted(ctrl_t const* ctrl) noexcept
+        {
+            auto const group = _mm_loadu_si128(reinterpret_cast<__m128i const*>(ctrl));
+            return static_cast<u32>(_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(ctrl_sentinel), group)));
+        }
+    };
+#endif
+
+    [[nodiscard]] inline bool use_sse2_groups() noexcept
+    {
+#if KEYCAP_SIMD_X86
+        return keycap::simd::max_instruction_set() >= keycap::simd::instruction_set::sse2;
+#else
+        return false;
+#endif
+    }
+
+    /// <summary>
+    /// Visits the groups a hash probes in turn. The offsets grow triangularly, which visits every group of a table
+    /// whose capacity is one less than a power of two.
+    /// </summary>
+    struct probe_sequence
+    {
+        [[nodiscard]] sz offset(sz i = 0) const noexcept
+        {
+            return (offset_ + i) & mask_;
+        }
+
+        void next() noexcept
+        {
+            index_ += group_width;
+            offset_ = (offset_ + index_) & mask_;
+        }
+
+        sz mask_;
+        sz offset_;
+        sz index_ = 0;
+    };
+
+    /// <summary>
+    /// Finalizes a hash that may have poor entropy in some bits, like std::hash of integers on most implementations
+    /// </summary>
+    [[nodiscard]] constexpr u64 mix_bits(u64 value) noexcept
+    {
+        value ^= value >> 33;
+        value *= 0xFF51AFD7ED558CCD;
+        value ^= value >> 33;
+        value *= 0xC4CEB9FE1A85EC53;
+        value ^= value >> 33;
+        return value;
+    }
+
+    template <typename Key>
+    struct set_policy
+    {
+        using key_type = Key;
+        using value_type = Key;
+        using slot_type = Key;
+        using mutable_value_type = Key;
+
+        static constexpr bool constant_iterators = true;
+
+        [[nodiscard]] static Key const& key(Key const& value) noexcept
+        {
+            return value;
+        }
+
+        [[nodiscard]] static value_type& element(slot_type& slot) noexcept
+        {
+            return slot;
+        }
+    };
+
+    template <typename Key, typename Value>
+    struct map_policy
+    {
+        using key_type = Key;
+        using mapped_type = Value;
+        using value_type = std::pair<Key const, Value>;
+        using mutable_value_type = std::pair<Key, Value>;
+
+        // Slots hold a pair with a mutable key, so that growing the table can move keys instead of copying them. They
+        // are exposed as pair<Key const, Value> like in the standard containers, which have the same layout.
+        using slot_type = mutable_value_type;
+
+        static_assert(sizeof(value_type) == sizeof(slot_type) && alignof(value_type) == alignof(slot_type));
+
+        static constexpr bool constant_iterators = false;
+
+        template <typename Pair>
+        [[nodiscard]] static Key const& key(Pair const& value) noexcept
+        {
+            return value.first;
+        }
+
+        [[nodiscard]] static value_type& element(slot_type& slot) noexcept
+        {
+            return *std::launder(reinterpret_cast<value_type*>(&slot));
+        }
+    };
+
+    template <typename Hash, typename KeyEqual>
+    concept transparent = requires {
+        typename Hash::is_transparent;
+        typename KeyEqual::is_transparent;
+    };
+
+    // Lookups take any key type if the hash and the comparison are transparent, and convert to Key otherwise
+    template <bool Transparent>
+    struct key_arg_selector
+    {
+        template <typename K, typename Key>
+        using type = Key;
+    };
+
+    template <>
+    struct key_arg_selector<true>
+    {
+        template <typename K, typename Key>
+        using type = K;
+    };
+
+    struct string_hash
+    {
+        using is_transparent = void;
+
+        [[nodiscard]] u64 operator()(std::string_view string) const noexcept
+        {
+            return keycap::hash_u64(string);
+        }
+    };
+
+    /// <summary>
+    /// The open-addressing table behind flat_map and flat_set, following the SwissTable design: a separate array of
+    /// control bytes holds 7 bits of each slot's hash. A lookup compares a group of 16 control bytes at once and only
+    /// compares keys whose bits match, which rarely happens more than once.
+    /// </summary>
+    template <typename Policy, typename Hash, typename KeyEqual>
+    class raw_table
+    {
+        using slot_type = typename Policy::slot_type;
+        using mutable_value_type = typename Policy::mutable_value_type;
+
+        template <typename K>
+        using key_arg =
+            typename key_arg_selector<transparent<Hash, KeyEqual>>::template type<K, typename Policy::key_type>;
+
+        template <bool Const>
+        class basic_iterator
+        {
+          public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = typename Policy::value_type;
+            using difference_type = std::ptrdiff_t;
+            using reference = std::conditional_t<Const, value_type const&, value_type&>;
+            using pointer = std::conditional_t<Const, value_type const*, value_type*>;
+
+            basic_iterator() noexcept = default;
+
+            // Converts an iterator to a const_iterator
+            template <bool OtherConst>
+                requires(Const && !OtherConst)
+            basic_iterator(basic_iterator<OtherConst> const& other) noexcept
+              : ctrl_{other.ctrl_}
+              , slot_{other.slot_}
+            {
+            }
+
+            [[nodiscard]] reference operator*() const noexcept
+            {
+                return Policy::element(*slot_);
+            }
+
+            [[nodiscard]] pointer operator->() const noexcept
+            {
+                return &Policy::element(*slot_);
+            }
+
+            basic_iterator& operator++() noexcept
+            {
+                ++ctrl_;
+                ++slot_;
+                skip_empty_slots();
+                return *this;
+            }
+
+            basic_iterator operator++(int) noexcept
+            {
+                auto copy = *this;
+                ++*this;
+                return copy;
+            }
+
+            template <bool OtherConst>
+            [[nodiscard]] bool operator==(basic_iterator<OtherConst> const& other) const noexcept
+            {
+                return ctrl_ == other.ctrl_;
+            }
+
+          private:
+            friend class raw_table;
+            template <bool>
+            friend class basic_iterator;
+
+            basic_iterator(ctrl_t const* ctrl, slot_type* slot) noexcept
+              : ctrl_{ctrl}
+              , slot_{slot}
+            {
+            }
+
+            // The sentinel after the last slot stops the loop
+            void skip_empty_slots() noexcept
+            {
+                while (*ctrl_ < ctrl_sentinel)
+                {
+                    ++ctrl_;
+                    ++slot_;
+                }
+            }
+
+            ctrl_t const* ctrl_ = nullptr;
+            slot_type* slot_ = nullptr;
+        };
+
+      public:
+        using key_type = typename Policy::key_type;
+        using value_type = typename Policy::value_type;
+        using size_type = sz;
+        using difference_type = std::ptrdiff_t;
+        using hasher = Hash;
+        using key_equal = KeyEqual;
+        using reference = value_type&;
+        using const_reference = value_type const&;
+        using pointer = value_type*;
+        using const_pointer = value_type const*;
+        using const_iterator = basic_iterator<true>;
+        using iterator = basic_iterator<Policy::constant_iterators>;
+
+        raw_table() noexcept(std::is_nothrow_default_constructible_v<Hash> &&
+                             std::is_nothrow_default_constructible_v<KeyEqual>) = default;
+
+        explicit raw_table(sz capacity, Hash const& hash = Hash{}, KeyEqual const& equal = KeyEqual{})
+          : hash_{hash}
+          , equal_{equal}
+        {
+            reserve(capacity);
+        }
+
+        template <std::input_iterator Iterator, std::sentinel_for<Iterator> Sentinel>
+        raw_table(Iterator first, Sentinel last, sz capacity = 0, Hash const& hash = Hash{},
+                  KeyEqual const& equal = KeyEqual{})
+          : raw_table(capacity, hash, equal)
+        {
+            insert(first, last);
+        }
+
+        raw_table(std::initializer_list<value_type> values, sz capacity = 0, Hash const& hash = Hash{},
+                  KeyEqual const& equal = KeyEqual{})
+          : raw_table(values.begin(), values.end(), std::max(capacity, values.size()), hash, equal)
+        {
+        }
+
+        raw_table(raw_table const& other)
+          : raw_table(other.size_, other.hash_, other.equal_)
+        {
+            for (auto const& value : other)
+            {
+                auto const index = prepare_insert(hash_of(Policy::key(value)));
+                construct(index, value);
+            }
+        }
+
+        raw_table(raw_table&& other) noexcept(std::is_nothrow_move_constructible_v<Hash> &&
+                                              std::is_nothrow_move_constructible_v<KeyEqual>)
+          : ctrl_{std::exchange(other.ctrl_, const_cast<ctrl_t*>(empty_group))}
+          , slots_{std::exchange(other.slots_, nullptr)}
+          , capacity_{std::exchange(other.capacity_, 0)}
+          , size_{std::exchange(other.size_, 0)}
+          , growth_left_{std::exchange(other.growth_left_, 0)}
+          , hash_{std::move(other.hash_)}
+          , equal_{std::move(other.equal_)}
+        {
+        }
+
+        raw_table& operator=(raw_table const& other)
+        {
+            if (this != &other)
+            {
+                auto copy = other;
+                swap(copy);
+            }
+            return *this;
+        }
+
+        raw_table& operator=(raw_table&& other) noexcept(std::is_nothrow_move_assignable_v<Hash> &&
+                                                         std::is_nothrow_move_assignable_v<KeyEqual>)
+        {
+            if (this != &other)
+            {
+                destroy_and_deallocate();
+                ctrl_ = std::exchange(other.ctrl_, const_cast<ctrl_t*>(empty_group));
+                slots_ = std::exchange(other.slots_, nullptr);
+                capacity_ = std::exchange(other.capacity_, 0);
+                size_ = std::exchange(other.size_, 0);
+                growth_left_ = std::exchange(other.growth_left_, 0);
+                hash_ = std::move(other.hash_);
+                equal_ = std::move(other.equal_);
+            }
+            return *this;
+        }
+
+        ~raw_table()
+        {
+            destroy_and_deallocate();
+        }
+
+        [[nodiscard]] iterator begin() noexcept
+        {
+            auto it = iterator{ctrl_, slots_};
+            it.skip_empty_slots();
+            return it;
+        }
+
+        [[nodiscard]] const_iterator begin() const noexcept
+        {
+            return const_cast<raw_table*>(this)->begin();
+        }
+
+        [[nodiscard]] const_iterator cbegin() const noexcept
+        {
+            return begin();
+        }
+
+        [[nodiscard]] iterator end() noexcept
+        {
+            return iterator{ctrl_ + capacity_, slots_ + capacity_};
+        }
+
+        [[nodiscard]] const_iterator end() const noexcept
+        {
+            return const_cast<raw_table*>(this)->end();
+        }
+
+        [[nodiscard]] const_iterator cend() const noexcept
+        {
+            return end();
+        }
+
+        [[nodiscard]] bool empty() const noexcept
+        {
+            return size_ == 0;
+        }
+
+        [[nodiscard]] sz size() const noexcept
+        {
+            return size_;
+        }
+
+        [[nodiscard]] sz max_size() const noexcept
+        {
+            return std::numeric_limits<sz>::max() / (sizeof(slot_type) + 1) / 2;
+        }
+
+        /// <summary>
+        /// Returns the number of slots, which is always one less than a power of two
+        /// </summary>
+        [[nodiscard]] sz capacity() const noexcept
+        {
+            return capacity_;
+        }
+
+        [[nodiscard]] float load_factor() const noexcept
+        {
+            return capacity_ == 0 ? 0.0f : static_cast<float>(size_) / static_cast<float>(capacity_);
+        }
+
+        /// <summary>
+        /// Returns the load factor at which the table grows. Fixed at 7/8, since the probe sequence stays short even
+        /// for tables that are almost full.
+        /// </summary>
+        [[nodiscard]] static constexpr float max_load_factor() noexcept
+        {
+            return 0.875f;
+        }
+
+        /// <summary>
+        /// Makes room for at least the given number of elements without growing
+        /// </summary>
+        void reserve(sz count)
+        {
+            if (count > growth_left_ + size_)
+                resize(capacity_for(count));
+        }
+
+        /// <summary>
+        /// Rehashes the table into the smallest capacity that can hold both the given number of elements and all
+        /// current elements. Clears all deleted slots. rehash(0) shrinks the table to fit.
+        /// </summary>
+        void rehash(sz count)
+        {
+            auto const capacity = capacity_for(std::max(count, size_));
+            if (capacity != capacity_ || size_ + growth_left_ < growth_for(capacity_))
+                resize(capacity);
+        }
+
+        /// <summary>
+        /// Destroys all elements, but keeps the memory
+        /// </summary>
+        void clear() noexcept
+        {
+            if (capacity_ == 0)
+                return;
+
+            destroy_elements();
+            std::fill_n(ctrl_, capacity_ + group_width, ctrl_empty);
+            ctrl_[capacity_] = ctrl_sentinel;
+            size_ = 0;
+            growth_left_ = growth_for(capacity_);
+        }
+
+        std::pair<iterator, bool> insert(value_type const& value)
+        {
+            return emplace_with_key(Policy::key(value), value);
+        }
+
+        std::pair<iterator, bool> insert(value_type&& value)
+        {
+            return emplace_with_key(Policy::key(value), std::move(value));
+        }
+
+        template <std::input_iterator Iterator, std::sentinel_for<Iterator> Sentinel>
+        void insert(Iterator first, Sentinel last)
+        {
+            if constexpr (std::forward_iterator<Iterator>)
+                reserve(size_ + static_cast<sz>(std::ranges::distance(first, last)));
+
+            for (; first != last; ++first)
+                emplace(*first);
+        }
+
+        void insert(std::initializer_list<value_type> values)
+        {
+            insert(values.begin(), values.end());
+        }
+
+        /// <summary>
+        /// Constructs an element from the given arguments and inserts it, unless an element with the same key exists
+        /// </summary>
+        template <typename... Args>
+        std::pair<iterator, bool> emplace(Args&&... args)
+        {
+            if constexpr (sizeof...(Args) == 1 && (std::same_as<std::remove_cvref_t<Args>, value_type> && ...))
+            {
+                return insert(std::forward<Args>(args)...);
+            }
+            else
+            {
+                mutable_value_type value(std::forward<Args>(args)...);
+                return emplace_with_key(Policy::key(value), std::move(value));
+            }
+        }
+
+        template <typename K = key_type>
+        [[nodiscard]] iterator find(key_arg<K> const& key)
+        {
+            auto const index = find_index(key);
+            return index == capacity_ ? end() : iterator_at(index);
+        }
+
+        template <typename K = key_type>
+        [[nodiscard]] const_iterator find(key_arg<K> const& key) const
+        {
+            return const_cast<raw_table*>(this)->find<K>(key);
+        }
+
+        template <typename K = key_type>
+        [[nodiscard]] bool contains(key_arg<K> const& key) const
+        {
+            return find_index(key) != capacity_;
+        }
+
+        template <typename K = key_type>
+        [[nodiscard]] sz count(key_arg<K> const& key) const
+        {
+            return contains<K>(key) ? 1 : 0;
+        }
+
+        /// <summary>
+        /// Erases the element with the given key, if any
+        /// </summary>
+        /// <returns>The number of erased elements</returns>
+        template <typename K = key_type>
+            requires(!std::convertible_to<K const&, const_iterator>)
+        sz erase(key_arg<K> const& key)
+        {
+            auto const index = find_index(key);
+            if (index == capacity_)
+                return 0;
+
+            erase_at(index);
+            return 1;
+        }
+
+        /// <summary>
+        /// Erases the given element. Does not invalidate any other iterators.
+        /// </summary>
+        /// <returns>An iterator to the element after the erased one</returns>
+        iterator erase(const_iterator position)
+        {
+            auto const index = static_cast<sz>(position.ctrl_ - ctrl_);
+            erase_at(index);
+
+            auto next = iterator{ctrl_ + index, slots_ + index};
+            next.skip_empty_slots();
+            return next;
+        }
+
+        iterator erase(iterator position)
+            requires(!Policy::constant_iterators)
+        {
+            return erase(const_iterator{position});
+        }
+
+        iterator erase(const_iterator first, const_iterator last)
+        {
+            while (first != last)
+                first = erase(first);
+            return iterator{last.ctrl_, last.slot_};
+        }
+
+        void swap(raw_table& other) noexcept(std::is_nothrow_swappable_v<Hash> && std::is_nothrow_swappable_v<KeyEqual>)
+        {
+            using std::swap;
+            swap(ctrl_, other.ctrl_);
+            swap(slots_, other.slots_);
+            swap(capacity_, other.capacity_);
+            swap(size_, other.size_);
+            swap(growth_left_, other.growth_left_);
+            swap(hash_, other.hash_);
+            swap(equal_, other.equal_);
+            swap(sse2_, other.sse2_);
+        }
+
+        friend void swap(raw_table& lhs, raw_table& rhs) noexcept(noexcept(lhs.swap(rhs)))
+        {
+            lhs.swap(rhs);
+        }
+
+        [[nodiscard]] hasher hash_function() const
+        {
+            return hash_;
+        }
+
+        [[nodiscard]] key_equal key_eq() const
+        {
+            return equal_;
+        }
+
+        /// <summary>
+        /// Returns whether both tables contain equal elements, regardless of their order
+        /// </summary>
+        [[nodiscard]] friend bool operator==(raw_table const& lhs, raw_table const& rhs)
+        {
+            if (lhs.size_ != rhs.size_)
+                return false;
+
+            return std::ranges::all_of(lhs, [&](value_type const& value) {
+                auto const it = rhs.find(Policy::key(value));
+                return it != rhs.end() && *it == value;
+            });
+        }
+
+      protected:
+        /// <summary>
+        /// Returns the slot of the element with the given key, inserting one constructed from the given arguments if
+        /// there is none
+        /// </summary>
+        template <typename K, typename... Args>
+        std::pair<iterator, bool> emplace_with_key(K const& key, Args&&... args)
+        {
+            auto const hash = hash_of(key);
+            auto index = find_index(key, hash);
+            if (index != capacity_)
+                return {iterator_at(index), false};
+
+            if (must_grow(hash)) [[unlikely]]
+            {
+                // The arguments may refer to elements, which growing moves, so the new element is constructed first
+                mutable_value_type value(std::forward<Args>(args)...);
+                grow();
+                index = prepare_insert(hash);
+                construct(index, std::move(value));
+            }
+            else
+            {
+                index = prepare_insert(hash);
+                construct(index, std::forward<Args>(args)...);
+            }
+            return {iterator_at(index), true};
+        }
+
+        template <typename K>
+        [[nodiscard]] sz find_index(K const& key) const
+        {
+            return find_index(key, hash_of(key));
+        }
+
+        [[nodiscard]] iterator iterator_at(sz index) noexcept
+        {
+            return iterator{ctrl_ + index, slots_ + index};
+        }
+
+      private:
+        template <typename K>
+        [[nodiscard]] u64 hash_of(K const& key) const
+        {
+            return static_cast<u64>(hash_(key));
+        }
+
+        [[nodiscard]] static constexpr ctrl_t h2(u64 hash) noexcept
+        {
+            return static_cast<ctrl_t>(hash & 0x7F);
+        }
+
+        // Salted with the address of the control bytes, so that inserting the elements of one table into another in
+        // iteration order does not cluster them
+        [[nodiscard]] probe_sequence probe(u64 hash) const noexcept
+        {
+            auto const salt = reinterpret_cast<std::uintptr_t>(ctrl_) >> 12;
+            return probe_sequence{capacity_, static_cast<sz>((hash >> 7) ^ salt) & capacity_};
+        }
+
+        [[nodiscard]] static constexpr sz growth_for(sz capacity) noexcept
+        {
+            return capacity - capacity / 8;
+        }
+
+        [[nodiscard]] static constexpr sz capacity_for(sz count) noexcept
+        {
+            if (count == 0)
+                return 0;
+
+            auto const capacity = std::bit_ceil(count + count / 7 + 1) - 1;
+            return std::max(capacity, group_width - 1);
+        }
+
+        template <typename Function>
+        decltype(auto) dispatch(Function&& function) const
+        {
+#if KEYCAP_SIMD_X86
+            if (sse2_)
+                return function(sse2_group{});
+#endif
+            return function(scalar_group{});
+        }
+
+        template <typename K>
+        [[nodiscard]] sz find_index(K const& key, u64 hash) const
+        {
+            return dispatch([&]<typename Group>(Group) {
+                for (auto sequence = probe(hash);; sequence.next())
+                {
+                    auto const* group = ctrl_ + sequence.offset();
+                    for (auto matches = Group::match(group, h2(hash)); matches != 0; matches &= matches - 1)
+                    {
+                        auto const index = sequence.offset(static_cast<sz>(std::countr_zero(matches)));
+                        if (equal_(Policy::key(slots_[index]), key)) [[likely]]
+                            return index;
+                    }
+
+                    if (Group::match_empty(group) != 0) [[likely]]
+                        return capacity_;
+                }
+            });
+        }
+
+        [[nodiscard]] sz find_first_non_full(u64 hash) const noexcept
+        {
+            return dispatch([&]<typename Group>(Group) {
+                for (auto sequence = probe(hash);; sequence.next())
+                {
+                    auto const mask = Group::match_empty_or_deleted(ctrl_ + sequence.offset());
+                    if (mask != 0)
+                        return sequence.offset(static_cast<sz>(std::countr_zero(mask)));
+                }
+            });
+        }
+
+        // Also writes the copy of the first group's control bytes behind the sentinel, so that probing a group near
+        // the end needs no wrap-around
+        void set_ctrl(sz index, ctrl_t value) noexcept
+        {
+            ctrl_[index] = value;
+            ctrl_[((index - (group_width - 1)) & capacity_) + (group_width - 1)] = value;
+        }
+
+        // Returns whether inserting an element with the given hash has to grow the table first
+        [[nodiscard]] bool must_grow(u64 hash) const noexcept
+        {
+            return growth_left_ == 0 && ctrl_[find_first_non_full(hash)] != ctrl_deleted;
+        }
+
+        // Claims a slot for a new element with the given hash, growing the table if necessary
+        [[nodiscard]] sz prepare_insert(u64 hash)
+        {
+            auto index = find_first_non_full(hash);
+            if (growth_left_ == 0 && ctrl_[index] != ctrl_deleted) [[unlikely]]
+            {
+                grow();
+                index = find_first_non_full(hash);
+            }
+
+            growth_left_ -= ctrl_[index] == ctrl_empty;
+            set_ctrl(index, h2(hash));
+            ++size_;
+            return index;
+        }
+
+        template <typename... Args>
+        void construct(sz index, Args&&... args)
+        {
+            try
+            {
+                ::new (static_cast<void*>(slots_ + index)) slot_type(std::forward<Args>(args)...);
+            }
+            catch (...)
+            {
+                set_ctrl(index, ctrl_deleted);
+                --size_;
+                throw;
+            }
+        }
+
+        // A slot becomes empty again if no group that contains it was ever full, since no probe sequence can have
+        // passed over it. Otherwise it has to stay a tombstone.
+        void erase_at(sz index) noexcept
+        {
+            std::destroy_at(slots_ + index);
+            --size_;
+
+            auto const empty_after = dispatch([&]<typename Group>(Group) { return Group::match_empty(ctrl_ + index); });
+            auto const empty_before = dispatch([&]<typename Group>(Group) {
+                return Group::match_empty(ctrl_ + ((index - group_width) & capacity_));
+            });
+
+            auto const was_never_full = empty_after != 0 && empty_before != 0 &&
+                                        std::countr_zero(static_cast<u16>(empty_after)) +
+                                                std::countl_zero(static_cast<u16>(empty_before)) <
+                                            static_cast<int>(group_width);
+
+            set_ctrl(index, was_never_full ? ctrl_empty : ctrl_deleted);
+            growth_left_ += was_never_full;
+        }
+
+        // Doubles the capacity, unless enough of the table is tombstones that rehashing in place frees enough room
+        void grow()
+        {
+            if (capacity_ > group_width && size_ * 32 <= capacity_ * 25)
+                resize(capacity_);
+            else
+                resize(capacity_ == 0 ? group_width - 1 : capacity_ * 2 + 1);
+        }
+
+        [[nodiscard]] static constexpr sz slots_offset(sz capacity) noexcept
+        {
+            auto const ctrl_size = capacity + group_width;
+            return (ctrl_size + alignof(slot_type) - 1) & ~(alignof(slot_type) - 1);
+        }
+
+        [[nodiscard]] static constexpr std::align_val_t allocation_alignment() noexcept
+        {
+            return std::align_val_t{std::max(alignof(slot_type), group_width)};
+        }
+
+        [[nodiscard]] static constexpr sz allocation_size(sz capacity) noexcept
+        {
+            return slots_offset(capacity) + capacity * sizeof(slot_type);
+        }
+
+        // The old elements are only destroyed once all of them are in the new arrays. If hashing or copying one (for
+        // types that are not nothrow move constructible) throws, the new arrays are discarded and the table keeps its
+        // old elements.
+        void resize(sz capacity)
+        {
+            if (capacity == 0)
+            {
+                destroy_and_deallocate();
+                return;
+            }
+
+            auto* const old_ctrl = ctrl_;
+            auto* const old_slots = slots_;
+            auto const old_capacity = capacity_;
+
+            auto* const memory = static_cast<std::byte*>(::operator new(allocation_size(capacity),
+                                                                        allocation_alignment()));
+            ctrl_ = reinterpret_cast<ctrl_t*>(memory);
+            slots_ = reinterpret_cast<slot_type*>(memory + slots_offset(capacity));
+            capacity_ = capacity;
+            std::fill_n(ctrl_, capacity + group_width, ctrl_empty);
+            ctrl_[capacity] = ctrl_sentinel;
+
+            try
+            {
+                for (sz i = 0; i < old_capacity; ++i)
+                {
+                    if (old_ctrl[i] < 0)
+                        continue;
+
+                    auto const hash = hash_of(Policy::key(old_slots[i]));
+                    auto const index = find_first_non_full(hash);
+                    ::new (static_cast<void*>(slots_ + index)) slot_type(std::move_if_noexcept(old_slots[i]));
+                    set_ctrl(index, h2(hash));
+                }
+            }
+            catch (...)
+            {
+                destroy_elements();
+                ::operator delete(memory, allocation_size(capacity), allocation_alignment());
+                ctrl_ = old_ctrl;
+                slots_ = old_slots;
+                capacity_ = old_capacity;
+                throw;
+            }
+
+            growth_left_ = growth_for(capacity) - size_;
+
+            if (old_capacity != 0)
+            {
+                if constexpr (!std::is_trivially_destructible_v<slot_type>)
+                {
+                    for (sz i = 0; i < old_capacity; ++i)
+                    {
+                        if (old_ctrl[i] >= 0)
+                            std::destroy_at(old_slots + i);
+                    }
+                }
+                ::operator delete(old_ctrl, allocation_size(old_capacity), allocation_alignment());
+            }
+        }
+
+        void destroy_elements() noexcept
+        {
+            if constexpr (!std::is_trivially_destructible_v<slot_type>)
+            {
+                for (sz i = 0; i < capacity_; ++i)
+                {
+                    if (ctrl_[i] >= 0)
+                        std::destroy_at(slots_ + i);
+                }
+            }
+        }
+
+        void destroy_and_deallocate() noexcept
+        {
+            if (capacity_ == 0)
+                return;
+
+            destroy_elements();
+            ::operator delete(ctrl_, allocation_size(capacity_), allocation_alignment());
+            ctrl_ = const_cast<ctrl_t*>(empty_group);
+            slots_ = nullptr;
+            capacity_ = 0;
+            size_ = 0;
+            growth_left_ = 0;
+        }
+
+        ctrl_t* ctrl_ = const_cast<ctrl_t*>(empty_group);
+        slot_type* slots_ = nullptr;
+        sz capacity_ = 0;
+        sz size_ = 0;
+        sz growth_left_ = 0;
+
+        [[no_unique_address]] Hash hash_;
+        [[no_unique_address]] KeyEqual equal_;
+
+        // Chosen once per table, so that lookups do not query the instruction set
+        bool sse2_ = use_sse2_groups();
+    };
+}
+
+namespace keycap
+{
+    /// <summary>
+    /// The default hash of flat_map and flat_set. Uses std::hash, whose result is mixed, since the table relies on all
+    /// bits of the hash being random. Strings are hashed with hash_u64 instead, and the hash is transparent for them:
+    /// a std::string key can be looked up with a std::string_view or a string literal without a temporary string.
+    /// </summary>
+    export template <typename T>
+    struct flat_hash
+    {
+        [[nodiscard]] u64 operator()(T const& value) const noexcept(noexcept(std::hash<T>{}(value)))
+        {
+            return impl::mix_bits(static_cast<u64>(std::hash<T>{}(value)));
+        }
+    };
+
+    template <>
+    struct flat_hash<std::string> : impl::string_hash
+    {
+    };
+
+    template <>
+    struct flat_hash<std::string_view> : impl::string_hash
+    {
+    };
+
+    /// <summary>
+    /// An unordered set stored in one flat array using open addressing. Lookups probe 16 slots at a time (using SSE2
+    /// where available) and usually touch a single cache line of metadata and a single element. Unlike
+    /// std::unordered_set, inserting may move elements and invalidates all iterators and references; erasing only
+    /// invalidates those to the erased element.
+    /// </summary>
+    /// <typeparam name="Key">The type of the elements, which must be move constructible</typeparam>
+    /// <typeparam name="Hash">The hash function. Heterogeneous lookup is enabled if it and KeyEqual are transparent.
+    /// </typeparam>
+    export template <typename Key, typename Hash = flat_hash<Key>, typename KeyEqual = std::equal_to<>>
+        requires std::move_constructible<Key>
+    class flat_set : public impl::raw_table<impl::set_policy<Key>, Hash, KeyEqual>
+    {
+        using base = impl::raw_table<impl::set_policy<Key>, Hash, KeyEqual>;
+
+      public:
+        using base::base;
+    };
+
+    /// <summary>
+    /// An unordered map stored in one flat array using open addressing. Lookups probe 16 slots at a time (using SSE2
+    /// where available) and usually touch a single cache line of metadata and a single element. Unlike
+    /// std::unordered_map, inserting may move elements and invalidates all iterators and references; erasing only
+    /// invalidates those to the erased element.
+    /// </summary>
+    /// <typeparam name="Key">The type of the keys, which must be move constructible</typeparam>
+    /// <typeparam name="Value">The type of the mapped values, which must be move constructible</typeparam>
+    /// <typeparam name="Hash">The hash function. Heterogeneous lookup is enabled if it and KeyEqual are transparent.
+    /// </typeparam>
+    export template <typename Key, typename Value, typename Hash = flat_hash<Key>,
+              typename KeyEqual = std::equal_to<>>
+        requires std::move_constructible<Key> && std::move_constructible<Value>
+    class flat_map : public impl::raw_table<impl::map_policy<Key, Value>, Hash, KeyEqual>
+    {
+        using base = impl::raw_table<impl::map_policy<Key, Value>, Hash, KeyEqual>;
+
+        template <typename K>
+        using key_arg = typename impl::key_arg_selector<impl::transparent<Hash, KeyEqual>>::template type<K, Key>;
+
+        template <typename K>
+        static constexpr bool heterogeneous_key = impl::transparent<Hash, KeyEqual> &&
+                                                  !std::same_as<std::remove_cvref_t<K>, Key> &&
+                                                  !std::convertible_to<K, typename base::const_iterator> &&
+                                                  std::constructible_from<Key, K>;
+
+      public:
+        using mapped_type = Value;
+        using typename base::iterator;
+        using typename base::const_iterator;
+
+        using base::base;
+
+        /// <summary>
+        /// Inserts an element with the given key and a value constructed from the given arguments, unless the key
+        /// exists. Does not construct the value if it does.
+        /// </summary>
+        template <typename... Args>
+        std::pair<iterator, bool> try_emplace(Key const& key, Args&&... args)
+        {
+            return try_emplace_impl(key, std::forward<Args>(args)...);
+        }
+
+        template <typename... Args>
+        std::pair<iterator, bool> try_emplace(Key&& key, Args&&... args)
+        {
+            return try_emplace_impl(std::move(key), std::forward<Args>(args)...);
+        }
+
+        /// <summary>
+        /// Like try_emplace, but only constructs a Key from the given key if it is inserted. Requires a transparent
+        /// hash and comparison.
+        /// </summary>
+        template <typename K, typename... Args>
+            requires heterogeneous_key<K>
+        std::pair<iterator, bool> try_emplace(K&& key, Args&&... args)
+        {
+            return try_emplace_impl(std::forward<K>(key), std::forward<Args>(args)...);
+        }
+
+        /// <summary>
+        /// Inserts the given value under the given key, or assigns it to the existing element with that key
+        /// </summary>
+        template <typename V>
+        std::pair<iterator, bool> insert_or_assign(Key const& key, V&& value)
+        {
+            return insert_or_assign_impl(key, std::forward<V>(value));
+        }
+
+        template <typename V>
+        std::pair<iterator, bool> insert_or_assign(Key&& key, V&& value)
+        {
+            return insert_or_assign_impl(std::move(key), std::forward<V>(value));
+        }
+
+        template <typename K, typename V>
+            requires heterogeneous_key<K>
+        std::pair<iterator, bool> insert_or_assign(K&& key, V&& value)
+        {
+            return insert_or_assign_impl(std::forward<K>(key), std::forward<V>(value));
+        }
+
+        /// <summary>
+        /// Returns the value with the given key, inserting a value initialized one if there is none
+        /// </summary>
+        Value& operator[](Key const& key)
+        {
+            return try_emplace_impl(key).first->second;
+        }
+
+        Value& operator[](Key&& key)
+        {
+            return try_emplace_impl(std::move(key)).first->second;
+        }
+
+        template <typename K>
+            requires heterogeneous_key<K>
+        Value& operator[](K&& key)
+        {
+            return try_emplace_impl(std::forward<K>(key)).first->second;
+        }
+
+        /// <summary>
+        /// Returns the value with the given key. Throws error_code::invalid_argument if there is none.
+        /// </summary>
+        template <typename K = Key>
+        [[nodiscard]] Value& at(key_arg<K> const& key)
+        {
+            auto const it = this->template find<K>(key);
+            if (it == this->end())
+            {
+                throw exception{error_code::invalid_argument, module::core, fragment::flatmap, __LINE__,
+                                "The flat_map does not contain the given key"};
+            }
+            return it->second;
+        }
+
+        template <typename K = Key>
+        [[nodiscard]] Value const& at(key_arg<K> const& key) const
+        {
+            return const_cast<flat_map*>(this)->template at<K>(key);
+        }
+
+      private:
+        template <typename K, typename... Args>
+        std::pair<iterator, bool> try_emplace_impl(K&& key, Args&&... args)
+        {
+            return this->emplace_with_key(key, std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)),
+                                          std::forward_as_tuple(std::forward<Args>(args)...));
+        }
+
+        template <typename K, typename V>
+        std::pair<iterator, bool> insert_or_assign_impl(K&& key, V&& value)
+        {
+            auto result = try_emplace_impl(std::forward<K>(key), std::forward<V>(value));
+            if (!result.second)
+                result.first->second = std::forward<V>(value);
+            return result;
+        }
+    };
+}
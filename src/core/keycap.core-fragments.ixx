@@ -15,5 +15,13 @@ namespace keycap::fragment
         scopeguard,
         string,
         types,
+        perfecthash,
+        array,
+        sampling,
+        grid,
+        parallel,
+        queue,
+        memory,
+        flatmap,
     };
 }
\ No newline at end of file
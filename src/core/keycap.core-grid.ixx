@@ -0,0 +1,617 @@
+module;
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstdlib>
+#include <limits>
+#include <new>
+#include <ranges>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+export module keycap.core : grid;
+
+import : error;
+import : fragments;
+import : math;
+import : types;
+
+namespace keycap
+{
+    /// <summary>
+    /// An allocator whose allocations start at a multiple of the given alignment, e.g. a cache-line for aligned SIMD
+    /// loads
+    /// </summary>
+    export template <typename T, sz Alignment = 64>
+        requires(std::has_single_bit(Alignment))
+    class aligned_allocator
+    {
+      public:
+        using value_type = T;
+
+        static constexpr std::align_val_t alignment{std::max(Alignment, alignof(T))};
+
+        template <typename U>
+        struct rebind
+        {
+            using other = aligned_allocator<U, Alignment>;
+        };
+
+        constexpr aligned_allocator() noexcept = default;
+
+        template <typename U>
+        constexpr aligned_allocator(aligned_allocator<U, Alignment> const&) noexcept
+        {
+        }
+
+        [[nodiscard]] T* allocate(sz count)
+        {
+            if (count > std::numeric_limits<sz>::max() / sizeof(T))
+                throw std::bad_array_new_length{};
+
+            return static_cast<T*>(::operator new(count * sizeof(T), alignment));
+        }
+
+        void deallocate(T* pointer, sz count) noexcept
+        {
+            ::operator delete(pointer, count * sizeof(T), alignment);
+        }
+
+        template <typename U>
+        [[nodiscard]] constexpr bool operator==(aligned_allocator<U, Alignment> const&) const noexcept
+        {
+            return true;
+        }
+    };
+
+    /// <summary>
+    /// Requires that a given type maps the X-, Y- and Z-Coordinates of a grid to indices into its storage and back
+    /// </summary>
+    export template <typename T>
+    concept grid_layout = std::regular<T> && std::constructible_from<T, u32, u32, u32> &&
+                          requires(T const layout, u32 coordinate, u64 index) {
+                              // clang-format off
+        { layout.index(coordinate, coordinate, coordinate) } -> std::same_as<u64>;
+        { layout.coordinates(index) } -> std::same_as<std::array<u32, 3>>;
+        { layout.size() } -> std::same_as<u64>;
+        { T::contiguous_rows } -> std::convertible_to<bool>;
+                              // clang-format on
+                          };
+
+    /// <summary>
+    /// Stores the cells of a grid row after row and slice after slice. Best suited for sweeps along the X-Axis.
+    /// </summary>
+    export class row_major_layout
+    {
+      public:
+        static constexpr bool contiguous_rows = true;
+
+        constexpr row_major_layout() noexcept = default;
+
+        constexpr row_major_layout(u32 width, u32 height, u32 depth) noexcept
+          : width_{width}
+          , slice_size_{u64{width} * height}
+          , size_{slice_size_ * depth}
+        {
+        }
+
+        [[nodiscard]] constexpr u64 index(u32 x, u32 y, u32 z) const noexcept
+        {
+            return z * slice_size_ + u64{y} * width_ + x;
+        }
+
+        [[nodiscard]] constexpr std::array<u32, 3> coordinates(u64 index) const noexcept
+        {
+            auto const in_slice = index % slice_size_;
+            return {static_cast<u32>(in_slice % width_), static_cast<u32>(in_slice / width_),
+                    static_cast<u32>(index / slice_size_)};
+        }
+
+        /// <summary>
+        /// Returns the number of cells required to store the grid
+        /// </summary>
+        [[nodiscard]] constexpr u64 size() const noexcept
+        {
+            return size_;
+        }
+
+        [[nodiscard]] constexpr bool operator==(row_major_layout const&) const noexcept = default;
+
+      private:
+        u32 width_ = 0;
+        u64 slice_size_ = 0;
+        u64 size_ = 0;
+    };
+
+    /// <summary>
+    /// Stores the cells of a grid in tiles of TileWidth * TileHeight * TileDepth cells, see tiled_index. Neighbors
+    /// along every axis mostly share a tile, which suits stencils and sweeps along any axis. Every tile is contiguous
+    /// in memory, but the grid is padded to whole tiles.
+    /// </summary>
+    export template <u32 TileWidth = 8, u32 TileHeight = TileWidth, u32 TileDepth = 1>
+    class tiled_layout
+    {
+      public:
+        using index_type = tiled_index<TileWidth, TileHeight, TileDepth>;
+
+        static constexpr bool contiguous_rows = false;
+        static constexpr u32 tile_width = TileWidth;
+        static constexpr u32 tile_height = TileHeight;
+        static constexpr u32 tile_depth = TileDepth;
+        static constexpr u64 tile_size = index_type::tile_size;
+
+        constexpr tiled_layout() noexcept
+          : tiled_layout{0, 0, 0}
+        {
+        }
+
+        constexpr tiled_layout(u32 width, u32 height, u32 depth) noexcept
+          : index_{width, height}
+          , size_{index_.size(depth)}
+        {
+        }
+
+        [[nodiscard]] constexpr u64 index(u32 x, u32 y, u32 z) const noexcept
+        {
+            return index_(x, y, z);
+        }
+
+        [[nodiscard]] constexpr std::array<u32, 3> coordinates(u64 index) const noexcept
+        {
+            return index_.coordinates(index);
+        }
+
+        /// <summary>
+        /// Returns the number of cells required to store the grid, including the padding
+        /// </summary>
+        [[nodiscard]] constexpr u64 size() const noexcept
+        {
+            return size_;
+        }
+
+        [[nodiscard]] constexpr bool operator==(tiled_layout const&) const noexcept = default;
+
+      private:
+        index_type index_;
+        u64 size_;
+    };
+
+    /// <summary>
+    /// Stores the cells of a grid along a Z-order curve, see morton_encode. Uses 2D codes if the grid has a depth of
+    /// 1 and 3D codes otherwise, which limit every dimension to 2^21 cells. Keeps neighbors close at every scale, but
+    /// pads the grid to the next power of two per dimension, so it works best for square grids of such sizes.
+    /// </summary>
+    export class morton_layout
+    {
+      public:
+        static constexpr bool contiguous_rows = false;
+
+        constexpr morton_layout() noexcept = default;
+
+        constexpr morton_layout(u32 width, u32 height, u32 depth)
+          : three_dimensional_{depth > 1}
+        {
+            constexpr u32 max_extent = 1u << 21;
+            if (three_dimensional_ && (width > max_extent || height > max_extent || depth > max_extent))
+            {
+                throw exception{error_code::invalid_argument, module::core, fragment::grid, __LINE__,
+                                "A three-dimensional morton_layout is limited to 2^21 cells per dimension"};
+            }
+
+            if (width != 0 && height != 0 && depth != 0)
+                size_ = index(width - 1, height - 1, depth - 1) + 1;
+        }
+
+        [[nodiscard]] constexpr u64 index(u32 x, u32 y, u32 z) const noexcept
+        {
+            return three_dimensional_ ? morton_encode(x, y, z) : morton_encode(x, y);
+        }
+
+        [[nodiscard]] constexpr std::array<u32, 3> coordinates(u64 index) const noexcept
+        {
+            if (three_dimensional_)
+                return morton_decode_3d(index);
+
+            auto const [x, y] = morton_decode_2d(index);
+            return {x, y, 0};
+        }
+
+        /// <summary>
+        /// Returns the number of cells required to store the grid, including the padding
+        /// </summary>
+        [[nodiscard]] constexpr u64 size() const noexcept
+        {
+            return size_;
+        }
+
+        [[nodiscard]] constexpr bool operator==(morton_layout const&) const noexcept = default;
+
+      private:
+        bool three_dimensional_ = false;
+        u64 size_ = 0;
+    };
+
+    /// <summary>
+    /// The cells visited by grid::for_each_neighbor
+    /// </summary>
+    export enum class neighborhood
+    {
+        /// <summary>
+        /// The cells sharing a face with the center, i.e. 4 in 2D and 6 in 3D
+        /// </summary>
+        von_neumann,
+
+        /// <summary>
+        /// The cells sharing at least a corner with the center, i.e. 8 in 2D and 26 in 3D
+        /// </summary>
+        moore
+    };
+
+    /// <summary>
+    /// A two- or three-dimensional grid of cells stored in a single, cache-line aligned allocation. The layout decides
+    /// where a cell lives in memory; cells are always addressed by their coordinates.
+    /// Iterating the grid visits every stored cell in memory order, including the padding some layouts require, which
+    /// makes it the fastest way to transform all cells. Use rows() or tiles() to visit cells by their position.
+    /// </summary>
+    /// <typeparam name="T">The type of a cell</typeparam>
+    /// <typeparam name="Layout">row_major_layout, tiled_layout or morton_layout</typeparam>
+    export template <typename T, grid_layout Layout = row_major_layout>
+        requires(!std::same_as<T, bool>)
+    class grid
+    {
+        using storage_type = std::vector<T, aligned_allocator<T>>;
+
+      public:
+        using value_type = T;
+        using layout_type = Layout;
+        using allocator_type = aligned_allocator<T>;
+        using reference = T&;
+        using const_reference = T const&;
+        using iterator = typename storage_type::iterator;
+        using const_iterator = typename storage_type::const_iterator;
+        using difference_type = typename storage_type::difference_type;
+        using size_type = sz;
+
+        grid() = default;
+
+        /// <summary>
+        /// Creates a grid of the given dimensions with every cell, including the padding, set to the given value
+        /// </summary>
+        grid(u32 width, u32 height, u32 depth = 1, T const& value = T{})
+          : width_{width}
+          , height_{height}
+          , depth_{depth}
+          , layout_{width, height, depth}
+          , cells_(static_cast<sz>(layout_.size()), value)
+        {
+        }
+
+        /// <summary>
+        /// Returns the cell at the given coordinates without checking them
+        /// </summary>
+        [[nodiscard]] reference operator()(u32 x, u32 y, u32 z = 0) noexcept
+        {
+            return cells_[static_cast<sz>(layout_.index(x, y, z))];
+        }
+
+        /// <summary>
+        /// Returns the cell at the given coordinates without checking them
+        /// </summary>
+        [[nodiscard]] const_reference operator()(u32 x, u32 y, u32 z = 0) const noexcept
+        {
+            return cells_[static_cast<sz>(layout_.index(x, y, z))];
+        }
+
+        /// <summary>
+        /// Returns the cell at the given coordinates. Throws error_code::buffer_overflow if they are out of bounds.
+        /// </summary>
+        [[nodiscard]] reference at(u32 x, u32 y, u32 z = 0)
+        {
+            require_contains(x, y, z);
+            return (*this)(x, y, z);
+        }
+
+        /// <summary>
+        /// Returns the cell at the given coordinates. Throws error_code::buffer_overflow if they are out of bounds.
+        /// </summary>
+        [[nodiscard]] const_reference at(u32 x, u32 y, u32 z = 0) const
+        {
+            require_contains(x, y, z);
+            return (*this)(x, y, z);
+        }
+
+        /// <summary>
+        /// Returns whether the given coordinates lie within the grid
+        /// </summary>
+        [[nodiscard]] constexpr bool contains(i64 x, i64 y, i64 z = 0) const noexcept
+        {
+            return x >= 0 && y >= 0 && z >= 0 && x < width_ && y < height_ && z < depth_;
+        }
+
+        /// <summary>
+        /// Returns the given row as a contiguous span for row_major_layout and as a random-access view otherwise
+        /// </summary>
+        [[nodiscard]] auto row(u32 y, u32 z = 0) noexcept
+        {
+            return row_of(*this, y, z);
+        }
+
+        /// <summary>
+        /// Returns the given row as a contiguous span for row_major_layout and as a random-access view otherwise
+        /// </summary>
+        [[nodiscard]] auto row(u32 y, u32 z = 0) const noexcept
+        {
+            return row_of(*this, y, z);
+        }
+
+        /// <summary>
+        /// Returns a view of all rows of the given slice, see row()
+        /// </summary>
+        [[nodiscard]] auto rows(u32 z = 0) noexcept
+        {
+            return std::views::iota(u32{0}, height_) | std::views::transform([this, z](u32 y) { return row(y, z); });
+        }
+
+        /// <summary>
+        /// Returns a view of all rows of the given slice, see row()
+        /// </summary>
+        [[nodiscard]] auto rows(u32 z = 0) const noexcept
+        {
+            return std::views::iota(u32{0}, height_) | std::views::transform([this, z](u32 y) { return row(y, z); });
+        }
+
+        /// <summary>
+        /// Returns the cells of the tile containing the given cell, including its padding, in memory order. Only
+        /// available for tiled_layout.
+        /// </summary>
+        [[nodiscard]] std::span<T> tile(u32 x, u32 y, u32 z = 0) noexcept
+            requires requires { Layout::tile_size; }
+        {
+            return {data() + tile_start(x, y, z), static_cast<sz>(Layout::tile_size)};
+        }
+
+        /// <summary>
+        /// Returns the cells of the tile containing the given cell, including its padding, in memory order. Only
+        /// available for tiled_layout.
+        /// </summary>
+        [[nodiscard]] std::span<T const> tile(u32 x, u32 y, u32 z = 0) const noexcept
+            requires requires { Layout::tile_size; }
+        {
+            return {data() + tile_start(x, y, z), static_cast<sz>(Layout::tile_size)};
+        }
+
+        /// <summary>
+        /// Returns a view of all tiles as spans in memory order. layout().coordinates(tile.data() - data()) returns
+        /// the coordinates of a tile's first cell. Only available for tiled_layout.
+        /// </summary>
+        [[nodiscard]] auto tiles() noexcept
+            requires requires { Layout::tile_size; }
+        {
+            return tiles_of(*this);
+        }
+
+        /// <summary>
+        /// Returns a view of all tiles as spans in memory order. Only available for tiled_layout.
+        /// </summary>
+        [[nodiscard]] auto tiles() const noexcept
+            requires requires { Layout::tile_size; }
+        {
+            return tiles_of(*this);
+        }
+
+        /// <summary>
+        /// Calls visit(cell, x, y, z) for every neighbor of the given cell that lies within the grid. Neighbors along
+        /// the Z-Axis are only visited if the grid is three-dimensional, i.e. has a depth greater than 1.
+        /// </summary>
+        template <typename Visitor>
+            requires std::invocable<Visitor&, T&, u32, u32, u32>
+        void for_each_neighbor(u32 x, u32 y, u32 z, neighborhood kind, Visitor&& visit)
+        {
+            visit_neighbors(*this, x, y, z, kind, visit);
+        }
+
+        /// <summary>
+        /// Calls visit(cell, x, y, z) for every neighbor of the given cell that lies within the grid. Neighbors along
+        /// the Z-Axis are only visited if the grid is three-dimensional, i.e. has a depth greater than 1.
+        /// </summary>
+        template <typename Visitor>
+            requires std::invocable<Visitor&, T const&, u32, u32, u32>
+        void for_each_neighbor(u32 x, u32 y, u32 z, neighborhood kind, Visitor&& visit) const
+        {
+            visit_neighbors(*this, x, y, z, kind, visit);
+        }
+
+        /// <summary>
+        /// Sets every cell, including the padding, to the given value
+        /// </summary>
+        void fill(T const& value)
+        {
+            std::ranges::fill(cells_, value);
+        }
+
+        [[nodiscard]] constexpr u32 width() const noexcept
+        {
+            return width_;
+        }
+
+        [[nodiscard]] constexpr u32 height() const noexcept
+        {
+            return height_;
+        }
+
+        [[nodiscard]] constexpr u32 depth() const noexcept
+        {
+            return depth_;
+        }
+
+        /// <summary>
+        /// Returns the number of cells within the grid, i.e. width * height * depth
+        /// </summary>
+        [[nodiscard]] constexpr u64 cell_count() const noexcept
+        {
+            return u64{width_} * height_ * depth_;
+        }
+
+        [[nodiscard]] constexpr Layout const& layout() const noexcept
+        {
+            return layout_;
+        }
+
+        /// <summary>
+        /// Returns the storage, which is aligned to a cache-line
+        /// </summary>
+        [[nodiscard]] T* data() noexcept
+        {
+            return cells_.data();
+        }
+
+        /// <summary>
+        /// Returns the storage, which is aligned to a cache-line
+        /// </summary>
+        [[nodiscard]] T const* data() const noexcept
+        {
+            return cells_.data();
+        }
+
+        [[nodiscard]] iterator begin() noexcept
+        {
+            return cells_.begin();
+        }
+
+        [[nodiscard]] iterator end() noexcept
+        {
+            return cells_.end();
+        }
+
+        [[nodiscard]] const_iterator begin() const noexcept
+        {
+            return cells_.begin();
+        }
+
+        [[nodiscard]] const_iterator end() const noexcept
+        {
+            return cells_.end();
+        }
+
+        [[nodiscard]] const_iterator cbegin() const noexcept
+        {
+            return cells_.cbegin();
+        }
+
+        [[nodiscard]] const_iterator cend() const noexcept
+        {
+            return cells_.cend();
+        }
+
+        /// <summary>
+        /// Returns the number of stored cells, including the padding
+        /// </summary>
+        [[nodiscard]] size_type size() const noexcept
+        {
+            return cells_.size();
+        }
+
+        [[nodiscard]] size_type max_size() const noexcept
+        {
+            return cells_.max_size();
+        }
+
+        [[nodiscard]] bool empty() const noexcept
+        {
+            return cells_.empty();
+        }
+
+        void swap(grid& other) noexcept
+        {
+            std::swap(width_, other.width_);
+            std::swap(height_, other.height_);
+            std::swap(depth_, other.depth_);
+            std::swap(layout_, other.layout_);
+            cells_.swap(other.cells_);
+        }
+
+        friend void swap(grid& lhs, grid& rhs) noexcept
+        {
+            lhs.swap(rhs);
+        }
+
+        [[nodiscard]] bool operator==(grid const&) const = default;
+
+      private:
+        void require_contains(u32 x, u32 y, u32 z) const
+        {
+            if (!contains(x, y, z))
+            {
+                throw exception{error_code::buffer_overflow, module::core, fragment::grid, __LINE__,
+                                "The coordinates lie outside of the grid"};
+            }
+        }
+
+        [[nodiscard]] sz tile_start(u32 x, u32 y, u32 z) const noexcept
+        {
+            return static_cast<sz>(layout_.index(x, y, z) / Layout::tile_size * Layout::tile_size);
+        }
+
+        template <typename Self>
+        [[nodiscard]] static auto row_of(Self& self, u32 y, u32 z) noexcept
+        {
+            if constexpr (Layout::contiguous_rows)
+            {
+                return std::span{self.data() + self.layout_.index(0, y, z), self.width_};
+            }
+            else
+            {
+                return std::views::iota(u32{0}, self.width_) |
+                       std::views::transform([&self, y, z](u32 x) -> auto& { return self(x, y, z); });
+            }
+        }
+
+        template <typename Self>
+        [[nodiscard]] static auto tiles_of(Self& self) noexcept
+        {
+            return std::views::iota(sz{0}, self.size() / Layout::tile_size) |
+                   std::views::transform([&self](sz tile) {
+                       return std::span{self.data() + tile * Layout::tile_size, static_cast<sz>(Layout::tile_size)};
+                   });
+        }
+
+        template <typename Self, typename Visitor>
+        static void visit_neighbors(Self& self, u32 x, u32 y, u32 z, neighborhood kind, Visitor& visit)
+        {
+            auto const reach_z = self.depth_ > 1 ? 1 : 0;
+            for (auto dz = -reach_z; dz <= reach_z; ++dz)
+            {
+                for (auto dy = -1; dy <= 1; ++dy)
+                {
+                    for (auto dx = -1; dx <= 1; ++dx)
+                    {
+                        auto const distance = std::abs(dx) + std::abs(dy) + std::abs(dz);
+                        if (distance == 0 || (kind == neighborhood::von_neumann && distance > 1))
+                            continue;
+
+                        auto const nx = i64{x} + dx;
+                        auto const ny = i64{y} + dy;
+                        auto const nz = i64{z} + dz;
+                        if (!self.contains(nx, ny, nz))
+                            continue;
+
+                        auto const cx = static_cast<u32>(nx);
+                        auto const cy = static_cast<u32>(ny);
+                        auto const cz = static_cast<u32>(nz);
+                        visit(self(cx, cy, cz), cx, cy, cz);
+                    }
+                }
+            }
+        }
+
+        u32 width_ = 0;
+        u32 height_ = 0;
+        u32 depth_ = 0;
+        Layout layout_;
+        storage_type cells_;
+    };
+}
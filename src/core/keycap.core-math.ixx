@@ -1,9 +1,121 @@
 module;
 
+#include "simd.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <concepts>
+#include <span>
+#include <tuple>
+#include <type_traits>
 #include <utility>
 
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// pdep and pext are only available in 64-bit mode. Single Morton codes only use them when compiling for a CPU that
+// has them anyway, since checking for them at runtime costs more than they save. MSVC's /arch:AVX2 implies BMI2.
+#if KEYCAP_SIMD_X86 && (defined(__x86_64__) || defined(_M_X64))
+#define KEYCAP_MORTON_BMI2 1
+#else
+#define KEYCAP_MORTON_BMI2 0
+#endif
+
+#if KEYCAP_MORTON_BMI2 && (defined(__BMI2__) || (defined(_MSC_VER) && defined(__AVX2__)))
+#define KEYCAP_MORTON_BMI2_ALWAYS 1
+#else
+#define KEYCAP_MORTON_BMI2_ALWAYS 0
+#endif
+
 export module keycap.core : math;
 
+import : error;
+import : fragments;
+import : simd;
+import : types;
+
+namespace impl
+{
+    /// <summary>
+    /// Returns the high 64 bits of the 128-bit product of a and b and stores the low 64 bits in low
+    /// </summary>
+    [[nodiscard]] constexpr u64 multiply_high(u64 a, u64 b, u64& low) noexcept
+    {
+        if !consteval
+        {
+#if defined(__SIZEOF_INT128__)
+            __extension__ typedef unsigned __int128 u128;
+            auto const product = static_cast<u128>(a) * b;
+            low = static_cast<u64>(product);
+            return static_cast<u64>(product >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+            u64 high;
+            low = _umul128(a, b, &high);
+            return high;
+#endif
+        }
+
+        u64 const a_low = a & 0xFFFFFFFF, a_high = a >> 32;
+        u64 const b_low = b & 0xFFFFFFFF, b_high = b >> 32;
+
+        u64 const low_low = a_low * b_low;
+        u64 const high_low = a_high * b_low;
+        u64 const low_high = a_low * b_high;
+        u64 const cross = (low_low >> 32) + (high_low & 0xFFFFFFFF) + low_high;
+
+        low = (cross << 32) | (low_low & 0xFFFFFFFF);
+        return a_high * b_high + (high_low >> 32) + (cross >> 32);
+    }
+
+    /// <summary>
+    /// Returns the high half of the double-width product of a and b
+    /// </summary>
+    template <typename T>
+    [[nodiscard]] constexpr T multiply_high(T a, T b) noexcept
+    {
+        if constexpr (sizeof(T) == 8)
+        {
+            u64 low;
+            return multiply_high(a, b, low);
+        }
+        else
+        {
+            return static_cast<T>((static_cast<u64>(a) * b) >> 32);
+        }
+    }
+
+    /// <summary>
+    /// Returns (high * 2^64 + low) / divisor. The quotient has to fit into 64 bits, i.e. high < divisor.
+    /// </summary>
+    [[nodiscard]] constexpr u64 divide_wide(u64 high, u64 low, u64 divisor) noexcept
+    {
+        u64 quotient = 0;
+        for (int bit = 0; bit < 64; ++bit)
+        {
+            auto const carry = high >> 63;
+            high = (high << 1) | (low >> 63);
+            low <<= 1;
+            quotient <<= 1;
+
+            if (carry != 0 || high >= divisor)
+            {
+                high -= divisor;
+                quotient |= 1;
+            }
+        }
+        return quotient;
+    }
+
+    /// <summary>
+    /// Takes the place of the fixed_divisor of a floating point linear_map
+    /// </summary>
+    struct no_divisor
+    {
+    };
+}
+
 namespace keycap
 {
     /// <summary>
@@ -33,4 +145,762 @@ namespace keycap
     {
         return ((value - in_min) * (out_max - out_min) / (in_max - in_min)) + out_min;
     }
+
+    /// <summary>
+    /// Divides by a divisor that is known ahead of time using a multiplication and two shifts instead of a hardware
+    /// division (Granlund and Montgomery's round-up method, as used by libdivide). Worth it as soon as the same
+    /// divisor is used more than a handful of times.
+    /// </summary>
+    /// <example>
+    /// keycap::fixed_divisor<u32> const width{1920};
+    /// auto const row = index / width;
+    /// </example>
+    export template <std::unsigned_integral T>
+        requires(sizeof(T) == 4 || sizeof(T) == 8)
+    class fixed_divisor
+    {
+      public:
+        /// <summary>
+        /// Precomputes the multiplier for the given divisor. Throws error_code::invalid_argument if it is 0.
+        /// </summary>
+        constexpr explicit fixed_divisor(T divisor)
+          : divisor_{divisor}
+        {
+            if (divisor == 0)
+            {
+                throw exception{error_code::invalid_argument, module::core, fragment::math, __LINE__,
+                                "Can not divide by zero"};
+            }
+
+            // shift = ceil(log2(divisor)), multiplier = floor(2^N * (2^shift - divisor) / divisor) + 1
+            shift_ = static_cast<u8>(std::bit_width(static_cast<T>(divisor - 1)));
+            if constexpr (sizeof(T) == 8)
+            {
+                auto const excess = shift_ == 64 ? u64{0} - divisor : (u64{1} << shift_) - divisor;
+                multiplier_ = impl::divide_wide(excess, 0, divisor) + 1;
+            }
+            else
+            {
+                auto const excess = (u64{1} << shift_) - divisor;
+                multiplier_ = static_cast<T>((excess << 32) / divisor + 1);
+            }
+
+            pre_shift_ = std::min<u8>(shift_, 1);
+            post_shift_ = std::max<u8>(shift_, 1) - 1;
+        }
+
+        /// <summary>
+        /// Returns value / divisor()
+        /// </summary>
+        [[nodiscard]] constexpr T divide(T value) const noexcept
+        {
+            auto const high = impl::multiply_high(value, multiplier_);
+            return (high + ((value - high) >> pre_shift_)) >> post_shift_;
+        }
+
+        /// <summary>
+        /// Returns value % divisor()
+        /// </summary>
+        [[nodiscard]] constexpr T modulo(T value) const noexcept
+        {
+            return value - divide(value) * divisor_;
+        }
+
+        [[nodiscard]] friend constexpr T operator/(T value, fixed_divisor const& divisor) noexcept
+        {
+            return divisor.divide(value);
+        }
+
+        [[nodiscard]] friend constexpr T operator%(T value, fixed_divisor const& divisor) noexcept
+        {
+            return divisor.modulo(value);
+        }
+
+        [[nodiscard]] constexpr T divisor() const noexcept
+        {
+            return divisor_;
+        }
+
+        /// <summary>
+        /// The parameters for SIMD code: value / divisor() = (t + ((value - t) >> min(shift(), 1))) >> (max(shift(),
+        /// 1) - 1), where t is the high half of value * multiplier()
+        /// </summary>
+        [[nodiscard]] constexpr T multiplier() const noexcept
+        {
+            return multiplier_;
+        }
+
+        [[nodiscard]] constexpr u8 shift() const noexcept
+        {
+            return shift_;
+        }
+
+      private:
+        T divisor_;
+        T multiplier_ = 0;
+        u8 shift_ = 0;
+        u8 pre_shift_ = 0;
+        u8 post_shift_ = 0;
+    };
+
+    /// <summary>
+    /// Returns the X- and Y-Coordinates of the given index into an array of the given width, just like
+    /// get_coordinates(T, T), but without a hardware division
+    /// </summary>
+    export template <typename T>
+    [[nodiscard]] constexpr std::pair<T, T> get_coordinates(T index, fixed_divisor<T> const& width) noexcept
+    {
+        auto const row = index / width;
+        return {index - row * width.divisor(), row % width};
+    }
+
+    /// <summary>
+    /// Precomputes a linear mapping from the {in_min, in_max} bounds to the {out_min, out_max} bounds. Integers are
+    /// mapped exactly like map does, but divided by a fixed_divisor. Floating point numbers are multiplied by the
+    /// ratio of the bounds instead of being divided, so the result may differ from map in the last digit.
+    /// </summary>
+    export template <typename T>
+        requires std::floating_point<T> || (std::integral<T> && (sizeof(T) == 4 || sizeof(T) == 8))
+    class linear_map
+    {
+      public:
+        /// <summary>
+        /// Throws error_code::invalid_argument if in_min equals in_max
+        /// </summary>
+        constexpr linear_map(T in_min, T in_max, T out_min, T out_max)
+          : in_min_{in_min}
+          , out_min_{out_min}
+          , scale_{make_scale(in_min, in_max, out_min, out_max)}
+          , in_range_{make_divisor(in_min, in_max)}
+          , negative_in_range_{in_max < in_min}
+        {
+        }
+
+        [[nodiscard]] constexpr T operator()(T value) const noexcept
+        {
+            if constexpr (std::floating_point<T>)
+            {
+                return (value - in_min_) * scale_ + out_min_;
+            }
+            else if constexpr (std::unsigned_integral<T>)
+            {
+                return (value - in_min_) * scale_ / in_range_ + out_min_;
+            }
+            else
+            {
+                // Divides the magnitude and truncates towards zero, just like the built-in division
+                using unsigned_type = std::make_unsigned_t<T>;
+                auto const numerator = (value - in_min_) * scale_;
+                auto const magnitude = numerator < 0 ? unsigned_type{0} - static_cast<unsigned_type>(numerator)
+                                                     : static_cast<unsigned_type>(numerator);
+                auto const quotient = magnitude / in_range_;
+                auto const negative = (numerator < 0) != negative_in_range_;
+                return static_cast<T>(negative ? unsigned_type{0} - quotient : quotient) + out_min_;
+            }
+        }
+
+        /// <summary>
+        /// Maps every value into output, which must be of the same size. Vectorized for u32 and f32.
+        /// </summary>
+        void operator()(std::span<T const> values, std::span<T> output) const;
+
+      private:
+        using divisor_type = std::conditional_t<std::floating_point<T>, impl::no_divisor,
+                                                fixed_divisor<std::make_unsigned_t<std::conditional_t<
+                                                    std::floating_point<T>, u32, T>>>>;
+
+        [[nodiscard]] static constexpr T make_scale(T in_min, T in_max, T out_min, T out_max)
+        {
+            if (in_min == in_max)
+            {
+                throw exception{error_code::invalid_argument, module::core, fragment::math, __LINE__,
+                                "The input bounds of a linear_map must not be equal"};
+            }
+
+            if constexpr (std::floating_point<T>)
+                return (out_max - out_min) / (in_max - in_min);
+            else
+                return out_max - out_min;
+        }
+
+        [[nodiscard]] static constexpr divisor_type make_divisor(T in_min, T in_max)
+        {
+            if constexpr (std::floating_point<T>)
+                return {};
+            else if constexpr (std::unsigned_integral<T>)
+                return divisor_type{static_cast<T>(in_max - in_min)};
+            else
+            {
+                auto const range = static_cast<std::make_unsigned_t<T>>(in_max) -
+                                   static_cast<std::make_unsigned_t<T>>(in_min);
+                return divisor_type{in_max < in_min ? std::make_unsigned_t<T>{0} - range : range};
+            }
+        }
+
+        T in_min_;
+        T out_min_;
+        T scale_;
+        [[no_unique_address]] divisor_type in_range_;
+        bool negative_in_range_;
+    };
+}
+
+namespace impl
+{
+    constexpr u64 morton_mask_2d = 0x5555'5555'5555'5555;
+    constexpr u64 morton_mask_3d = 0x1249'2492'4924'9249;
+
+    /// <summary>
+    /// Spreads the bits of the given value so that there is a zero bit between every two of them
+    /// </summary>
+    [[nodiscard]] constexpr u64 spread_bits_2d(u32 value) noexcept
+    {
+        u64 x = value;
+        x = (x | (x << 16)) & 0x0000'FFFF'0000'FFFF;
+        x = (x | (x << 8)) & 0x00FF'00FF'00FF'00FF;
+        x = (x | (x << 4)) & 0x0F0F'0F0F'0F0F'0F0F;
+        x = (x | (x << 2)) & 0x3333'3333'3333'3333;
+        x = (x | (x << 1)) & morton_mask_2d;
+        return x;
+    }
+
+    /// <summary>
+    /// Reverses spread_bits_2d, ignoring every odd bit
+    /// </summary>
+    [[nodiscard]] constexpr u32 compact_bits_2d(u64 x) noexcept
+    {
+        x &= morton_mask_2d;
+        x = (x | (x >> 1)) & 0x3333'3333'3333'3333;
+        x = (x | (x >> 2)) & 0x0F0F'0F0F'0F0F'0F0F;
+        x = (x | (x >> 4)) & 0x00FF'00FF'00FF'00FF;
+        x = (x | (x >> 8)) & 0x0000'FFFF'0000'FFFF;
+        x = (x | (x >> 16)) & 0x0000'0000'FFFF'FFFF;
+        return static_cast<u32>(x);
+    }
+
+    /// <summary>
+    /// Spreads the lower 21 bits of the given value so that there are two zero bits between every two of them
+    /// </summary>
+    [[nodiscard]] constexpr u64 spread_bits_3d(u32 value) noexcept
+    {
+        u64 x = value & 0x1F'FFFF;
+        x = (x | (x << 32)) & 0x001F'0000'0000'FFFF;
+        x = (x | (x << 16)) & 0x001F'0000'FF00'00FF;
+        x = (x | (x << 8)) & 0x100F'00F0'0F00'F00F;
+        x = (x | (x << 4)) & 0x10C3'0C30'C30C'30C3;
+        x = (x | (x << 2)) & morton_mask_3d;
+        return x;
+    }
+
+    /// <summary>
+    /// Reverses spread_bits_3d, ignoring all bits but every third
+    /// </summary>
+    [[nodiscard]] constexpr u32 compact_bits_3d(u64 x) noexcept
+    {
+        x &= morton_mask_3d;
+        x = (x | (x >> 2)) & 0x10C3'0C30'C30C'30C3;
+        x = (x | (x >> 4)) & 0x100F'00F0'0F00'F00F;
+        x = (x | (x >> 8)) & 0x001F'0000'FF00'00FF;
+        x = (x | (x >> 16)) & 0x001F'0000'0000'FFFF;
+        x = (x | (x >> 32)) & 0x0000'0000'001F'FFFF;
+        return static_cast<u32>(x);
+    }
+
+#if KEYCAP_MORTON_BMI2
+    KEYCAP_TARGET("bmi2")
+    inline u64 morton_encode_bmi2(u32 x, u32 y) noexcept
+    {
+        return _pdep_u64(x, morton_mask_2d) | _pdep_u64(y, morton_mask_2d << 1);
+    }
+
+    KEYCAP_TARGET("bmi2")
+    inline u64 morton_encode_bmi2(u32 x, u32 y, u32 z) noexcept
+    {
+        return _pdep_u64(x, morton_mask_3d) | _pdep_u64(y, morton_mask_3d << 1) | _pdep_u64(z, morton_mask_3d << 2);
+    }
+
+    KEYCAP_TARGET("bmi2")
+    inline std::pair<u32, u32> morton_decode_2d_bmi2(u64 code) noexcept
+    {
+        return {static_cast<u32>(_pext_u64(code, morton_mask_2d)),
+                static_cast<u32>(_pext_u64(code, morton_mask_2d << 1))};
+    }
+
+    KEYCAP_TARGET("bmi2")
+    inline std::array<u32, 3> morton_decode_3d_bmi2(u64 code) noexcept
+    {
+        return {static_cast<u32>(_pext_u64(code, morton_mask_3d)),
+                static_cast<u32>(_pext_u64(code, morton_mask_3d << 1)),
+                static_cast<u32>(_pext_u64(code, morton_mask_3d << 2))};
+    }
+#endif
+}
+
+namespace keycap
+{
+    /// <summary>
+    /// Interleaves the bits of the given coordinates into their Morton (Z-order) code. Cells that are close to each
+    /// other in 2D are close to each other in the 1D order, too. Uses BMI2's pdep when compiling for it.
+    /// </summary>
+    export [[nodiscard]] constexpr u64 morton_encode(u32 x, u32 y) noexcept
+    {
+#if KEYCAP_MORTON_BMI2_ALWAYS
+        if !consteval
+        {
+            return impl::morton_encode_bmi2(x, y);
+        }
+#endif
+        return impl::spread_bits_2d(x) | (impl::spread_bits_2d(y) << 1);
+    }
+
+    /// <summary>
+    /// Interleaves the bits of the given coordinates into their Morton (Z-order) code. Only the lower 21 bits of every
+    /// coordinate are kept. Uses BMI2's pdep when compiling for it.
+    /// </summary>
+    export [[nodiscard]] constexpr u64 morton_encode(u32 x, u32 y, u32 z) noexcept
+    {
+#if KEYCAP_MORTON_BMI2_ALWAYS
+        if !consteval
+        {
+            return impl::morton_encode_bmi2(x, y, z);
+        }
+#endif
+        return impl::spread_bits_3d(x) | (impl::spread_bits_3d(y) << 1) | (impl::spread_bits_3d(z) << 2);
+    }
+
+    /// <summary>
+    /// Returns the X- and Y-Coordinates of the given 2D Morton code. Uses BMI2's pext when compiling for it.
+    /// </summary>
+    export [[nodiscard]] constexpr std::pair<u32, u32> morton_decode_2d(u64 code) noexcept
+    {
+#if KEYCAP_MORTON_BMI2_ALWAYS
+        if !consteval
+        {
+            return impl::morton_decode_2d_bmi2(code);
+        }
+#endif
+        return {impl::compact_bits_2d(code), impl::compact_bits_2d(code >> 1)};
+    }
+
+    /// <summary>
+    /// Returns the X-, Y- and Z-Coordinates of the given 3D Morton code. Uses BMI2's pext when compiling for it.
+    /// </summary>
+    export [[nodiscard]] constexpr std::array<u32, 3> morton_decode_3d(u64 code) noexcept
+    {
+#if KEYCAP_MORTON_BMI2_ALWAYS
+        if !consteval
+        {
+            return impl::morton_decode_3d_bmi2(code);
+        }
+#endif
+        return {impl::compact_bits_3d(code), impl::compact_bits_3d(code >> 1), impl::compact_bits_3d(code >> 2)};
+    }
+
+    /// <summary>
+    /// Maps coordinates to indices of a grid that is stored in tiles (blocks) of TileWidth x TileHeight x TileDepth
+    /// cells. The cells of a tile are stored contiguously in row-major order, and so are the tiles themselves. Walking
+    /// a neighborhood then touches a few tiles instead of as many rows. The grid is padded to whole tiles.
+    /// </summary>
+    /// <typeparam name="TileWidth">The width of a tile, must be a power of two</typeparam>
+    /// <typeparam name="TileHeight">The height of a tile, must be a power of two</typeparam>
+    /// <typeparam name="TileDepth">The depth of a tile, must be a power of two. 1 for 2D grids.</typeparam>
+    export template <u32 TileWidth = 8, u32 TileHeight = TileWidth, u32 TileDepth = 1>
+        requires(std::has_single_bit(TileWidth) && std::has_single_bit(TileHeight) && std::has_single_bit(TileDepth))
+    class tiled_index
+    {
+      public:
+        static constexpr u32 tile_width = TileWidth;
+        static constexpr u32 tile_height = TileHeight;
+        static constexpr u32 tile_depth = TileDepth;
+        static constexpr u64 tile_size = u64{TileWidth} * TileHeight * TileDepth;
+
+        /// <summary>
+        /// Creates the indexing for a grid of the given width and height in cells. The depth does not matter.
+        /// </summary>
+        constexpr explicit tiled_index(u32 width, u32 height = 1) noexcept
+          : tiles_per_row_{(u64{width} + TileWidth - 1) / TileWidth}
+          , tiles_per_slice_{tiles_per_row_ * ((u64{height} + TileHeight - 1) / TileHeight)}
+        {
+        }
+
+        /// <summary>
+        /// Returns the index of the cell at the given coordinates
+        /// </summary>
+        [[nodiscard]] constexpr u64 operator()(u32 x, u32 y, u32 z = 0) const noexcept
+        {
+            auto const tile = (z / TileDepth) * tiles_per_slice_ + (y / TileHeight) * tiles_per_row_ + x / TileWidth;
+            auto const cell = (u64{z % TileDepth} * TileHeight + y % TileHeight) * TileWidth + x % TileWidth;
+            return tile * tile_size + cell;
+        }
+
+        /// <summary>
+        /// Returns the X-, Y- and Z-Coordinates of the cell at the given index
+        /// </summary>
+        [[nodiscard]] constexpr std::array<u32, 3> coordinates(u64 index) const noexcept
+        {
+            auto const tile = index / tile_size;
+            auto const cell = index % tile_size;
+            auto const tile_in_slice = tile % tiles_per_slice_;
+
+            return {static_cast<u32>((tile_in_slice % tiles_per_row_) * TileWidth + cell % TileWidth),
+                    static_cast<u32>((tile_in_slice / tiles_per_row_) * TileHeight + (cell / TileWidth) % TileHeight),
+                    static_cast<u32>((tile / tiles_per_slice_) * TileDepth + cell / (u64{TileWidth} * TileHeight))};
+        }
+
+        /// <summary>
+        /// Returns the number of cells required to store a grid of the given depth, including the padding
+        /// </summary>
+        [[nodiscard]] constexpr u64 size(u32 depth = 1) const noexcept
+        {
+            return tiles_per_slice_ * ((u64{depth} + TileDepth - 1) / TileDepth) * tile_size;
+        }
+
+        [[nodiscard]] constexpr bool operator==(tiled_index const&) const noexcept = default;
+
+      private:
+        u64 tiles_per_row_;
+        u64 tiles_per_slice_;
+    };
+}
+
+namespace impl
+{
+    /// <summary>
+    /// Throws error_code::invalid_argument unless all given spans have the same size
+    /// </summary>
+    void require_same_size(sz size, std::same_as<sz> auto... sizes)
+    {
+        if (((sizes != size) || ...))
+        {
+            throw keycap::exception{keycap::error_code::invalid_argument, keycap::module::core, keycap::fragment::math,
+                                    __LINE__, "All spans have to be of the same size"};
+        }
+    }
+
+#if KEYCAP_SIMD_X86
+    /// <summary>
+    /// Returns the high 32 bits of the products of the unsigned 32-bit lanes of a and b
+    /// </summary>
+    KEYCAP_TARGET("avx2")
+    inline __m256i multiply_high_epu32(__m256i a, __m256i b) noexcept
+    {
+        auto const even = _mm256_srli_epi64(_mm256_mul_epu32(a, b), 32);
+        auto const odd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), _mm256_srli_epi64(b, 32));
+        return _mm256_blend_epi32(even, odd, 0b10101010);
+    }
+
+    /// <summary>
+    /// The parameters of a fixed_divisor<u32> broadcast to all lanes
+    /// </summary>
+    struct divisor_avx2
+    {
+        __m256i divisor;
+        __m256i multiplier;
+        __m128i pre_shift;
+        __m128i post_shift;
+    };
+
+    KEYCAP_TARGET("avx2")
+    inline divisor_avx2 broadcast(keycap::fixed_divisor<u32> const& divisor) noexcept
+    {
+        return {_mm256_set1_epi32(static_cast<int>(divisor.divisor())),
+                _mm256_set1_epi32(static_cast<int>(divisor.multiplier())),
+                _mm_cvtsi32_si128(std::min<u8>(divisor.shift(), 1)),
+                _mm_cvtsi32_si128(std::max<u8>(divisor.shift(), 1) - 1)};
+    }
+
+    KEYCAP_TARGET("avx2")
+    inline __m256i divide_epu32(__m256i value, divisor_avx2 const& divisor) noexcept
+    {
+        auto const high = multiply_high_epu32(value, divisor.multiplier);
+        auto const sum = _mm256_add_epi32(high, _mm256_srl_epi32(_mm256_sub_epi32(value, high), divisor.pre_shift));
+        return _mm256_srl_epi32(sum, divisor.post_shift);
+    }
+
+    KEYCAP_TARGET("avx2")
+    sz get_index_avx2(u32 const* x, u32 const* y, u32 width, u32* indices, sz count) noexcept
+    {
+        auto const widths = _mm256_set1_epi32(static_cast<int>(width));
+
+        sz i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            auto const xs = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(x + i));
+            auto const ys = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(y + i));
+            auto const index = _mm256_add_epi32(xs, _mm256_mullo_epi32(ys, widths));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(indices + i), index);
+        }
+        return i;
+    }
+
+    KEYCAP_TARGET("avx2")
+    sz get_coordinates_avx2(u32 const* indices, keycap::fixed_divisor<u32> const& width, u32* x, u32* y,
+                            sz count) noexcept
+    {
+        auto const divisor = broadcast(width);
+
+        sz i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            auto const index = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(indices + i));
+            auto const row = divide_epu32(index, divisor);
+            auto const xs = _mm256_sub_epi32(index, _mm256_mullo_epi32(row, divisor.divisor));
+            auto const ys = _mm256_sub_epi32(row, _mm256_mullo_epi32(divide_epu32(row, divisor), divisor.divisor));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(x + i), xs);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(y + i), ys);
+        }
+        return i;
+    }
+
+    KEYCAP_TARGET("avx2")
+    sz map_avx2(u32 const* values, u32 in_min, u32 scale, keycap::fixed_divisor<u32> const& in_range, u32 out_min,
+                u32* output, sz count) noexcept
+    {
+        auto const divisor = broadcast(in_range);
+        auto const in_mins = _mm256_set1_epi32(static_cast<int>(in_min));
+        auto const scales = _mm256_set1_epi32(static_cast<int>(scale));
+        auto const out_mins = _mm256_set1_epi32(static_cast<int>(out_min));
+
+        sz i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            auto const value = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(values + i));
+            auto const numerator = _mm256_mullo_epi32(_mm256_sub_epi32(value, in_mins), scales);
+            auto const mapped = _mm256_add_epi32(divide_epu32(numerator, divisor), out_mins);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + i), mapped);
+        }
+        return i;
+    }
+
+    KEYCAP_TARGET("avx2")
+    sz map_avx2(f32 const* values, f32 in_min, f32 scale, f32 out_min, f32* output, sz count) noexcept
+    {
+        auto const in_mins = _mm256_set1_ps(in_min);
+        auto const scales = _mm256_set1_ps(scale);
+        auto const out_mins = _mm256_set1_ps(out_min);
+
+        sz i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            auto const value = _mm256_loadu_ps(values + i);
+            _mm256_storeu_ps(output + i, _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(value, in_mins), scales), out_mins));
+        }
+        return i;
+    }
+#endif
+
+#if KEYCAP_MORTON_BMI2
+    KEYCAP_TARGET("bmi2")
+    void morton_encode_bmi2(u32 const* x, u32 const* y, u64* codes, sz count) noexcept
+    {
+        for (sz i = 0; i < count; ++i)
+            codes[i] = morton_encode_bmi2(x[i], y[i]);
+    }
+
+    KEYCAP_TARGET("bmi2")
+    void morton_encode_bmi2(u32 const* x, u32 const* y, u32 const* z, u64* codes, sz count) noexcept
+    {
+        for (sz i = 0; i < count; ++i)
+            codes[i] = morton_encode_bmi2(x[i], y[i], z[i]);
+    }
+
+    KEYCAP_TARGET("bmi2")
+    void morton_decode_2d_bmi2(u64 const* codes, u32* x, u32* y, sz count) noexcept
+    {
+        for (sz i = 0; i < count; ++i)
+            std::tie(x[i], y[i]) = morton_decode_2d_bmi2(codes[i]);
+    }
+
+    KEYCAP_TARGET("bmi2")
+    void morton_decode_3d_bmi2(u64 const* codes, u32* x, u32* y, u32* z, sz count) noexcept
+    {
+        for (sz i = 0; i < count; ++i)
+        {
+            auto const [cx, cy, cz] = morton_decode_3d_bmi2(codes[i]);
+            x[i] = cx;
+            y[i] = cy;
+            z[i] = cz;
+        }
+    }
+
+    /// <summary>
+    /// Returns whether pdep and pext may be used. They are only used alongside AVX2, so that limiting the
+    /// instruction_set to something below it selects the portable code path.
+    /// </summary>
+    [[nodiscard]] bool use_bmi2() noexcept
+    {
+        return keycap::simd::detected_features().bmi2 &&
+               keycap::simd::max_instruction_set() >= keycap::simd::instruction_set::avx2;
+    }
+#endif
+
+    /// <summary>
+    /// Returns whether the AVX2 code paths may be used
+    /// </summary>
+    [[nodiscard]] bool use_avx2() noexcept
+    {
+        return keycap::simd::max_instruction_set() >= keycap::simd::instruction_set::avx2;
+    }
+}
+
+namespace keycap
+{
+    template <typename T>
+        requires std::floating_point<T> || (std::integral<T> && (sizeof(T) == 4 || sizeof(T) == 8))
+    void linear_map<T>::operator()(std::span<T const> values, std::span<T> output) const
+    {
+        impl::require_same_size(output.size(), values.size());
+
+        sz i = 0;
+#if KEYCAP_SIMD_X86
+        if constexpr (std::same_as<T, u32>)
+        {
+            if (impl::use_avx2())
+                i = impl::map_avx2(values.data(), in_min_, scale_, in_range_, out_min_, output.data(), output.size());
+        }
+        else if constexpr (std::same_as<T, f32>)
+        {
+            if (impl::use_avx2())
+                i = impl::map_avx2(values.data(), in_min_, scale_, out_min_, output.data(), output.size());
+        }
+#endif
+        for (; i < output.size(); ++i)
+            output[i] = (*this)(values[i]);
+    }
+
+    /// <summary>
+    /// Computes get_index(x[i], y[i], width) for every i. Vectorized for u32.
+    /// </summary>
+    export template <typename T>
+    void get_index(std::type_identity_t<std::span<T const>> x, std::type_identity_t<std::span<T const>> y,
+                   std::type_identity_t<T> width, std::span<T> indices)
+    {
+        impl::require_same_size(indices.size(), x.size(), y.size());
+
+        sz i = 0;
+#if KEYCAP_SIMD_X86
+        if constexpr (std::same_as<T, u32>)
+        {
+            if (impl::use_avx2())
+                i = impl::get_index_avx2(x.data(), y.data(), width, indices.data(), indices.size());
+        }
+#endif
+        for (; i < indices.size(); ++i)
+            indices[i] = get_index(x[i], y[i], width);
+    }
+
+    /// <summary>
+    /// Computes get_coordinates(indices[i], width) for every i without hardware divisions. Vectorized for u32.
+    /// </summary>
+    export template <std::unsigned_integral T>
+    void get_coordinates(std::type_identity_t<std::span<T const>> indices,
+                         std::type_identity_t<fixed_divisor<T>> const& width, std::span<T> x, std::span<T> y)
+    {
+        impl::require_same_size(indices.size(), x.size(), y.size());
+
+        sz i = 0;
+#if KEYCAP_SIMD_X86
+        if constexpr (std::same_as<T, u32>)
+        {
+            if (impl::use_avx2())
+                i = impl::get_coordinates_avx2(indices.data(), width, x.data(), y.data(), indices.size());
+        }
+#endif
+        for (; i < indices.size(); ++i)
+            std::tie(x[i], y[i]) = get_coordinates(indices[i], width);
+    }
+
+    /// <summary>
+    /// Computes get_coordinates(indices[i], width) for every i without hardware divisions. Vectorized for u32.
+    /// </summary>
+    export template <std::unsigned_integral T>
+    void get_coordinates(std::type_identity_t<std::span<T const>> indices, std::type_identity_t<T> width,
+                         std::span<T> x, std::span<T> y)
+    {
+        get_coordinates<T>(indices, fixed_divisor<T>{width}, x, y);
+    }
+
+    /// <summary>
+    /// Applies the given linear_map to every value. Vectorized for u32 and f32.
+    /// </summary>
+    export template <typename T>
+    void map(std::type_identity_t<std::span<T const>> values, std::type_identity_t<linear_map<T>> const& mapping,
+             std::span<T> output)
+    {
+        mapping(values, output);
+    }
+
+    /// <summary>
+    /// Computes map(values[i], in_min, in_max, out_min, out_max) for every i, see linear_map. Vectorized for u32 and
+    /// f32.
+    /// </summary>
+    export template <typename T>
+    void map(std::type_identity_t<std::span<T const>> values, std::type_identity_t<T> in_min,
+             std::type_identity_t<T> in_max, std::type_identity_t<T> out_min, std::type_identity_t<T> out_max,
+             std::span<T> output)
+    {
+        map<T>(values, linear_map<T>{in_min, in_max, out_min, out_max}, output);
+    }
+
+    /// <summary>
+    /// Computes morton_encode(x[i], y[i]) for every i. Uses BMI2's pdep if the CPU supports it.
+    /// </summary>
+    export void morton_encode(std::span<u32 const> x, std::span<u32 const> y, std::span<u64> codes)
+    {
+        impl::require_same_size(codes.size(), x.size(), y.size());
+#if KEYCAP_MORTON_BMI2
+        if (impl::use_bmi2())
+            return impl::morton_encode_bmi2(x.data(), y.data(), codes.data(), codes.size());
+#endif
+        for (sz i = 0; i < codes.size(); ++i)
+            codes[i] = morton_encode(x[i], y[i]);
+    }
+
+    /// <summary>
+    /// Computes morton_encode(x[i], y[i], z[i]) for every i. Uses BMI2's pdep if the CPU supports it.
+    /// </summary>
+    export void morton_encode(std::span<u32 const> x, std::span<u32 const> y, std::span<u32 const> z,
+                              std::span<u64> codes)
+    {
+        impl::require_same_size(codes.size(), x.size(), y.size(), z.size());
+#if KEYCAP_MORTON_BMI2
+        if (impl::use_bmi2())
+            return impl::morton_encode_bmi2(x.data(), y.data(), z.data(), codes.data(), codes.size());
+#endif
+        for (sz i = 0; i < codes.size(); ++i)
+            codes[i] = morton_encode(x[i], y[i], z[i]);
+    }
+
+    /// <summary>
+    /// Computes morton_decode_2d(codes[i]) for every i. Uses BMI2's pext if the CPU supports it.
+    /// </summary>
+    export void morton_decode_2d(std::span<u64 const> codes, std::span<u32> x, std::span<u32> y)
+    {
+        impl::require_same_size(codes.size(), x.size(), y.size());
+#if KEYCAP_MORTON_BMI2
+        if (impl::use_bmi2())
+            return impl::morton_decode_2d_bmi2(codes.data(), x.data(), y.data(), codes.size());
+#endif
+        for (sz i = 0; i < codes.size(); ++i)
+            std::tie(x[i], y[i]) = morton_decode_2d(codes[i]);
+    }
+
+    /// <summary>
+    /// Computes morton_decode_3d(codes[i]) for every i. Uses BMI2's pext if the CPU supports it.
+    /// </summary>
+    export void morton_decode_3d(std::span<u64 const> codes, std::span<u32> x, std::span<u32> y, std::span<u32> z)
+    {
+        impl::require_same_size(codes.size(), x.size(), y.size(), z.size());
+#if KEYCAP_MORTON_BMI2
+        if (impl::use_bmi2())
+            return impl::morton_decode_3d_bmi2(codes.data(), x.data(), y.data(), z.data(), codes.size());
+#endif
+        for (sz i = 0; i < codes.size(); ++i)
+        {
+            auto const [cx, cy, cz] = morton_decode_3d(codes[i]);
+            x[i] = cx;
+            y[i] = cy;
+            z[i] = cz;
+        }
+    }
 }
@@ -0,0 +1,357 @@
+module;
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <span>
+
+export module keycap.core : memory;
+
+import : error;
+import : fragments;
+import : types;
+
+namespace keycap
+{
+    /// <summary>
+    /// A monotonic memory_resource: allocating bumps a pointer, deallocating does nothing, and all memory is reclaimed
+    /// at once by reset() or release(). Starts in an optional caller-provided buffer and continues in chunks of growing
+    /// size from the upstream resource. Unlike std::pmr::monotonic_buffer_resource, reset() keeps the chunks, so an
+    /// arena that is reset after every request stops allocating from the upstream resource once it is warmed up.
+    /// Not thread-safe.
+    /// </summary>
+    export class arena_resource : public std::pmr::memory_resource
+    {
+      public:
+        static constexpr sz default_chunk_size = 4096;
+
+        /// <summary>
+        /// Creates an arena that allocates all memory from the given upstream resource
+        /// </summary>
+        explicit arena_resource(std::pmr::memory_resource* upstream = std::pmr::get_default_resource()) noexcept
+          : arena_resource{std::span<std::byte>{}, upstream}
+        {
+        }
+
+        /// <summary>
+        /// Creates an arena that starts in the given buffer, which has to outlive it, and continues in chunks from the
+        /// given upstream resource once the buffer is exhausted
+        /// </summary>
+        explicit arena_resource(std::span<std::byte> buffer,
+                                std::pmr::memory_resource* upstream = std::pmr::get_default_resource()) noexcept
+          : upstream_{upstream}
+          , buffer_{buffer}
+          , current_{buffer.data()}
+          , end_{buffer.data() + buffer.size()}
+          , next_chunk_size_{std::max(default_chunk_size, std::bit_ceil(buffer.size()))}
+        {
+        }
+
+        arena_resource(arena_resource const&) = delete;
+        arena_resource& operator=(arena_resource const&) = delete;
+
+        ~arena_resource() override
+        {
+            release();
+        }
+
+        /// <summary>
+        /// Makes all memory available again without returning any chunks to the upstream resource. Invalidates all
+        /// previous allocations.
+        /// </summary>
+        void reset() noexcept
+        {
+            active_ = nullptr;
+            current_ = buffer_.data();
+            end_ = buffer_.data() + buffer_.size();
+            bytes_allocated_ = 0;
+        }
+
+        /// <summary>
+        /// Returns all chunks to the upstream resource and starts over in the initial buffer. Invalidates all previous
+        /// allocations.
+        /// </summary>
+        void release() noexcept
+        {
+            while (chunks_ != nullptr)
+            {
+                auto* const next = chunks_->next;
+                upstream_->deallocate(chunks_, chunks_->size, alignof(std::max_align_t));
+                chunks_ = next;
+            }
+
+            last_ = nullptr;
+            capacity_ = buffer_.size();
+            next_chunk_size_ = std::max(default_chunk_size, std::bit_ceil(buffer_.size()));
+            reset();
+        }
+
+        /// <summary>
+        /// Returns the number of bytes requested since the last reset or release
+        /// </summary>
+        [[nodiscard]] sz bytes_allocated() const noexcept
+        {
+            return bytes_allocated_;
+        }
+
+        /// <summary>
+        /// Returns the size of the initial buffer and all chunks, including their bookkeeping
+        /// </summary>
+        [[nodiscard]] sz capacity() const noexcept
+        {
+            return capacity_;
+        }
+
+        [[nodiscard]] std::pmr::memory_resource* upstream_resource() const noexcept
+        {
+            return upstream_;
+        }
+
+      protected:
+        void* do_allocate(sz bytes, sz alignment) override
+        {
+            if (auto* const memory = bump(bytes, alignment))
+                return memory;
+
+            // Continue in the chunks kept by reset before asking upstream for a new one
+            for (auto* chunk = active_ != nullptr ? active_->next : chunks_; chunk != nullptr; chunk = chunk->next)
+            {
+                enter(chunk);
+                if (auto* const memory = bump(bytes, alignment))
+                    return memory;
+            }
+
+            auto const size = std::max(next_chunk_size_, sizeof(chunk_header) + bytes + alignment);
+            auto* const memory = upstream_->allocate(size, alignof(std::max_align_t));
+            auto* const chunk = ::new (memory) chunk_header{nullptr, size};
+            (last_ != nullptr ? last_->next : chunks_) = chunk;
+            last_ = chunk;
+            capacity_ += size;
+            next_chunk_size_ = size * 2;
+
+            enter(chunk);
+            return bump(bytes, alignment);
+        }
+
+        void do_deallocate(void*, sz, sz) noexcept override
+        {
+        }
+
+        [[nodiscard]] bool do_is_equal(std::pmr::memory_resource const& other) const noexcept override
+        {
+            return this == &other;
+        }
+
+      private:
+        struct alignas(std::max_align_t) chunk_header
+        {
+            chunk_header* next;
+            sz size;
+        };
+
+        void* bump(sz bytes, sz alignment) noexcept
+        {
+            void* memory = current_;
+            auto space = static_cast<sz>(end_ - current_);
+            if (std::align(alignment, bytes, memory, space) == nullptr)
+                return nullptr;
+
+            current_ = static_cast<std::byte*>(memory) + bytes;
+            bytes_allocated_ += bytes;
+            return memory;
+        }
+
+        void enter(chunk_header* chunk) noexcept
+        {
+            active_ = chunk;
+            current_ = reinterpret_cast<std::byte*>(chunk + 1);
+            end_ = reinterpret_cast<std::byte*>(chunk) + chunk->size;
+        }
+
+        std::pmr::memory_resource* upstream_;
+        std::span<std::byte> buffer_;
+
+        std::byte* current_;
+        std::byte* end_;
+
+        // All chunks in the order they were allocated, and the one allocations are currently taken from, if any
+        chunk_header* chunks_ = nullptr;
+        chunk_header* last_ = nullptr;
+        chunk_header* active_ = nullptr;
+
+        sz next_chunk_size_;
+        sz capacity_ = buffer_.size();
+        sz bytes_allocated_ = 0;
+    };
+
+    /// <summary>
+    /// An arena_resource whose initial buffer of the given size is part of the object, e.g. to serve a request from
+    /// the stack
+    /// </summary>
+    export template <sz Size>
+    class inplace_arena_resource : public arena_resource
+    {
+      public:
+        explicit inplace_arena_resource(std::pmr::memory_resource* upstream = std::pmr::get_default_resource()) noexcept
+          : arena_resource{std::span<std::byte>{buffer_}, upstream}
+        {
+        }
+
+      private:
+        alignas(std::max_align_t) std::byte buffer_[Size];
+    };
+
+    /// <summary>
+    /// A memory_resource for objects of a single size, e.g. the nodes of a std::pmr::list or std::pmr::map. Hands out
+    /// blocks of block_size bytes from a free list, which makes allocating and deallocating constant time without
+    /// touching the upstream resource. Allocations that are larger or stricter aligned than a block are forwarded to
+    /// the upstream resource. Blocks are returned to the upstream resource by release() or on destruction.
+    /// Not thread-safe.
+    /// </summary>
+    export class pool_resource : public std::pmr::memory_resource
+    {
+      public:
+        /// <summary>
+        /// Creates a pool of blocks of at least the given size and alignment. Throws error_code::invalid_argument if
+        /// the block size or the number of blocks per chunk is 0, or if the alignment is not a power of two.
+        /// </summary>
+        /// <param name="block_size">The size of the objects to pool</param>
+        /// <param name="blocks_per_chunk">The number of blocks requested from the upstream resource at once</param>
+        explicit pool_resource(sz block_size, sz blocks_per_chunk = 256,
+                               std::pmr::memory_resource* upstream = std::pmr::get_default_resource(),
+                               sz block_alignment = alignof(std::max_align_t))
+          : upstream_{upstream}
+          , block_alignment_{std::max(block_alignment, alignof(free_block))}
+          , blocks_per_chunk_{blocks_per_chunk}
+        {
+            if (block_size == 0 || blocks_per_chunk == 0 || !std::has_single_bit(block_alignment))
+            {
+                throw exception{error_code::invalid_argument, module::core, fragment::memory, __LINE__,
+                                "A pool_resource needs a non-zero block size and number of blocks per chunk, and a "
+                                "power-of-two alignment"};
+            }
+
+            block_size_ = round_up(std::max(block_size, sizeof(free_block)), block_alignment_);
+            header_size_ = round_up(sizeof(chunk_header), block_alignment_);
+        }
+
+        pool_resource(pool_resource const&) = delete;
+        pool_resource& operator=(pool_resource const&) = delete;
+
+        ~pool_resource() override
+        {
+            release();
+        }
+
+        /// <summary>
+        /// Returns all chunks to the upstream resource. Invalidates all blocks, but not the allocations that were
+        /// forwarded to the upstream resource.
+        /// </summary>
+        void release() noexcept
+        {
+            while (chunks_ != nullptr)
+            {
+                auto* const next = chunks_->next;
+                upstream_->deallocate(chunks_, chunk_size(), chunk_alignment());
+                chunks_ = next;
+            }
+            free_ = nullptr;
+        }
+
+        /// <summary>
+        /// Returns the size of a block, i.e. the largest allocation served from the pool
+        /// </summary>
+        [[nodiscard]] sz block_size() const noexcept
+        {
+            return block_size_;
+        }
+
+        [[nodiscard]] sz block_alignment() const noexcept
+        {
+            return block_alignment_;
+        }
+
+        [[nodiscard]] std::pmr::memory_resource* upstream_resource() const noexcept
+        {
+            return upstream_;
+        }
+
+      protected:
+        void* do_allocate(sz bytes, sz alignment) override
+        {
+            if (bytes > block_size_ || alignment > block_alignment_)
+                return upstream_->allocate(bytes, alignment);
+
+            if (free_ == nullptr)
+                refill();
+
+            auto* const block = free_;
+            free_ = block->next;
+            return block;
+        }
+
+        void do_deallocate(void* memory, sz bytes, sz alignment) noexcept override
+        {
+            if (bytes > block_size_ || alignment > block_alignment_)
+            {
+                upstream_->deallocate(memory, bytes, alignment);
+                return;
+            }
+
+            free_ = ::new (memory) free_block{free_};
+        }
+
+        [[nodiscard]] bool do_is_equal(std::pmr::memory_resource const& other) const noexcept override
+        {
+            return this == &other;
+        }
+
+      private:
+        struct free_block
+        {
+            free_block* next;
+        };
+
+        struct chunk_header
+        {
+            chunk_header* next;
+        };
+
+        [[nodiscard]] static sz round_up(sz size, sz alignment) noexcept
+        {
+            return (size + alignment - 1) & ~(alignment - 1);
+        }
+
+        [[nodiscard]] sz chunk_size() const noexcept
+        {
+            return header_size_ + block_size_ * blocks_per_chunk_;
+        }
+
+        [[nodiscard]] sz chunk_alignment() const noexcept
+        {
+            return std::max(block_alignment_, alignof(chunk_header));
+        }
+
+        void refill()
+        {
+            auto* const memory = static_cast<std::byte*>(upstream_->allocate(chunk_size(), chunk_alignment()));
+            chunks_ = ::new (memory) chunk_header{chunks_};
+
+            // Linked back to front, so that the blocks are handed out in address order
+            auto* const blocks = memory + header_size_;
+            for (auto i = blocks_per_chunk_; i-- > 0;)
+                free_ = ::new (blocks + i * block_size_) free_block{free_};
+        }
+
+        std::pmr::memory_resource* upstream_;
+        sz block_size_ = 0;
+        sz block_alignment_;
+        sz blocks_per_chunk_;
+        sz header_size_ = 0;
+
+        chunk_header* chunks_ = nullptr;
+        free_block* free_ = nullptr;
+    };
+}
@@ -0,0 +1,847 @@
+module;
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <concepts>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <ranges>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+export module keycap.core : parallel;
+
+import : error;
+import : fragments;
+import : random;
+import : types;
+
+namespace impl
+{
+    /// <summary>
+    /// A unit of work scheduled by keycap::thread_pool
+    /// </summary>
+    class task
+    {
+      public:
+        virtual ~task() = default;
+
+        /// <summary>
+        /// Runs the task, marks it as done and drops the pool's reference. Must be called exactly once.
+        /// </summary>
+        virtual void run() noexcept = 0;
+
+        [[nodiscard]] bool done() const noexcept
+        {
+            return done_.load(std::memory_order_acquire);
+        }
+
+        /// <summary>
+        /// Blocks the calling thread until the task is done
+        /// </summary>
+        void wait() const noexcept
+        {
+            done_.wait(false, std::memory_order_acquire);
+        }
+
+        /// <summary>
+        /// Drops a reference, deleting the task once both the pool and the handle are done with it
+        /// </summary>
+        void release() noexcept
+        {
+            if (references_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                delete this;
+        }
+
+      protected:
+        void finish() noexcept
+        {
+            done_.store(true, std::memory_order_release);
+            done_.notify_all();
+        }
+
+      private:
+        std::atomic<bool> done_ = false;
+
+        // Held by the pool until the task has run and by its handle
+        std::atomic<u32> references_ = 2;
+    };
+
+    /// <summary>
+    /// The result of a task, or the exception it threw
+    /// </summary>
+    template <typename R>
+    class task_state : public task
+    {
+      public:
+        [[nodiscard]] R get()
+        {
+            if (error_)
+                std::rethrow_exception(error_);
+
+            if constexpr (!std::is_void_v<R>)
+                return std::move(*result_);
+        }
+
+      protected:
+        template <typename F>
+        void invoke(F& function) noexcept
+        {
+            try
+            {
+                if constexpr (std::is_void_v<R>)
+                    function();
+                else
+                    result_.emplace(function());
+            }
+            catch (...)
+            {
+                error_ = std::current_exception();
+            }
+        }
+
+      private:
+        struct no_result
+        {
+        };
+
+        [[no_unique_address]] std::conditional_t<std::is_void_v<R>, no_result, std::optional<R>> result_;
+        std::exception_ptr error_;
+    };
+
+    template <typename R, typename F>
+    class function_task final : public task_state<R>
+    {
+      public:
+        explicit function_task(F&& function)
+          : function_{std::move(function)}
+        {
+        }
+
+        void run() noexcept override
+        {
+            this->invoke(function_);
+            this->finish();
+            this->release();
+        }
+
+      private:
+        F function_;
+    };
+
+    // adapted from "Correct and Efficient Work-Stealing for Weak Memory Models" (Lê, Pop, Cohen, Zappa Nardelli)
+    /// <summary>
+    /// A Chase-Lev work-stealing deque. Its owner pushes and pops at the bottom, while any other thread may steal from
+    /// the top. Grows as needed; retired buffers are kept until destruction, since thieves may still read them.
+    /// Uses sequentially consistent operations instead of fences, which thread sanitizers understand.
+    /// </summary>
+    template <typename T>
+        requires std::is_pointer_v<T>
+    class chase_lev_deque
+    {
+      public:
+        explicit chase_lev_deque(sz capacity = 256)
+        {
+            buffers_.push_back(std::make_unique<buffer>(std::bit_ceil(std::max<sz>(capacity, 2))));
+            buffer_.store(buffers_.back().get(), std::memory_order_relaxed);
+        }
+
+        chase_lev_deque(chase_lev_deque const&) = delete;
+        chase_lev_deque& operator=(chase_lev_deque const&) = delete;
+
+        /// <summary>
+        /// Adds an item at the bottom. May only be called by the owner.
+        /// </summary>
+        void push(T item)
+        {
+            auto const bottom = bottom_.load(std::memory_order_relaxed);
+            auto const top = top_.load(std::memory_order_acquire);
+            auto* buffer = buffer_.load(std::memory_order_relaxed);
+
+            if (bottom - top >= static_cast<i64>(buffer->capacity))
+                buffer = grow(buffer, top, bottom);
+
+            buffer->store(bottom, item);
+            bottom_.store(bottom + 1, std::memory_order_release);
+        }
+
+        /// <summary>
+        /// Removes the item at the bottom, i.e. the one pushed last. Returns nullptr if the deque is empty. May only be
+        /// called by the owner.
+        /// </summary>
+        [[nodiscard]] T pop() noexcept
+        {
+            auto const bottom = bottom_.load(std::memory_order_relaxed) - 1;
+            auto* const buffer = buffer_.load(std::memory_order_relaxed);
+            bottom_.store(bottom, std::memory_order_seq_cst);
+
+            auto top = top_.load(std::memory_order_seq_cst);
+            if (top > bottom)
+            {
+                bottom_.store(bottom + 1, std::memory_order_relaxed);
+                return nullptr;
+            }
+
+            auto item = buffer->load(bottom);
+            if (top == bottom)
+            {
+                // The last item, which a thief may be after as well
+                if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                    item = nullptr;
+                bottom_.store(bottom + 1, std::memory_order_relaxed);
+            }
+            return item;
+        }
+
+        /// <summary>
+        /// Removes the item at the top, i.e. the oldest one. Returns nullptr if the deque is empty or another thread
+        /// got there first. Thread-safe.
+        /// </summary>
+        [[nodiscard]] T steal() noexcept
+        {
+            auto top = top_.load(std::memory_order_seq_cst);
+            auto const bottom = bottom_.load(std::memory_order_seq_cst);
+            if (top >= bottom)
+                return nullptr;
+
+            auto const item = buffer_.load(std::memory_order_acquire)->load(top);
+            if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                return nullptr;
+            return item;
+        }
+
+        /// <summary>
+        /// Returns whether the deque seems empty. The answer may be outdated by the time it is returned.
+        /// </summary>
+        [[nodiscard]] bool empty() const noexcept
+        {
+            return bottom_.load(std::memory_order_relaxed) <= top_.load(std::memory_order_relaxed);
+        }
+
+      private:
+        struct buffer
+        {
+            explicit buffer(sz size)
+              : capacity{size}
+              , slots{std::make_unique<std::atomic<T>[]>(size)}
+            {
+            }
+
+            [[nodiscard]] T load(i64 index) const noexcept
+            {
+                return slots[static_cast<sz>(index) & (capacity - 1)].load(std::memory_order_relaxed);
+            }
+
+            void store(i64 index, T item) noexcept
+            {
+                slots[static_cast<sz>(index) & (capacity - 1)].store(item, std::memory_order_relaxed);
+            }
+
+            sz capacity;
+            std::unique_ptr<std::atomic<T>[]> slots;
+        };
+
+        buffer* grow(buffer* old, i64 top, i64 bottom)
+        {
+            buffers_.push_back(std::make_unique<buffer>(old->capacity * 2));
+            auto* const grown = buffers_.back().get();
+            for (auto i = top; i < bottom; ++i)
+                grown->store(i, old->load(i));
+
+            buffer_.store(grown, std::memory_order_release);
+            return grown;
+        }
+
+        alignas(64) std::atomic<i64> top_ = 0;
+        alignas(64) std::atomic<i64> bottom_ = 0;
+        std::atomic<buffer*> buffer_;
+
+        // Only touched by the owner
+        std::vector<std::unique_ptr<buffer>> buffers_;
+    };
+
+    /// <summary>
+    /// The pool the calling thread works for, if any, and its index within that pool
+    /// </summary>
+    struct worker_context
+    {
+        void const* pool = nullptr;
+        sz index = 0;
+    };
+
+    static thread_local worker_context current_worker;
+}
+
+namespace keycap
+{
+    export template <typename R>
+    class task_handle;
+
+    /// <summary>
+    /// A fixed set of worker threads that run submitted tasks. Every worker owns a Chase-Lev deque: tasks submitted
+    /// by a worker go to its own deque and are run newest-first, while idle workers steal the oldest tasks of others.
+    /// Tasks submitted from other threads go to a shared queue. Idle workers sleep until new work arrives.
+    /// Given a seed, worker i draws the keycap::random functions from stream i of a stream_registry with that seed, so
+    /// the streams are reproducible; which worker runs which task is not. Without a seed, the workers draw like any
+    /// other thread that was not seeded, so no two pools share a stream.
+    /// </summary>
+    export class thread_pool
+    {
+      public:
+        /// <summary>
+        /// Starts the given number of workers. Throws error_code::invalid_argument if it is 0. If starting a worker
+        /// fails, the workers started so far are joined before the error is rethrown.
+        /// </summary>
+        explicit thread_pool(sz thread_count = std::max(1u, std::thread::hardware_concurrency()),
+                             std::optional<u64> seed = std::nullopt)
+        {
+            if (thread_count == 0)
+            {
+                throw exception{error_code::invalid_argument, module::core, fragment::parallel, __LINE__,
+                                "A thread_pool needs at least one thread"};
+            }
+
+            workers_.reserve(thread_count);
+            for (sz i = 0; i < thread_count; ++i)
+                workers_.push_back(std::make_unique<worker>(i));
+
+            std::optional<random::stream_registry> seeded;
+            if (seed)
+                seeded.emplace(*seed);
+            auto& streams = seeded ? *seeded : random::thread_streams();
+
+            threads_.reserve(thread_count);
+            try
+            {
+                for (sz i = 0; i < thread_count; ++i)
+                    threads_.emplace_back([this, i, stream = streams.next_stream()] { work(i, stream); });
+            }
+            catch (...)
+            {
+                // The destructor does not run for a partially constructed pool, and destroying a joinable thread
+                // terminates
+                stop();
+                throw;
+            }
+        }
+
+        thread_pool(thread_pool const&) = delete;
+        thread_pool& operator=(thread_pool const&) = delete;
+
+        /// <summary>
+        /// Runs all queued tasks and joins the workers
+        /// </summary>
+        ~thread_pool()
+        {
+            stop();
+        }
+
+        /// <summary>
+        /// Returns the process-wide pool with one worker per hardware thread
+        /// </summary>
+        [[nodiscard]] static thread_pool& global()
+        {
+            static thread_pool pool;
+            return pool;
+        }
+
+        /// <summary>
+        /// Schedules the given callable and returns a handle to its result
+        /// </summary>
+        template <typename F>
+            requires std::invocable<std::decay_t<F>&>
+        [[nodiscard]] auto submit(F&& function) -> task_handle<std::invoke_result_t<std::decay_t<F>&>>
+        {
+            using result = std::invoke_result_t<std::decay_t<F>&>;
+            using task_type = impl::function_task<result, std::decay_t<F>>;
+
+            auto* const state = new task_type{std::decay_t<F>{std::forward<F>(function)}};
+            task_handle<result> handle{this, state};
+            try
+            {
+                schedule(state);
+            }
+            catch (...)
+            {
+                // The task never runs, so the pool's reference is dropped here
+                state->release();
+                throw;
+            }
+            return handle;
+        }
+
+        /// <summary>
+        /// Returns the number of workers
+        /// </summary>
+        [[nodiscard]] sz thread_count() const noexcept
+        {
+            return workers_.size();
+        }
+
+        /// <summary>
+        /// Returns the index of the calling worker thread, or std::nullopt if it is not a worker of this pool
+        /// </summary>
+        [[nodiscard]] std::optional<sz> worker_index() const noexcept
+        {
+            if (impl::current_worker.pool != this)
+                return std::nullopt;
+            return impl::current_worker.index;
+        }
+
+      private:
+        template <typename R>
+        friend class task_handle;
+
+        struct worker
+        {
+            explicit worker(sz index)
+              : victims{index}
+            {
+            }
+
+            impl::chase_lev_deque<impl::task*> deque;
+
+            // Picks the workers to steal from. Deliberately separate from the worker's keycap::random stream.
+            random::wyrand victims;
+        };
+
+        void schedule(impl::task* task)
+        {
+            if (impl::current_worker.pool == this)
+            {
+                workers_[impl::current_worker.index]->deque.push(task);
+            }
+            else
+            {
+                std::scoped_lock lock{injected_mutex_};
+                injected_.push_back(task);
+                injected_count_.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            wake();
+        }
+
+        /// <summary>
+        /// Lets the workers run out of tasks and joins them
+        /// </summary>
+        void stop() noexcept
+        {
+            stopping_.store(true, std::memory_order_seq_cst);
+            epoch_.fetch_add(1, std::memory_order_seq_cst);
+            epoch_.notify_all();
+
+            for (auto& thread : threads_)
+                thread.join();
+        }
+
+        void wake() noexcept
+        {
+            epoch_.fetch_add(1, std::memory_order_seq_cst);
+            if (sleeping_.load(std::memory_order_seq_cst) > 0)
+                epoch_.notify_one();
+        }
+
+        /// <summary>
+        /// Returns a task of the given worker's own deque, the shared queue or another worker's deque, in that order
+        /// </summary>
+        [[nodiscard]] impl::task* find_task(sz index) noexcept
+        {
+            auto& self = *workers_[index];
+            if (auto* task = self.deque.pop())
+                return task;
+
+            if (injected_count_.load(std::memory_order_relaxed) > 0)
+            {
+                std::scoped_lock lock{injected_mutex_};
+                if (!injected_.empty())
+                {
+                    auto* task = injected_.front();
+                    injected_.pop_front();
+                    injected_count_.fetch_sub(1, std::memory_order_relaxed);
+                    return task;
+                }
+            }
+
+            auto const count = workers_.size();
+            auto const first = static_cast<sz>(self.victims() % count);
+            for (sz i = 0; i < count; ++i)
+            {
+                auto const victim = (first + i) % count;
+                if (victim == index)
+                    continue;
+
+                if (auto* task = workers_[victim]->deque.steal())
+                    return task;
+            }
+            return nullptr;
+        }
+
+        /// <summary>
+        /// Runs a single pending task on the calling worker. Returns false if there was none.
+        /// </summary>
+        bool run_pending_task() noexcept
+        {
+            if (auto* task = find_task(impl::current_worker.index))
+            {
+                task->run();
+                return true;
+            }
+            return false;
+        }
+
+        void work(sz index, random::xoroshiro128plus const& stream)
+        {
+            impl::current_worker = {this, index};
+            random::use_stream(stream);
+
+            constexpr int spins_before_sleeping = 64;
+            while (true)
+            {
+                auto const epoch = epoch_.load(std::memory_order_seq_cst);
+
+                auto* task = find_task(index);
+                for (int spin = 0; task == nullptr && spin < spins_before_sleeping; ++spin)
+                {
+                    std::this_thread::yield();
+                    task = find_task(index);
+                }
+
+                if (task != nullptr)
+                {
+                    task->run();
+                    continue;
+                }
+
+                if (stopping_.load(std::memory_order_seq_cst))
+                    break;
+
+                // Anyone scheduling a task after the search bumps the epoch, so the wait returns right away
+                sleeping_.fetch_add(1, std::memory_order_seq_cst);
+                epoch_.wait(epoch, std::memory_order_seq_cst);
+                sleeping_.fetch_sub(1, std::memory_order_seq_cst);
+            }
+
+            impl::current_worker = {};
+        }
+
+        std::vector<std::unique_ptr<worker>> workers_;
+        std::vector<std::thread> threads_;
+
+        std::mutex injected_mutex_;
+        std::deque<impl::task*> injected_;
+        std::atomic<sz> injected_count_ = 0;
+
+        alignas(64) std::atomic<u64> epoch_ = 0;
+        std::atomic<u32> sleeping_ = 0;
+        std::atomic<bool> stopping_ = false;
+    };
+
+    /// <summary>
+    /// Refers to a task scheduled by a thread_pool. Waiting on a worker thread runs other pending tasks in the
+    /// meantime, so tasks may wait for tasks they submitted without deadlocking the pool. Dropping the handle does
+    /// not cancel the task.
+    /// </summary>
+    export template <typename R>
+    class task_handle
+    {
+      public:
+        task_handle() = default;
+
+        task_handle(task_handle&& other) noexcept
+          : pool_{other.pool_}
+          , state_{std::exchange(other.state_, nullptr)}
+        {
+        }
+
+        task_handle& operator=(task_handle&& other) noexcept
+        {
+            if (this != &other)
+            {
+                if (state_)
+                    state_->release();
+                pool_ = other.pool_;
+                state_ = std::exchange(other.state_, nullptr);
+            }
+            return *this;
+        }
+
+        ~task_handle()
+        {
+            if (state_)
+                state_->release();
+        }
+
+        /// <summary>
+        /// Returns whether the handle refers to a task
+        /// </summary>
+        [[nodiscard]] bool valid() const noexcept
+        {
+            return state_ != nullptr;
+        }
+
+        /// <summary>
+        /// Returns whether the task is done
+        /// </summary>
+        [[nodiscard]] bool ready() const noexcept
+        {
+            return state_->done();
+        }
+
+        /// <summary>
+        /// Waits until the task is done
+        /// </summary>
+        void wait() const noexcept
+        {
+            if (pool_->worker_index())
+            {
+                while (!state_->done())
+                {
+                    if (!pool_->run_pending_task())
+                        std::this_thread::yield();
+                }
+            }
+            else
+            {
+                state_->wait();
+            }
+        }
+
+        /// <summary>
+        /// Waits until the task is done and returns its result, or rethrows the exception it threw
+        /// </summary>
+        R get()
+        {
+            wait();
+            return state_->get();
+        }
+
+      private:
+        friend class thread_pool;
+
+        task_handle(thread_pool* pool, impl::task_state<R>* state) noexcept
+          : pool_{pool}
+          , state_{state}
+        {
+        }
+
+        thread_pool* pool_ = nullptr;
+        impl::task_state<R>* state_ = nullptr;
+    };
+}
+
+namespace impl
+{
+    /// <summary>
+    /// Returns the given grain size, or one that yields about eight chunks per worker if it is 0
+    /// </summary>
+    [[nodiscard]] inline sz grain_size(keycap::thread_pool const& pool, sz size, sz grain, sz minimum = 1) noexcept
+    {
+        if (grain != 0)
+            return grain;
+        return std::max(minimum, size / (8 * pool.thread_count()));
+    }
+
+    /// <summary>
+    /// Runs the given function on a worker of the pool, directly if the calling thread already is one
+    /// </summary>
+    template <typename F>
+    auto run_on(keycap::thread_pool& pool, F&& function)
+    {
+        if (pool.worker_index())
+            return function();
+        return pool.submit(std::forward<F>(function)).get();
+    }
+
+    /// <summary>
+    /// Calls leaf(first, last) for chunks of at most grain elements. Splits the range in halves, handing the upper
+    /// half to the pool, until the chunks are small enough. Has to run on a worker.
+    /// </summary>
+    template <typename Iterator, typename Leaf>
+    void fork_join(keycap::thread_pool& pool, Iterator first, Iterator last, sz grain, Leaf& leaf)
+    {
+        auto const size = static_cast<sz>(last - first);
+        if (size <= grain)
+        {
+            leaf(first, last);
+            return;
+        }
+
+        auto const middle = first + static_cast<std::iter_difference_t<Iterator>>(size / 2);
+        auto upper = pool.submit([&pool, middle, last, grain, &leaf] {
+            impl::fork_join(pool, middle, last, grain, leaf);
+        });
+
+        try
+        {
+            impl::fork_join(pool, first, middle, grain, leaf);
+        }
+        catch (...)
+        {
+            // The upper half refers to leaf, so it has to finish first
+            upper.wait();
+            throw;
+        }
+        upper.get();
+    }
+
+    template <typename T, typename Iterator, typename Reduce>
+    T reduce(keycap::thread_pool& pool, Iterator first, Iterator last, sz grain, T const& identity, Reduce& reduce)
+    {
+        auto const size = static_cast<sz>(last - first);
+        if (size <= grain)
+            return std::accumulate(first, last, identity, std::ref(reduce));
+
+        auto const middle = first + static_cast<std::iter_difference_t<Iterator>>(size / 2);
+        auto upper = pool.submit([&pool, middle, last, grain, &identity, &reduce] {
+            return impl::reduce(pool, middle, last, grain, identity, reduce);
+        });
+
+        std::optional<T> lower;
+        try
+        {
+            lower.emplace(impl::reduce(pool, first, middle, grain, identity, reduce));
+        }
+        catch (...)
+        {
+            upper.wait();
+            throw;
+        }
+        return std::invoke(reduce, std::move(*lower), upper.get());
+    }
+
+    template <typename Iterator, typename Compare>
+    void sort(keycap::thread_pool& pool, Iterator first, Iterator last, sz grain, Compare& compare)
+    {
+        auto const size = static_cast<sz>(last - first);
+        if (size <= grain)
+        {
+            std::sort(first, last, std::ref(compare));
+            return;
+        }
+
+        auto const middle = first + static_cast<std::iter_difference_t<Iterator>>(size / 2);
+        auto upper = pool.submit([&pool, middle, last, grain, &compare] {
+            impl::sort(pool, middle, last, grain, compare);
+        });
+
+        try
+        {
+            impl::sort(pool, first, middle, grain, compare);
+        }
+        catch (...)
+        {
+            upper.wait();
+            throw;
+        }
+        upper.get();
+
+        std::inplace_merge(first, middle, last, std::ref(compare));
+    }
+}
+
+namespace keycap
+{
+    /// <summary>
+    /// Calls function(element) for every element of the given range on the workers of the given pool. The range is
+    /// split into chunks of at most grain elements; a grain of 0 picks about eight chunks per worker. Rethrows the
+    /// first exception thrown by the function once all chunks are done.
+    /// </summary>
+    export template <std::ranges::random_access_range Range, typename Function>
+        requires std::invocable<Function&, std::ranges::range_reference_t<Range>>
+    void parallel_for(thread_pool& pool, Range&& range, Function function, sz grain = 0)
+    {
+        auto const first = std::ranges::begin(range);
+        auto const last = first + std::ranges::distance(range);
+        auto const size = static_cast<sz>(last - first);
+        if (size == 0)
+            return;
+
+        auto leaf = [&function](auto chunk_first, auto chunk_last) {
+            for (; chunk_first != chunk_last; ++chunk_first)
+                std::invoke(function, *chunk_first);
+        };
+        impl::run_on(pool, [&] { impl::fork_join(pool, first, last, impl::grain_size(pool, size, grain), leaf); });
+    }
+
+    /// <summary>
+    /// Calls function(element) for every element of the given range on the workers of thread_pool::global()
+    /// </summary>
+    export template <std::ranges::random_access_range Range, typename Function>
+        requires std::invocable<Function&, std::ranges::range_reference_t<Range>>
+    void parallel_for(Range&& range, Function function, sz grain = 0)
+    {
+        parallel_for(thread_pool::global(), std::forward<Range>(range), std::move(function), grain);
+    }
+
+    /// <summary>
+    /// Combines all elements of the given range using the given associative operation on the workers of the given
+    /// pool, starting every chunk of at most grain elements from identity. The chunks and the order in which their
+    /// results are combined only depend on the size of the range and the grain, so given an explicit grain, the
+    /// result is the same for any number of workers, even for floating-point numbers.
+    /// </summary>
+    export template <std::ranges::random_access_range Range, typename T, typename Reduce = std::plus<>>
+        requires std::invocable<Reduce&, T, std::ranges::range_reference_t<Range>> &&
+                 std::invocable<Reduce&, T, T>
+    [[nodiscard]] T parallel_reduce(thread_pool& pool, Range&& range, T identity, Reduce reduce = {}, sz grain = 0)
+    {
+        auto const first = std::ranges::begin(range);
+        auto const last = first + std::ranges::distance(range);
+        auto const size = static_cast<sz>(last - first);
+        if (size == 0)
+            return identity;
+
+        return impl::run_on(pool, [&] {
+            return impl::reduce(pool, first, last, impl::grain_size(pool, size, grain), identity, reduce);
+        });
+    }
+
+    /// <summary>
+    /// Combines all elements of the given range using the given associative operation on the workers of
+    /// thread_pool::global()
+    /// </summary>
+    export template <std::ranges::random_access_range Range, typename T, typename Reduce = std::plus<>>
+        requires std::invocable<Reduce&, T, std::ranges::range_reference_t<Range>> &&
+                 std::invocable<Reduce&, T, T>
+    [[nodiscard]] T parallel_reduce(Range&& range, T identity, Reduce reduce = {}, sz grain = 0)
+    {
+        return parallel_reduce(thread_pool::global(), std::forward<Range>(range), std::move(identity),
+                               std::move(reduce), grain);
+    }
+
+    /// <summary>
+    /// Sorts the given range on the workers of the given pool. Chunks of at most grain elements are sorted
+    /// independently and merged pairwise; a grain of 0 picks about eight chunks per worker, but at least 4096
+    /// elements. Not stable.
+    /// </summary>
+    export template <std::ranges::random_access_range Range, typename Compare = std::ranges::less>
+        requires std::sortable<std::ranges::iterator_t<Range>, Compare>
+    void parallel_sort(thread_pool& pool, Range&& range, Compare compare = {}, sz grain = 0)
+    {
+        auto const first = std::ranges::begin(range);
+        auto const last = first + std::ranges::distance(range);
+        auto const size = static_cast<sz>(last - first);
+        if (size < 2)
+            return;
+
+        impl::run_on(pool, [&] { impl::sort(pool, first, last, impl::grain_size(pool, size, grain, 4096), compare); });
+    }
+
+    /// <summary>
+    /// Sorts the given range on the workers of thread_pool::global()
+    /// </summary>
+    export template <std::ranges::random_access_range Range, typename Compare = std::ranges::less>
+        requires std::sortable<std::ranges::iterator_t<Range>, Compare>
+    void parallel_sort(Range&& range, Compare compare = {}, sz grain = 0)
+    {
+        parallel_sort(thread_pool::global(), std::forward<Range>(range), std::move(compare), grain);
+    }
+}
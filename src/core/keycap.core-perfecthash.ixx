@@ -0,0 +1,245 @@
+module;
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <string_view>
+#include <utility>
+
+export module keycap.core : perfecthash;
+
+import : error;
+import : fragments;
+import : string;
+import : types;
+
+namespace impl
+{
+    /// <summary>
+    /// Maps a key's hash to its slot, using the displacement that was chosen for the key's bucket
+    /// </summary>
+    [[nodiscard]] constexpr sz displace(u64 hash, u64 displacement, sz slot_count) noexcept
+    {
+        return static_cast<sz>(mix(hash ^ displacement, wyp[2])) & (slot_count - 1);
+    }
+}
+
+namespace keycap
+{
+    /// <summary>
+    /// An immutable map from strings to values with a collision-free hash table that is built at compile time from a
+    /// fixed list of entries (CHD, "hash and displace"). A lookup costs one hash_u64 and one string comparison and
+    /// never allocates.
+    /// </summary>
+    /// <typeparam name="T">The mapped type</typeparam>
+    /// <typeparam name="N">The number of entries</typeparam>
+    export template <typename T, sz N>
+    class perfect_hash_map
+    {
+      public:
+        using key_type = std::string_view;
+        using mapped_type = T;
+        using value_type = std::pair<std::string_view, T>;
+        using size_type = sz;
+
+        static constexpr sz slot_count = std::bit_ceil(N == 0 ? sz{1} : N);
+
+        /// <summary>
+        /// Builds the table from the given entries. Keys must be unique, otherwise a keycap::exception is thrown (which
+        /// fails compilation when evaluated at compile time).
+        /// </summary>
+        constexpr explicit perfect_hash_map(std::array<value_type, N> const& entries)
+        {
+            if constexpr (N > 0)
+            {
+                ensure_unique_keys(entries);
+
+                for (u64 seed = 0;; ++seed)
+                {
+                    if (try_build(entries, seed))
+                        break;
+                }
+            }
+        }
+
+        /// <summary>
+        /// Returns a pointer to the value mapped to the given key, or nullptr if the key is not part of the map
+        /// </summary>
+        [[nodiscard]] constexpr T const* find(std::string_view key) const noexcept
+        {
+            if constexpr (N == 0)
+            {
+                return nullptr;
+            }
+            else
+            {
+                auto const& slot = slots_[slot_of(key)];
+                return slot.first == key ? &slot.second : nullptr;
+            }
+        }
+
+        /// <summary>
+        /// Returns whether the given key is part of the map
+        /// </summary>
+        [[nodiscard]] constexpr bool contains(std::string_view key) const noexcept
+        {
+            return find(key) != nullptr;
+        }
+
+        /// <summary>
+        /// Returns the value mapped to the given key. Throws a keycap::exception if the key is not part of the map.
+        /// </summary>
+        [[nodiscard]] constexpr T const& at(std::string_view key) const
+        {
+            if (auto const* value = find(key))
+                return *value;
+
+            throw exception{error_code::invalid_argument, module::core, fragment::perfecthash, __LINE__,
+                            "Key is not part of the perfect_hash_map"};
+        }
+
+        [[nodiscard]] constexpr sz size() const noexcept
+        {
+            return N;
+        }
+
+        [[nodiscard]] constexpr bool empty() const noexcept
+        {
+            return N == 0;
+        }
+
+      private:
+        static constexpr sz bucket_count = slot_count;
+        static constexpr u64 max_displacement = 1 << 16;
+
+        [[nodiscard]] constexpr sz slot_of(std::string_view key) const noexcept
+        {
+            auto const hash = hash_u64(key, seed_);
+            auto const displacement = displacements_[hash & (bucket_count - 1)];
+
+            // Buckets with a single key store the slot directly
+            if (displacement < 0)
+                return static_cast<sz>(-displacement - 1);
+
+            return impl::displace(hash, static_cast<u64>(displacement), slot_count);
+        }
+
+        static constexpr void ensure_unique_keys(std::array<value_type, N> const& entries)
+        {
+            std::array<std::string_view, N> keys{};
+            std::transform(entries.begin(), entries.end(), keys.begin(), [](auto const& entry) {
+                return entry.first;
+            });
+            std::sort(keys.begin(), keys.end());
+
+            if (std::adjacent_find(keys.begin(), keys.end()) != keys.end())
+            {
+                throw exception{error_code::invalid_argument, module::core, fragment::perfecthash, __LINE__,
+                                "The keys of a perfect_hash_map must be unique"};
+            }
+        }
+
+        constexpr bool try_build(std::array<value_type, N> const& entries, u64 seed)
+        {
+            std::array<u64, N> hashes{};
+            std::array<sz, bucket_count> bucket_sizes{};
+            for (sz i = 0; i < N; ++i)
+            {
+                hashes[i] = hash_u64(entries[i].first, seed);
+                ++bucket_sizes[hashes[i] & (bucket_count - 1)];
+            }
+
+            // Entry indices sorted by bucket, biggest buckets first, as those are the hardest to place
+            std::array<sz, N> order{};
+            for (sz i = 0; i < N; ++i)
+            {
+                order[i] = i;
+            }
+            std::sort(order.begin(), order.end(), [&](sz lhs, sz rhs) {
+                auto const lhs_bucket = hashes[lhs] & (bucket_count - 1);
+                auto const rhs_bucket = hashes[rhs] & (bucket_count - 1);
+                if (bucket_sizes[lhs_bucket] != bucket_sizes[rhs_bucket])
+                    return bucket_sizes[lhs_bucket] > bucket_sizes[rhs_bucket];
+                return lhs_bucket < rhs_bucket;
+            });
+
+            std::array<bool, slot_count> occupied{};
+            std::array<i64, bucket_count> displacements{};
+            std::array<sz, slot_count> entry_of_slot{};
+            std::array<sz, N> slots{};
+
+            sz first = 0;
+            while (first < N && bucket_sizes[hashes[order[first]] & (bucket_count - 1)] > 1)
+            {
+                auto const bucket = hashes[order[first]] & (bucket_count - 1);
+                sz const last = first + bucket_sizes[bucket];
+
+                bool placed = false;
+                for (u64 displacement = 1; !placed && displacement <= max_displacement; ++displacement)
+                {
+                    placed = true;
+                    for (sz i = first; placed && i < last; ++i)
+                    {
+                        slots[i] = impl::displace(hashes[order[i]], displacement, slot_count);
+                        placed = !occupied[slots[i]] && std::find(&slots[first], &slots[i], slots[i]) == &slots[i];
+                    }
+
+                    if (placed)
+                    {
+                        for (sz i = first; i < last; ++i)
+                        {
+                            occupied[slots[i]] = true;
+                            entry_of_slot[slots[i]] = order[i];
+                        }
+                        displacements[bucket] = static_cast<i64>(displacement);
+                    }
+                }
+
+                if (!placed)
+                    return false;
+
+                first = last;
+            }
+
+            // The remaining buckets hold a single key each, which is put into the next free slot
+            sz free_slot = 0;
+            for (; first < N; ++first)
+            {
+                while (occupied[free_slot])
+                    ++free_slot;
+
+                occupied[free_slot] = true;
+                entry_of_slot[free_slot] = order[first];
+                displacements[hashes[order[first]] & (bucket_count - 1)] = -static_cast<i64>(free_slot) - 1;
+            }
+
+            // Unused slots hold a copy of the first entry. Looking up that entry's key always leads to its own slot,
+            // so any other key landing on an unused slot fails the comparison without an extra check.
+            for (sz slot = 0; slot < slot_count; ++slot)
+            {
+                slots_[slot] = entries[occupied[slot] ? entry_of_slot[slot] : 0];
+            }
+
+            displacements_ = displacements;
+            seed_ = seed;
+            return true;
+        }
+
+        std::array<value_type, slot_count> slots_{};
+        std::array<i64, bucket_count> displacements_{};
+        u64 seed_ = 0;
+    };
+
+    /// <summary>
+    /// Creates a perfect_hash_map from the given entries, e.g.
+    /// constexpr auto commands = make_perfect_hash_map&lt;int&gt;({{"help", 0}, {"quit", 1}});
+    /// </summary>
+    export template <typename T, sz N>
+    [[nodiscard]] constexpr perfect_hash_map<T, N> make_perfect_hash_map(
+        std::pair<std::string_view, T> const (&entries)[N])
+    {
+        std::array<std::pair<std::string_view, T>, N> array{};
+        std::copy(std::begin(entries), std::end(entries), array.begin());
+        return perfect_hash_map<T, N>{array};
+    }
+}
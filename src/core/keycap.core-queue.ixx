@@ -0,0 +1,711 @@
+module;
+
+#include "simd.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <optional>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+export module keycap.core : queue;
+
+import : error;
+import : fragments;
+import : types;
+
+namespace impl
+{
+    /// <summary>
+    /// Tells the CPU that the calling thread is spinning
+    /// </summary>
+    inline void cpu_relax() noexcept
+    {
+#if KEYCAP_SIMD_X86
+        _mm_pause();
+#else
+        std::this_thread::yield();
+#endif
+    }
+
+    /// <summary>
+    /// Lets threads block until a condition holds: they spin first, then yield, and finally sleep on a futex (via
+    /// std::atomic::wait). Whoever makes the condition true calls notify, which only costs a fence unless a thread is
+    /// actually asleep.
+    /// </summary>
+    class waiter
+    {
+      public:
+        static constexpr int spins = 128;
+        static constexpr int yields = 16;
+
+        template <typename Ready>
+        void wait(Ready const& ready) noexcept
+        {
+            for (int i = 0; i < spins; ++i)
+            {
+                if (ready())
+                    return;
+                cpu_relax();
+            }
+
+            for (int i = 0; i < yields; ++i)
+            {
+                if (ready())
+                    return;
+                std::this_thread::yield();
+            }
+
+            while (true)
+            {
+                // Pairs with the fence in notify: either the notifier sees the sleeper, or the sleeper sees the change
+                sleepers_.fetch_add(1, std::memory_order_seq_cst);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                auto const observed = signal_.load(std::memory_order_acquire);
+
+                if (ready())
+                {
+                    sleepers_.fetch_sub(1, std::memory_order_relaxed);
+                    return;
+                }
+
+                signal_.wait(observed, std::memory_order_acquire);
+                sleepers_.fetch_sub(1, std::memory_order_relaxed);
+
+                if (ready())
+                    return;
+            }
+        }
+
+        /// <summary>
+        /// Wakes all sleeping threads. Has to be called after the change that may make their condition true.
+        /// </summary>
+        void notify() noexcept
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (sleepers_.load(std::memory_order_relaxed) > 0)
+            {
+                signal_.fetch_add(1, std::memory_order_release);
+                signal_.notify_all();
+            }
+        }
+
+      private:
+        std::atomic<u32> sleepers_ = 0;
+        std::atomic<u32> signal_ = 0;
+    };
+
+    /// <summary>
+    /// Uninitialized storage for a single T
+    /// </summary>
+    template <typename T>
+    struct slot
+    {
+        alignas(T) std::byte storage[sizeof(T)];
+
+        template <typename... Args>
+        void construct(Args&&... args) noexcept(std::is_nothrow_constructible_v<T, Args...>)
+        {
+            ::new (static_cast<void*>(storage)) T(std::forward<Args>(args)...);
+        }
+
+        [[nodiscard]] T& get() noexcept
+        {
+            return *std::launder(reinterpret_cast<T*>(storage));
+        }
+
+        /// <summary>
+        /// Moves the value out and destroys it
+        /// </summary>
+        [[nodiscard]] T take() noexcept(std::is_nothrow_move_constructible_v<T>)
+        {
+            auto& value = get();
+            T result{std::move(value)};
+            value.~T();
+            return result;
+        }
+
+        void destroy() noexcept
+        {
+            get().~T();
+        }
+    };
+
+    [[nodiscard]] inline sz queue_capacity(sz capacity)
+    {
+        if (capacity == 0 || capacity > (sz{1} << (sizeof(sz) * 8 - 2)))
+        {
+            throw keycap::exception{keycap::error_code::invalid_argument, keycap::module::core,
+                                    keycap::fragment::queue, __LINE__,
+                                    "The capacity of a queue has to be greater than 0 and less than 2^62"};
+        }
+        return std::bit_ceil(capacity);
+    }
+}
+
+namespace keycap
+{
+    /// <summary>
+    /// A bounded, lock-free queue for exactly one producer and one consumer thread. The indices of both sides live on
+    /// separate cache-lines, and each side caches the other's index, so the two threads only share a cache-line when
+    /// the queue runs full or empty. The blocking push and pop spin, then yield, then sleep until the other side makes
+    /// progress.
+    /// </summary>
+    /// <typeparam name="T">The type of the elements, which must be nothrow movable</typeparam>
+    export template <std::movable T>
+        requires std::is_nothrow_move_constructible_v<T>
+    class spsc_queue
+    {
+      public:
+        using value_type = T;
+
+        /// <summary>
+        /// Creates a queue holding at least the given number of elements; the capacity is rounded up to a power of
+        /// two. Throws error_code::invalid_argument if it is 0.
+        /// </summary>
+        explicit spsc_queue(sz capacity)
+          : mask_{impl::queue_capacity(capacity) - 1}
+          , slots_{std::make_unique<impl::slot<T>[]>(mask_ + 1)}
+        {
+        }
+
+        spsc_queue(spsc_queue const&) = delete;
+        spsc_queue& operator=(spsc_queue const&) = delete;
+
+        ~spsc_queue()
+        {
+            auto const tail = tail_.load(std::memory_order_relaxed);
+            for (auto head = head_.load(std::memory_order_relaxed); head != tail; ++head)
+                slots_[head & mask_].destroy();
+        }
+
+        /// <summary>
+        /// Constructs an element at the back of the queue. Returns false if the queue is full. Producer only.
+        /// </summary>
+        template <typename... Args>
+            requires std::constructible_from<T, Args...>
+        bool try_emplace(Args&&... args)
+        {
+            auto const tail = tail_.load(std::memory_order_relaxed);
+            if (tail - cached_head_ > mask_)
+            {
+                cached_head_ = head_.load(std::memory_order_acquire);
+                if (tail - cached_head_ > mask_)
+                    return false;
+            }
+
+            slots_[tail & mask_].construct(std::forward<Args>(args)...);
+            tail_.store(tail + 1, std::memory_order_release);
+            not_empty_.notify();
+            return true;
+        }
+
+        /// <summary>
+        /// Adds an element at the back of the queue. Returns false if the queue is full. Producer only.
+        /// </summary>
+        bool try_push(T value)
+        {
+            return try_emplace(std::move(value));
+        }
+
+        /// <summary>
+        /// Adds an element at the back of the queue, waiting for space if it is full. Producer only.
+        /// </summary>
+        void push(T value)
+        {
+            while (!try_emplace(std::move(value)))
+                not_full_.wait([this] { return !full(); });
+        }
+
+        /// <summary>
+        /// Removes the element at the front of the queue. Returns std::nullopt if the queue is empty. Consumer only.
+        /// </summary>
+        [[nodiscard]] std::optional<T> try_pop()
+        {
+            auto const head = head_.load(std::memory_order_relaxed);
+            if (head == cached_tail_)
+            {
+                cached_tail_ = tail_.load(std::memory_order_acquire);
+                if (head == cached_tail_)
+                    return std::nullopt;
+            }
+
+            std::optional<T> value{slots_[head & mask_].take()};
+            head_.store(head + 1, std::memory_order_release);
+            not_full_.notify();
+            return value;
+        }
+
+        /// <summary>
+        /// Removes the element at the front of the queue, waiting for one if it is empty. Consumer only.
+        /// </summary>
+        [[nodiscard]] T pop()
+        {
+            while (true)
+            {
+                if (auto value = try_pop())
+                    return std::move(*value);
+                not_empty_.wait([this] { return !empty(); });
+            }
+        }
+
+        /// <summary>
+        /// Copies as many of the given values as fit to the back of the queue and returns their number. Publishes them
+        /// all at once, which makes it much cheaper than pushing one at a time. Producer only.
+        /// </summary>
+        sz try_push_bulk(std::span<T const> values)
+            requires std::is_nothrow_copy_constructible_v<T>
+        {
+            auto const tail = tail_.load(std::memory_order_relaxed);
+            if (tail - cached_head_ + values.size() > mask_ + 1)
+                cached_head_ = head_.load(std::memory_order_acquire);
+
+            auto const count = std::min(values.size(), mask_ + 1 - (tail - cached_head_));
+            if (count == 0)
+                return 0;
+
+            for (sz i = 0; i < count; ++i)
+                slots_[(tail + i) & mask_].construct(values[i]);
+
+            tail_.store(tail + count, std::memory_order_release);
+            not_empty_.notify();
+            return count;
+        }
+
+        /// <summary>
+        /// Copies all given values to the back of the queue, waiting for space as needed. Producer only.
+        /// </summary>
+        void push_bulk(std::span<T const> values)
+            requires std::is_nothrow_copy_constructible_v<T>
+        {
+            while (!values.empty())
+            {
+                values = values.subspan(try_push_bulk(values));
+                if (!values.empty())
+                    not_full_.wait([this] { return !full(); });
+            }
+        }
+
+        /// <summary>
+        /// Moves up to output.size() elements from the front of the queue to output and returns their number.
+        /// Consumer only.
+        /// </summary>
+        sz try_pop_bulk(std::span<T> output)
+            requires std::is_nothrow_move_assignable_v<T>
+        {
+            auto const head = head_.load(std::memory_order_relaxed);
+            if (cached_tail_ - head < output.size())
+                cached_tail_ = tail_.load(std::memory_order_acquire);
+
+            auto const count = std::min(output.size(), cached_tail_ - head);
+            if (count == 0)
+                return 0;
+
+            for (sz i = 0; i < count; ++i)
+                output[i] = slots_[(head + i) & mask_].take();
+
+            head_.store(head + count, std::memory_order_release);
+            not_full_.notify();
+            return count;
+        }
+
+        /// <summary>
+        /// Moves up to output.size() elements from the front of the queue to output and returns their number, waiting
+        /// until there is at least one. Consumer only.
+        /// </summary>
+        sz pop_bulk(std::span<T> output)
+            requires std::is_nothrow_move_assignable_v<T>
+        {
+            if (output.empty())
+                return 0;
+
+            while (true)
+            {
+                if (auto const count = try_pop_bulk(output); count > 0)
+                    return count;
+                not_empty_.wait([this] { return !empty(); });
+            }
+        }
+
+        /// <summary>
+        /// Returns whether the queue is empty. Exact when called by the consumer, a snapshot otherwise.
+        /// </summary>
+        [[nodiscard]] bool empty() const noexcept
+        {
+            return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+        }
+
+        /// <summary>
+        /// Returns whether the queue is full. Exact when called by the producer, a snapshot otherwise.
+        /// </summary>
+        [[nodiscard]] bool full() const noexcept
+        {
+            return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire) > mask_;
+        }
+
+        /// <summary>
+        /// Returns the number of elements, which may be outdated by the time it is returned
+        /// </summary>
+        [[nodiscard]] sz size() const noexcept
+        {
+            auto const head = head_.load(std::memory_order_acquire);
+            return tail_.load(std::memory_order_acquire) - head;
+        }
+
+        [[nodiscard]] sz capacity() const noexcept
+        {
+            return mask_ + 1;
+        }
+
+      private:
+        // Read-only after construction, shared by both sides
+        sz const mask_;
+        std::unique_ptr<impl::slot<T>[]> const slots_;
+
+        // Written by the consumer
+        alignas(64) std::atomic<sz> head_ = 0;
+        sz cached_tail_ = 0;
+        impl::waiter not_full_;
+
+        // Written by the producer
+        alignas(64) std::atomic<sz> tail_ = 0;
+        sz cached_head_ = 0;
+        impl::waiter not_empty_;
+
+        // Keeps whatever follows the queue off the producer's cache-line
+        [[maybe_unused]] alignas(64) std::byte padding_[1];
+    };
+
+    // adapted from https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+    /// <summary>
+    /// A bounded, lock-free queue for any number of producer and consumer threads (Dmitry Vyukov's design). Every
+    /// cell carries a sequence number telling whether it is ready to be written or read in the current lap, so
+    /// producers and consumers only contend on their own position counter. Bulk operations claim several cells with
+    /// a single compare-and-swap. The blocking push and pop spin, then yield, then sleep until the other side makes
+    /// progress. Elements from the same producer are popped in the order they were pushed.
+    /// </summary>
+    /// <typeparam name="T">The type of the elements, which must be nothrow movable</typeparam>
+    export template <std::movable T>
+        requires std::is_nothrow_move_constructible_v<T>
+    class mpmc_queue
+    {
+      public:
+        using value_type = T;
+
+        /// <summary>
+        /// Creates a queue holding at least the given number of elements; the capacity is rounded up to a power of
+        /// two. Throws error_code::invalid_argument if it is 0.
+        /// </summary>
+        explicit mpmc_queue(sz capacity)
+          : mask_{impl::queue_capacity(capacity) - 1}
+          , cells_{std::make_unique<cell[]>(mask_ + 1)}
+        {
+            for (sz i = 0; i <= mask_; ++i)
+                cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        mpmc_queue(mpmc_queue const&) = delete;
+        mpmc_queue& operator=(mpmc_queue const&) = delete;
+
+        ~mpmc_queue()
+        {
+            auto const end = enqueue_position_.load(std::memory_order_relaxed);
+            for (auto position = dequeue_position_.load(std::memory_order_relaxed); position != end; ++position)
+            {
+                auto& cell = cells_[position & mask_];
+                if (cell.sequence.load(std::memory_order_relaxed) == position + 1)
+                    cell.value.destroy();
+            }
+        }
+
+        /// <summary>
+        /// Constructs an element at the back of the queue. Returns false if the queue is full. Thread-safe.
+        /// </summary>
+        template <typename... Args>
+            requires std::constructible_from<T, Args...>
+        bool try_emplace(Args&&... args)
+        {
+            // A claimed cell has to be published, so the element is constructed up front if that may throw
+            if constexpr (!std::is_nothrow_constructible_v<T, Args...>)
+                return try_emplace(T(std::forward<Args>(args)...));
+
+            auto position = enqueue_position_.load(std::memory_order_relaxed);
+            while (true)
+            {
+                auto& cell = cells_[position & mask_];
+                auto const lap = distance(cell.sequence.load(std::memory_order_acquire), position);
+                if (lap == 0)
+                {
+                    if (enqueue_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    {
+                        cell.value.construct(std::forward<Args>(args)...);
+                        cell.sequence.store(position + 1, std::memory_order_release);
+                        not_empty_.notify();
+                        return true;
+                    }
+                }
+                else if (lap < 0)
+                {
+                    return false;
+                }
+                else
+                {
+                    position = enqueue_position_.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        /// <summary>
+        /// Adds an element at the back of the queue. Returns false if the queue is full. Thread-safe.
+        /// </summary>
+        bool try_push(T value)
+        {
+            return try_emplace(std::move(value));
+        }
+
+        /// <summary>
+        /// Adds an element at the back of the queue, waiting for space if it is full. Thread-safe.
+        /// </summary>
+        void push(T value)
+        {
+            while (!try_emplace(std::move(value)))
+                not_full_.wait([this] { return can_push(); });
+        }
+
+        /// <summary>
+        /// Removes the element at the front of the queue. Returns std::nullopt if the queue is empty. Thread-safe.
+        /// </summary>
+        [[nodiscard]] std::optional<T> try_pop()
+        {
+            auto position = dequeue_position_.load(std::memory_order_relaxed);
+            while (true)
+            {
+                auto& cell = cells_[position & mask_];
+                auto const lap = distance(cell.sequence.load(std::memory_order_acquire), position + 1);
+                if (lap == 0)
+                {
+                    if (dequeue_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    {
+                        std::optional<T> value{cell.value.take()};
+                        cell.sequence.store(position + mask_ + 1, std::memory_order_release);
+                        not_full_.notify();
+                        return value;
+                    }
+                }
+                else if (lap < 0)
+                {
+                    return std::nullopt;
+                }
+                else
+                {
+                    position = dequeue_position_.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        /// <summary>
+        /// Removes the element at the front of the queue, waiting for one if it is empty. Thread-safe.
+        /// </summary>
+        [[nodiscard]] T pop()
+        {
+            while (true)
+            {
+                if (auto value = try_pop())
+                    return std::move(*value);
+                not_empty_.wait([this] { return can_pop(); });
+            }
+        }
+
+        /// <summary>
+        /// Copies as many of the given values as there are consecutive free cells to the back of the queue and returns
+        /// their number. Claims all cells with a single compare-and-swap. Thread-safe.
+        /// </summary>
+        sz try_push_bulk(std::span<T const> values)
+            requires std::is_nothrow_copy_constructible_v<T>
+        {
+            if (values.empty())
+                return 0;
+
+            auto position = enqueue_position_.load(std::memory_order_relaxed);
+            while (true)
+            {
+                auto const count = claimable(position, values.size(), 0);
+                if (count == 0)
+                {
+                    auto const lap = distance(cells_[position & mask_].sequence.load(std::memory_order_acquire),
+                                              position);
+                    if (lap < 0)
+                        return 0;
+
+                    position = enqueue_position_.load(std::memory_order_relaxed);
+                    continue;
+                }
+
+                if (enqueue_position_.compare_exchange_weak(position, position + count, std::memory_order_relaxed))
+                {
+                    for (sz i = 0; i < count; ++i)
+                    {
+                        auto& cell = cells_[(position + i) & mask_];
+                        cell.value.construct(values[i]);
+                        cell.sequence.store(position + i + 1, std::memory_order_release);
+                    }
+                    not_empty_.notify();
+                    return count;
+                }
+            }
+        }
+
+        /// <summary>
+        /// Copies all given values to the back of the queue, waiting for space as needed. Values of concurrent
+        /// producers may end up in between. Thread-safe.
+        /// </summary>
+        void push_bulk(std::span<T const> values)
+            requires std::is_nothrow_copy_constructible_v<T>
+        {
+            while (!values.empty())
+            {
+                values = values.subspan(try_push_bulk(values));
+                if (!values.empty())
+                    not_full_.wait([this] { return can_push(); });
+            }
+        }
+
+        /// <summary>
+        /// Moves up to output.size() consecutive elements from the front of the queue to output and returns their
+        /// number. Claims all cells with a single compare-and-swap. Thread-safe.
+        /// </summary>
+        sz try_pop_bulk(std::span<T> output)
+            requires std::is_nothrow_move_assignable_v<T>
+        {
+            if (output.empty())
+                return 0;
+
+            auto position = dequeue_position_.load(std::memory_order_relaxed);
+            while (true)
+            {
+                auto const count = claimable(position, output.size(), 1);
+                if (count == 0)
+                {
+                    auto const lap = distance(cells_[position & mask_].sequence.load(std::memory_order_acquire),
+                                              position + 1);
+                    if (lap < 0)
+                        return 0;
+
+                    position = dequeue_position_.load(std::memory_order_relaxed);
+                    continue;
+                }
+
+                if (dequeue_position_.compare_exchange_weak(position, position + count, std::memory_order_relaxed))
+                {
+                    for (sz i = 0; i < count; ++i)
+                    {
+                        auto& cell = cells_[(position + i) & mask_];
+                        output[i] = cell.value.take();
+                        cell.sequence.store(position + i + mask_ + 1, std::memory_order_release);
+                    }
+                    not_full_.notify();
+                    return count;
+                }
+            }
+        }
+
+        /// <summary>
+        /// Moves up to output.size() elements from the front of the queue to output and returns their number, waiting
+        /// until there is at least one. Thread-safe.
+        /// </summary>
+        sz pop_bulk(std::span<T> output)
+            requires std::is_nothrow_move_assignable_v<T>
+        {
+            if (output.empty())
+                return 0;
+
+            while (true)
+            {
+                if (auto const count = try_pop_bulk(output); count > 0)
+                    return count;
+                not_empty_.wait([this] { return can_pop(); });
+            }
+        }
+
+        /// <summary>
+        /// Returns whether the queue is empty. The answer may be outdated by the time it is returned.
+        /// </summary>
+        [[nodiscard]] bool empty() const noexcept
+        {
+            return !can_pop();
+        }
+
+        /// <summary>
+        /// Returns the number of elements, which may be outdated by the time it is returned
+        /// </summary>
+        [[nodiscard]] sz size() const noexcept
+        {
+            auto const dequeued = dequeue_position_.load(std::memory_order_acquire);
+            auto const enqueued = enqueue_position_.load(std::memory_order_acquire);
+            return enqueued > dequeued ? std::min(enqueued - dequeued, mask_ + 1) : 0;
+        }
+
+        [[nodiscard]] sz capacity() const noexcept
+        {
+            return mask_ + 1;
+        }
+
+      private:
+        struct cell
+        {
+            std::atomic<sz> sequence;
+            impl::slot<T> value;
+        };
+
+        [[nodiscard]] static std::ptrdiff_t distance(sz sequence, sz expected) noexcept
+        {
+            return static_cast<std::ptrdiff_t>(sequence - expected);
+        }
+
+        /// <summary>
+        /// Returns the number of consecutive cells starting at the given position whose sequence equals their position
+        /// plus the given offset, i.e. that are free (0) or filled (1) in the current lap, up to the given limit
+        /// </summary>
+        [[nodiscard]] sz claimable(sz position, sz limit, sz offset) const noexcept
+        {
+            limit = std::min(limit, mask_ + 1);
+
+            sz count = 0;
+            while (count < limit &&
+                   cells_[(position + count) & mask_].sequence.load(std::memory_order_acquire) ==
+                       position + count + offset)
+                ++count;
+            return count;
+        }
+
+        [[nodiscard]] bool can_push() const noexcept
+        {
+            auto const position = enqueue_position_.load(std::memory_order_relaxed);
+            return distance(cells_[position & mask_].sequence.load(std::memory_order_acquire), position) >= 0;
+        }
+
+        [[nodiscard]] bool can_pop() const noexcept
+        {
+            auto const position = dequeue_position_.load(std::memory_order_relaxed);
+            return distance(cells_[position & mask_].sequence.load(std::memory_order_acquire), position + 1) >= 0;
+        }
+
+        sz const mask_;
+        std::unique_ptr<cell[]> const cells_;
+
+        alignas(64) std::atomic<sz> enqueue_position_ = 0;
+        impl::waiter not_empty_;
+
+        alignas(64) std::atomic<sz> dequeue_position_ = 0;
+        impl::waiter not_full_;
+
+        [[maybe_unused]] alignas(64) std::byte padding_[1];
+    };
+}
@@ -1,86 +1,1061 @@
 module;
 
+#include "simd.hpp"
+
+#include <algorithm>
 #include <array>
+#include <bit>
+#include <cmath>
+#include <concepts>
 #include <limits>
-#include <random>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <type_traits>
+
+export module keycap.core:random;
+
+import :math;
+import :simd;
+import :types;
+
+namespace impl
+{
+    /// <summary>
+    /// A minimal unsigned 128-bit integer for the state of pcg64
+    /// </summary>
+    struct u128
+    {
+        u64 low;
+        u64 high;
+
+        [[nodiscard]] constexpr bool operator==(u128 const&) const noexcept = default;
+    };
+
+    [[nodiscard]] constexpr u128 add(u128 a, u128 b) noexcept
+    {
+        u64 const low = a.low + b.low;
+        return {low, a.high + b.high + (low < a.low ? 1 : 0)};
+    }
+
+    [[nodiscard]] constexpr u128 multiply(u128 a, u128 b) noexcept
+    {
+        u64 low;
+        u64 const high = multiply_high(a.low, b.low, low);
+        return {low, high + a.high * b.low + a.low * b.high};
+    }
+
+    /// <summary>
+    /// Returns a uniformly distributed value in [0, range) using Lemire's nearly divisionless method. Only the upper
+    /// 32 bits of every engine output are used, the lower bits of xoroshiro128+ are of poor quality.
+    /// See https://arxiv.org/abs/1805.10941
+    /// </summary>
+    template <typename Engine>
+    [[nodiscard]] constexpr u32 bounded_u32(Engine& engine, u32 range) noexcept
+    {
+        u64 product = (engine() >> 32) * range;
+        auto low = static_cast<u32>(product);
+        if (low < range)
+        {
+            u32 const threshold = (0u - range) % range;
+            while (low < threshold)
+            {
+                product = (engine() >> 32) * range;
+                low = static_cast<u32>(product);
+            }
+        }
+
+        return static_cast<u32>(product >> 32);
+    }
+
+    /// <summary>
+    /// Returns a uniformly distributed value in [0, range) using Lemire's nearly divisionless method
+    /// </summary>
+    template <typename Engine>
+    [[nodiscard]] constexpr u64 bounded_u64(Engine& engine, u64 range) noexcept
+    {
+        u64 low;
+        u64 high = multiply_high(engine(), range, low);
+        if (low < range)
+        {
+            u64 const threshold = (0ull - range) % range;
+            while (low < threshold)
+                high = multiply_high(engine(), range, low);
+        }
+
+        return high;
+    }
+
+    /// <summary>
+    /// Returns a uniformly distributed integer in [min, max]. The result only depends on the engine's output, so it
+    /// is identical on every platform and standard library.
+    /// </summary>
+    template <std::integral T, typename Engine>
+    [[nodiscard]] constexpr T uniform_int(Engine& engine, T min, T max) noexcept
+    {
+        using unsigned_type = std::make_unsigned_t<T>;
+        auto const span = static_cast<unsigned_type>(static_cast<unsigned_type>(max) - static_cast<unsigned_type>(min));
+
+        unsigned_type offset;
+        if constexpr (sizeof(T) <= sizeof(u32))
+        {
+            offset = span == std::numeric_limits<unsigned_type>::max()
+                         ? static_cast<unsigned_type>(engine() >> (64 - std::numeric_limits<unsigned_type>::digits))
+                         : static_cast<unsigned_type>(bounded_u32(engine, static_cast<u32>(span) + 1));
+        }
+        else
+        {
+            offset = span == std::numeric_limits<u64>::max() ? engine() : bounded_u64(engine, span + 1);
+        }
+
+        return static_cast<T>(static_cast<unsigned_type>(static_cast<unsigned_type>(min) + offset));
+    }
+
+    /// <summary>
+    /// Returns a uniformly distributed f64 in [0, 1) by filling the mantissa of a number in [1, 2) with the upper 52
+    /// bits of the engine's output
+    /// </summary>
+    template <typename Engine>
+    [[nodiscard]] constexpr f64 unit_f64(Engine& engine) noexcept
+    {
+        return std::bit_cast<f64>((engine() >> 12) | 0x3FF0000000000000ull) - 1.0;
+    }
+
+    /// <summary>
+    /// Returns a uniformly distributed f32 in [0, 1) by filling the mantissa of a number in [1, 2) with the upper 23
+    /// bits of the engine's output
+    /// </summary>
+    template <typename Engine>
+    [[nodiscard]] constexpr f32 unit_f32(Engine& engine) noexcept
+    {
+        return std::bit_cast<f32>(static_cast<u32>(engine() >> 41) | 0x3F800000u) - 1.0f;
+    }
+
+    /// <summary>
+    /// Returns a uniformly distributed floating point number in [min, max)
+    /// </summary>
+    template <std::floating_point T>
+    [[nodiscard]] constexpr T scale_unit(T unit, T min, T max) noexcept
+    {
+        auto const result = min + (max - min) * unit;
+
+        // Rounding may land exactly on max
+        return result < max ? result : (min < max ? std::nextafter(max, min) : min);
+    }
+
+    /// <summary>
+    /// The number of interleaved xoroshiro128+ states used for bulk generation. It is fixed for every instruction set
+    /// so that the generated sequence only depends on the seed.
+    /// </summary>
+    constexpr sz bulk_lanes = 8;
+
+    /// <summary>
+    /// Advances all lanes by blocks steps, writing the output of lane l at step j to output[j * bulk_lanes + l]
+    /// </summary>
+    void generate_lanes_scalar(u64* s0, u64* s1, u64* output, sz blocks) noexcept
+    {
+        for (sz block = 0; block < blocks; ++block)
+        {
+            for (sz lane = 0; lane < bulk_lanes; ++lane)
+            {
+                u64 const a = s0[lane];
+                u64 b = s1[lane];
+                output[block * bulk_lanes + lane] = a + b;
+
+                b ^= a;
+                s0[lane] = std::rotl(a, 24) ^ b ^ (b << 16);
+                s1[lane] = std::rotl(b, 37);
+            }
+        }
+    }
+
+#if KEYCAP_SIMD_X86
+    template <int Shift>
+    KEYCAP_TARGET("sse2")
+    __m128i rotl_m128(__m128i value) noexcept
+    {
+        return _mm_or_si128(_mm_slli_epi64(value, Shift), _mm_srli_epi64(value, 64 - Shift));
+    }
+
+    KEYCAP_TARGET("sse2")
+    void generate_lanes_sse2(u64* s0, u64* s1, u64* output, sz blocks) noexcept
+    {
+        constexpr sz registers = bulk_lanes / 2;
+
+        __m128i a[registers], b[registers];
+        for (sz r = 0; r < registers; ++r)
+        {
+            a[r] = _mm_load_si128(reinterpret_cast<__m128i const*>(s0 + r * 2));
+            b[r] = _mm_load_si128(reinterpret_cast<__m128i const*>(s1 + r * 2));
+        }
+
+        for (sz block = 0; block < blocks; ++block)
+        {
+            for (sz r = 0; r < registers; ++r)
+            {
+                _mm_store_si128(reinterpret_cast<__m128i*>(output + block * bulk_lanes + r * 2),
+                                _mm_add_epi64(a[r], b[r]));
+
+                b[r] = _mm_xor_si128(b[r], a[r]);
+                a[r] = _mm_xor_si128(_mm_xor_si128(rotl_m128<24>(a[r]), b[r]), _mm_slli_epi64(b[r], 16));
+                b[r] = rotl_m128<37>(b[r]);
+            }
+        }
+
+        for (sz r = 0; r < registers; ++r)
+        {
+            _mm_store_si128(reinterpret_cast<__m128i*>(s0 + r * 2), a[r]);
+            _mm_store_si128(reinterpret_cast<__m128i*>(s1 + r * 2), b[r]);
+        }
+    }
+
+    template <int Shift>
+    KEYCAP_TARGET("avx2")
+    __m256i rotl_m256(__m256i value) noexcept
+    {
+        return _mm256_or_si256(_mm256_slli_epi64(value, Shift), _mm256_srli_epi64(value, 64 - Shift));
+    }
+
+    KEYCAP_TARGET("avx2")
+    void generate_lanes_avx2(u64* s0, u64* s1, u64* output, sz blocks) noexcept
+    {
+        auto a0 = _mm256_load_si256(reinterpret_cast<__m256i const*>(s0));
+        auto a1 = _mm256_load_si256(reinterpret_cast<__m256i const*>(s0 + 4));
+        auto b0 = _mm256_load_si256(reinterpret_cast<__m256i const*>(s1));
+        auto b1 = _mm256_load_si256(reinterpret_cast<__m256i const*>(s1 + 4));
+
+        for (sz block = 0; block < blocks; ++block)
+        {
+            _mm256_store_si256(reinterpret_cast<__m256i*>(output + block * bulk_lanes), _mm256_add_epi64(a0, b0));
+            _mm256_store_si256(reinterpret_cast<__m256i*>(output + block * bulk_lanes + 4), _mm256_add_epi64(a1, b1));
+
+            b0 = _mm256_xor_si256(b0, a0);
+            b1 = _mm256_xor_si256(b1, a1);
+            a0 = _mm256_xor_si256(_mm256_xor_si256(rotl_m256<24>(a0), b0), _mm256_slli_epi64(b0, 16));
+            a1 = _mm256_xor_si256(_mm256_xor_si256(rotl_m256<24>(a1), b1), _mm256_slli_epi64(b1, 16));
+            b0 = rotl_m256<37>(b0);
+            b1 = rotl_m256<37>(b1);
+        }
+
+        _mm256_store_si256(reinterpret_cast<__m256i*>(s0), a0);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(s0 + 4), a1);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(s1), b0);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(s1 + 4), b1);
+    }
+
+    KEYCAP_TARGET("avx512f")
+    void generate_lanes_avx512(u64* s0, u64* s1, u64* output, sz blocks) noexcept
+    {
+        auto a = _mm512_load_si512(s0);
+        auto b = _mm512_load_si512(s1);
+
+        // The masked forms with all lanes selected avoid a -Wmaybe-uninitialized false positive in GCC 12's headers
+        constexpr __mmask8 all = 0xFF;
+        for (sz block = 0; block < blocks; ++block)
+        {
+            _mm512_store_si512(output + block * bulk_lanes, _mm512_add_epi64(a, b));
+
+            b = _mm512_xor_si512(b, a);
+            a = _mm512_xor_si512(_mm512_xor_si512(_mm512_mask_rol_epi64(a, all, a, 24), b),
+                                 _mm512_mask_slli_epi64(b, all, b, 16));
+            b = _mm512_mask_rol_epi64(b, all, b, 37);
+        }
+
+        _mm512_store_si512(s0, a);
+        _mm512_store_si512(s1, b);
+    }
+#endif
+
+    void generate_lanes(u64* s0, u64* s1, u64* output, sz blocks) noexcept
+    {
+#if KEYCAP_SIMD_X86
+        switch (keycap::simd::max_instruction_set())
+        {
+            case keycap::simd::instruction_set::avx512:
+                return generate_lanes_avx512(s0, s1, output, blocks);
+            case keycap::simd::instruction_set::avx2:
+                return generate_lanes_avx2(s0, s1, output, blocks);
+            case keycap::simd::instruction_set::sse2:
+                return generate_lanes_sse2(s0, s1, output, blocks);
+            case keycap::simd::instruction_set::scalar:
+                break;
+        }
+#endif
+        generate_lanes_scalar(s0, s1, output, blocks);
+    }
+
+#if KEYCAP_SIMD_X86
+    /// <summary>
+    /// Moves the low 32 bits of every 64-bit lane of lo and hi into the 8 lanes of the result, keeping their order
+    /// </summary>
+    KEYCAP_TARGET("avx2")
+    __m256i gather_low_halves_m256(__m256i lo, __m256i hi) noexcept
+    {
+        auto const interleaved = _mm256_blend_epi32(lo, _mm256_slli_epi64(hi, 32), 0b10101010);
+        return _mm256_permutevar8x32_epi32(interleaved, _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7));
+    }
+
+    /// <summary>
+    /// Maps count raw values to count u32 using Lemire's method without rejecting, see bulk_mapping. Returns false if
+    /// any value should have been rejected. If range is 0 the upper 32 bits are returned as they are.
+    /// </summary>
+    KEYCAP_TARGET("avx2")
+    bool map_u32_avx2(u64 const* raw, u32* output, sz count, u32 min, u64 range, u64 threshold) noexcept
+    {
+        auto const range_vector = _mm256_set1_epi64x(static_cast<i64>(range));
+        auto const threshold_vector = _mm256_set1_epi64x(static_cast<i64>(threshold));
+        auto const low_mask = _mm256_set1_epi64x(0xFFFFFFFF);
+        auto const min_vector = _mm256_set1_epi32(static_cast<i32>(min));
+
+        auto rejected = _mm256_setzero_si256();
+        for (sz i = 0; i < count; i += 8)
+        {
+            auto lo = _mm256_srli_epi64(_mm256_load_si256(reinterpret_cast<__m256i const*>(raw + i)), 32);
+            auto hi = _mm256_srli_epi64(_mm256_load_si256(reinterpret_cast<__m256i const*>(raw + i + 4)), 32);
+            if (range != 0)
+            {
+                lo = _mm256_mul_epu32(lo, range_vector);
+                hi = _mm256_mul_epu32(hi, range_vector);
+
+                // Both sides are below 2^32, so the signed comparison is exact
+                rejected = _mm256_or_si256(rejected,
+                                           _mm256_cmpgt_epi64(threshold_vector, _mm256_and_si256(lo, low_mask)));
+                rejected = _mm256_or_si256(rejected,
+                                           _mm256_cmpgt_epi64(threshold_vector, _mm256_and_si256(hi, low_mask)));
+                lo = _mm256_srli_epi64(lo, 32);
+                hi = _mm256_srli_epi64(hi, 32);
+            }
+
+            auto const values = _mm256_add_epi32(gather_low_halves_m256(lo, hi), min_vector);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + i), values);
+        }
+
+        return _mm256_testz_si256(rejected, rejected) != 0;
+    }
+
+    KEYCAP_TARGET("avx2")
+    void map_f64_avx2(u64 const* raw, f64* output, sz count, f64 min, f64 span, f64 max, f64 fallback) noexcept
+    {
+        auto const one = _mm256_set1_epi64x(0x3FF0000000000000ll);
+        auto const one_f64 = _mm256_set1_pd(1.0);
+
+        for (sz i = 0; i < count; i += 4)
+        {
+            auto const bits = _mm256_or_si256(
+                _mm256_srli_epi64(_mm256_load_si256(reinterpret_cast<__m256i const*>(raw + i)), 12), one);
+            auto const unit = _mm256_sub_pd(_mm256_castsi256_pd(bits), one_f64);
+
+            // Multiply and add separately, a fused multiply-add would round differently than the scalar path
+            auto const result = _mm256_add_pd(_mm256_set1_pd(min), _mm256_mul_pd(_mm256_set1_pd(span), unit));
+            auto const below_max = _mm256_cmp_pd(result, _mm256_set1_pd(max), _CMP_LT_OQ);
+            _mm256_storeu_pd(output + i, _mm256_blendv_pd(_mm256_set1_pd(fallback), result, below_max));
+        }
+    }
+
+    KEYCAP_TARGET("avx2")
+    void map_f32_avx2(u64 const* raw, f32* output, sz count, f32 min, f32 span, f32 max, f32 fallback) noexcept
+    {
+        auto const one = _mm256_set1_epi32(0x3F800000);
+        auto const one_f32 = _mm256_set1_ps(1.0f);
+
+        for (sz i = 0; i < count; i += 8)
+        {
+            auto const lo = _mm256_srli_epi64(_mm256_load_si256(reinterpret_cast<__m256i const*>(raw + i)), 41);
+            auto const hi = _mm256_srli_epi64(_mm256_load_si256(reinterpret_cast<__m256i const*>(raw + i + 4)), 41);
+            auto const bits = _mm256_or_si256(gather_low_halves_m256(lo, hi), one);
+            auto const unit = _mm256_sub_ps(_mm256_castsi256_ps(bits), one_f32);
+
+            auto const result = _mm256_add_ps(_mm256_set1_ps(min), _mm256_mul_ps(_mm256_set1_ps(span), unit));
+            auto const below_max = _mm256_cmp_ps(result, _mm256_set1_ps(max), _CMP_LT_OQ);
+            _mm256_storeu_ps(output + i, _mm256_blendv_ps(_mm256_set1_ps(fallback), result, below_max));
+        }
+    }
+#endif
+
+    /// <summary>
+    /// Maps raw engine output onto [min, max] for integers and [min, max) for floating point numbers, exactly like
+    /// the single value functions do. Blocks are mapped without branches; only if a block contains a value that
+    /// Lemire's method rejects is it mapped again, skipping the rejected values.
+    /// </summary>
+    template <typename T>
+    class bulk_mapping
+    {
+      public:
+        constexpr bulk_mapping(T min, T max) noexcept
+          : min_{min}
+          , max_{max}
+        {
+            if constexpr (std::floating_point<T>)
+            {
+                span_ = max - min;
+                fallback_ = min < max ? std::nextafter(max, min) : min;
+            }
+            else
+            {
+                auto const span = static_cast<unsigned_type>(static_cast<unsigned_type>(max) -
+                                                             static_cast<unsigned_type>(min));
+                full_range_ = span == std::numeric_limits<unsigned_type>::max();
+                if constexpr (sizeof(T) <= sizeof(u32))
+                {
+                    range_ = full_range_ ? 0 : static_cast<u32>(span) + 1;
+                    threshold_ = full_range_ ? 0 : static_cast<u32>((0u - static_cast<u32>(range_)) % range_);
+                }
+                else
+                {
+                    range_ = full_range_ ? 0 : static_cast<u64>(span) + 1;
+                    threshold_ = full_range_ ? 0 : (0ull - range_) % range_;
+                }
+            }
+        }
+
+        /// <summary>
+        /// Maps count raw values to count results. Returns false if any of them had to be rejected, in which case
+        /// the results must be discarded. raw must be aligned to 32 bytes and hold count rounded up to a multiple of
+        /// bulk_lanes values.
+        /// </summary>
+        bool map_all(u64 const* raw, T* output, sz count) const noexcept
+        {
+#if KEYCAP_SIMD_X86
+            if (keycap::simd::max_instruction_set() >= keycap::simd::instruction_set::avx2)
+            {
+                auto const vectorized = count - count % bulk_lanes;
+                if (!map_vectorized_avx2(raw, output, vectorized))
+                    return false;
+
+                return map_all_scalar(raw + vectorized, output + vectorized, count - vectorized);
+            }
+#endif
+            return map_all_scalar(raw, output, count);
+        }
+
+        /// <summary>
+        /// Maps raw values, skipping rejected ones, until either the raw values are exhausted or capacity results
+        /// have been written. Returns the number of results written.
+        /// </summary>
+        sz map_accepted(u64 const* raw, sz count, T* output, sz capacity) const noexcept
+        {
+            sz written = 0;
+            for (sz i = 0; i < count && written < capacity; ++i)
+            {
+                bool rejected = false;
+                auto const value = map(raw[i], rejected);
+                if (!rejected)
+                    output[written++] = value;
+            }
+
+            return written;
+        }
+
+      private:
+        using unsigned_type = std::make_unsigned_t<std::conditional_t<std::integral<T>, T, int>>;
+
+        bool map_all_scalar(u64 const* raw, T* output, sz count) const noexcept
+        {
+            bool rejected = false;
+            for (sz i = 0; i < count; ++i)
+                output[i] = map(raw[i], rejected);
+
+            return !rejected;
+        }
+
+#if KEYCAP_SIMD_X86
+        bool map_vectorized_avx2(u64 const* raw, T* output, sz count) const noexcept
+        {
+            if constexpr (std::same_as<T, f64>)
+            {
+                map_f64_avx2(raw, output, count, min_, span_, max_, fallback_);
+                return true;
+            }
+            else if constexpr (std::same_as<T, f32>)
+            {
+                map_f32_avx2(raw, output, count, min_, span_, max_, fallback_);
+                return true;
+            }
+            else if constexpr (sizeof(T) == sizeof(u32))
+            {
+                return map_u32_avx2(raw, reinterpret_cast<u32*>(output), count, static_cast<u32>(min_), range_,
+                                    threshold_);
+            }
+            else if constexpr (sizeof(T) < sizeof(u32))
+            {
+                // Narrower types keep the upper bits of a full range value, which the u32 kernel does not
+                if (full_range_)
+                    return map_all_scalar(raw, output, count);
+
+                alignas(32) std::array<u32, bulk_lanes * 8> wide;
+                for (sz i = 0; i < count; i += wide.size())
+                {
+                    auto const chunk = std::min(count - i, wide.size());
+                    if (!map_u32_avx2(raw + i, wide.data(), chunk, static_cast<u32>(min_), range_, threshold_))
+                        return false;
+
+                    for (sz j = 0; j < chunk; ++j)
+                        output[i + j] = static_cast<T>(wide[j]);
+                }
+                return true;
+            }
+            else
+            {
+                return map_all_scalar(raw, output, count);
+            }
+        }
+#endif
+
+        [[nodiscard]] T map(u64 raw, bool& rejected) const noexcept
+        {
+            if constexpr (std::floating_point<T>)
+            {
+                T unit;
+                if constexpr (sizeof(T) == sizeof(f32))
+                    unit = std::bit_cast<f32>(static_cast<u32>(raw >> 41) | 0x3F800000u) - 1.0f;
+                else
+                    unit = std::bit_cast<f64>((raw >> 12) | 0x3FF0000000000000ull) - 1.0;
+
+                auto const result = min_ + span_ * unit;
+                return result < max_ ? result : fallback_;
+            }
+            else
+            {
+                u64 offset;
+                if (full_range_)
+                {
+                    offset = raw >> (64 - std::numeric_limits<unsigned_type>::digits);
+                }
+                else if constexpr (sizeof(T) <= sizeof(u32))
+                {
+                    u64 const product = (raw >> 32) * range_;
+                    rejected |= static_cast<u32>(product) < threshold_;
+                    offset = product >> 32;
+                }
+                else
+                {
+                    u64 low;
+                    offset = multiply_high(raw, range_, low);
+                    rejected |= low < threshold_;
+                }
+
+                return static_cast<T>(
+                    static_cast<unsigned_type>(static_cast<unsigned_type>(min_) + static_cast<unsigned_type>(offset)));
+            }
+        }
+
+        T min_;
+        T max_;
+        T span_{};
+        T fallback_{};
+        bool full_range_ = false;
+        u64 range_ = 0;
+        u64 threshold_ = 0;
+    };
+}
+
+namespace keycap::random
+{
+    // adapted from https://prng.di.unimi.it/splitmix64.c
+    template <sz N>
+    [[nodiscard]] constexpr std::array<u64, N> split_mix(u64 seed) noexcept
+    {
+        constexpr auto mix = [](u64& seed) noexcept -> u64 {
+            u64 z = (seed += 0x9e3779b97f4a7c15);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+            return z ^ (z >> 31);
+        };
+
+        std::array<u64, N> state;
+        for (auto& word : state)
+            word = mix(seed);
+
+        return state;
+    }
+
+    constexpr [[nodiscard]] std::array<u64, 2> split_mix_64(u64 seed) noexcept
+    {
+        return split_mix<2>(seed);
+    }
+
+    // adapted from https://prng.di.unimi.it/xoroshiro128plus.c
+    export struct xoroshiro128plus
+    {
+        using result_type = u64;
+
+        constexpr [[nodiscard]] xoroshiro128plus(u64 seed) noexcept
+          : state_{split_mix_64(seed)}
+        {
+        }
+
+        constexpr [[nodiscard]] xoroshiro128plus() noexcept
+          : state_{split_mix_64(0x0F1E2D3C4B5A6978)}
+        {
+        }
+
+        void seed(u64 seed)
+        {
+            state_ = split_mix_64(seed);
+        }
+
+        constexpr [[nodiscard]] u64 operator()() noexcept
+        {
+            constexpr auto rotl = [](u64 const x, int const k) noexcept -> u64 {
+                return (x << k) | (x >> (64 - k));
+            };
+
+            u64 const s0 = state_[0];
+            u64 s1 = state_[1];
+            u64 const result = s0 + s1;
+
+            s1 ^= s0;
+            state_[0] = rotl(s0, 24) ^ s1 ^ (s1 << 16);
+            state_[1] = rotl(s1, 37);
+
+            return result;
+        }
+
+        /// <summary>
+        /// Advances the state by 2^64 calls to operator(). Calling jump repeatedly yields up to 2^64 non-overlapping
+        /// subsequences of 2^64 values each.
+        /// </summary>
+        constexpr void jump() noexcept
+        {
+            apply_jump({0xdf900294d8f554a5, 0x170865df4b3201fc});
+        }
+
+        /// <summary>
+        /// Advances the state by 2^96 calls to operator(). Calling long_jump repeatedly yields up to 2^32
+        /// non-overlapping subsequences of 2^96 values each, every one of which can be split further using jump.
+        /// </summary>
+        constexpr void long_jump() noexcept
+        {
+            apply_jump({0xd2a98b26625eee7b, 0xdddf9b1090aa7ac1});
+        }
+
+        [[nodiscard]] constexpr std::array<u64, 2> const& state() const noexcept
+        {
+            return state_;
+        }
+
+        static constexpr [[nodiscard]] u64 min() noexcept
+        {
+            return std::numeric_limits<u64>::lowest();
+        }
+
+        static constexpr [[nodiscard]] u64 max() noexcept
+        {
+            return std::numeric_limits<u64>::max();
+        }
+
+        [[nodiscard]] constexpr bool operator==(xoroshiro128plus const&) const noexcept = default;
+
+      private:
+        constexpr void apply_jump(std::array<u64, 2> const& polynomial) noexcept
+        {
+            std::array<u64, 2> jumped{};
+            for (auto const word : polynomial)
+            {
+                for (int bit = 0; bit < 64; ++bit)
+                {
+                    if (word & (u64{1} << bit))
+                    {
+                        jumped[0] ^= state_[0];
+                        jumped[1] ^= state_[1];
+                    }
+                    (void)(*this)();
+                }
+            }
+
+            state_ = jumped;
+        }
+
+        std::array<u64, 2> state_;
+    };
+
+    /// <summary>
+    /// Engines the random_* functions and fill accept: uniform random bit generators producing the full range of u64
+    /// </summary>
+    export template <typename Engine>
+    concept random_engine = std::uniform_random_bit_generator<Engine> &&
+                            std::same_as<std::invoke_result_t<Engine&>, u64> && (Engine::min() == 0) &&
+                            (Engine::max() == std::numeric_limits<u64>::max());
+
+    // adapted from https://prng.di.unimi.it/xoshiro256starstar.c
+    /// <summary>
+    /// xoshiro256**: 256 bits of state, all 64 output bits are of high quality. Slightly slower than xoroshiro128+.
+    /// </summary>
+    export class xoshiro256starstar
+    {
+      public:
+        using result_type = u64;
+
+        constexpr xoshiro256starstar() noexcept
+          : xoshiro256starstar{0x0F1E2D3C4B5A6978}
+        {
+        }
+
+        constexpr explicit xoshiro256starstar(u64 seed) noexcept
+          : state_{split_mix<4>(seed)}
+        {
+        }
+
+        constexpr void seed(u64 seed) noexcept
+        {
+            state_ = split_mix<4>(seed);
+        }
+
+        [[nodiscard]] constexpr u64 operator()() noexcept
+        {
+            u64 const result = std::rotl(state_[1] * 5, 7) * 9;
+            u64 const t = state_[1] << 17;
+
+            state_[2] ^= state_[0];
+            state_[3] ^= state_[1];
+            state_[1] ^= state_[2];
+            state_[0] ^= state_[3];
+
+            state_[2] ^= t;
+            state_[3] = std::rotl(state_[3], 45);
+
+            return result;
+        }
+
+        /// <summary>
+        /// Advances the state by 2^128 calls to operator()
+        /// </summary>
+        constexpr void jump() noexcept
+        {
+            apply_jump({0x180ec6d33cfd0aba, 0xd5a61266f0c9392c, 0xa9582618e03fc9aa, 0x39abdc4529b1661c});
+        }
+
+        /// <summary>
+        /// Advances the state by 2^192 calls to operator()
+        /// </summary>
+        constexpr void long_jump() noexcept
+        {
+            apply_jump({0x76e15d3efefdcbbf, 0xc5004e441c522fb3, 0x77710069854ee241, 0x39109bb02acbe635});
+        }
+
+        [[nodiscard]] constexpr std::array<u64, 4> const& state() const noexcept
+        {
+            return state_;
+        }
+
+        [[nodiscard]] static constexpr u64 min() noexcept
+        {
+            return std::numeric_limits<u64>::lowest();
+        }
+
+        [[nodiscard]] static constexpr u64 max() noexcept
+        {
+            return std::numeric_limits<u64>::max();
+        }
+
+        [[nodiscard]] constexpr bool operator==(xoshiro256starstar const&) const noexcept = default;
+
+      private:
+        constexpr void apply_jump(std::array<u64, 4> const& polynomial) noexcept
+        {
+            std::array<u64, 4> jumped{};
+            for (auto const word : polynomial)
+            {
+                for (int bit = 0; bit < 64; ++bit)
+                {
+                    if (word & (u64{1} << bit))
+                    {
+                        for (sz i = 0; i < jumped.size(); ++i)
+                            jumped[i] ^= state_[i];
+                    }
+                    (void)(*this)();
+                }
+            }
+
+            state_ = jumped;
+        }
+
+        std::array<u64, 4> state_;
+    };
+
+    // adapted from https://github.com/imneme/pcg-cpp (pcg_engines::setseq_xsl_rr_128_64)
+    /// <summary>
+    /// PCG64 (XSL-RR 128/64): a 128-bit LCG with a permuted output. Distinct stream values yield distinct sequences.
+    /// Produces the same values as pcg-cpp's pcg64 for the same seed and stream.
+    /// </summary>
+    export class pcg64
+    {
+      public:
+        using result_type = u64;
+
+        constexpr pcg64() noexcept
+          : pcg64{0x0F1E2D3C4B5A6978}
+        {
+        }
+
+        constexpr explicit pcg64(u64 seed) noexcept
+          : increment_{default_increment}
+        {
+            this->seed(seed);
+        }
+
+        constexpr pcg64(u64 seed, u64 stream) noexcept
+          : increment_{(stream << 1) | 1, stream >> 63}
+        {
+            this->seed(seed);
+        }
+
+        constexpr void seed(u64 seed) noexcept
+        {
+            state_ = impl::add(impl::u128{seed, 0}, increment_);
+            bump();
+        }
+
+        [[nodiscard]] constexpr u64 operator()() noexcept
+        {
+            bump();
+
+            auto const rotation = static_cast<int>(state_.high >> 58);
+            return std::rotr(state_.high ^ state_.low, rotation);
+        }
+
+        [[nodiscard]] static constexpr u64 min() noexcept
+        {
+            return std::numeric_limits<u64>::lowest();
+        }
+
+        [[nodiscard]] static constexpr u64 max() noexcept
+        {
+            return std::numeric_limits<u64>::max();
+        }
+
+        [[nodiscard]] constexpr bool operator==(pcg64 const&) const noexcept = default;
+
+      private:
+        static constexpr impl::u128 multiplier{0x4385df649fccf645, 0x2360ed051fc65da4};
+        static constexpr impl::u128 default_increment{0x14057b7ef767814f, 0x5851f42d4c957f2d};
 
-export module keycap.core:random;
+        constexpr void bump() noexcept
+        {
+            state_ = impl::add(impl::multiply(state_, multiplier), increment_);
+        }
 
-import :types;
+        impl::u128 state_{};
+        impl::u128 increment_;
+    };
 
-namespace keycap::random
-{
-    // adapted from https://prng.di.unimi.it/splitmix64.c
-    constexpr [[nodiscard]] std::array<u64, 2> split_mix_64(u64 seed) noexcept
+    // adapted from https://github.com/wangyi-fudan/wyhash (wyrand, final version 4)
+    /// <summary>
+    /// wyrand: a 64-bit counter passed through a multiply-xor mix. The fastest engine here, its period is 2^64.
+    /// </summary>
+    export class wyrand
     {
-        constexpr auto mix = [](u64& seed) noexcept -> u64 {
-            u64 z = (seed += 0x9e3779b97f4a7c15);
-            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
-            z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
-            return z ^ (z >> 31);
-        };
+      public:
+        using result_type = u64;
 
-        return {mix(seed), mix(seed)};
-    }
+        constexpr wyrand() noexcept
+          : wyrand{0x0F1E2D3C4B5A6978}
+        {
+        }
 
-    // adapted from https://prng.di.unimi.it/xoroshiro128plus.c
-    struct xoroshiro128plus
-    {
-        constexpr [[nodiscard]] xoroshiro128plus(u64 seed) noexcept
-          : state_{split_mix_64(seed)}
+        constexpr explicit wyrand(u64 seed) noexcept
+          : state_{seed}
         {
         }
 
-        constexpr [[nodiscard]] xoroshiro128plus() noexcept
-          : state_{split_mix_64(0x0F1E2D3C4B5A6978)}
+        constexpr void seed(u64 seed) noexcept
         {
+            state_ = seed;
         }
 
-        void seed(u64 seed)
+        [[nodiscard]] constexpr u64 operator()() noexcept
         {
-            state_ = split_mix_64(seed);
+            state_ += 0x2d358dccaa6c78a5;
+
+            u64 low;
+            u64 const high = impl::multiply_high(state_, state_ ^ 0x8bb84b93962eacc9, low);
+            return low ^ high;
         }
 
-        constexpr [[nodiscard]] u64 operator()() noexcept
+        [[nodiscard]] static constexpr u64 min() noexcept
         {
-            constexpr auto rotl = [](u64 const x, int const k) noexcept -> u64 {
-                return (x << k) | (x >> (64 - k));
-            };
+            return std::numeric_limits<u64>::lowest();
+        }
 
-            u64 const s0 = state_[0];
-            u64 s1 = state_[1];
-            u64 const result = s0 + s1;
+        [[nodiscard]] static constexpr u64 max() noexcept
+        {
+            return std::numeric_limits<u64>::max();
+        }
 
-            s1 ^= s0;
-            state_[0] = rotl(s0, 24) ^ s1 ^ (s1 << 16);
-            state_[1] = rotl(s1, 37);
+        [[nodiscard]] constexpr bool operator==(wyrand const&) const noexcept = default;
 
-            return result;
+      private:
+        u64 state_;
+    };
+
+    /// <summary>
+    /// Hands out non-overlapping streams of a single master seed, e.g. one per thread or per task of a parallel
+    /// Monte-Carlo run. Stream i is the master engine advanced by i long jumps, so streams are 2^96 values apart.
+    /// Results stay reproducible as long as every task is given the same stream index.
+    /// </summary>
+    export class stream_registry
+    {
+      public:
+        explicit stream_registry(u64 master_seed) noexcept
+          : master_{master_seed}
+          , next_{master_}
+        {
         }
 
-        static constexpr [[nodiscard]] u64 min() noexcept
+        /// <summary>
+        /// Returns the next unused stream. Thread-safe, constant time.
+        /// </summary>
+        [[nodiscard]] xoroshiro128plus next_stream()
         {
-            return std::numeric_limits<u64>::lowest();
+            std::scoped_lock lock{mutex_};
+
+            auto const stream = next_;
+            next_.long_jump();
+            return stream;
         }
 
-        static constexpr [[nodiscard]] u64 max() noexcept
+        /// <summary>
+        /// Returns the stream with the given index, regardless of which streams have been handed out so far. Takes
+        /// time linear in the index.
+        /// </summary>
+        [[nodiscard]] xoroshiro128plus stream(u64 index) const noexcept
         {
-            return std::numeric_limits<u64>::max();
+            auto stream = master_;
+            for (u64 i = 0; i < index; ++i)
+                stream.long_jump();
+
+            return stream;
         }
 
       private:
-        std::array<u64, 2> state_;
+        xoroshiro128plus const master_;
+
+        std::mutex mutex_;
+        xoroshiro128plus next_;
+    };
+
+    /// <summary>
+    /// impl::bulk_lanes interleaved xoroshiro128+ states, advanced in lockstep using SIMD. Lane i starts i + 1 jumps
+    /// ahead of the engine it was created from, so the lanes never overlap each other or that engine.
+    /// </summary>
+    struct xoroshiro128plus_lanes
+    {
+        explicit xoroshiro128plus_lanes(xoroshiro128plus const& origin) noexcept
+        {
+            reset(origin);
+        }
+
+        void reset(xoroshiro128plus const& origin) noexcept
+        {
+            // Jumping takes a few microseconds, so it is deferred until the lanes are actually used
+            origin_ = origin;
+            jumped_ = false;
+        }
+
+        /// <summary>
+        /// Writes blocks * impl::bulk_lanes values to output
+        /// </summary>
+        void generate(u64* output, sz blocks) noexcept
+        {
+            if (!jumped_)
+            {
+                for (sz lane = 0; lane < impl::bulk_lanes; ++lane)
+                {
+                    origin_.jump();
+                    s0_[lane] = origin_.state()[0];
+                    s1_[lane] = origin_.state()[1];
+                }
+                jumped_ = true;
+            }
+
+            impl::generate_lanes(s0_.data(), s1_.data(), output, blocks);
+        }
+
+      private:
+        alignas(64) std::array<u64, impl::bulk_lanes> s0_;
+        alignas(64) std::array<u64, impl::bulk_lanes> s1_;
+
+        xoroshiro128plus origin_;
+        bool jumped_ = false;
+    };
+
+    /// <summary>
+    /// The engines behind the random_* functions and fill of a single thread
+    /// </summary>
+    struct thread_engines
+    {
+        explicit thread_engines(xoroshiro128plus const& stream) noexcept
+          : single{stream}
+          , lanes{stream}
+        {
+        }
+
+        void reset(xoroshiro128plus const& stream) noexcept
+        {
+            single = stream;
+            lanes.reset(stream);
+        }
+
+        xoroshiro128plus single;
+        xoroshiro128plus_lanes lanes;
     };
 
-    static thread_local xoroshiro128plus prng;
+    /// <summary>
+    /// A thread that neither called seed nor use_stream draws its own stream from here on first use, so no two threads
+    /// produce the same sequence. Which stream a thread gets depends on the order in which threads first use the
+    /// random functions, so these sequences are not reproducible.
+    /// </summary>
+    stream_registry& thread_streams()
+    {
+        static stream_registry registry{0x0F1E2D3C4B5A6978};
+        return registry;
+    }
+
+    // Created on first use, so that seeding a thread before that does not use up a stream of thread_streams()
+    static thread_local std::optional<thread_engines> engines;
+
+    [[nodiscard]] thread_engines& local_engines() noexcept
+    {
+        if (!engines) [[unlikely]]
+            engines.emplace(thread_streams().next_stream());
+
+        return *engines;
+    }
 
     /// <summary>
-    /// Seeds the PRNG's with the given value
+    /// Seeds the calling thread's PRNG's with the given value. Together with use_stream, this is the only way to get
+    /// reproducible sequences from the random_* functions and fill.
     /// </summary>
     /// <param name="seed">The value to seed the PRNG with</param>
     export void seed(u64 seed)
     {
-        prng.seed(seed);
+        engines.emplace(xoroshiro128plus{seed});
+    }
+
+    /// <summary>
+    /// Makes the calling thread's random_* functions and fill draw from the given stream, e.g. one handed out by a
+    /// stream_registry. Together with seed, this is the only way to get reproducible sequences.
+    /// </summary>
+    /// <param name="stream">The stream to draw from</param>
+    export void use_stream(xoroshiro128plus const& stream)
+    {
+        engines.emplace(stream);
+    }
+
+    /// <summary>
+    /// Returns the calling thread's engine behind the random_* functions, for use by other partitions
+    /// </summary>
+    xoroshiro128plus& thread_engine() noexcept
+    {
+        return local_engines().single;
+    }
+
+    /// <summary>
+    /// Writes blocks * impl::bulk_lanes raw values of the calling thread's bulk PRNG to output
+    /// </summary>
+    void generate_bulk(u64* output, sz blocks)
+    {
+        local_engines().lanes.generate(output, blocks);
     }
 
     /// <summary>
@@ -91,8 +1066,7 @@ namespace keycap::random
     /// <returns>A random value between min and max (inclusive)</returns>
     export i8 random_i8(i8 const min = std::numeric_limits<i8>::min(), i8 const max = std::numeric_limits<i8>::max())
     {
-        std::uniform_int_distribution<i16> dist(min, max);
-        return static_cast<i8>(dist(prng));
+        return impl::uniform_int<i8>(local_engines().single, min, max);
     }
 
     /// <summary>
@@ -104,8 +1078,7 @@ namespace keycap::random
     /// <returns>A random value between min and max (inclusive)</returns>
     export u8 random_u8(u8 const min = std::numeric_limits<u8>::min(), u8 const max = std::numeric_limits<u8>::max())
     {
-        std::uniform_int_distribution<u16> dist(min, max);
-        return static_cast<u8>(dist(prng));
+        return impl::uniform_int<u8>(local_engines().single, min, max);
     }
 
     /// <summary>
@@ -118,8 +1091,7 @@ namespace keycap::random
     export i16 random_i16(i16 const min = std::numeric_limits<i16>::min(),
                           i16 const max = std::numeric_limits<i16>::max())
     {
-        std::uniform_int_distribution<i16> dist(min, max);
-        return dist(prng);
+        return impl::uniform_int<i16>(local_engines().single, min, max);
     }
 
     /// <summary>
@@ -132,8 +1104,7 @@ namespace keycap::random
     export u16 random_u16(u16 const min = std::numeric_limits<u16>::min(),
                           u16 const max = std::numeric_limits<u16>::max())
     {
-        std::uniform_int_distribution<u16> dist(min, max);
-        return dist(prng);
+        return impl::uniform_int<u16>(local_engines().single, min, max);
     }
 
     /// <summary>
@@ -146,8 +1117,7 @@ namespace keycap::random
     export i32 random_i32(i32 const min = std::numeric_limits<i32>::min(),
                           i32 const max = std::numeric_limits<i32>::max())
     {
-        std::uniform_int_distribution<i32> dist(min, max);
-        return dist(prng);
+        return impl::uniform_int<i32>(local_engines().single, min, max);
     }
 
     /// <summary>
@@ -160,8 +1130,7 @@ namespace keycap::random
     export u32 random_u32(u32 const min = std::numeric_limits<u32>::min(),
                           u32 const max = std::numeric_limits<u32>::max())
     {
-        std::uniform_int_distribution<u32> dist(min, max);
-        return dist(prng);
+        return impl::uniform_int<u32>(local_engines().single, min, max);
     }
 
     /// <summary>
@@ -174,8 +1143,7 @@ namespace keycap::random
     export i64 random_i64(i64 const min = std::numeric_limits<i64>::min(),
                           i64 const max = std::numeric_limits<i64>::max())
     {
-        std::uniform_int_distribution<i64> dist(min, max);
-        return dist(prng);
+        return impl::uniform_int<i64>(local_engines().single, min, max);
     }
 
     /// <summary>
@@ -188,7 +1156,307 @@ namespace keycap::random
     export u64 random_u64(u64 const min = std::numeric_limits<u64>::min(),
                           u64 const max = std::numeric_limits<u64>::max())
     {
-        std::uniform_int_distribution<u64> dist(min, max);
-        return dist(prng);
+        return impl::uniform_int<u64>(local_engines().single, min, max);
+    }
+
+    /// <summary>
+    /// Generates a pseudo-random f32 in [0, 1). Very fast, thread-safe, not cryptographically safe.
+    /// </summary>
+    /// <returns>A random value in [0, 1)</returns>
+    export f32 random_f32()
+    {
+        return impl::unit_f32(local_engines().single);
+    }
+
+    /// <summary>
+    /// Generates a pseudo-random f32 between min (inclusive) and max (exclusive). Very fast, thread-safe, not
+    /// cryptographically safe.
+    /// </summary>
+    /// <param name="min">The lower bound (inclusive)</param>
+    /// <param name="max">The upper bound (exclusive)</param>
+    /// <returns>A random value in [min, max)</returns>
+    export f32 random_f32(f32 const min, f32 const max)
+    {
+        return impl::scale_unit(impl::unit_f32(local_engines().single), min, max);
+    }
+
+    /// <summary>
+    /// Generates a pseudo-random f64 in [0, 1). Very fast, thread-safe, not cryptographically safe.
+    /// </summary>
+    /// <returns>A random value in [0, 1)</returns>
+    export f64 random_f64()
+    {
+        return impl::unit_f64(local_engines().single);
+    }
+
+    /// <summary>
+    /// Generates a pseudo-random f64 between min (inclusive) and max (exclusive). Very fast, thread-safe, not
+    /// cryptographically safe.
+    /// </summary>
+    /// <param name="min">The lower bound (inclusive)</param>
+    /// <param name="max">The upper bound (exclusive)</param>
+    /// <returns>A random value in [min, max)</returns>
+    export f64 random_f64(f64 const min, f64 const max)
+    {
+        return impl::scale_unit(impl::unit_f64(local_engines().single), min, max);
+    }
+
+    /// <summary>
+    /// Generates a pseudo-random i8 between min and max (inclusive) using the given engine
+    /// </summary>
+    /// <param name="engine">The engine to draw from</param>
+    /// <param name="min">The lower bound (inclusive)</param>
+    /// <param name="max">The upper bound (inclusive)</param>
+    /// <returns>A random value between min and max (inclusive)</returns>
+    export template <random_engine Engine>
+    i8 random_i8(Engine& engine, i8 const min = std::numeric_limits<i8>::min(),
+                 i8 const max = std::numeric_limits<i8>::max())
+    {
+        return impl::uniform_int<i8>(engine, min, max);
+    }
+
+    /// <summary>
+    /// Generates a pseudo-random u8 between min and max (inclusive) using the given engine
+    /// </summary>
+    /// <param name="engine">The engine to draw from</param>
+    /// <param name="min">The lower bound (inclusive)</param>
+    /// <param name="max">The upper bound (inclusive)</param>
+    /// <returns>A random value between min and max (inclusive)</returns>
+    export template <random_engine Engine>
+    u8 random_u8(Engine& engine, u8 const min = std::numeric_limits<u8>::min(),
+                 u8 const max = std::numeric_limits<u8>::max())
+    {
+        return impl::uniform_int<u8>(engine, min, max);
+    }
+
+    /// <summary>
+    /// Generates a pseudo-random i16 between min and max (inclusive) using the given engine
+    /// </summary>
+    /// <param name="engine">The engine to draw from</param>
+    /// <param name="min">The lower bound (inclusive)</param>
+    /// <param name="max">The upper bound (inclusive)</param>
+    /// <returns>A random value between min and max (inclusive)</returns>
+    export template <random_engine Engine>
+    i16 random_i16(Engine& engine, i16 const min = std::numeric_limits<i16>::min(),
+                   i16 const max = std::numeric_limits<i16>::max())
+    {
+        return impl::uniform_int<i16>(engine, min, max);
+    }
+
+    /// <summary>
+    /// Generates a pseudo-random u16 between min and max (inclusive) using the given engine
+    /// </summary>
+    /// <param name="engine">The engine to draw from</param>
+    /// <param name="min">The lower bound (inclusive)</param>
+    /// <param name="max">The upper bound (inclusive)</param>
+    /// <returns>A random value between min and max (inclusive)</returns>
+    export template <random_engine Engine>
+    u16 random_u16(Engine& engine, u16 const min = std::numeric_limits<u16>::min(),
+                   u16 const max = std::numeric_limits<u16>::max())
+    {
+        return impl::uniform_int<u16>(engine, min, max);
+    }
+
+    /// <summary>
+    /// Generates a pseudo-random i32 between min and max (inclusive) using the given engine
+    /// </summary>
+    /// <param name="engine">The engine to draw from</param>
+    /// <param name="min">The lower bound (inclusive)</param>
+    /// <param name="max">The upper bound (inclusive)</param>
+    /// <returns>A random value between min and max (inclusive)</returns>
+    export template <random_engine Engine>
+    i32 random_i32(Engine& engine, i32 const min = std::numeric_limits<i32>::min(),
+                   i32 const max = std::numeric_limits<i32>::max())
+    {
+        return impl::uniform_int<i32>(engine, min, max);
+    }
+
+    /// <summary>
+    /// Generates a pseudo-random u32 between min and max (inclusive) using the given engine
+    /// </summary>
+    /// <param name="engine">The engine to draw from</param>
+    /// <param name="min">The lower bound (inclusive)</param>
+    /// <param name="max">The upper bound (inclusive)</param>
+    /// <returns>A random value between min and max (inclusive)</returns>
+    export template <random_engine Engine>
+    u32 random_u32(Engine& engine, u32 const min = std::numeric_limits<u32>::min(),
+                   u32 const max = std::numeric_limits<u32>::max())
+    {
+        return impl::uniform_int<u32>(engine, min, max);
+    }
+
+    /// <summary>
+    /// Generates a pseudo-random i64 between min and max (inclusive) using the given engine
+    /// </summary>
+    /// <param name="engine">The engine to draw from</param>
+    /// <param name="min">The lower bound (inclusive)</param>
+    /// <param name="max">The upper bound (inclusive)</param>
+    /// <returns>A random value between min and max (inclusive)</returns>
+    export template <random_engine Engine>
+    i64 random_i64(Engine& engine, i64 const min = std::numeric_limits<i64>::min(),
+                   i64 const max = std::numeric_limits<i64>::max())
+    {
+        return impl::uniform_int<i64>(engine, min, max);
+    }
+
+    /// <summary>
+    /// Generates a pseudo-random u64 between min and max (inclusive) using the given engine
+    /// </summary>
+    /// <param name="engine">The engine to draw from</param>
+    /// <param name="min">The lower bound (inclusive)</param>
+    /// <param name="max">The upper bound (inclusive)</param>
+    /// <returns>A random value between min and max (inclusive)</returns>
+    export template <random_engine Engine>
+    u64 random_u64(Engine& engine, u64 const min = std::numeric_limits<u64>::min(),
+                   u64 const max = std::numeric_limits<u64>::max())
+    {
+        return impl::uniform_int<u64>(engine, min, max);
+    }
+
+    /// <summary>
+    /// Generates a pseudo-random f32 in [0, 1) using the given engine
+    /// </summary>
+    /// <param name="engine">The engine to draw from</param>
+    /// <returns>A random value in [0, 1)</returns>
+    export template <random_engine Engine>
+    f32 random_f32(Engine& engine)
+    {
+        return impl::unit_f32(engine);
+    }
+
+    /// <summary>
+    /// Generates a pseudo-random f32 between min (inclusive) and max (exclusive) using the given engine
+    /// </summary>
+    /// <param name="engine">The engine to draw from</param>
+    /// <param name="min">The lower bound (inclusive)</param>
+    /// <param name="max">The upper bound (exclusive)</param>
+    /// <returns>A random value in [min, max)</returns>
+    export template <random_engine Engine>
+    f32 random_f32(Engine& engine, f32 const min, f32 const max)
+    {
+        return impl::scale_unit(impl::unit_f32(engine), min, max);
+    }
+
+    /// <summary>
+    /// Generates a pseudo-random f64 in [0, 1) using the given engine
+    /// </summary>
+    /// <param name="engine">The engine to draw from</param>
+    /// <returns>A random value in [0, 1)</returns>
+    export template <random_engine Engine>
+    f64 random_f64(Engine& engine)
+    {
+        return impl::unit_f64(engine);
+    }
+
+    /// <summary>
+    /// Generates a pseudo-random f64 between min (inclusive) and max (exclusive) using the given engine
+    /// </summary>
+    /// <param name="engine">The engine to draw from</param>
+    /// <param name="min">The lower bound (inclusive)</param>
+    /// <param name="max">The upper bound (exclusive)</param>
+    /// <returns>A random value in [min, max)</returns>
+    export template <random_engine Engine>
+    f64 random_f64(Engine& engine, f64 const min, f64 const max)
+    {
+        return impl::scale_unit(impl::unit_f64(engine), min, max);
+    }
+
+    /// <summary>
+    /// Types that keycap::random::fill can generate
+    /// </summary>
+    export template <typename T>
+    concept fillable = (std::integral<T> && !std::same_as<T, bool>) || std::same_as<T, f32> || std::same_as<T, f64>;
+
+    /// <summary>
+    /// Fills values with raw output mapped onto [min, max]. generate(raw, wanted) must write at least wanted and at
+    /// most raw_size values to raw and return how many it wrote.
+    /// </summary>
+    template <typename T, typename Generate>
+    void fill_with(std::span<T> values, T const min, T const max, Generate&& generate)
+    {
+        constexpr sz raw_size = 512;
+        static_assert(raw_size % impl::bulk_lanes == 0);
+
+        impl::bulk_mapping<T> const mapping{min, max};
+        alignas(64) std::array<u64, raw_size> raw;
+
+        sz filled = 0;
+        while (filled < values.size())
+        {
+            auto const wanted = std::min(values.size() - filled, raw_size);
+            auto const generated = generate(raw.data(), wanted);
+
+            if (mapping.map_all(raw.data(), values.data() + filled, wanted))
+                filled += wanted;
+            else
+                filled += mapping.map_accepted(raw.data(), generated, values.data() + filled, wanted);
+        }
+    }
+
+    /// <summary>
+    /// Fills the given values with pseudo-random numbers between min and max, inclusive for integers and exclusive
+    /// of max for floating point numbers. Uses impl::bulk_lanes interleaved xoroshiro128+ states advanced with
+    /// SIMD; the output only depends on the seed, not on the instruction set. Very fast, thread-safe, not
+    /// cryptographically safe.
+    /// </summary>
+    /// <param name="values">The values to fill</param>
+    /// <param name="min">The lower bound (inclusive)</param>
+    /// <param name="max">The upper bound (inclusive for integers, exclusive for floating point numbers)</param>
+    export template <fillable T>
+    void fill(std::span<T> values, std::type_identity_t<T> const min, std::type_identity_t<T> const max)
+    {
+        fill_with(values, min, max, [](u64* raw, sz wanted) {
+            auto const blocks = (wanted + impl::bulk_lanes - 1) / impl::bulk_lanes;
+            generate_bulk(raw, blocks);
+            return blocks * impl::bulk_lanes;
+        });
+    }
+
+    /// <summary>
+    /// Fills the given values with pseudo-random numbers spanning the whole range of integers, or [0, 1) for
+    /// floating point numbers. Very fast, thread-safe, not cryptographically safe.
+    /// </summary>
+    /// <param name="values">The values to fill</param>
+    export template <fillable T>
+    void fill(std::span<T> values)
+    {
+        if constexpr (std::floating_point<T>)
+            fill(values, T{0}, T{1});
+        else
+            fill(values, std::numeric_limits<T>::min(), std::numeric_limits<T>::max());
+    }
+
+    /// <summary>
+    /// Fills the given values with pseudo-random numbers drawn from the given engine between min and max, inclusive
+    /// for integers and exclusive of max for floating point numbers
+    /// </summary>
+    /// <param name="engine">The engine to draw from</param>
+    /// <param name="values">The values to fill</param>
+    /// <param name="min">The lower bound (inclusive)</param>
+    /// <param name="max">The upper bound (inclusive for integers, exclusive for floating point numbers)</param>
+    export template <random_engine Engine, fillable T>
+    void fill(Engine& engine, std::span<T> values, std::type_identity_t<T> const min,
+              std::type_identity_t<T> const max)
+    {
+        fill_with(values, min, max, [&engine](u64* raw, sz wanted) {
+            for (sz i = 0; i < wanted; ++i)
+                raw[i] = engine();
+            return wanted;
+        });
+    }
+
+    /// <summary>
+    /// Fills the given values with pseudo-random numbers drawn from the given engine spanning the whole range of
+    /// integers, or [0, 1) for floating point numbers
+    /// </summary>
+    /// <param name="engine">The engine to draw from</param>
+    /// <param name="values">The values to fill</param>
+    export template <random_engine Engine, fillable T>
+    void fill(Engine& engine, std::span<T> values)
+    {
+        if constexpr (std::floating_point<T>)
+            fill(engine, values, T{0}, T{1});
+        else
+            fill(engine, values, std::numeric_limits<T>::min(), std::numeric_limits<T>::max());
     }
-}
\ No newline at end of file
+}
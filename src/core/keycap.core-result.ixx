@@ -0,0 +1,84 @@
+module;
+
+#include <fmt/format.h>
+
+#include <expected>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+export module keycap.core : result;
+
+import : error;
+import : types;
+
+namespace keycap
+{
+    /// <summary>
+    /// A compact description of an error, carrying the same codes as keycap::exception. Creating one neither allocates
+    /// nor captures a stack-trace, which makes it cheap enough for hot paths.
+    /// </summary>
+    export struct error_record
+    {
+        error_code error;
+        keycap::module module;
+        u64 fragment;
+        u32 line_number;
+
+        /// <summary>
+        /// A description of the error. Is not owned by the record, so it must outlive it, e.g. a string literal.
+        /// </summary>
+        std::string_view message;
+
+        /// <summary>
+        /// Formats the record just like keycap::exception::to_string(false) does
+        /// </summary>
+        [[nodiscard]] std::string to_string() const
+        {
+            return fmt::format("Error [{}-{}-{}-{}]: \"{}\"", static_cast<u64>(error), static_cast<u64>(module),
+                               fragment, line_number, message);
+        }
+
+        /// <summary>
+        /// Throws the equivalent keycap::exception
+        /// </summary>
+        [[noreturn]] void raise() const
+        {
+            throw exception{error, module, fragment, line_number, std::string{message}};
+        }
+
+        [[nodiscard]] constexpr bool operator==(error_record const&) const noexcept = default;
+    };
+
+    /// <summary>
+    /// Either a value or an error_record. Returned by the non-throwing try_* variants of fallible functions.
+    /// </summary>
+    export template <typename T>
+    using result = std::expected<T, error_record>;
+
+    /// <summary>
+    /// Creates the error state of a keycap::result
+    /// </summary>
+    /// <param name="message">A description of the error that outlives the result, e.g. a string literal</param>
+    export [[nodiscard]] constexpr std::unexpected<error_record> make_error(error_code error, keycap::module module,
+                                                                            u64 fragment, u32 line_number,
+                                                                            std::string_view message) noexcept
+    {
+        return std::unexpected{error_record{error, module, fragment, line_number, message}};
+    }
+
+    /// <summary>
+    /// Returns the value of the given result or throws its error as a keycap::exception. Bridges the try_* variants
+    /// to code that prefers exceptions.
+    /// </summary>
+    export template <typename T>
+    T value_or_throw(result<T>&& result)
+    {
+        if (!result)
+            result.error().raise();
+
+        if constexpr (!std::is_void_v<T>)
+            return std::move(*result);
+    }
+}
@@ -0,0 +1,489 @@
+module;
+
+#include "simd.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <concepts>
+#include <initializer_list>
+#include <limits>
+#include <ranges>
+#include <span>
+#include <utility>
+#include <vector>
+
+export module keycap.core : sampling;
+
+import : error;
+import : fragments;
+import : math;
+import : random;
+import : types;
+
+namespace impl
+{
+    /// <summary>
+    /// The number of swap targets shuffle draws per block, so their cache lines can be prefetched before swapping
+    /// </summary>
+    constexpr sz shuffle_block = 64;
+
+    /// <summary>
+    /// Shuffles of spans larger than this prefetch their swap targets; smaller spans are expected to be cached
+    /// </summary>
+    constexpr sz shuffle_prefetch_bytes = 1 << 20;
+
+    /// <summary>
+    /// Draws Count uniformly distributed indices from a single engine output: indices[j] is in [0, bound - j). The
+    /// product of the bounds must fit into 64 bits.
+    /// See Brackett-Rozinsky and Lemire, "Batched Ranged Random Integer Generation", https://arxiv.org/abs/2408.06213
+    /// </summary>
+    template <sz Count, typename Engine>
+    void batched_indices(Engine& engine, u64 bound, u64* indices) noexcept
+    {
+        auto const draw = [&] {
+            u64 remainder = engine();
+            for (sz j = 0; j < Count; ++j)
+                indices[j] = multiply_high(remainder, bound - j, remainder);
+            return remainder;
+        };
+
+        auto remainder = draw();
+
+        u64 product = bound;
+        for (sz j = 1; j < Count; ++j)
+            product *= bound - j;
+
+        if (remainder < product)
+        {
+            u64 const threshold = (0ull - product) % product;
+            while (remainder < threshold)
+                remainder = draw();
+        }
+    }
+
+    /// <summary>
+    /// Returns how many indices batched_indices can draw at once when the largest bound is the given one
+    /// </summary>
+    [[nodiscard]] constexpr sz batch_size(u64 bound) noexcept
+    {
+        if (bound > u64{1} << 32)
+            return 1;
+        if (bound > u64{1} << 21)
+            return 2;
+        if (bound > u64{1} << 16)
+            return 3;
+        if (bound > u64{1} << 10)
+            return 4;
+        return 6;
+    }
+
+    /// <summary>
+    /// Draws the swap targets of the Fisher-Yates positions remaining - 1, remaining - 2, ... into targets, batching
+    /// as many as possible per engine output. Returns the number of targets drawn, 0 once fewer than 2 values remain.
+    /// </summary>
+    template <typename Engine>
+    sz draw_swap_targets(Engine& engine, u64 remaining, std::array<u64, shuffle_block>& targets) noexcept
+    {
+        sz count = 0;
+        while (count < targets.size() && remaining - count > 1)
+        {
+            auto const bound = remaining - count;
+            auto* const output = targets.data() + count;
+
+            auto const batch = std::min({batch_size(bound), targets.size() - count, static_cast<sz>(bound - 1)});
+            switch (batch)
+            {
+                case 6:
+                    batched_indices<6>(engine, bound, output);
+                    break;
+                case 5:
+                    batched_indices<5>(engine, bound, output);
+                    break;
+                case 4:
+                    batched_indices<4>(engine, bound, output);
+                    break;
+                case 3:
+                    batched_indices<3>(engine, bound, output);
+                    break;
+                case 2:
+                    batched_indices<2>(engine, bound, output);
+                    break;
+                default:
+                    *output = bounded_u64(engine, bound);
+                    break;
+            }
+            count += batch;
+        }
+
+        return count;
+    }
+
+    /// <summary>
+    /// Hints the CPU to load the cache line holding the given address
+    /// </summary>
+    inline void prefetch([[maybe_unused]] void const* address) noexcept
+    {
+#if KEYCAP_SIMD_X86
+        _mm_prefetch(static_cast<char const*>(address), _MM_HINT_T0);
+#endif
+    }
+}
+
+namespace keycap::random
+{
+    /// <summary>
+    /// Draws indices with probabilities proportional to a list of weights in constant time per draw, using Vose's
+    /// variant of Walker's alias method. Building the table takes linear time.
+    /// </summary>
+    export class alias_table
+    {
+      public:
+        /// <summary>
+        /// Builds the table for the given weights
+        /// </summary>
+        /// <param name="weights">Non-negative, finite weights of which at least one is positive</param>
+        template <std::ranges::input_range R>
+            requires std::convertible_to<std::ranges::range_reference_t<R>, f64>
+        explicit alias_table(R&& weights)
+        {
+            std::vector<f64> scaled;
+            if constexpr (std::ranges::sized_range<R>)
+                scaled.reserve(std::ranges::size(weights));
+
+            for (auto&& weight : weights)
+                scaled.push_back(static_cast<f64>(weight));
+
+            build(std::move(scaled));
+        }
+
+        /// <summary>
+        /// Builds the table for the given weights
+        /// </summary>
+        /// <param name="weights">Non-negative, finite weights of which at least one is positive</param>
+        explicit alias_table(std::initializer_list<f64> weights)
+        {
+            build(std::vector<f64>(weights));
+        }
+
+        /// <summary>
+        /// Returns the number of weights the table was built from
+        /// </summary>
+        [[nodiscard]] sz size() const noexcept
+        {
+            return columns_.size();
+        }
+
+        /// <summary>
+        /// Draws an index in [0, size()) from the given engine
+        /// </summary>
+        template <random_engine Engine>
+        [[nodiscard]] sz operator()(Engine& engine) const noexcept
+        {
+            auto const index = impl::bounded_u64(engine, columns_.size());
+            auto const& column = columns_[index];
+            return engine() < column.threshold ? index : column.alias;
+        }
+
+        /// <summary>
+        /// Draws an index in [0, size()) from the calling thread's engine
+        /// </summary>
+        [[nodiscard]] sz operator()() const noexcept
+        {
+            return (*this)(thread_engine());
+        }
+
+      private:
+        /// <summary>
+        /// Column i yields i if the engine's next output is below the threshold and alias otherwise
+        /// </summary>
+        struct column
+        {
+            u64 threshold;
+            sz alias;
+        };
+
+        void build(std::vector<f64> scaled)
+        {
+            if (scaled.empty())
+            {
+                throw exception{error_code::invalid_argument, module::core, fragment::sampling, __LINE__,
+                                "Can not build an alias table without weights"};
+            }
+
+            f64 total = 0.0;
+            for (sz i = 0; i < scaled.size(); ++i)
+            {
+                if (!std::isfinite(scaled[i]) || scaled[i] < 0.0)
+                {
+                    throw exception{error_code::invalid_argument, module::core, fragment::sampling, __LINE__,
+                                    fmt::format("Weight {} is {}, weights must be finite and non-negative", i,
+                                                scaled[i])};
+                }
+                total += scaled[i];
+            }
+
+            if (!(total > 0.0) || !std::isfinite(total))
+            {
+                throw exception{error_code::invalid_argument, module::core, fragment::sampling, __LINE__,
+                                fmt::format("The weights sum up to {}, which is not a valid total", total)};
+            }
+
+            // Scale the weights so that they average 1; columns then get filled up to 1 by their alias
+            auto const factor = static_cast<f64>(scaled.size()) / total;
+            std::vector<sz> small;
+            std::vector<sz> large;
+            for (sz i = 0; i < scaled.size(); ++i)
+            {
+                scaled[i] *= factor;
+                (scaled[i] < 1.0 ? small : large).push_back(i);
+            }
+
+            columns_.resize(scaled.size());
+            while (!small.empty() && !large.empty())
+            {
+                auto const lesser = small.back();
+                small.pop_back();
+                auto const greater = large.back();
+
+                columns_[lesser] = {to_threshold(scaled[lesser]), greater};
+
+                scaled[greater] = (scaled[greater] + scaled[lesser]) - 1.0;
+                if (scaled[greater] < 1.0)
+                {
+                    large.pop_back();
+                    small.push_back(greater);
+                }
+            }
+
+            // Whatever remains is 1 up to rounding errors
+            for (auto const index : large)
+                columns_[index] = {std::numeric_limits<u64>::max(), index};
+            for (auto const index : small)
+                columns_[index] = {std::numeric_limits<u64>::max(), index};
+        }
+
+        [[nodiscard]] static u64 to_threshold(f64 probability) noexcept
+        {
+            auto const scaled = probability * 0x1.0p64;
+            return scaled >= 0x1.0p64 ? std::numeric_limits<u64>::max() : static_cast<u64>(scaled);
+        }
+
+        std::vector<column> columns_;
+    };
+
+    /// <summary>
+    /// Keeps a uniformly distributed sample of fixed size from a stream of unknown length, using Li's Algorithm L.
+    /// Once the reservoir is full only O(k * (1 + log(n / k))) random numbers are drawn for n values; ranges with
+    /// random access are skipped through without visiting the rejected values.
+    /// </summary>
+    export template <typename T, random_engine Engine = xoroshiro128plus>
+    class reservoir_sampler
+    {
+      public:
+        /// <summary>
+        /// Creates a sampler seeded from the calling thread's engine
+        /// </summary>
+        /// <param name="capacity">The size of the sample, must be positive</param>
+        explicit reservoir_sampler(sz capacity)
+          : reservoir_sampler{capacity, Engine{thread_engine()()}}
+        {
+        }
+
+        /// <summary>
+        /// Creates a sampler drawing from the given engine
+        /// </summary>
+        /// <param name="capacity">The size of the sample, must be positive</param>
+        /// <param name="engine">The engine to draw from</param>
+        reservoir_sampler(sz capacity, Engine engine)
+          : capacity_{capacity}
+          , engine_{std::move(engine)}
+        {
+            if (capacity == 0)
+            {
+                throw exception{error_code::invalid_argument, module::core, fragment::sampling, __LINE__,
+                                "The capacity of a reservoir_sampler must be positive"};
+            }
+
+            reservoir_.reserve(capacity);
+        }
+
+        /// <summary>
+        /// Offers the next value of the stream
+        /// </summary>
+        template <typename U>
+            requires std::constructible_from<T, U&&> && std::assignable_from<T&, U&&>
+        void push(U&& value)
+        {
+            if (reservoir_.size() < capacity_)
+            {
+                reservoir_.emplace_back(std::forward<U>(value));
+                if (++seen_ == capacity_)
+                    schedule(seen_);
+                return;
+            }
+
+            if (seen_ == next_)
+                accept(std::forward<U>(value));
+            ++seen_;
+        }
+
+        /// <summary>
+        /// Offers all values of the given range, in order
+        /// </summary>
+        template <std::ranges::input_range R>
+            requires std::constructible_from<T, std::ranges::range_reference_t<R>>
+        void push_range(R&& values)
+        {
+            if constexpr (std::ranges::random_access_range<R> && std::ranges::sized_range<R>)
+            {
+                auto const size = static_cast<u64>(std::ranges::size(values));
+                auto first = std::ranges::begin(values);
+
+                u64 index = 0;
+                for (; index < size && reservoir_.size() < capacity_; ++index)
+                    push(first[index]);
+                if (index == size)
+                    return;
+
+                // Jump straight to the values that get accepted
+                auto const end = seen_ + (size - index);
+                auto const base = seen_ - index;
+                while (next_ < end)
+                {
+                    seen_ = next_;
+                    accept(first[static_cast<std::ranges::range_difference_t<R>>(next_ - base)]);
+                }
+                seen_ = end;
+            }
+            else
+            {
+                for (auto&& value : values)
+                    push(std::forward<decltype(value)>(value));
+            }
+        }
+
+        /// <summary>
+        /// Returns the current sample. Holds every value seen so far while fewer than capacity values were offered.
+        /// </summary>
+        [[nodiscard]] std::span<T const> sample() const noexcept
+        {
+            return reservoir_;
+        }
+
+        /// <summary>
+        /// Returns the number of values offered so far
+        /// </summary>
+        [[nodiscard]] u64 seen() const noexcept
+        {
+            return seen_;
+        }
+
+        /// <summary>
+        /// Returns the size of the sample
+        /// </summary>
+        [[nodiscard]] sz capacity() const noexcept
+        {
+            return capacity_;
+        }
+
+        /// <summary>
+        /// Discards the sample to start over with a new stream. The engine is not reset.
+        /// </summary>
+        void clear() noexcept
+        {
+            reservoir_.clear();
+            seen_ = 0;
+            next_ = 0;
+            threshold_ = 1.0;
+        }
+
+      private:
+        template <typename U>
+        void accept(U&& value)
+        {
+            reservoir_[impl::bounded_u64(engine_, capacity_)] = std::forward<U>(value);
+            schedule(seen_ + 1);
+        }
+
+        /// <summary>
+        /// Determines the next value to accept, which is the given one or comes after it
+        /// </summary>
+        void schedule(u64 from) noexcept
+        {
+            auto const k = static_cast<f64>(capacity_);
+            threshold_ *= std::exp(std::log(open_unit()) / k);
+
+            auto const skip = std::floor(std::log(open_unit()) / std::log1p(-threshold_));
+            auto const remaining = static_cast<f64>(std::numeric_limits<u64>::max() - from);
+            next_ = skip < remaining ? from + static_cast<u64>(skip) : std::numeric_limits<u64>::max();
+        }
+
+        /// <summary>
+        /// Returns a uniformly distributed f64 in (0, 1]
+        /// </summary>
+        [[nodiscard]] f64 open_unit() noexcept
+        {
+            return 1.0 - impl::unit_f64(engine_);
+        }
+
+        sz capacity_;
+        Engine engine_;
+
+        std::vector<T> reservoir_;
+        u64 seen_ = 0;
+        u64 next_ = 0;
+        f64 threshold_ = 1.0;
+    };
+
+    /// <summary>
+    /// Shuffles the given values using the given engine. Every permutation is equally likely. A Fisher-Yates shuffle
+    /// that draws up to six swap indices from a single engine output and prefetches the swap targets of large spans.
+    /// </summary>
+    /// <param name="engine">The engine to draw from</param>
+    /// <param name="values">The values to shuffle</param>
+    export template <random_engine Engine, typename T, sz Extent>
+    void shuffle(Engine& engine, std::span<T, Extent> values)
+    {
+        bool const prefetch = values.size_bytes() > impl::shuffle_prefetch_bytes;
+        auto const draw = [&](u64 remaining, std::array<u64, impl::shuffle_block>& targets) {
+            auto const count = impl::draw_swap_targets(engine, remaining, targets);
+            if (prefetch)
+            {
+                for (sz j = 0; j < count; ++j)
+                    impl::prefetch(values.data() + targets[j]);
+            }
+            return count;
+        };
+
+        // The targets of the next block are drawn and prefetched while the current block is being swapped
+        std::array<std::array<u64, impl::shuffle_block>, 2> targets;
+        sz current = 0;
+
+        u64 remaining = values.size();
+        auto count = draw(remaining, targets[current]);
+        while (count > 0)
+        {
+            auto const next_count = draw(remaining - count, targets[current ^ 1]);
+
+            for (sz j = 0; j < count; ++j)
+                std::ranges::swap(values[remaining - 1 - j], values[targets[current][j]]);
+
+            remaining -= count;
+            count = next_count;
+            current ^= 1;
+        }
+    }
+
+    /// <summary>
+    /// Shuffles the given values using the calling thread's engine. Every permutation is equally likely.
+    /// </summary>
+    /// <param name="values">The values to shuffle</param>
+    export template <typename T, sz Extent>
+    void shuffle(std::span<T, Extent> values)
+    {
+        shuffle(thread_engine(), values);
+    }
+}
@@ -1,15 +1,134 @@
 module;
 
+#include <concepts>
+#include <cstddef>
 #include <deque>
 #include <exception>
 #include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
 
 export module keycap.core : scopeguard;
 
+import : error;
+import : fragments;
+import : types;
+
+namespace impl
+{
+    enum class scope_policy
+    {
+        exit,
+        success,
+        fail
+    };
+
+    /// <summary>
+    /// Tells whether a scope guard's handler has to run. Remembers the number of uncaught exceptions on construction,
+    /// so that a guard created while unwinding still notices whether its own scope is left by an exception.
+    /// </summary>
+    template <scope_policy Policy>
+    class scope_exit_condition
+    {
+      public:
+        [[nodiscard]] bool holds() const noexcept
+        {
+            if constexpr (Policy == scope_policy::success)
+                return std::uncaught_exceptions() <= uncaught_exceptions_;
+            else
+                return std::uncaught_exceptions() > uncaught_exceptions_;
+        }
+
+      private:
+        int uncaught_exceptions_ = std::uncaught_exceptions();
+    };
+
+    template <>
+    class scope_exit_condition<scope_policy::exit>
+    {
+      public:
+        [[nodiscard]] constexpr bool holds() const noexcept
+        {
+            return true;
+        }
+    };
+
+    /// <summary>
+    /// Stores a single handler inline and runs it on destruction if the policy's condition holds
+    /// </summary>
+    template <scope_policy Policy, typename Callable>
+    class basic_scope_guard
+    {
+      public:
+        template <typename F>
+            requires(!std::same_as<std::remove_cvref_t<F>, basic_scope_guard> && std::constructible_from<Callable, F>)
+        explicit basic_scope_guard(F&& func) noexcept(std::is_nothrow_constructible_v<Callable, F>)
+          : callable_{construct(std::forward<F>(func))}
+        {
+        }
+
+        basic_scope_guard(basic_scope_guard&& other) noexcept(std::is_nothrow_move_constructible_v<Callable>)
+            requires std::move_constructible<Callable>
+          : condition_{other.condition_}
+          , callable_{std::move(other.callable_)}
+          , active_{std::exchange(other.active_, false)}
+        {
+        }
+
+        basic_scope_guard(basic_scope_guard const&) = delete;
+        basic_scope_guard& operator=(basic_scope_guard const&) = delete;
+        basic_scope_guard& operator=(basic_scope_guard&&) = delete;
+
+        ~basic_scope_guard() noexcept(Policy != scope_policy::success || std::is_nothrow_invocable_v<Callable&>)
+        {
+            if (active_ && condition_.holds())
+                callable_();
+        }
+
+        /// <summary>
+        /// Prevents the handler from running
+        /// </summary>
+        void dismiss() noexcept
+        {
+            active_ = false;
+        }
+
+      private:
+        // Runs the handler right away if it can not be stored, unless it should only run on success
+        template <typename F>
+        static Callable construct(F&& func)
+        {
+            if constexpr (std::is_nothrow_constructible_v<Callable, F>)
+            {
+                return Callable(std::forward<F>(func));
+            }
+            else
+            {
+                try
+                {
+                    return Callable(std::forward<F>(func));
+                }
+                catch (...)
+                {
+                    if constexpr (Policy != scope_policy::success)
+                        func();
+                    throw;
+                }
+            }
+        }
+
+        [[no_unique_address]] scope_exit_condition<Policy> condition_;
+        Callable callable_;
+        bool active_ = true;
+    };
+}
+
 namespace keycap
 {
     /// <summary>
     /// Copied from https://stackoverflow.com/a/28413370/13692001
+    /// Allocates every handler on the heap; prefer scope_exit, scope_success, scope_fail or inplace_scope_guard.
     /// </summary>
     export class scope_guard
     {
@@ -79,4 +198,180 @@ namespace keycap
         std::deque<std::function<void()>> handlers_;
         execution policy_ = always;
     };
+
+    /// <summary>
+    /// Runs the given callable when leaving the scope. The callable is stored inline, so the guard neither allocates
+    /// nor calls through type erasure.
+    /// </summary>
+    /// <example>
+    /// auto* file = std::fopen(path, "r");
+    /// keycap::scope_exit close{[&] { std::fclose(file); }};
+    /// </example>
+    export template <typename Callable>
+    class scope_exit : public impl::basic_scope_guard<impl::scope_policy::exit, Callable>
+    {
+      public:
+        using impl::basic_scope_guard<impl::scope_policy::exit, Callable>::basic_scope_guard;
+    };
+
+    export template <typename Callable>
+    scope_exit(Callable) -> scope_exit<Callable>;
+
+    /// <summary>
+    /// Runs the given callable when leaving the scope normally, i.e. not because of an exception. The callable is
+    /// stored inline.
+    /// </summary>
+    export template <typename Callable>
+    class scope_success : public impl::basic_scope_guard<impl::scope_policy::success, Callable>
+    {
+      public:
+        using impl::basic_scope_guard<impl::scope_policy::success, Callable>::basic_scope_guard;
+    };
+
+    export template <typename Callable>
+    scope_success(Callable) -> scope_success<Callable>;
+
+    /// <summary>
+    /// Runs the given callable when leaving the scope because of an exception. The callable is stored inline.
+    /// </summary>
+    export template <typename Callable>
+    class scope_fail : public impl::basic_scope_guard<impl::scope_policy::fail, Callable>
+    {
+      public:
+        using impl::basic_scope_guard<impl::scope_policy::fail, Callable>::basic_scope_guard;
+    };
+
+    export template <typename Callable>
+    scope_fail(Callable) -> scope_fail<Callable>;
+
+    /// <summary>
+    /// A drop-in replacement for scope_guard that stores up to Capacity handlers of up to HandlerSize bytes each
+    /// inline instead of on the heap. Handlers run in reverse order of their addition, and exceptions thrown by them
+    /// are swallowed. Unlike scope_guard, the policy is evaluated against the number of uncaught exceptions at
+    /// construction, so guards created during stack unwinding behave correctly.
+    /// </summary>
+    /// <typeparam name="Capacity">The maximum number of handlers</typeparam>
+    /// <typeparam name="HandlerSize">The maximum size of a single handler, e.g. a lambda capturing three
+    /// references</typeparam>
+    export template <sz Capacity, sz HandlerSize = 3 * sizeof(void*)>
+    class inplace_scope_guard
+    {
+      public:
+        using execution = scope_guard::execution;
+
+        explicit inplace_scope_guard(execution policy = scope_guard::always) noexcept
+          : policy_{policy}
+        {
+        }
+
+        template <class Callable>
+        inplace_scope_guard(Callable&& func, execution policy = scope_guard::always)
+          : policy_{policy}
+        {
+            *this += std::forward<Callable>(func);
+        }
+
+        // Handlers may point into the guard's scope, so it stays where it was created
+        inplace_scope_guard(inplace_scope_guard const&) = delete;
+        inplace_scope_guard& operator=(inplace_scope_guard const&) = delete;
+
+        /// <summary>
+        /// Adds a handler. If the guard is full, the handler runs right away (unless the policy is no_exception) and a
+        /// keycap::exception is thrown.
+        /// </summary>
+        template <class Callable>
+        inplace_scope_guard& operator+=(Callable&& func)
+        {
+            using handler = std::decay_t<Callable>;
+            static_assert(sizeof(handler) <= HandlerSize, "The handler is larger than HandlerSize");
+            static_assert(alignof(handler) <= alignof(std::max_align_t), "The handler is over-aligned");
+
+            try
+            {
+                if (size_ == Capacity)
+                {
+                    throw exception{error_code::buffer_overflow, module::core, fragment::scopeguard, __LINE__,
+                                    "inplace_scope_guard can not hold any more handlers"};
+                }
+
+                auto& slot = slots_[size_];
+                ::new (static_cast<void*>(slot.storage)) handler(std::forward<Callable>(func));
+                slot.run = [](void* storage, bool invoke) noexcept {
+                    auto& h = *std::launder(static_cast<handler*>(storage));
+                    if (invoke)
+                    {
+                        try
+                        {
+                            h();
+                        }
+                        catch (...)
+                        {
+                        }
+                    }
+                    h.~handler();
+                };
+                ++size_;
+            }
+            catch (...)
+            {
+                if (policy_ != scope_guard::no_exception)
+                    func();
+                throw;
+            }
+
+            return *this;
+        }
+
+        ~inplace_scope_guard()
+        {
+            auto const exceptional = std::uncaught_exceptions() > uncaught_exceptions_;
+            auto const invoke = policy_ == scope_guard::always || (exceptional == (policy_ == scope_guard::exception));
+            run(invoke);
+        }
+
+        /// <summary>
+        /// Removes all handlers without running them
+        /// </summary>
+        void dismiss() noexcept
+        {
+            run(false);
+        }
+
+        /// <summary>
+        /// Returns the number of handlers
+        /// </summary>
+        [[nodiscard]] sz size() const noexcept
+        {
+            return size_;
+        }
+
+        /// <summary>
+        /// Returns the maximum number of handlers
+        /// </summary>
+        [[nodiscard]] static constexpr sz capacity() noexcept
+        {
+            return Capacity;
+        }
+
+      private:
+        void run(bool invoke) noexcept
+        {
+            while (size_ > 0)
+            {
+                auto& slot = slots_[--size_];
+                slot.run(slot.storage, invoke);
+            }
+        }
+
+        struct slot
+        {
+            alignas(std::max_align_t) std::byte storage[HandlerSize];
+            void (*run)(void* storage, bool invoke) noexcept;
+        };
+
+        slot slots_[Capacity];
+        sz size_ = 0;
+        execution policy_;
+        int uncaught_exceptions_ = std::uncaught_exceptions();
+    };
 }
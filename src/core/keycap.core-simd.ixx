@@ -0,0 +1,149 @@
+module;
+
+#include "simd.hpp"
+
+#if KEYCAP_SIMD_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#include <algorithm>
+#include <atomic>
+
+export module keycap.core : simd;
+
+import : types;
+
+namespace keycap::simd
+{
+    /// <summary>
+    /// The instruction sets keycap provides optimized code paths for, ordered from least to most capable
+    /// </summary>
+    export enum class instruction_set : u8 //
+    {
+        scalar,
+        sse2,
+        avx2,
+        avx512,
+    };
+
+    /// <summary>
+    /// Individual CPU features that are not implied by the instruction_set alone
+    /// </summary>
+    export struct cpu_features
+    {
+        bool sse2 = false;
+        bool avx2 = false;
+        bool bmi2 = false;
+        bool avx512f = false;
+    };
+}
+
+namespace impl
+{
+#if KEYCAP_SIMD_X86
+    void cpuid(int leaf, int subleaf, int (&registers)[4]) noexcept
+    {
+#ifdef _MSC_VER
+        __cpuidex(registers, leaf, subleaf);
+#else
+        unsigned int a = 0, b = 0, c = 0, d = 0;
+        __cpuid_count(leaf, subleaf, a, b, c, d);
+        registers[0] = static_cast<int>(a);
+        registers[1] = static_cast<int>(b);
+        registers[2] = static_cast<int>(c);
+        registers[3] = static_cast<int>(d);
+#endif
+    }
+
+    [[nodiscard]] u64 xgetbv() noexcept
+    {
+#ifdef _MSC_VER
+        return _xgetbv(0);
+#else
+        unsigned int eax = 0, edx = 0;
+        __asm__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+        return (static_cast<u64>(edx) << 32) | eax;
+#endif
+    }
+#endif
+
+    [[nodiscard]] keycap::simd::cpu_features detect_cpu_features() noexcept
+    {
+        keycap::simd::cpu_features features;
+#if KEYCAP_SIMD_X86
+        int registers[4] = {};
+        cpuid(0, 0, registers);
+        int const max_leaf = registers[0];
+
+        cpuid(1, 0, registers);
+        features.sse2 = (registers[3] & (1 << 26)) != 0;
+
+        // The OS has to save the extended registers on context switches, otherwise we must not use them
+        bool const os_saves_ymm = (registers[2] & (1 << 27)) != 0 && (xgetbv() & 0x06) == 0x06;
+        bool const os_saves_zmm = os_saves_ymm && (xgetbv() & 0xE6) == 0xE6;
+
+        if (max_leaf >= 7)
+        {
+            cpuid(7, 0, registers);
+            features.avx2 = os_saves_ymm && (registers[1] & (1 << 5)) != 0;
+            features.bmi2 = (registers[1] & (1 << 8)) != 0;
+            features.avx512f = os_saves_zmm && (registers[1] & (1 << 16)) != 0;
+        }
+#endif
+        return features;
+    }
+
+    std::atomic<keycap::simd::instruction_set> instruction_set_limit{keycap::simd::instruction_set::avx512};
+}
+
+namespace keycap::simd
+{
+    /// <summary>
+    /// Returns the features supported by the CPU the application is running on. Detected once and cached afterwards.
+    /// </summary>
+    export [[nodiscard]] cpu_features const& detected_features() noexcept
+    {
+        static cpu_features const features = impl::detect_cpu_features();
+        return features;
+    }
+
+    /// <summary>
+    /// Returns the most capable instruction_set supported by the CPU the application is running on
+    /// </summary>
+    export [[nodiscard]] instruction_set detected_instruction_set() noexcept
+    {
+        auto const& features = detected_features();
+        if (features.avx512f && features.avx2)
+            return instruction_set::avx512;
+        if (features.avx2)
+            return instruction_set::avx2;
+        if (features.sse2)
+            return instruction_set::sse2;
+
+        return instruction_set::scalar;
+    }
+
+    /// <summary>
+    /// Returns the instruction_set all runtime-dispatched code paths will use. This is the detected instruction_set,
+    /// capped by limit_instruction_set.
+    /// </summary>
+    export [[nodiscard]] instruction_set max_instruction_set() noexcept
+    {
+        static instruction_set const detected = detected_instruction_set();
+        return std::min(detected, impl::instruction_set_limit.load(std::memory_order_relaxed));
+    }
+
+    /// <summary>
+    /// Caps the instruction_set used by runtime-dispatched code paths. Mainly useful for testing and benchmarking the
+    /// fallback paths on a capable machine.
+    /// </summary>
+    /// <returns>The previous limit</returns>
+    export instruction_set limit_instruction_set(instruction_set limit) noexcept
+    {
+        return impl::instruction_set_limit.exchange(limit, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,289 @@
+module;
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+export module keycap.core : source;
+
+import : string;
+import : types;
+
+namespace impl
+{
+    /// <summary>
+    /// Hashes std::string keys and allows looking them up by std::string_view
+    /// </summary>
+    struct transparent_string_hash
+    {
+        using is_transparent = void;
+
+        [[nodiscard]] sz operator()(std::string_view string) const noexcept
+        {
+            return static_cast<sz>(keycap::hash_u64(string));
+        }
+    };
+}
+
+namespace keycap
+{
+    /// <summary>
+    /// The contents of a source file with an index of where its lines start. The file is read once, so that later
+    /// changes to it do not affect the lines already handed out.
+    /// </summary>
+    export class source_file
+    {
+      public:
+        /// <summary>
+        /// Reads the file at the given path and indexes its lines. Returns nullptr if it can not be read.
+        /// </summary>
+        [[nodiscard]] static std::shared_ptr<source_file const> load(std::string const& path)
+        {
+            std::error_code error;
+            if (!std::filesystem::is_regular_file(path, error))
+                return nullptr;
+
+            std::ifstream stream{path, std::ios::binary};
+            if (!stream)
+                return nullptr;
+
+            std::string contents{std::istreambuf_iterator<char>{stream}, std::istreambuf_iterator<char>{}};
+            if (stream.bad())
+                return nullptr;
+
+            return std::shared_ptr<source_file const>{new source_file{std::move(contents)}};
+        }
+
+        /// <summary>
+        /// Returns the given line (1-based) without its line break, or an empty string if there is no such line.
+        /// Constant time.
+        /// </summary>
+        [[nodiscard]] std::string_view line(u32 number) const noexcept
+        {
+            if (number == 0 || number > line_count())
+                return {};
+
+            auto const start = line_starts_[number - 1];
+            auto line = std::string_view{contents_}.substr(start, line_starts_[number] - start);
+
+            if (line.ends_with('\n'))
+                line.remove_suffix(1);
+            if (line.ends_with('\r'))
+                line.remove_suffix(1);
+            return line;
+        }
+
+        /// <summary>
+        /// Returns the given line (1-based) and up to context lines before and context + 1 lines after it, one per row
+        /// and prefixed with their number. The given line is marked with '>'. Returns an empty string if there is no
+        /// such line, e.g. because the location of a stack frame is unknown.
+        /// </summary>
+        [[nodiscard]] std::string excerpt(u32 number, u32 context) const
+        {
+            if (number == 0 || number > line_count())
+                return {};
+
+            std::string buffer;
+
+            u32 const first = number > context ? number - context : 1;
+            u32 const last = std::min(number + context + 1, line_count());
+            for (u32 i = first; i <= last; ++i)
+                buffer += fmt::format("   {} {}:    {}\n", i == number ? '>' : ' ', i, line(i));
+
+            return buffer;
+        }
+
+        /// <summary>
+        /// Returns the number of lines
+        /// </summary>
+        [[nodiscard]] u32 line_count() const noexcept
+        {
+            return static_cast<u32>(line_starts_.size() - 1);
+        }
+
+        /// <summary>
+        /// Returns the number of bytes of the contents and the line index
+        /// </summary>
+        [[nodiscard]] sz size_bytes() const noexcept
+        {
+            return contents_.size() + line_starts_.size() * sizeof(sz);
+        }
+
+      private:
+        explicit source_file(std::string contents)
+          : contents_{std::move(contents)}
+        {
+            line_starts_.push_back(0);
+            for (auto position = contents_.find('\n'); position != std::string::npos;
+                 position = contents_.find('\n', position + 1))
+                line_starts_.push_back(position + 1);
+
+            // The last line does not need to end with a line break
+            if (line_starts_.back() != contents_.size())
+                line_starts_.push_back(contents_.size());
+        }
+
+        std::string contents_;
+
+        // Line i (0-based) spans [line_starts_[i], line_starts_[i + 1])
+        std::vector<sz> line_starts_;
+    };
+
+    /// <summary>
+    /// Caches source files for error reports, so that every file is read only once. The least recently
+    /// used files are evicted once the cache exceeds its capacity. Files that could not be read are cached as well.
+    /// Files are read into memory, so a file that changes after it has been cached keeps showing its old lines until
+    /// it is evicted or the cache is cleared.
+    /// Thread-safe.
+    /// </summary>
+    export class source_cache
+    {
+      public:
+        /// <summary>
+        /// Creates a cache holding up to the given number of bytes of file contents and line indices
+        /// </summary>
+        explicit source_cache(sz capacity_bytes = 64 * 1024 * 1024)
+          : capacity_{capacity_bytes}
+        {
+        }
+
+        source_cache(source_cache const&) = delete;
+        source_cache& operator=(source_cache const&) = delete;
+
+        /// <summary>
+        /// Returns the process-wide cache used by keycap::exception
+        /// </summary>
+        [[nodiscard]] static source_cache& global()
+        {
+            static source_cache cache;
+            return cache;
+        }
+
+        /// <summary>
+        /// Returns the given file, loading it on first use, or nullptr if it can not be read. The file stays valid
+        /// while it is referenced, even if it gets evicted in the meantime.
+        /// </summary>
+        [[nodiscard]] std::shared_ptr<source_file const> get(std::string_view path)
+        {
+            {
+                std::scoped_lock lock{mutex_};
+                if (auto const entry = entries_.find(path); entry != entries_.end())
+                {
+                    recently_used_.splice(recently_used_.begin(), recently_used_, entry->second);
+                    return entry->second->file;
+                }
+            }
+
+            // Load without holding the lock, so that threads reporting from other files are not blocked
+            std::string key{path};
+            auto file = source_file::load(key);
+            auto const cost = key.size() + (file ? file->size_bytes() : 0);
+
+            std::scoped_lock lock{mutex_};
+            if (auto const entry = entries_.find(path); entry != entries_.end())
+            {
+                recently_used_.splice(recently_used_.begin(), recently_used_, entry->second);
+                return entry->second->file;
+            }
+
+            if (cost > capacity_)
+                return file;
+
+            recently_used_.push_front({key, file, cost});
+            entries_.emplace(std::move(key), recently_used_.begin());
+            size_bytes_ += cost;
+            evict();
+
+            return file;
+        }
+
+        /// <summary>
+        /// Returns the given line (1-based) of the given file, or an empty string if there is no such line. The
+        /// returned string does not depend on the cache.
+        /// </summary>
+        [[nodiscard]] std::string line(std::string_view path, u32 number)
+        {
+            auto const file = get(path);
+            return file ? std::string{file->line(number)} : std::string{};
+        }
+
+        /// <summary>
+        /// Changes the capacity, evicting files if necessary
+        /// </summary>
+        void set_capacity(sz capacity_bytes)
+        {
+            std::scoped_lock lock{mutex_};
+            capacity_ = capacity_bytes;
+            evict();
+        }
+
+        /// <summary>
+        /// Evicts all files
+        /// </summary>
+        void clear()
+        {
+            std::scoped_lock lock{mutex_};
+            entries_.clear();
+            recently_used_.clear();
+            size_bytes_ = 0;
+        }
+
+        /// <summary>
+        /// Returns the number of cached files
+        /// </summary>
+        [[nodiscard]] sz file_count() const
+        {
+            std::scoped_lock lock{mutex_};
+            return entries_.size();
+        }
+
+        /// <summary>
+        /// Returns the number of bytes the cached files take up
+        /// </summary>
+        [[nodiscard]] sz size_bytes() const
+        {
+            std::scoped_lock lock{mutex_};
+            return size_bytes_;
+        }
+
+      private:
+        struct entry
+        {
+            std::string path;
+            std::shared_ptr<source_file const> file;
+            sz cost;
+        };
+
+        void evict()
+        {
+            while (size_bytes_ > capacity_)
+            {
+                auto const& oldest = recently_used_.back();
+                size_bytes_ -= oldest.cost;
+                entries_.erase(entries_.find(oldest.path));
+                recently_used_.pop_back();
+            }
+        }
+
+        mutable std::mutex mutex_;
+        sz capacity_;
+        sz size_bytes_ = 0;
+
+        // The most recently used file comes first
+        std::list<entry> recently_used_;
+        std::unordered_map<std::string, std::list<entry>::iterator, impl::transparent_string_hash, std::equal_to<>>
+            entries_;
+    };
+}
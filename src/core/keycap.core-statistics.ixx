@@ -0,0 +1,236 @@
+module;
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <string_view>
+#include <vector>
+
+export module keycap.core : statistics;
+
+import : random;
+import : types;
+
+namespace impl
+{
+    /// <summary>
+    /// Returns the regularized upper incomplete gamma function Q(a, x) = 1 - P(a, x)
+    /// </summary>
+    [[nodiscard]] f64 regularized_gamma_q(f64 a, f64 x)
+    {
+        if (x <= 0.0)
+            return 1.0;
+
+        constexpr int max_iterations = 10'000;
+        constexpr f64 epsilon = 1e-15;
+        auto const log_prefix = a * std::log(x) - x - std::lgamma(a);
+
+        if (x < a + 1.0)
+        {
+            // Series expansion of P(a, x)
+            f64 term = 1.0 / a;
+            f64 sum = term;
+            for (int n = 1; n < max_iterations && std::abs(term) > std::abs(sum) * epsilon; ++n)
+            {
+                term *= x / (a + n);
+                sum += term;
+            }
+
+            return 1.0 - sum * std::exp(log_prefix);
+        }
+
+        // Continued fraction of Q(a, x), evaluated using the modified Lentz method
+        constexpr f64 tiny = std::numeric_limits<f64>::min() / epsilon;
+        f64 b = x + 1.0 - a;
+        f64 c = 1.0 / tiny;
+        f64 d = 1.0 / b;
+        f64 h = d;
+        for (int n = 1; n < max_iterations; ++n)
+        {
+            auto const an = -n * (n - a);
+            b += 2.0;
+            d = an * d + b;
+            d = std::abs(d) < tiny ? tiny : d;
+            c = b + an / c;
+            c = std::abs(c) < tiny ? tiny : c;
+            d = 1.0 / d;
+
+            auto const delta = d * c;
+            h *= delta;
+            if (std::abs(delta - 1.0) < epsilon)
+                break;
+        }
+
+        return std::exp(log_prefix) * h;
+    }
+
+    /// <summary>
+    /// Returns the probability of a chi-square statistic of at least the given value
+    /// </summary>
+    [[nodiscard]] f64 chi_square_p_value(f64 statistic, f64 degrees_of_freedom)
+    {
+        return regularized_gamma_q(degrees_of_freedom / 2.0, statistic / 2.0);
+    }
+
+    /// <summary>
+    /// Returns P(X <= k) for a Poisson distributed X with the given mean
+    /// </summary>
+    [[nodiscard]] f64 poisson_cdf(u64 k, f64 mean)
+    {
+        return regularized_gamma_q(static_cast<f64>(k) + 1.0, mean);
+    }
+}
+
+namespace keycap::random
+{
+    /// <summary>
+    /// The outcome of a single statistical test
+    /// </summary>
+    export struct statistical_test_result
+    {
+        /// <summary>
+        /// The name of the test
+        /// </summary>
+        std::string_view name;
+
+        /// <summary>
+        /// The test statistic, e.g. chi-square
+        /// </summary>
+        f64 statistic = 0.0;
+
+        /// <summary>
+        /// The probability of a statistic at least this extreme for a perfect generator
+        /// </summary>
+        f64 p_value = 0.0;
+
+        /// <summary>
+        /// A test fails if the p-value is suspiciously close to either 0 (too bad) or 1 (too good to be random)
+        /// </summary>
+        /// <param name="alpha">The significance level per tail</param>
+        [[nodiscard]] bool passed(f64 alpha = 1e-4) const noexcept
+        {
+            return p_value > alpha && p_value < 1.0 - alpha;
+        }
+    };
+
+    /// <summary>
+    /// Counts how often each of the 64 output bits is set. For a good engine every bit is set half the time; the
+    /// deviations are combined into a chi-square statistic with 64 degrees of freedom.
+    /// </summary>
+    /// <param name="engine">The engine to test</param>
+    /// <param name="samples">The number of values to draw</param>
+    export template <random_engine Engine>
+    [[nodiscard]] statistical_test_result bit_frequency_test(Engine& engine, sz samples = 1 << 20)
+    {
+        std::array<u64, 64> ones{};
+        for (sz i = 0; i < samples; ++i)
+        {
+            auto const value = engine();
+            for (sz bit = 0; bit < ones.size(); ++bit)
+                ones[bit] += (value >> bit) & 1;
+        }
+
+        auto const expected = static_cast<f64>(samples) / 2.0;
+        f64 statistic = 0.0;
+        for (auto const count : ones)
+        {
+            auto const deviation = static_cast<f64>(count) - expected;
+            statistic += deviation * deviation / (expected / 2.0);
+        }
+
+        return {"bit frequency", statistic, impl::chi_square_p_value(statistic, ones.size())};
+    }
+
+    /// <summary>
+    /// Marsaglia's birthday spacings test: draws 512 birthdays in a year of 2^24 days, taken from the bits starting
+    /// at the given shift, and counts repeated spacings between sorted birthdays. The repeats of all repetitions
+    /// follow a Poisson distribution with mean 2 * repetitions.
+    /// </summary>
+    /// <param name="engine">The engine to test</param>
+    /// <param name="shift">The lowest of the 24 bits to use, 40 tests the upper and 0 the lower bits</param>
+    /// <param name="repetitions">The number of years to simulate</param>
+    export template <random_engine Engine>
+    [[nodiscard]] statistical_test_result birthday_spacings_test(Engine& engine, u32 shift = 40,
+                                                                sz repetitions = 2'000)
+    {
+        constexpr sz birthdays = 512;
+        constexpr u32 day_bits = 24;
+        constexpr f64 mean_repeats = static_cast<f64>(birthdays * birthdays * birthdays) / (4.0 * (1 << day_bits));
+
+        std::vector<u32> days(birthdays);
+        std::vector<u32> spacings(birthdays);
+
+        u64 repeats = 0;
+        for (sz repetition = 0; repetition < repetitions; ++repetition)
+        {
+            for (auto& day : days)
+                day = static_cast<u32>((engine() >> shift) & ((1u << day_bits) - 1));
+
+            std::ranges::sort(days);
+            spacings[0] = days[0];
+            for (sz i = 1; i < birthdays; ++i)
+                spacings[i] = days[i] - days[i - 1];
+
+            std::ranges::sort(spacings);
+            for (sz i = 1; i < birthdays; ++i)
+                repeats += spacings[i] == spacings[i - 1];
+        }
+
+        // P(X >= repeats); statistical_test_result::passed rejects both too many and too few repeats
+        auto const mean = mean_repeats * static_cast<f64>(repetitions);
+        auto const p_value = repeats == 0 ? 1.0 : 1.0 - impl::poisson_cdf(repeats - 1, mean);
+        return {"birthday spacings", static_cast<f64>(repeats), p_value};
+    }
+
+    /// <summary>
+    /// Knuth's gap test: measures the gaps between values in [0, 1/16) and compares the distribution of their
+    /// lengths against the geometric distribution using a chi-square test.
+    /// </summary>
+    /// <param name="engine">The engine to test</param>
+    /// <param name="gaps">The number of gaps to measure</param>
+    export template <random_engine Engine>
+    [[nodiscard]] statistical_test_result gap_test(Engine& engine, sz gaps = 1 << 18)
+    {
+        constexpr f64 probability = 1.0 / 16.0;
+        constexpr sz longest_gap = 64;
+
+        std::array<u64, longest_gap + 1> counts{};
+        for (sz gap = 0; gap < gaps; ++gap)
+        {
+            sz length = 0;
+            while (static_cast<f64>(engine() >> 11) * 0x1.0p-53 >= probability)
+                ++length;
+
+            ++counts[std::min(length, longest_gap)];
+        }
+
+        f64 statistic = 0.0;
+        f64 remaining = 1.0;
+        for (sz length = 0; length < counts.size(); ++length)
+        {
+            // Gaps of at least longest_gap are pooled into the last category
+            auto const expected_probability = length < longest_gap ? remaining * probability : remaining;
+            remaining -= expected_probability;
+
+            auto const expected = expected_probability * static_cast<f64>(gaps);
+            auto const deviation = static_cast<f64>(counts[length]) - expected;
+            statistic += deviation * deviation / expected;
+        }
+
+        return {"gap", statistic, impl::chi_square_p_value(statistic, longest_gap)};
+    }
+
+    /// <summary>
+    /// Runs all statistical tests against the given engine, testing both the upper and the lower output bits
+    /// </summary>
+    /// <param name="engine">The engine to test</param>
+    export template <random_engine Engine>
+    [[nodiscard]] std::array<statistical_test_result, 4> run_statistical_battery(Engine& engine)
+    {
+        auto lower_bits = birthday_spacings_test(engine, 0);
+        lower_bits.name = "birthday spacings, lower bits";
+
+        return {bit_frequency_test(engine), birthday_spacings_test(engine), lower_bits, gap_test(engine)};
+    }
+}
@@ -1,64 +1,917 @@
 module;
 
+#include "simd.hpp"
+
+#include <fmt/format.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <compare>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <new>
+#include <ranges>
+#include <span>
 #include <string>
 #include <string_view>
+#include <type_traits>
 #include <vector>
 
 export module keycap.core : string;
 
 import : concepts;
+import : simd;
 import : types;
 
+namespace impl
+{
+    enum class ascii_case
+    {
+        lower,
+        upper,
+    };
+
+    [[nodiscard]] constexpr u8 to_lower_ascii(u8 c) noexcept
+    {
+        return static_cast<u8>(c | (static_cast<u8>(c - 'A') < 26 ? 0x20 : 0));
+    }
+
+    template <ascii_case Case>
+    [[nodiscard]] constexpr char convert_case_ascii(char c) noexcept
+    {
+        constexpr char first = Case == ascii_case::lower ? 'A' : 'a';
+        bool const in_range = static_cast<u8>(c - first) < 26;
+        return static_cast<char>(c ^ (in_range ? 0x20 : 0));
+    }
+
+    template <ascii_case Case>
+    void convert_case_scalar(char* data, sz size) noexcept
+    {
+        for (sz i = 0; i < size; ++i)
+        {
+            data[i] = convert_case_ascii<Case>(data[i]);
+        }
+    }
+
+#if KEYCAP_SIMD_X86
+    // Characters are compared as signed bytes, which keeps everything >= 0x80 out of the [first, last] range
+
+    template <ascii_case Case>
+    KEYCAP_TARGET("sse2")
+    __m128i convert_case_m128(__m128i chars) noexcept
+    {
+        constexpr char first = Case == ascii_case::lower ? 'A' : 'a';
+        auto const in_range = _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8(first - 1)),
+                                            _mm_cmplt_epi8(chars, _mm_set1_epi8(first + 26)));
+        return _mm_xor_si128(chars, _mm_and_si128(in_range, _mm_set1_epi8(0x20)));
+    }
+
+    template <ascii_case Case>
+    KEYCAP_TARGET("avx2")
+    __m256i convert_case_m256(__m256i chars) noexcept
+    {
+        constexpr char first = Case == ascii_case::lower ? 'A' : 'a';
+        auto const in_range = _mm256_and_si256(_mm256_cmpgt_epi8(chars, _mm256_set1_epi8(first - 1)),
+                                               _mm256_cmpgt_epi8(_mm256_set1_epi8(first + 26), chars));
+        return _mm256_xor_si256(chars, _mm256_and_si256(in_range, _mm256_set1_epi8(0x20)));
+    }
+
+    template <ascii_case Case>
+    KEYCAP_TARGET("sse2")
+    void convert_case_sse2(char* data, sz size) noexcept
+    {
+        sz i = 0;
+        for (; i + 16 <= size; i += 16)
+        {
+            auto* chunk = reinterpret_cast<__m128i*>(data + i);
+            _mm_storeu_si128(chunk, convert_case_m128<Case>(_mm_loadu_si128(chunk)));
+        }
+        convert_case_scalar<Case>(data + i, size - i);
+    }
+
+    template <ascii_case Case>
+    KEYCAP_TARGET("avx2")
+    void convert_case_avx2(char* data, sz size) noexcept
+    {
+        sz i = 0;
+        for (; i + 32 <= size; i += 32)
+        {
+            auto* chunk = reinterpret_cast<__m256i*>(data + i);
+            _mm256_storeu_si256(chunk, convert_case_m256<Case>(_mm256_loadu_si256(chunk)));
+        }
+        convert_case_sse2<Case>(data + i, size - i);
+    }
+
+    KEYCAP_TARGET("sse2")
+    sz mismatch_ci_sse2(char const* lhs, char const* rhs, sz size) noexcept
+    {
+        sz i = 0;
+        for (; i + 16 <= size; i += 16)
+        {
+            auto const l =
+                convert_case_m128<ascii_case::lower>(_mm_loadu_si128(reinterpret_cast<__m128i const*>(lhs + i)));
+            auto const r =
+                convert_case_m128<ascii_case::lower>(_mm_loadu_si128(reinterpret_cast<__m128i const*>(rhs + i)));
+            auto const equal = static_cast<u32>(_mm_movemask_epi8(_mm_cmpeq_epi8(l, r)));
+            if (equal != 0xFFFF)
+                return i + static_cast<sz>(std::countr_one(equal));
+        }
+
+        for (; i < size; ++i)
+        {
+            if (to_lower_ascii(static_cast<u8>(lhs[i])) != to_lower_ascii(static_cast<u8>(rhs[i])))
+                return i;
+        }
+        return size;
+    }
+
+    KEYCAP_TARGET("avx2")
+    sz mismatch_ci_avx2(char const* lhs, char const* rhs, sz size) noexcept
+    {
+        sz i = 0;
+        for (; i + 32 <= size; i += 32)
+        {
+            auto const l =
+                convert_case_m256<ascii_case::lower>(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(lhs + i)));
+            auto const r =
+                convert_case_m256<ascii_case::lower>(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(rhs + i)));
+            auto const equal = static_cast<u32>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(l, r)));
+            if (equal != 0xFFFFFFFF)
+                return i + static_cast<sz>(std::countr_one(equal));
+        }
+
+        return i + mismatch_ci_sse2(lhs + i, rhs + i, size - i);
+    }
+#endif
+
+    // The hash is wyhash (final version 4, https://github.com/wangyi-fudan/wyhash) for inputs of up to
+    // long_input_threshold bytes. Longer inputs are consumed in 64 byte stripes by 8 independent 64-bit lanes, similar
+    // to XXH3, which maps onto SSE2 and AVX2 registers. The constexpr, scalar and vectorized paths yield the same hash.
+
+    constexpr u64 wyp[4] = {0x2d358dccaa6c78a5, 0x8bb84b93962eacc9, 0x4b33a62ed433d4a3, 0x4d5a2da51de1aa47};
+
+    constexpr sz long_input_threshold = 256;
+    constexpr sz stripe_size = 64;
+    constexpr sz lanes = stripe_size / sizeof(u64);
+    constexpr sz stripes_per_block = 16;
+    constexpr sz block_size = stripe_size * stripes_per_block;
+    constexpr u64 scramble_prime = 0x9E3779B1;
+
+    // Stripe n of a block uses stripe_keys[n..n + lanes), the last (partial) stripe uses the keys past that
+    constexpr auto stripe_keys = [] {
+        std::array<u64, stripes_per_block + lanes> keys{};
+        u64 state = wyp[0];
+        for (auto& key : keys)
+        {
+            u64 z = (state += 0x9e3779b97f4a7c15);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+            key = z ^ (z >> 31);
+        }
+        return keys;
+    }();
+
+    constexpr void mum(u64& a, u64& b) noexcept
+    {
+#ifdef __SIZEOF_INT128__
+        __extension__ typedef unsigned __int128 u128;
+        u128 const r = static_cast<u128>(a) * b;
+        a = static_cast<u64>(r);
+        b = static_cast<u64>(r >> 64);
+#else
+#ifdef _M_X64
+        if (!std::is_constant_evaluated())
+        {
+            u64 high = 0;
+            a = _umul128(a, b, &high);
+            b = high;
+            return;
+        }
+#endif
+        u64 const a_lo = a & 0xFFFFFFFF, a_hi = a >> 32;
+        u64 const b_lo = b & 0xFFFFFFFF, b_hi = b >> 32;
+        u64 const lo_lo = a_lo * b_lo, hi_lo = a_hi * b_lo, lo_hi = a_lo * b_hi, hi_hi = a_hi * b_hi;
+        u64 const cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+        a = (cross << 32) | (lo_lo & 0xFFFFFFFF);
+        b = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+#endif
+    }
+
+    [[nodiscard]] constexpr u64 mix(u64 a, u64 b) noexcept
+    {
+        mum(a, b);
+        return a ^ b;
+    }
+
+    template <typename T>
+    [[nodiscard]] constexpr T read_le(char const* data) noexcept
+    {
+        if (std::is_constant_evaluated())
+        {
+            T value = 0;
+            for (sz i = 0; i < sizeof(T); ++i)
+            {
+                value |= static_cast<T>(static_cast<u8>(data[i])) << (8 * i);
+            }
+            return value;
+        }
+
+        T value;
+        std::memcpy(&value, data, sizeof(T));
+        if constexpr (std::endian::native == std::endian::big)
+            value = std::byteswap(value);
+
+        return value;
+    }
+
+    [[nodiscard]] constexpr u64 read_u64(char const* data) noexcept
+    {
+        return read_le<u64>(data);
+    }
+
+    [[nodiscard]] constexpr u64 read_u32(char const* data) noexcept
+    {
+        return read_le<u32>(data);
+    }
+
+    [[nodiscard]] constexpr u64 wyhash(char const* data, sz size, u64 seed) noexcept
+    {
+        seed ^= mix(seed ^ wyp[0], wyp[1]);
+
+        u64 a = 0;
+        u64 b = 0;
+        if (size <= 16)
+        {
+            if (size >= 4)
+            {
+                sz const offset = (size >> 3) << 2;
+                a = (read_u32(data) << 32) | read_u32(data + offset);
+                b = (read_u32(data + size - 4) << 32) | read_u32(data + size - 4 - offset);
+            }
+            else if (size > 0)
+            {
+                a = (static_cast<u64>(static_cast<u8>(data[0])) << 16)
+                    | (static_cast<u64>(static_cast<u8>(data[size >> 1])) << 8)
+                    | static_cast<u64>(static_cast<u8>(data[size - 1]));
+            }
+        }
+        else
+        {
+            sz i = size;
+            if (i > 48)
+            {
+                u64 see1 = seed;
+                u64 see2 = seed;
+                do
+                {
+                    seed = mix(read_u64(data) ^ wyp[1], read_u64(data + 8) ^ seed);
+                    see1 = mix(read_u64(data + 16) ^ wyp[2], read_u64(data + 24) ^ see1);
+                    see2 = mix(read_u64(data + 32) ^ wyp[3], read_u64(data + 40) ^ see2);
+                    data += 48;
+                    i -= 48;
+                } while (i > 48);
+                seed ^= see1 ^ see2;
+            }
+
+            while (i > 16)
+            {
+                seed = mix(read_u64(data) ^ wyp[1], read_u64(data + 8) ^ seed);
+                data += 16;
+                i -= 16;
+            }
+
+            a = read_u64(data + i - 16);
+            b = read_u64(data + i - 8);
+        }
+
+        a ^= wyp[1];
+        b ^= seed;
+        mum(a, b);
+        return mix(a ^ wyp[0] ^ size, b ^ wyp[1]);
+    }
+
+    using accumulators = std::array<u64, lanes>;
+
+    constexpr void accumulate_stripe_scalar(accumulators& acc, char const* data, u64 const* keys) noexcept
+    {
+        for (sz lane = 0; lane < lanes; ++lane)
+        {
+            u64 const value = read_u64(data + lane * sizeof(u64));
+            u64 const keyed = value ^ keys[lane];
+            acc[lane ^ 1] += value;
+            acc[lane] += (keyed & 0xFFFFFFFF) * (keyed >> 32);
+        }
+    }
+
+    constexpr void scramble_scalar(accumulators& acc, u64 const* keys) noexcept
+    {
+        for (sz lane = 0; lane < lanes; ++lane)
+        {
+            u64 value = acc[lane];
+            value ^= value >> 47;
+            value ^= keys[lane];
+            acc[lane] = value * scramble_prime;
+        }
+    }
+
+    constexpr void accumulate_blocks_scalar(accumulators& acc, char const* data, sz blocks) noexcept
+    {
+        for (sz block = 0; block < blocks; ++block, data += block_size)
+        {
+            for (sz stripe = 0; stripe < stripes_per_block; ++stripe)
+            {
+                accumulate_stripe_scalar(acc, data + stripe * stripe_size, stripe_keys.data() + stripe);
+            }
+            scramble_scalar(acc, stripe_keys.data() + stripes_per_block);
+        }
+    }
+
+#if KEYCAP_SIMD_X86
+    KEYCAP_TARGET("sse2")
+    void accumulate_blocks_sse2(accumulators& acc, char const* data, sz blocks) noexcept
+    {
+        __m128i a[lanes / 2];
+        for (sz i = 0; i < lanes / 2; ++i)
+            a[i] = _mm_loadu_si128(reinterpret_cast<__m128i const*>(acc.data() + i * 2));
+
+        auto const prime = _mm_set1_epi32(static_cast<int>(scramble_prime));
+
+        for (sz block = 0; block < blocks; ++block, data += block_size)
+        {
+            for (sz stripe = 0; stripe < stripes_per_block; ++stripe)
+            {
+                auto const* input = reinterpret_cast<__m128i const*>(data + stripe * stripe_size);
+                auto const* keys = reinterpret_cast<__m128i const*>(stripe_keys.data() + stripe);
+                for (sz i = 0; i < lanes / 2; ++i)
+                {
+                    auto const value = _mm_loadu_si128(input + i);
+                    auto const keyed = _mm_xor_si128(value, _mm_loadu_si128(keys + i));
+                    auto const product = _mm_mul_epu32(keyed, _mm_srli_epi64(keyed, 32));
+                    auto const swapped = _mm_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2));
+                    a[i] = _mm_add_epi64(a[i], _mm_add_epi64(product, swapped));
+                }
+            }
+
+            auto const* keys = reinterpret_cast<__m128i const*>(stripe_keys.data() + stripes_per_block);
+            for (sz i = 0; i < lanes / 2; ++i)
+            {
+                auto value = _mm_xor_si128(a[i], _mm_srli_epi64(a[i], 47));
+                value = _mm_xor_si128(value, _mm_loadu_si128(keys + i));
+                auto const low = _mm_mul_epu32(value, prime);
+                auto const high = _mm_mul_epu32(_mm_srli_epi64(value, 32), prime);
+                a[i] = _mm_add_epi64(low, _mm_slli_epi64(high, 32));
+            }
+        }
+
+        for (sz i = 0; i < lanes / 2; ++i)
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(acc.data() + i * 2), a[i]);
+    }
+
+    KEYCAP_TARGET("avx2")
+    void accumulate_blocks_avx2(accumulators& acc, char const* data, sz blocks) noexcept
+    {
+        __m256i a[lanes / 4];
+        for (sz i = 0; i < lanes / 4; ++i)
+            a[i] = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(acc.data() + i * 4));
+
+        auto const prime = _mm256_set1_epi32(static_cast<int>(scramble_prime));
+
+        for (sz block = 0; block < blocks; ++block, data += block_size)
+        {
+            for (sz stripe = 0; stripe < stripes_per_block; ++stripe)
+            {
+                auto const* input = reinterpret_cast<__m256i const*>(data + stripe * stripe_size);
+                auto const* keys = reinterpret_cast<__m256i const*>(stripe_keys.data() + stripe);
+                for (sz i = 0; i < lanes / 4; ++i)
+                {
+                    auto const value = _mm256_loadu_si256(input + i);
+                    auto const keyed = _mm256_xor_si256(value, _mm256_loadu_si256(keys + i));
+                    auto const product = _mm256_mul_epu32(keyed, _mm256_srli_epi64(keyed, 32));
+                    auto const swapped = _mm256_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2));
+                    a[i] = _mm256_add_epi64(a[i], _mm256_add_epi64(product, swapped));
+                }
+            }
+
+            auto const* keys = reinterpret_cast<__m256i const*>(stripe_keys.data() + stripes_per_block);
+            for (sz i = 0; i < lanes / 4; ++i)
+            {
+                auto value = _mm256_xor_si256(a[i], _mm256_srli_epi64(a[i], 47));
+                value = _mm256_xor_si256(value, _mm256_loadu_si256(keys + i));
+                auto const low = _mm256_mul_epu32(value, prime);
+                auto const high = _mm256_mul_epu32(_mm256_srli_epi64(value, 32), prime);
+                a[i] = _mm256_add_epi64(low, _mm256_slli_epi64(high, 32));
+            }
+        }
+
+        for (sz i = 0; i < lanes / 4; ++i)
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc.data() + i * 4), a[i]);
+    }
+#endif
+
+    constexpr void accumulate_blocks(accumulators& acc, char const* data, sz blocks) noexcept
+    {
+#if KEYCAP_SIMD_X86
+        // The vector paths read the input with native byte order
+        if (!std::is_constant_evaluated() && std::endian::native == std::endian::little)
+        {
+            switch (keycap::simd::max_instruction_set())
+            {
+                case keycap::simd::instruction_set::avx512:
+                case keycap::simd::instruction_set::avx2:
+                    return accumulate_blocks_avx2(acc, data, blocks);
+                case keycap::simd::instruction_set::sse2:
+                    return accumulate_blocks_sse2(acc, data, blocks);
+                case keycap::simd::instruction_set::scalar:
+                    break;
+            }
+        }
+#endif
+        accumulate_blocks_scalar(acc, data, blocks);
+    }
+
+    [[nodiscard]] constexpr u64 hash_long(char const* data, sz size, u64 seed) noexcept
+    {
+        accumulators acc{};
+        for (sz lane = 0; lane < lanes; ++lane)
+        {
+            acc[lane] = mix(seed ^ wyp[lane % 4], stripe_keys[lane] + lane);
+        }
+
+        sz const blocks = size / block_size;
+        accumulate_blocks(acc, data, blocks);
+
+        // The remaining full stripes, followed by the last stripe which may overlap with the previous one
+        char const* tail = data + blocks * block_size;
+        sz const stripes = (size - blocks * block_size) / stripe_size;
+        for (sz stripe = 0; stripe < stripes; ++stripe)
+        {
+            accumulate_stripe_scalar(acc, tail + stripe * stripe_size, stripe_keys.data() + stripe);
+        }
+        accumulate_stripe_scalar(acc, data + size - stripe_size, stripe_keys.data() + stripes_per_block);
+
+        u64 result = size * wyp[1];
+        for (sz lane = 0; lane < lanes; lane += 2)
+        {
+            result += mix(acc[lane] ^ wyp[lane % 4], acc[lane + 1] ^ stripe_keys[lane]);
+        }
+
+        return mix(result ^ seed, wyp[2]);
+    }
+
+    template <ascii_case Case>
+    void convert_case(char* data, sz size) noexcept
+    {
+#if KEYCAP_SIMD_X86
+        switch (keycap::simd::max_instruction_set())
+        {
+            case keycap::simd::instruction_set::avx512:
+            case keycap::simd::instruction_set::avx2:
+                return convert_case_avx2<Case>(data, size);
+            case keycap::simd::instruction_set::sse2:
+                return convert_case_sse2<Case>(data, size);
+            case keycap::simd::instruction_set::scalar:
+                break;
+        }
+#endif
+        convert_case_scalar<Case>(data, size);
+    }
+
+    [[nodiscard]] sz mismatch_ci(char const* lhs, char const* rhs, sz size) noexcept
+    {
+#if KEYCAP_SIMD_X86
+        switch (keycap::simd::max_instruction_set())
+        {
+            case keycap::simd::instruction_set::avx512:
+            case keycap::simd::instruction_set::avx2:
+                return mismatch_ci_avx2(lhs, rhs, size);
+            case keycap::simd::instruction_set::sse2:
+                return mismatch_ci_sse2(lhs, rhs, size);
+            case keycap::simd::instruction_set::scalar:
+                break;
+        }
+#endif
+        for (sz i = 0; i < size; ++i)
+        {
+            if (to_lower_ascii(static_cast<u8>(lhs[i])) != to_lower_ascii(static_cast<u8>(rhs[i])))
+                return i;
+        }
+        return size;
+    }
+}
+
 namespace keycap
 {
+    /// <summary>
+    /// Controls whether split_view yields empty tokens (e.g. between two consecutive delimiters)
+    /// </summary>
+    export enum class split_options
+    {
+        keep_empty,
+        skip_empty,
+    };
+
+    /// <summary>
+    /// A lazy, non-allocating view over the substrings in the given string that are delimited by the given delimiter.
+    /// The view does not own the underlying string, which must outlive any tokens obtained from it.
+    /// </summary>
+    export class split_view : public std::ranges::view_interface<split_view>
+    {
+      public:
+        class iterator
+        {
+          public:
+            using value_type = std::string_view;
+            using difference_type = std::ptrdiff_t;
+            using iterator_concept = std::forward_iterator_tag;
+            using iterator_category = std::forward_iterator_tag;
+
+            constexpr iterator() noexcept = default;
+
+            explicit constexpr iterator(split_view const& view) noexcept
+              : remaining_{view.string_}
+              , delimiter_{view.delimiter_}
+              , delimiter_char_{view.delimiter_char_}
+              , single_char_{view.single_char_}
+              , skip_empty_{view.options_ == split_options::skip_empty}
+              , at_end_{false}
+            {
+                ++*this;
+            }
+
+            [[nodiscard]] constexpr std::string_view operator*() const noexcept
+            {
+                return token_;
+            }
+
+            constexpr iterator& operator++() noexcept
+            {
+                do
+                {
+                    advance();
+                } while (skip_empty_ && !at_end_ && token_.empty());
+
+                return *this;
+            }
+
+            constexpr iterator operator++(int) noexcept
+            {
+                auto copy = *this;
+                ++*this;
+                return copy;
+            }
+
+            [[nodiscard]] constexpr bool operator==(iterator const& other) const noexcept
+            {
+                if (at_end_ || other.at_end_)
+                    return at_end_ == other.at_end_;
+
+                return token_.data() == other.token_.data() && token_.size() == other.token_.size();
+            }
+
+            [[nodiscard]] constexpr bool operator==(std::default_sentinel_t) const noexcept
+            {
+                return at_end_;
+            }
+
+          private:
+            constexpr void advance() noexcept
+            {
+                if (exhausted_)
+                {
+                    at_end_ = true;
+                    return;
+                }
+
+                sz pos = std::string_view::npos;
+                if (single_char_)
+                    pos = remaining_.find(delimiter_char_);
+                else if (!delimiter_.empty())
+                    pos = remaining_.find(delimiter_);
+
+                if (pos == std::string_view::npos)
+                {
+                    token_ = remaining_;
+                    exhausted_ = true;
+                    return;
+                }
+
+                token_ = remaining_.substr(0, pos);
+                remaining_.remove_prefix(pos + (single_char_ ? 1 : delimiter_.size()));
+            }
+
+            std::string_view remaining_;
+            std::string_view token_;
+            std::string_view delimiter_;
+            char delimiter_char_ = '\0';
+            bool single_char_ = false;
+            bool skip_empty_ = false;
+            bool exhausted_ = false;
+            bool at_end_ = true;
+        };
+
+        constexpr split_view() noexcept = default;
+
+        /// <summary>
+        /// Creates a view over the tokens in the given string that are delimited by the given delimiter. An empty
+        /// delimiter yields the whole string as a single token.
+        /// </summary>
+        constexpr split_view(std::string_view string, std::string_view delimiter = " ",
+                             split_options options = split_options::keep_empty) noexcept
+          : string_{string}
+          , delimiter_{delimiter}
+          , delimiter_char_{delimiter.size() == 1 ? delimiter.front() : '\0'}
+          , single_char_{delimiter.size() == 1}
+          , options_{options}
+        {
+        }
+
+        /// <summary>
+        /// Creates a view over the tokens in the given string that are delimited by the given character
+        /// </summary>
+        constexpr split_view(std::string_view string, char delimiter,
+                             split_options options = split_options::keep_empty) noexcept
+          : string_{string}
+          , delimiter_char_{delimiter}
+          , single_char_{true}
+          , options_{options}
+        {
+        }
+
+        [[nodiscard]] constexpr iterator begin() const noexcept
+        {
+            return iterator{*this};
+        }
+
+        [[nodiscard]] constexpr std::default_sentinel_t end() const noexcept
+        {
+            return std::default_sentinel;
+        }
+
+      private:
+        std::string_view string_;
+        std::string_view delimiter_;
+        char delimiter_char_ = '\0';
+        bool single_char_ = false;
+        split_options options_ = split_options::keep_empty;
+    };
+
     /// <summary>
     /// Returns a vector of strings that contains the substrings in the given string that are delimited by elements of
     /// the specified string.
     /// </summary>
-    export [[nodiscard]] std::vector<std::string> split(std::string string, std::string delimiter = " ")
+    export [[nodiscard]] std::vector<std::string> split(std::string_view string, std::string_view delimiter = " ",
+                                                        split_options options = split_options::keep_empty)
     {
         std::vector<std::string> tokens;
-
-        sz pos = 0;
-        std::string token;
-        while ((pos = string.find(delimiter)) != std::string::npos)
+        for (auto token : split_view{string, delimiter, options})
         {
-            tokens.emplace_back(string.substr(0, pos));
-            string.erase(0, pos + delimiter.length());
+            tokens.emplace_back(token);
         }
-        tokens.emplace_back(string);
 
         return tokens;
     }
 
     /// <summary>
-    /// Joins the given vector of strings into one single string seperated by the given delimiter
+    /// Writes the given strings separated by the given delimiter to the given output iterator
+    /// </summary>
+    /// <returns>The output iterator past the last written character</returns>
+    export template <string_view_range Range, std::output_iterator<char> Output>
+    Output join_into(Output output, Range&& strings, std::string_view delimiter = " ")
+    {
+        bool first = true;
+        for (std::string_view string : strings)
+        {
+            if (!first)
+                output = std::copy(delimiter.begin(), delimiter.end(), output);
+
+            output = std::copy(string.begin(), string.end(), output);
+            first = false;
+        }
+
+        return output;
+    }
+
+    /// <summary>
+    /// Appends the given strings separated by the given delimiter to the given string, which may use any allocator.
+    /// The exact size is computed up front, so the string is grown at most once.
     /// </summary>
-    export [[nodiscard]] std::string join(std_container auto const& container, std::string delimiter = " ")
+    export template <string_view_range Range, typename Allocator>
+        requires std::ranges::forward_range<Range>
+    void join_into(std::basic_string<char, std::char_traits<char>, Allocator>& target, Range&& strings,
+                   std::string_view delimiter = " ")
     {
-        sz buffer_size = 0;
-        for (auto&& str : container)
+        sz size = 0;
+        sz count = 0;
+        for (std::string_view string : strings)
         {
-            buffer_size += str.size();
+            size += string.size();
+            ++count;
         }
 
+        if (count == 0)
+            return;
+
+        size += delimiter.size() * (count - 1);
+
+        auto const offset = target.size();
+        target.resize_and_overwrite(offset + size, [&](char* data, sz) {
+            join_into(data + offset, strings, delimiter);
+            return offset + size;
+        });
+    }
+
+    /// <summary>
+    /// Joins the given vector of strings into one single string seperated by the given delimiter
+    /// </summary>
+    export [[nodiscard]] std::string join(std_container auto const& container, std::string_view delimiter = " ")
+    {
         std::string str;
-        str.reserve(buffer_size);
+        join_into(str, container, delimiter);
+        return str;
+    }
 
-        bool first = true;
+    /// <summary>
+    /// Assembles a string from a number of pieces with a single allocation. Appended string_views are not copied until
+    /// the string is built and must outlive the string_builder's use, formatted pieces are kept in a small internal
+    /// buffer. Calling clear() keeps all buffers, so a reused string_builder does not allocate at all.
+    /// </summary>
+    export class string_builder
+    {
+      public:
+        /// <summary>
+        /// Appends the given string without copying it
+        /// </summary>
+        string_builder& append(std::string_view string)
+        {
+            pieces_.push_back({string.data(), string.size()});
+            size_ += string.size();
+            return *this;
+        }
 
-        for (auto&& s : container)
+        /// <summary>
+        /// Appends the given character
+        /// </summary>
+        string_builder& append(char character)
         {
-            if (!first)
-                str += delimiter;
+            auto const offset = scratch_.size();
+            scratch_.push_back(character);
+            pieces_.push_back({nullptr, 1, offset});
+            size_ += 1;
+            return *this;
+        }
+
+        /// <summary>
+        /// Appends the given integer in decimal representation
+        /// </summary>
+        string_builder& append(std::integral auto value)
+        {
+            fmt::format_int const formatted{value};
+            auto const offset = scratch_.size();
+            scratch_.append(formatted.data(), formatted.data() + formatted.size());
+            pieces_.push_back({nullptr, formatted.size(), offset});
+            size_ += formatted.size();
+            return *this;
+        }
 
-            str += s;
+        /// <summary>
+        /// Appends the given strings, separated by the given delimiter. Like append, this does not copy the strings,
+        /// so the range's elements must outlive the string_builder's use.
+        /// </summary>
+        template <string_view_range Range>
+            requires std::is_lvalue_reference_v<std::ranges::range_reference_t<Range const>> ||
+                     std::same_as<std::ranges::range_value_t<Range const>, std::string_view>
+        string_builder& append_joined(Range const& strings, std::string_view delimiter = " ")
+        {
+            bool first = true;
+            for (std::string_view string : strings)
+            {
+                if (!first)
+                    append(delimiter);
 
-            first = false;
+                append(string);
+                first = false;
+            }
+            return *this;
         }
 
-        return str;
+        // A temporary container would be destroyed before build() reads its elements
+        template <string_view_range Range>
+            requires(!std::ranges::borrowed_range<Range>)
+        string_builder& append_joined(Range&& strings, std::string_view delimiter = " ") = delete;
+
+        /// <summary>
+        /// Appends the given arguments formatted according to the given fmt format string
+        /// </summary>
+        template <typename... Args>
+        string_builder& format(fmt::format_string<Args...> format, Args&&... args)
+        {
+            auto const offset = scratch_.size();
+            fmt::format_to(fmt::appender(scratch_), format, std::forward<Args>(args)...);
+            pieces_.push_back({nullptr, scratch_.size() - offset, offset});
+            size_ += scratch_.size() - offset;
+            return *this;
+        }
+
+        /// <summary>
+        /// Returns the size of the string that will be built
+        /// </summary>
+        [[nodiscard]] sz size() const noexcept
+        {
+            return size_;
+        }
+
+        [[nodiscard]] bool empty() const noexcept
+        {
+            return size_ == 0;
+        }
+
+        /// <summary>
+        /// Writes the string to the given output iterator
+        /// </summary>
+        /// <returns>The output iterator past the last written character</returns>
+        template <std::output_iterator<char> Output>
+        Output build_into(Output output) const
+        {
+            for (auto const& piece : pieces_)
+            {
+                auto const* data = piece.data ? piece.data : scratch_.data() + piece.offset;
+                output = std::copy(data, data + piece.size, output);
+            }
+            return output;
+        }
+
+        /// <summary>
+        /// Appends the string to the given string, growing it at most once
+        /// </summary>
+        void build_into(std::string& target) const
+        {
+            auto const offset = target.size();
+            target.resize_and_overwrite(offset + size_, [&](char* data, sz) {
+                build_into(data + offset);
+                return offset + size_;
+            });
+        }
+
+        /// <summary>
+        /// Returns the built string
+        /// </summary>
+        [[nodiscard]] std::string build() const
+        {
+            std::string result;
+            build_into(result);
+            return result;
+        }
+
+        /// <summary>
+        /// Removes all pieces but keeps the allocated buffers for reuse
+        /// </summary>
+        void clear() noexcept
+        {
+            pieces_.clear();
+            scratch_.clear();
+            size_ = 0;
+        }
+
+      private:
+        struct piece
+        {
+            // Points to borrowed characters, or is nullptr for characters stored at offset within scratch_
+            char const* data = nullptr;
+            sz size = 0;
+            sz offset = 0;
+        };
+
+        std::vector<piece> pieces_;
+        fmt::memory_buffer scratch_;
+        sz size_ = 0;
+    };
+
+    /// <summary>
+    /// Converts the given characters to lowercase in-place. Only ASCII characters are converted, the conversion does
+    /// not depend on the current locale.
+    /// </summary>
+    export void to_lower(std::span<char> string) noexcept
+    {
+        impl::convert_case<impl::ascii_case::lower>(string.data(), string.size());
+    }
+
+    /// <summary>
+    /// Converts the given characters to uppercase in-place. Only ASCII characters are converted, the conversion does
+    /// not depend on the current locale.
+    /// </summary>
+    export void to_upper(std::span<char> string) noexcept
+    {
+        impl::convert_case<impl::ascii_case::upper>(string.data(), string.size());
     }
 
     /// <summary>
@@ -66,10 +919,7 @@ namespace keycap
     /// </summary>
     export [[nodiscard]] std::string to_lower(std::string string)
     {
-        std::for_each(string.begin(), string.end(), [](char& c) {
-            c = static_cast<char>(::tolower(c));
-        });
-
+        to_lower(std::span<char>{string});
         return string;
     }
 
@@ -78,34 +928,123 @@ namespace keycap
     /// </summary>
     export [[nodiscard]] std::string to_upper(std::string string)
     {
-        std::for_each(string.begin(), string.end(), [](char& c) {
-            c = static_cast<char>(::toupper(c));
-        });
-
+        to_upper(std::span<char>{string});
         return string;
     }
 
+    namespace pmr
+    {
+        /// <summary>
+        /// Like keycap::split, but allocates the vector and all of its strings from the given memory resource
+        /// </summary>
+        export [[nodiscard]] std::pmr::vector<std::pmr::string> split(
+            std::string_view string, std::string_view delimiter = " ",
+            split_options options = split_options::keep_empty,
+            std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        {
+            std::pmr::vector<std::pmr::string> tokens{resource};
+            for (auto token : split_view{string, delimiter, options})
+            {
+                tokens.emplace_back(token);
+            }
+
+            return tokens;
+        }
+
+        /// <summary>
+        /// Like keycap::join, but allocates the string from the given memory resource
+        /// </summary>
+        export [[nodiscard]] std::pmr::string join(
+            std_container auto const& container, std::string_view delimiter = " ",
+            std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        {
+            std::pmr::string str{resource};
+            join_into(str, container, delimiter);
+            return str;
+        }
+
+        /// <summary>
+        /// Returns a copy of the given string converted to lowercase, allocated from the given memory resource
+        /// </summary>
+        export [[nodiscard]] std::pmr::string to_lower(
+            std::string_view string, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        {
+            std::pmr::string lowered{string, resource};
+            keycap::to_lower(std::span<char>{lowered});
+            return lowered;
+        }
+
+        /// <summary>
+        /// Returns a copy of the given string converted to uppercase, allocated from the given memory resource
+        /// </summary>
+        export [[nodiscard]] std::pmr::string to_upper(
+            std::string_view string, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        {
+            std::pmr::string uppered{string, resource};
+            keycap::to_upper(std::span<char>{uppered});
+            return uppered;
+        }
+    }
+
     /// <summary>
-    /// Returns a hash of the given string with the given size
+    /// Returns whether the given strings are equal, ignoring the case of ASCII characters
+    /// </summary>
+    export [[nodiscard]] bool iequals(std::string_view lhs, std::string_view rhs) noexcept
+    {
+        return lhs.size() == rhs.size() && impl::mismatch_ci(lhs.data(), rhs.data(), lhs.size()) == lhs.size();
+    }
+
+    /// <summary>
+    /// Lexicographically compares the given strings, ignoring the case of ASCII characters
     /// </summary>
-    export constexpr [[nodiscard]] u64 hash_u64(char const* string, std::size_t size)
+    export [[nodiscard]] std::weak_ordering icompare(std::string_view lhs, std::string_view rhs) noexcept
     {
-        if (size == 0)
-            return 0;
+        auto const size = std::min(lhs.size(), rhs.size());
+        auto const index = impl::mismatch_ci(lhs.data(), rhs.data(), size);
+        if (index == size)
+            return lhs.size() <=> rhs.size();
+
+        return impl::to_lower_ascii(static_cast<u8>(lhs[index])) <=> impl::to_lower_ascii(static_cast<u8>(rhs[index]));
+    }
 
-        u64 const p = 131;
-        u64 const m = 4294967291;
+    /// <summary>
+    /// Returns a 64-bit hash of the given string with the given size. Yields the same value at compile-time and at
+    /// runtime, regardless of the instruction set used. Not suitable for cryptographic purposes.
+    /// </summary>
+    export [[nodiscard]] constexpr u64 hash_u64(char const* string, std::size_t size, u64 seed = 0) noexcept
+    {
+        if (size > impl::long_input_threshold)
+            return impl::hash_long(string, size, seed);
 
-        u64 hash = 0;
-        u64 multiplier = 1;
+        return impl::wyhash(string, size, seed);
+    }
 
-        for (std::size_t i = 0; i < size - 1; ++i)
+    /// <summary>
+    /// Returns a 64-bit hash of the given string. Yields the same value at compile-time and at runtime, regardless of
+    /// the instruction set used. Not suitable for cryptographic purposes.
+    /// </summary>
+    export [[nodiscard]] constexpr u64 hash_u64(std::string_view string, u64 seed = 0) noexcept
+    {
+        return hash_u64(string.data(), string.size(), seed);
+    }
+
+    /// <summary>
+    /// Returns a hash of the given string that ignores the case of ASCII characters. Equal to hash_u64 of the string
+    /// converted to lowercase.
+    /// </summary>
+    export [[nodiscard]] u64 ihash_u64(std::string_view string)
+    {
+        constexpr sz buffer_size = 256;
+        if (string.size() <= buffer_size)
         {
-            hash = (hash + multiplier * string[i]) % m;
-            multiplier = (multiplier * p) % m;
+            std::array<char, buffer_size> buffer;
+            std::copy(string.begin(), string.end(), buffer.begin());
+            to_lower(std::span<char>{buffer.data(), string.size()});
+            return hash_u64(buffer.data(), string.size());
         }
 
-        return hash;
+        auto lowered = to_lower(std::string{string});
+        return hash_u64(lowered.data(), lowered.size());
     }
 
     /// <summary>
@@ -116,3 +1055,245 @@ namespace keycap
         return hash_u64(string, size);
     }
 }
+
+namespace impl
+{
+    /// <summary>
+    /// The header preceding the characters of every interned string within a symbol_table's arena
+    /// </summary>
+    struct symbol_entry
+    {
+        u64 hash;
+        sz size;
+
+        [[nodiscard]] char const* data() const noexcept
+        {
+            return reinterpret_cast<char const*>(this + 1);
+        }
+
+        [[nodiscard]] std::string_view view() const noexcept
+        {
+            return {data(), size};
+        }
+    };
+}
+
+namespace keycap
+{
+    /// <summary>
+    /// A handle to a string interned by a symbol_table. Symbols are pointer-sized, stay valid for as long as their
+    /// symbol_table exists and can be compared and hashed in O(1). A default constructed symbol refers to no string.
+    /// </summary>
+    export class symbol
+    {
+      public:
+        constexpr symbol() noexcept = default;
+
+        /// <summary>
+        /// Returns the interned string. Null-terminated, so data() may be passed to C APIs.
+        /// </summary>
+        [[nodiscard]] std::string_view view() const noexcept
+        {
+            return entry_ ? entry_->view() : std::string_view{};
+        }
+
+        /// <summary>
+        /// Returns hash_u64 of the interned string without rehashing it
+        /// </summary>
+        [[nodiscard]] u64 hash() const noexcept
+        {
+            return entry_ ? entry_->hash : hash_u64(std::string_view{});
+        }
+
+        [[nodiscard]] explicit operator bool() const noexcept
+        {
+            return entry_ != nullptr;
+        }
+
+        [[nodiscard]] bool operator==(symbol const&) const noexcept = default;
+
+      private:
+        friend class symbol_table;
+
+        explicit symbol(impl::symbol_entry const* entry) noexcept
+          : entry_{entry}
+        {
+        }
+
+        impl::symbol_entry const* entry_ = nullptr;
+    };
+
+    /// <summary>
+    /// Interns strings, mapping every distinct string to a stable symbol. The characters of all strings are stored in
+    /// large arena blocks owned by the table. Looking up a string that already has been interned is lock-free, only
+    /// interning a new string takes a lock. Thread-safe.
+    /// </summary>
+    export class symbol_table
+    {
+      public:
+        explicit symbol_table(sz initial_capacity = 1024)
+        {
+            current_.store(make_table(std::bit_ceil(std::max(initial_capacity * 2, sz{16}))));
+        }
+
+        symbol_table(symbol_table const&) = delete;
+        symbol_table& operator=(symbol_table const&) = delete;
+
+        /// <summary>
+        /// Returns the symbol for the given string, interning the string if it has not been interned before
+        /// </summary>
+        [[nodiscard]] symbol intern(std::string_view string)
+        {
+            auto const hash = hash_u64(string);
+            if (auto const* entry = lookup(*current_.load(std::memory_order_acquire), string, hash))
+                return symbol{entry};
+
+            std::lock_guard lock{mutex_};
+
+            // Another thread may have interned the string (or grown the table) in the meantime
+            auto* table = current_.load(std::memory_order_relaxed);
+            if (auto const* entry = lookup(*table, string, hash))
+                return symbol{entry};
+
+            if ((size_.load(std::memory_order_relaxed) + 1) * 2 > table->slots.size())
+                table = grow(*table);
+
+            auto const* entry = allocate(string, hash);
+            insert(*table, entry);
+            size_.fetch_add(1, std::memory_order_relaxed);
+
+            return symbol{entry};
+        }
+
+        /// <summary>
+        /// Returns the symbol for the given string, or an empty symbol if the string has not been interned. Lock-free.
+        /// </summary>
+        [[nodiscard]] symbol find(std::string_view string) const noexcept
+        {
+            return symbol{lookup(*current_.load(std::memory_order_acquire), string, hash_u64(string))};
+        }
+
+        /// <summary>
+        /// Returns the number of interned strings
+        /// </summary>
+        [[nodiscard]] sz size() const noexcept
+        {
+            return size_.load(std::memory_order_relaxed);
+        }
+
+      private:
+        using entry_pointer = std::atomic<impl::symbol_entry const*>;
+
+        struct table
+        {
+            std::vector<entry_pointer> slots;
+        };
+
+        static constexpr sz block_size = 64 * 1024;
+
+        [[nodiscard]] table* make_table(sz capacity)
+        {
+            auto& result = tables_.emplace_back(std::make_unique<table>());
+            result->slots = std::vector<entry_pointer>(capacity);
+            return result.get();
+        }
+
+        [[nodiscard]] static impl::symbol_entry const* lookup(table const& table, std::string_view string,
+                                                              u64 hash) noexcept
+        {
+            sz const mask = table.slots.size() - 1;
+            for (sz i = hash & mask;; i = (i + 1) & mask)
+            {
+                auto const* entry = table.slots[i].load(std::memory_order_acquire);
+                if (!entry)
+                    return nullptr;
+
+                if (entry->hash == hash && entry->view() == string)
+                    return entry;
+            }
+        }
+
+        static void insert(table& table, impl::symbol_entry const* entry) noexcept
+        {
+            sz const mask = table.slots.size() - 1;
+            for (sz i = entry->hash & mask;; i = (i + 1) & mask)
+            {
+                if (!table.slots[i].load(std::memory_order_relaxed))
+                {
+                    table.slots[i].store(entry, std::memory_order_release);
+                    return;
+                }
+            }
+        }
+
+        /// <summary>
+        /// Rehashes all entries into a table twice the size. The old table is kept alive until the symbol_table is
+        /// destroyed, as concurrent lookups may still be probing it.
+        /// </summary>
+        [[nodiscard]] table* grow(table const& old)
+        {
+            auto* table = make_table(old.slots.size() * 2);
+            for (auto const& slot : old.slots)
+            {
+                if (auto const* entry = slot.load(std::memory_order_relaxed))
+                    insert(*table, entry);
+            }
+
+            current_.store(table, std::memory_order_release);
+            return table;
+        }
+
+        [[nodiscard]] impl::symbol_entry const* allocate(std::string_view string, u64 hash)
+        {
+            constexpr sz alignment = alignof(impl::symbol_entry);
+            sz const required = (sizeof(impl::symbol_entry) + string.size() + 1 + alignment - 1) & ~(alignment - 1);
+
+            if (required > block_remaining_)
+            {
+                sz const size = std::max(block_size, required);
+                block_cursor_ = blocks_.emplace_back(std::make_unique<std::byte[]>(size)).get();
+                block_remaining_ = size;
+            }
+
+            auto* entry = new (block_cursor_) impl::symbol_entry{hash, string.size()};
+            auto* characters = block_cursor_ + sizeof(impl::symbol_entry);
+            std::memcpy(characters, string.data(), string.size());
+            characters[string.size()] = std::byte{0};
+
+            block_cursor_ += required;
+            block_remaining_ -= required;
+            return entry;
+        }
+
+        std::atomic<table*> current_ = nullptr;
+        std::atomic<sz> size_ = 0;
+
+        std::mutex mutex_;
+        std::vector<std::unique_ptr<table>> tables_;
+        std::vector<std::unique_ptr<std::byte[]>> blocks_;
+        std::byte* block_cursor_ = nullptr;
+        sz block_remaining_ = 0;
+    };
+
+    /// <summary>
+    /// Returns the symbol for the given string from the process-wide symbol_table, interning the string if it has not
+    /// been interned before
+    /// </summary>
+    export [[nodiscard]] symbol intern(std::string_view string)
+    {
+        static symbol_table table{4096};
+        return table.intern(string);
+    }
+}
+
+template <>
+inline constexpr bool std::ranges::enable_borrowed_range<keycap::split_view> = true;
+
+template <>
+struct std::hash<keycap::symbol>
+{
+    [[nodiscard]] std::size_t operator()(keycap::symbol const& symbol) const noexcept
+    {
+        return static_cast<std::size_t>(symbol.hash());
+    }
+};
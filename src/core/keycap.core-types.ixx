@@ -13,4 +13,6 @@ export using i32 = std::int32_t;
 export using u32 = std::uint32_t;
 export using i64 = std::int64_t;
 export using u64 = std::uint64_t;
-export using sz = std::size_t;
\ No newline at end of file
+export using sz = std::size_t;
+export using f32 = float;
+export using f64 = double;
\ No newline at end of file
@@ -6,9 +6,20 @@ export import :algorithm;
 export import :array;
 export import :concepts;
 export import :error;
+export import :flatmap;
+export import :grid;
 export import :math;
+export import :memory;
+export import :parallel;
+export import :perfecthash;
+export import :queue;
 export import :random;
+export import :result;
+export import :sampling;
 export import :scopeguard;
+export import :simd;
+export import :source;
+export import :statistics;
 export import :string;
 export import :types;
 
@@ -0,0 +1,18 @@
+#pragma once
+
+// Helpers for writing SIMD code paths that are selected at runtime. Include this in the global module fragment of any
+// partition that uses intrinsics and dispatch through keycap::simd::max_instruction_set()
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define KEYCAP_SIMD_X86 1
+#include <immintrin.h>
+#else
+#define KEYCAP_SIMD_X86 0
+#endif
+
+// MSVC allows using any intrinsic in any function, gcc and clang require the function to opt into the instruction set
+#if defined(_MSC_VER) && !defined(__clang__)
+#define KEYCAP_TARGET(features)
+#else
+#define KEYCAP_TARGET(features) __attribute__((target(features)))
+#endif
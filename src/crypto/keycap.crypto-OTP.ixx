@@ -3,11 +3,13 @@ module;
 #include <botan/base32.h>
 #include <botan/mac.h>
 
-#include <fmt/format.h>
-
+#include <algorithm>
 #include <array>
 #include <cmath>
+#include <cstring>
+#include <expected>
 #include <string>
+#include <string_view>
 
 export module keycap.crypto:opt;
 
@@ -19,20 +21,32 @@ namespace keycap::crypto
     namespace hotp
     {
         constexpr sz required_min_digits = 6;
+        constexpr sz max_digits = 8;
+        static_assert(required_min_digits == 6 && max_digits == 8, "Update the error messages below");
+
+        constexpr std::string_view too_few_digits_message =
+            "As required per RFC 4226, num_digits can not be smaller than `6`!\n"
+            "See https://www.rfc-editor.org/rfc/rfc4226#section-13.2 Appendix A for more details.";
+        constexpr std::string_view too_many_digits_message = "num_digits can not be larger than `8`!";
+
         /// <summary>
-        /// Implementation of the OATH HMAC-based One-Time Password algorithm.
+        /// Implementation of the OATH HMAC-based One-Time Password algorithm. Returns error_code::invalid_argument
+        /// instead of throwing if num_digits is out of range.
         /// See: https://tools.ietf.org/html/rfc4226
         /// </summary>
-        export [[nodiscard]] std::string generate(std::string const& key, u64 counter,
-                                                  sz num_digits = required_min_digits)
+        export [[nodiscard]] result<std::string> try_generate(std::string const& key, u64 counter,
+                                                              sz num_digits = required_min_digits)
         {
             if (num_digits < required_min_digits)
             {
-                auto msg =
-                    fmt::format("As required per RFC 4226, num_digits can not be smaller than `{}`!\n"
-                                "See https://www.rfc-editor.org/rfc/rfc4226#section-13.2 Appendix A for more details.",
-                                required_min_digits);
-                throw exception{error_code::invalid_argument, module::crypto, fragment::otp, __LINE__, msg};
+                return make_error(error_code::invalid_argument, module::crypto, fragment::otp, __LINE__,
+                                  too_few_digits_message);
+            }
+
+            if (num_digits > max_digits)
+            {
+                return make_error(error_code::invalid_argument, module::crypto, fragment::otp, __LINE__,
+                                  too_many_digits_message);
             }
 
             auto hmac = Botan::MessageAuthenticationCode::create("HMAC(SHA-1)");
@@ -61,10 +75,32 @@ namespace keycap::crypto
 
             return result;
         }
+
+        /// <summary>
+        /// Implementation of the OATH HMAC-based One-Time Password algorithm.
+        /// See: https://tools.ietf.org/html/rfc4226
+        /// </summary>
+        export [[nodiscard]] std::string generate(std::string const& key, u64 counter,
+                                                  sz num_digits = required_min_digits)
+        {
+            return value_or_throw(try_generate(key, counter, num_digits));
+        }
     }
 
     namespace totp
     {
+        /// <summary>
+        /// Implementation of the OATH Time-based One-Time Password algorithm. Returns error_code::invalid_argument
+        /// instead of throwing if num_digits is out of range.
+        /// See: https://tools.ietf.org/html/rfc6238
+        /// </summary>
+        export [[nodiscard]] result<std::string> try_generate(std::string const& key, time_t now, time_t start,
+                                                              time_t step, sz num_digits = 6)
+        {
+            u64 counter = (now - start) / step;
+            return hotp::try_generate(key, counter, num_digits);
+        }
+
         /// <summary>
         /// Implementation of the OATH Time-based One-Time Password algorithm
         /// See: https://tools.ietf.org/html/rfc6238
@@ -88,9 +124,10 @@ namespace keycap::crypto
             for (int i = -1; i < 2; ++i)
             {
                 auto step = static_cast<u64>((std::floor(now / 30))) + i;
-                auto code_n = hotp::generate(key, step, code.size());
+                // Codes of unsupported length are never valid
+                auto code_n = hotp::try_generate(key, step, code.size());
 
-                if (code == code_n)
+                if (code_n && code == *code_n)
                     return true;
             }
 
@@ -2,7 +2,9 @@ module;
 
 #include <GLFW/glfw3.h>
 
+#include <expected>
 #include <string>
+#include <utility>
 
 export module keycap.window : window;
 export import : input_events;
@@ -123,10 +125,72 @@ namespace keycap
     {
         friend class window_context;
 
+        /// <summary>
+        /// Restricts construction to window_context
+        /// </summary>
+        struct passkey
+        {
+            explicit passkey() = default;
+        };
+
       public:
+        /// <summary>
+        /// Takes ownership of the given window handle. Use window_context::create_window or
+        /// window_context::try_create_window to create windows.
+        /// </summary>
+        window(passkey, GLFWwindow* handle, window_creation_parameters parameters)
+          : window_{handle}
+          , parameters_{std::move(parameters)}
+        {
+            glfwSetWindowUserPointer(window_, this);
+
+            if (parameters_.maximize)
+            {
+                glfwMaximizeWindow(window_);
+            }
+        }
+
+        window(window const&) = delete;
+        window& operator=(window const&) = delete;
+
+        /// <summary>
+        /// Takes over the other window's handle. The glfw window points back to its owner, so it is re-pointed at this
+        /// object.
+        /// </summary>
+        window(window&& other) noexcept
+          : window_{std::exchange(other.window_, nullptr)}
+          , parameters_{std::move(other.parameters_)}
+          , input_handler_{other.input_handler_}
+          , last_mouse_x_{other.last_mouse_x_}
+          , last_mouse_y_{other.last_mouse_y_}
+        {
+            if (window_)
+                glfwSetWindowUserPointer(window_, this);
+        }
+
+        window& operator=(window&& other) noexcept
+        {
+            if (this != &other)
+            {
+                if (window_)
+                    glfwDestroyWindow(window_);
+
+                window_ = std::exchange(other.window_, nullptr);
+                parameters_ = std::move(other.parameters_);
+                input_handler_ = other.input_handler_;
+                last_mouse_x_ = other.last_mouse_x_;
+                last_mouse_y_ = other.last_mouse_y_;
+
+                if (window_)
+                    glfwSetWindowUserPointer(window_, this);
+            }
+            return *this;
+        }
+
         ~window() noexcept
         {
-            glfwDestroyWindow(window_);
+            if (window_)
+                glfwDestroyWindow(window_);
         }
 
         /// <summary>
@@ -264,32 +328,23 @@ namespace keycap
         }
 
       private:
-        explicit window(window_creation_parameters parameters)
-          : parameters_{std::move(parameters)}
+        /// <summary>
+        /// Opens a glfw window, filling in the size of the primary monitor if none is given. Returns nullptr on
+        /// failure.
+        /// </summary>
+        [[nodiscard]] static GLFWwindow* open(window_creation_parameters& parameters) noexcept
         {
             if (parameters.height == 0 || parameters.width == 0)
             {
                 auto* monitor = glfwGetPrimaryMonitor();
                 auto* mode = glfwGetVideoMode(monitor);
 
-                parameters_.height = static_cast<u32>(mode->height);
-                parameters_.width = static_cast<u32>(mode->width);
+                parameters.height = static_cast<u32>(mode->height);
+                parameters.width = static_cast<u32>(mode->width);
             }
 
-            window_ = glfwCreateWindow(static_cast<int>(parameters_.width), static_cast<int>(parameters_.height),
-                                       parameters_.title.c_str(), nullptr, nullptr);
-            if (!window_)
-            {
-                throw exception(error_code::external_api_error, module::window, fragment::window, __LINE__,
-                                "Failed to create window");
-            }
-
-            glfwSetWindowUserPointer(window_, this);
-
-            if (parameters_.maximize)
-            {
-                glfwMaximizeWindow(window_);
-            }
+            return glfwCreateWindow(static_cast<int>(parameters.width), static_cast<int>(parameters.height),
+                                    parameters.title.c_str(), nullptr, nullptr);
         }
 
         GLFWwindow* window_ = nullptr;
@@ -306,6 +361,14 @@ namespace keycap
     /// </summary>
     export class window_context
     {
+        /// <summary>
+        /// Marks glfw as already initialized
+        /// </summary>
+        struct initialized
+        {
+            explicit initialized() = default;
+        };
+
       public:
         window_context()
         {
@@ -316,19 +379,79 @@ namespace keycap
             }
         }
 
+        /// <summary>
+        /// Use try_create instead
+        /// </summary>
+        explicit window_context(initialized) noexcept
+        {
+        }
+
+        // Terminates glfw when destroyed, so there must not be any copies
+        window_context(window_context const&) = delete;
+        window_context& operator=(window_context const&) = delete;
+
+        /// <summary>
+        /// Takes over terminating glfw from the other context, e.g. to move it out of the result of try_create
+        /// </summary>
+        window_context(window_context&& other) noexcept
+          : owns_glfw_{std::exchange(other.owns_glfw_, false)}
+        {
+        }
+
+        window_context& operator=(window_context&&) = delete;
+
+        /// <summary>
+        /// Initializes glfw, returning error_code::external_api_error instead of throwing on failure
+        /// </summary>
+        [[nodiscard]] static result<window_context> try_create() noexcept
+        {
+            if (glfwInit() != GLFW_TRUE)
+            {
+                return make_error(error_code::external_api_error, module::window, fragment::window, __LINE__,
+                                  "Failed to initialize glfw");
+            }
+
+            return result<window_context>{std::in_place, initialized{}};
+        }
+
         /// <summary>
         /// Creates a new window with the given parameters
         /// </summary>
         [[nodiscard]] window create_window(window_creation_parameters parameters)
         {
-            return window{parameters};
+            auto* handle = window::open(parameters);
+            if (!handle)
+            {
+                throw exception(error_code::external_api_error, module::window, fragment::window, __LINE__,
+                                "Failed to create window");
+            }
+
+            return window{window::passkey{}, handle, std::move(parameters)};
+        }
+
+        /// <summary>
+        /// Creates a new window with the given parameters, returning error_code::external_api_error instead of
+        /// throwing on failure
+        /// </summary>
+        [[nodiscard]] result<window> try_create_window(window_creation_parameters parameters)
+        {
+            auto* handle = window::open(parameters);
+            if (!handle)
+            {
+                return make_error(error_code::external_api_error, module::window, fragment::window, __LINE__,
+                                  "Failed to create window");
+            }
+
+            return result<window>{std::in_place, window::passkey{}, handle, std::move(parameters)};
         }
 
         ~window_context()
         {
-            glfwTerminate();
+            if (owns_glfw_)
+                glfwTerminate();
         }
 
       private:
+        bool owns_glfw_ = true;
     };
 }
@@ -0,0 +1,1957 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cctype>
+#include <cmath>
+#include <cstddef>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <list>
+#include <memory_resource>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+import keycap.core;
+
+namespace
+{
+    /// <summary>
+    /// Returns a string of roughly the given size consisting of short, space-delimited words
+    /// </summary>
+    std::string make_words(sz size)
+    {
+        constexpr std::string_view words[] = {"lorem", "ipsum", "dolor", "sit", "amet", "consectetur", "adipiscing"};
+
+        std::string buffer;
+        buffer.reserve(size + 16);
+        for (sz i = 0; buffer.size() < size; ++i)
+        {
+            buffer += words[i % std::size(words)];
+            buffer += ' ';
+        }
+
+        return buffer;
+    }
+
+    /// <summary>
+    /// The engine behind keycap::random, used to drive the standard distributions of the previous implementation
+    /// </summary>
+    struct legacy_engine
+    {
+        using result_type = u64;
+
+        static constexpr u64 min()
+        {
+            return 0;
+        }
+
+        static constexpr u64 max()
+        {
+            return ~u64{0};
+        }
+
+        u64 operator()()
+        {
+            u64 const s0 = state[0];
+            u64 s1 = state[1];
+            u64 const result = s0 + s1;
+
+            s1 ^= s0;
+            state[0] = std::rotl(s0, 24) ^ s1 ^ (s1 << 16);
+            state[1] = std::rotl(s1, 37);
+
+            return result;
+        }
+
+        u64 state[2] = {0x0F1E2D3C4B5A6978, 0x8796A5B4C3D2E1F0};
+    };
+
+    using keycap::simd::instruction_set;
+    constexpr instruction_set benchmarked_instruction_sets[] = {instruction_set::scalar, instruction_set::sse2,
+                                                                instruction_set::avx2, instruction_set::avx512};
+
+    std::string instruction_set_name(instruction_set set)
+    {
+        switch (set)
+        {
+            case instruction_set::scalar:
+                return "scalar";
+            case instruction_set::sse2:
+                return "sse2";
+            case instruction_set::avx2:
+                return "avx2";
+            case instruction_set::avx512:
+                return "avx512";
+        }
+        return "unknown";
+    }
+}
+
+TEST_CASE("Splitting large strings", "[keycap.core:string][benchmark]")
+{
+    // The previous implementation of keycap::split, kept as a baseline. It erases every token from the front of the
+    // input, which makes it quadratic in the input size
+    auto const legacy_split = [](std::string string, std::string delimiter) {
+        std::vector<std::string> tokens;
+
+        sz pos = 0;
+        while ((pos = string.find(delimiter)) != std::string::npos)
+        {
+            tokens.emplace_back(string.substr(0, pos));
+            string.erase(0, pos + delimiter.length());
+        }
+        tokens.emplace_back(string);
+
+        return tokens;
+    };
+
+    auto const small = make_words(64 * 1024);
+    auto const large = make_words(16 * 1024 * 1024);
+
+    BENCHMARK("legacy split 64 KiB")
+    {
+        return legacy_split(small, " ");
+    };
+
+    BENCHMARK("split 64 KiB")
+    {
+        return keycap::split(small, " ");
+    };
+
+    BENCHMARK("split_view 64 KiB")
+    {
+        sz total = 0;
+        for (auto token : keycap::split_view{small, ' '})
+        {
+            total += token.size();
+        }
+        return total;
+    };
+
+    BENCHMARK("split 16 MiB")
+    {
+        return keycap::split(large, " ");
+    };
+
+    BENCHMARK("split_view 16 MiB")
+    {
+        sz total = 0;
+        for (auto token : keycap::split_view{large, ' '})
+        {
+            total += token.size();
+        }
+        return total;
+    };
+
+    BENCHMARK("split_view 16 MiB, multi-character delimiter")
+    {
+        sz total = 0;
+        for (auto token : keycap::split_view{large, "m "})
+        {
+            total += token.size();
+        }
+        return total;
+    };
+}
+
+TEST_CASE("Converting the case of strings", "[keycap.core:string][benchmark]")
+{
+    // The previous implementation of keycap::to_lower, kept as a baseline
+    auto const legacy_to_lower = [](std::string string) {
+        std::for_each(string.begin(), string.end(), [](char& c) {
+            c = static_cast<char>(::tolower(c));
+        });
+
+        return string;
+    };
+
+    auto identifiers = make_words(1024 * 1024);
+    keycap::to_upper(std::span<char>{identifiers});
+
+    BENCHMARK("legacy to_lower 1 MiB")
+    {
+        return legacy_to_lower(identifiers);
+    };
+
+    BENCHMARK("to_lower 1 MiB")
+    {
+        return keycap::to_lower(identifiers);
+    };
+
+    for (auto set : benchmarked_instruction_sets)
+    {
+        if (set > keycap::simd::detected_instruction_set())
+            continue;
+
+        auto const previous = keycap::simd::limit_instruction_set(set);
+        auto const name = instruction_set_name(keycap::simd::max_instruction_set());
+
+        BENCHMARK("in-place to_lower 1 MiB, " + name)
+        {
+            keycap::to_lower(std::span<char>{identifiers});
+            return identifiers.front();
+        };
+
+        BENCHMARK("iequals 1 MiB, " + name)
+        {
+            return keycap::iequals(identifiers, identifiers);
+        };
+
+        keycap::simd::limit_instruction_set(previous);
+    }
+}
+
+TEST_CASE("Hashing strings", "[keycap.core:string][benchmark]")
+{
+    // The previous implementation of keycap::hash_u64, kept as a baseline
+    auto const legacy_hash_u64 = [](char const* string, std::size_t size) {
+        if (size == 0)
+            return u64{0};
+
+        u64 const p = 131;
+        u64 const m = 4294967291;
+
+        u64 hash = 0;
+        u64 multiplier = 1;
+
+        for (std::size_t i = 0; i < size - 1; ++i)
+        {
+            hash = (hash + multiplier * static_cast<u64>(string[i])) % m;
+            multiplier = (multiplier * p) % m;
+        }
+
+        return hash;
+    };
+
+    // Divide the bytes by the mean time to get the throughput, e.g. 64 MiB in 10 ms is 6.7 GB/s
+    auto const large = make_words(64 * 1024 * 1024);
+
+    BENCHMARK("legacy hash_u64 64 MiB")
+    {
+        return legacy_hash_u64(large.data(), large.size());
+    };
+
+    for (auto set : benchmarked_instruction_sets)
+    {
+        if (set > keycap::simd::detected_instruction_set())
+            continue;
+
+        auto const previous = keycap::simd::limit_instruction_set(set);
+
+        BENCHMARK("hash_u64 64 MiB, " + instruction_set_name(set))
+        {
+            return keycap::hash_u64(large);
+        };
+
+        keycap::simd::limit_instruction_set(previous);
+    }
+
+    std::vector<std::string> identifiers;
+    for (auto token : keycap::split_view{std::string_view{large}.substr(0, 1024 * 1024)})
+    {
+        identifiers.emplace_back(token);
+    }
+
+    BENCHMARK("legacy hash_u64 short identifiers")
+    {
+        u64 result = 0;
+        for (auto const& identifier : identifiers)
+        {
+            result ^= legacy_hash_u64(identifier.data(), identifier.size());
+        }
+        return result;
+    };
+
+    BENCHMARK("hash_u64 short identifiers")
+    {
+        u64 result = 0;
+        for (auto const& identifier : identifiers)
+        {
+            result ^= keycap::hash_u64(identifier);
+        }
+        return result;
+    };
+}
+
+TEST_CASE("Looking up keywords", "[keycap.core:perfecthash][benchmark]")
+{
+    constexpr std::pair<std::string_view, int> keyword_list[] = {
+        {"alignas", 0},    {"alignof", 1},       {"auto", 2},       {"bool", 3},          {"break", 4},
+        {"case", 5},       {"catch", 6},         {"char", 7},       {"class", 8},         {"concept", 9},
+        {"const", 10},     {"consteval", 11},    {"constexpr", 12}, {"constinit", 13},    {"continue", 14},
+        {"decltype", 15},  {"default", 16},      {"delete", 17},    {"do", 18},           {"double", 19},
+        {"else", 20},      {"enum", 21},         {"explicit", 22},  {"export", 23},       {"extern", 24},
+        {"false", 25},     {"float", 26},        {"for", 27},       {"friend", 28},       {"goto", 29},
+        {"if", 30},        {"inline", 31},       {"int", 32},       {"long", 33},         {"mutable", 34},
+        {"namespace", 35}, {"new", 36},          {"noexcept", 37},  {"nullptr", 38},      {"operator", 39},
+        {"private", 40},   {"protected", 41},    {"public", 42},    {"requires", 43},     {"return", 44},
+        {"short", 45},     {"signed", 46},       {"sizeof", 47},    {"static", 48},       {"static_assert", 49},
+        {"struct", 50},    {"switch", 51},       {"template", 52},  {"this", 53},         {"throw", 54},
+        {"true", 55},      {"try", 56},          {"typedef", 57},   {"typename", 58},     {"union", 59},
+        {"unsigned", 60},  {"using", 61},        {"virtual", 62},   {"void", 63},         {"volatile", 64},
+        {"while", 65},     {"co_await", 66},     {"co_return", 67}, {"co_yield", 68},     {"thread_local", 69},
+    };
+    constexpr auto keywords = keycap::make_perfect_hash_map(keyword_list);
+
+    std::unordered_map<std::string, int> const unordered{std::begin(keyword_list), std::end(keyword_list)};
+
+    std::vector<std::pair<std::string_view, int>> sorted{std::begin(keyword_list), std::end(keyword_list)};
+    std::sort(sorted.begin(), sorted.end());
+
+    // Every keyword a couple of times, a quarter of the queries are identifiers that miss
+    std::vector<std::string> queries;
+    for (int round = 0; round < 16; ++round)
+    {
+        for (auto const& [keyword, value] : keyword_list)
+        {
+            queries.emplace_back(round % 4 == 0 ? std::string{keyword} + "_id" : std::string{keyword});
+        }
+    }
+
+    BENCHMARK("std::unordered_map<std::string, int>")
+    {
+        int sum = 0;
+        for (auto const& query : queries)
+        {
+            if (auto itr = unordered.find(query); itr != unordered.end())
+                sum += itr->second;
+        }
+        return sum;
+    };
+
+    BENCHMARK("sorted std::vector, binary search")
+    {
+        int sum = 0;
+        for (auto const& query : queries)
+        {
+            auto itr = std::lower_bound(sorted.begin(), sorted.end(), std::string_view{query},
+                                        [](auto const& entry, std::string_view key) {
+                                            return entry.first < key;
+                                        });
+            if (itr != sorted.end() && itr->first == query)
+                sum += itr->second;
+        }
+        return sum;
+    };
+
+    BENCHMARK("perfect_hash_map")
+    {
+        int sum = 0;
+        for (auto const& query : queries)
+        {
+            if (auto const* value = keywords.find(query))
+                sum += *value;
+        }
+        return sum;
+    };
+}
+
+TEST_CASE("Interning strings concurrently", "[keycap.core:string][benchmark]")
+{
+    constexpr sz identifier_count = 10'000;
+    constexpr sz lookups_per_thread = 100'000;
+
+    std::vector<std::string> identifiers;
+    for (sz i = 0; i < identifier_count; ++i)
+    {
+        identifiers.push_back("identifier_" + std::to_string(i));
+    }
+
+    keycap::symbol_table table;
+    for (auto const& identifier : identifiers)
+    {
+        [[maybe_unused]] auto _ = table.intern(identifier);
+    }
+
+    // The usual alternative: a mutex-protected set of strings
+    std::mutex mutex;
+    std::unordered_set<std::string> set{identifiers.begin(), identifiers.end()};
+
+    // Runs the given function on thread_count threads, each doing lookups_per_thread lookups
+    auto const run_threads = [&](sz thread_count, auto&& lookup) {
+        std::vector<std::thread> threads;
+        for (sz t = 0; t < thread_count; ++t)
+        {
+            threads.emplace_back([&, t] {
+                for (sz i = 0; i < lookups_per_thread; ++i)
+                {
+                    lookup(identifiers[(i * 7 + t * 613) % identifier_count]);
+                }
+            });
+        }
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+    };
+
+    for (sz thread_count : std::array<sz, 6>{1, 2, 4, 8, 16, 32})
+    {
+        BENCHMARK("std::unordered_set + std::mutex, " + std::to_string(thread_count) + " threads")
+        {
+            run_threads(thread_count, [&](std::string const& identifier) {
+                std::lock_guard lock{mutex};
+                return set.insert(identifier).first->size();
+            });
+        };
+
+        BENCHMARK("symbol_table::intern, " + std::to_string(thread_count) + " threads")
+        {
+            run_threads(thread_count, [&](std::string const& identifier) {
+                return table.intern(identifier).view().size();
+            });
+        };
+    }
+}
+
+TEST_CASE("Assembling strings", "[keycap.core:string][benchmark]")
+{
+    // The previous implementation of keycap::join, kept as a baseline. It did not reserve space for the delimiters
+    auto const legacy_join = [](std::vector<std::string> const& container, std::string delimiter) {
+        sz buffer_size = 0;
+        for (auto&& str : container)
+        {
+            buffer_size += str.size();
+        }
+
+        std::string str;
+        str.reserve(buffer_size);
+
+        bool first = true;
+        for (auto&& s : container)
+        {
+            if (!first)
+                str += delimiter;
+
+            str += s;
+            first = false;
+        }
+
+        return str;
+    };
+
+    auto const words = keycap::split(make_words(4096));
+
+    BENCHMARK("legacy join")
+    {
+        return legacy_join(words, ", ");
+    };
+
+    BENCHMARK("join")
+    {
+        return keycap::join(words, ", ");
+    };
+
+    std::string target;
+    BENCHMARK("join_into a reused std::string")
+    {
+        target.clear();
+        keycap::join_into(target, words, ", ");
+        return target.size();
+    };
+
+    std::string const component{"keycap.core"};
+    std::string const message{"Failed to open file 'config.json'"};
+
+    BENCHMARK("log line with std::string +=")
+    {
+        std::string line;
+        line += "[";
+        line += std::to_string(1234567);
+        line += "] ";
+        line += component;
+        line += ": ";
+        line += message;
+        line += " (errno ";
+        line += std::to_string(2);
+        line += ")";
+        return line;
+    };
+
+    BENCHMARK("log line with fmt::format")
+    {
+        return fmt::format("[{}] {}: {} (errno {})", 1234567, component, message, 2);
+    };
+
+    keycap::string_builder builder;
+    BENCHMARK("log line with a reused string_builder")
+    {
+        builder.clear();
+        builder.append('[').append(1234567).append("] ").append(component).append(": ").append(message);
+        builder.append(" (errno ").append(2).append(')');
+        return builder.build();
+    };
+}
+
+TEST_CASE("Serializing binary data", "[keycap.core:array][benchmark]")
+{
+    // Serializing into a big endian buffer with the previous helpers, kept as a baseline
+    auto const legacy_write = [](std::vector<u8>& buffer, std::span<u32 const> values) {
+        buffer.clear();
+        for (auto value : values)
+        {
+            auto bytes = keycap::to_byte_array(value);
+            std::reverse(bytes.begin(), bytes.end());
+            buffer.insert(buffer.end(), bytes.begin(), bytes.end());
+        }
+        return buffer.size();
+    };
+
+    std::vector<u32> values(256 * 1024);
+    for (sz i = 0; i < values.size(); ++i)
+        values[i] = static_cast<u32>(i * 2654435761u);
+
+    std::vector<u8> buffer(values.size() * sizeof(u32));
+
+    // Note: 1 MiB per iteration; divide 1 MiB by the mean to get GB/s
+    BENCHMARK("legacy to_byte_array, 1 MiB of big endian u32")
+    {
+        return legacy_write(buffer, values);
+    };
+
+    BENCHMARK("byte_writer, element-wise, 1 MiB of big endian u32")
+    {
+        keycap::byte_writer<std::endian::big> writer{buffer};
+        for (auto value : values)
+            writer.write(value);
+        return writer.position();
+    };
+
+    for (auto set : benchmarked_instruction_sets)
+    {
+        if (set > keycap::simd::detected_instruction_set())
+            continue;
+
+        auto const previous = keycap::simd::limit_instruction_set(set);
+        auto const name = instruction_set_name(keycap::simd::max_instruction_set());
+
+        BENCHMARK("byte_writer, bulk, 1 MiB of big endian u32, " + name)
+        {
+            keycap::byte_writer<std::endian::big> writer{buffer};
+            writer.write(values);
+            return writer.position();
+        };
+
+        BENCHMARK("byte_reader, bulk, 1 MiB of big endian u32, " + name)
+        {
+            keycap::byte_reader<std::endian::big> reader{buffer};
+            reader.read(values);
+            return values.front();
+        };
+
+        keycap::simd::limit_instruction_set(previous);
+    }
+}
+
+TEST_CASE("Decoding binary data", "[keycap.core:array][benchmark]")
+{
+    std::vector<std::byte> blob(1024 * 1024);
+    for (sz i = 0; i < blob.size(); ++i)
+        blob[i] = static_cast<std::byte>(i * 31);
+
+    std::vector<u32> values(blob.size() / sizeof(u32));
+
+    BENCHMARK("from_byte_vector, 1 MiB of u32")
+    {
+        u32 sum = 0;
+        for (sz i = 0; i < blob.size(); i += sizeof(u32))
+        {
+            auto const* first = reinterpret_cast<u8 const*>(blob.data() + i);
+            sum += keycap::from_byte_vector<u32>(std::vector<u8>{first, first + sizeof(u32)});
+        }
+        return sum;
+    };
+
+    BENCHMARK("packed_view, element-wise, 1 MiB of u32")
+    {
+        u32 sum = 0;
+        for (auto value : keycap::packed_view<u32>{blob})
+            sum += value;
+        return sum;
+    };
+
+    BENCHMARK("packed_view, element-wise, 1 MiB of big endian u32")
+    {
+        u32 sum = 0;
+        for (auto value : keycap::packed_view<u32, std::endian::big>{blob})
+            sum += value;
+        return sum;
+    };
+
+    for (auto set : benchmarked_instruction_sets)
+    {
+        if (set > keycap::simd::detected_instruction_set())
+            continue;
+
+        auto const previous = keycap::simd::limit_instruction_set(set);
+        auto const name = instruction_set_name(keycap::simd::max_instruction_set());
+
+        BENCHMARK("packed_view::decode_into, 1 MiB of big endian u32, " + name)
+        {
+            return keycap::packed_view<u32, std::endian::big>{blob}.decode_into(values).size();
+        };
+
+        keycap::simd::limit_instruction_set(previous);
+    }
+}
+
+TEST_CASE("Generating random numbers", "[keycap.core:random][benchmark]")
+{
+    legacy_engine engine;
+
+    constexpr int count = 1'000'000;
+
+    // Note: 1'000'000 numbers per iteration; the mean in ms equals ns/number
+    BENCHMARK("legacy uniform_int_distribution, [1, 6]")
+    {
+        u64 sum = 0;
+        for (int i = 0; i < count; ++i)
+        {
+            std::uniform_int_distribution<u16> dist(1, 6);
+            sum += dist(engine);
+        }
+        return sum;
+    };
+
+    BENCHMARK("random_u8, [1, 6]")
+    {
+        u64 sum = 0;
+        for (int i = 0; i < count; ++i)
+            sum += keycap::random::random_u8(1, 6);
+        return sum;
+    };
+
+    BENCHMARK("legacy uniform_int_distribution, [0, 10^12)")
+    {
+        u64 sum = 0;
+        for (int i = 0; i < count; ++i)
+        {
+            std::uniform_int_distribution<u64> dist(0, 999'999'999'999);
+            sum += dist(engine);
+        }
+        return sum;
+    };
+
+    BENCHMARK("random_u64, [0, 10^12)")
+    {
+        u64 sum = 0;
+        for (int i = 0; i < count; ++i)
+            sum += keycap::random::random_u64(0, 999'999'999'999);
+        return sum;
+    };
+
+    BENCHMARK("legacy uniform_int_distribution, full range i32")
+    {
+        i64 sum = 0;
+        for (int i = 0; i < count; ++i)
+        {
+            std::uniform_int_distribution<i32> dist(std::numeric_limits<i32>::min(), std::numeric_limits<i32>::max());
+            sum += dist(engine);
+        }
+        return sum;
+    };
+
+    BENCHMARK("random_i32, full range")
+    {
+        i64 sum = 0;
+        for (int i = 0; i < count; ++i)
+            sum += keycap::random::random_i32();
+        return sum;
+    };
+
+    BENCHMARK("std::uniform_real_distribution, [0, 1)")
+    {
+        f64 sum = 0;
+        for (int i = 0; i < count; ++i)
+        {
+            std::uniform_real_distribution<f64> dist(0.0, 1.0);
+            sum += dist(engine);
+        }
+        return sum;
+    };
+
+    BENCHMARK("random_f64, [0, 1)")
+    {
+        f64 sum = 0;
+        for (int i = 0; i < count; ++i)
+            sum += keycap::random::random_f64();
+        return sum;
+    };
+
+    BENCHMARK("random_f32, [-1, 1)")
+    {
+        f32 sum = 0;
+        for (int i = 0; i < count; ++i)
+            sum += keycap::random::random_f32(-1.0f, 1.0f);
+        return sum;
+    };
+}
+
+
+TEST_CASE("Filling with random numbers", "[keycap.core:random][benchmark]")
+{
+    std::vector<u32> integers(4 * 1024 * 1024);
+    std::vector<f32> floats(integers.size());
+    std::vector<u64> wide(integers.size() / 2);
+
+    // Note: 16 MiB per iteration; divide 16 MiB by the mean to get GB/s
+    BENCHMARK("random_u32 per element, 16 MiB of u32 in [0, 1000]")
+    {
+        for (auto& value : integers)
+            value = keycap::random::random_u32(0, 1000);
+        return integers.back();
+    };
+
+    for (auto set : benchmarked_instruction_sets)
+    {
+        if (set > keycap::simd::detected_instruction_set())
+            continue;
+
+        auto const previous = keycap::simd::limit_instruction_set(set);
+        auto const name = instruction_set_name(keycap::simd::max_instruction_set());
+
+        BENCHMARK("fill, 16 MiB of u32 in [0, 1000], " + name)
+        {
+            keycap::random::fill(std::span{integers}, 0, 1000);
+            return integers.back();
+        };
+
+        BENCHMARK("fill, 16 MiB of f32 in [-1, 1), " + name)
+        {
+            keycap::random::fill(std::span{floats}, -1.0f, 1.0f);
+            return floats.back();
+        };
+
+        BENCHMARK("fill, 16 MiB of full range u64, " + name)
+        {
+            keycap::random::fill(std::span{wide});
+            return wide.back();
+        };
+
+        keycap::simd::limit_instruction_set(previous);
+    }
+}
+
+TEST_CASE("Estimating pi on parallel random streams", "[keycap.core:random][benchmark]")
+{
+    constexpr sz samples_per_thread = 1'000'000;
+
+    // The usual alternative to independent streams: a single generator shared behind a mutex
+    std::mutex mutex;
+    keycap::random::xoroshiro128plus shared{1};
+
+    keycap::random::stream_registry const registry{1};
+
+    // Runs thread_count tasks in parallel, each counting the random points that fall into the unit circle
+    auto const run_threads = [&](sz thread_count, auto&& task) {
+        std::vector<sz> hits(thread_count);
+        std::vector<std::thread> threads;
+        for (sz t = 0; t < thread_count; ++t)
+            threads.emplace_back([&, t] { hits[t] = task(t); });
+
+        for (auto& thread : threads)
+            thread.join();
+
+        sz total = 0;
+        for (auto hit : hits)
+            total += hit;
+        return 4.0 * static_cast<f64>(total) / static_cast<f64>(samples_per_thread * thread_count);
+    };
+
+    for (sz thread_count : std::array<sz, 4>{1, 2, 4, 8})
+    {
+        BENCHMARK("shared generator + std::mutex, " + std::to_string(thread_count) + " threads")
+        {
+            return run_threads(thread_count, [&](sz) {
+                sz hits = 0;
+                for (sz i = 0; i < samples_per_thread; ++i)
+                {
+                    std::scoped_lock lock{mutex};
+                    auto const x = static_cast<f64>(shared() >> 11) * 0x1.0p-53;
+                    auto const y = static_cast<f64>(shared() >> 11) * 0x1.0p-53;
+                    hits += x * x + y * y < 1.0;
+                }
+                return hits;
+            });
+        };
+
+        BENCHMARK("stream_registry stream per task, " + std::to_string(thread_count) + " threads")
+        {
+            return run_threads(thread_count, [&](sz task) {
+                keycap::random::use_stream(registry.stream(task));
+
+                sz hits = 0;
+                for (sz i = 0; i < samples_per_thread; ++i)
+                {
+                    auto const x = keycap::random::random_f64();
+                    auto const y = keycap::random::random_f64();
+                    hits += x * x + y * y < 1.0;
+                }
+                return hits;
+            });
+        };
+    }
+}
+
+TEST_CASE("Comparing random engines", "[keycap.core:random][benchmark]")
+{
+    constexpr int count = 1'000'000;
+    std::vector<u32> values(count);
+
+    // Note: 1'000'000 numbers per iteration; the mean in ms equals ns/number
+    auto const benchmark_engine = [&]<typename Engine>(std::string const& name, Engine engine) {
+        BENCHMARK(name + ", raw u64")
+        {
+            u64 sum = 0;
+            for (int i = 0; i < count; ++i)
+                sum += engine();
+            return sum;
+        };
+
+        BENCHMARK(name + ", random_u32 in [0, 1000]")
+        {
+            u64 sum = 0;
+            for (int i = 0; i < count; ++i)
+                sum += keycap::random::random_u32(engine, 0, 1000);
+            return sum;
+        };
+
+        BENCHMARK(name + ", fill u32 in [0, 1000]")
+        {
+            keycap::random::fill(engine, std::span{values}, 0, 1000);
+            return values.back();
+        };
+    };
+
+    benchmark_engine("std::mt19937_64", std::mt19937_64{1});
+    benchmark_engine("xoroshiro128plus", keycap::random::xoroshiro128plus{1});
+    benchmark_engine("xoshiro256starstar", keycap::random::xoshiro256starstar{1});
+    benchmark_engine("pcg64", keycap::random::pcg64{1});
+    benchmark_engine("wyrand", keycap::random::wyrand{1});
+}
+
+TEST_CASE("Drawing from weighted distributions", "[keycap.core:sampling][benchmark]")
+{
+    constexpr int draws = 1'000'000;
+
+    // Note: 1'000'000 draws per iteration; the mean in ms equals ns/draw. Large tables no longer fit into the cache,
+    // which dominates the cost of both methods.
+    for (sz size : std::array<sz, 3>{1'000, 1'000'000, 10'000'000})
+    {
+        std::vector<f64> weights(size);
+        keycap::random::fill(std::span{weights}, 0.0, 1.0);
+
+        auto const suffix = ", " + std::to_string(size) + " weights";
+
+        legacy_engine engine;
+        std::discrete_distribution<sz> distribution(weights.begin(), weights.end());
+        BENCHMARK("std::discrete_distribution" + suffix)
+        {
+            sz sum = 0;
+            for (int i = 0; i < draws; ++i)
+                sum += distribution(engine);
+            return sum;
+        };
+
+        keycap::random::alias_table const table{weights};
+        keycap::random::xoroshiro128plus keycap_engine;
+        BENCHMARK("alias_table" + suffix)
+        {
+            sz sum = 0;
+            for (int i = 0; i < draws; ++i)
+                sum += table(keycap_engine);
+            return sum;
+        };
+
+        BENCHMARK("building an alias_table" + suffix)
+        {
+            return keycap::random::alias_table{weights}.size();
+        };
+    }
+}
+
+TEST_CASE("Sampling streams", "[keycap.core:sampling][benchmark]")
+{
+    constexpr sz capacity = 1'000;
+
+    // The textbook Algorithm R, which draws a random number for every value of the stream
+    auto const algorithm_r = [](auto&& values, sz k, auto& engine) {
+        std::vector<u64> reservoir;
+        u64 seen = 0;
+        for (auto const value : values)
+        {
+            if (reservoir.size() < k)
+                reservoir.push_back(value);
+            else if (auto const index = std::uniform_int_distribution<u64>{0, seen}(engine); index < k)
+                reservoir[index] = value;
+            ++seen;
+        }
+        return reservoir;
+    };
+
+    // Note: the streams are generated on the fly, so 10^9 values need no memory
+    for (u64 size : {1'000'000ull, 100'000'000ull, 1'000'000'000ull})
+    {
+        auto const suffix = ", 1000 of " + std::to_string(size) + " values";
+        auto const stream = std::views::iota(u64{0}, size);
+
+        if (size <= 100'000'000)
+        {
+            legacy_engine engine;
+            BENCHMARK("Algorithm R" + suffix)
+            {
+                return algorithm_r(stream, capacity, engine).back();
+            };
+        }
+
+        BENCHMARK("reservoir_sampler::push" + suffix)
+        {
+            keycap::random::reservoir_sampler<u64> sampler{capacity};
+            for (auto const value : stream)
+                sampler.push(value);
+            return sampler.sample().back();
+        };
+
+        BENCHMARK("reservoir_sampler::push_range" + suffix)
+        {
+            keycap::random::reservoir_sampler<u64> sampler{capacity};
+            sampler.push_range(stream);
+            return sampler.sample().back();
+        };
+    }
+}
+
+TEST_CASE("Shuffling", "[keycap.core:sampling][benchmark]")
+{
+    // Note: 10^9 u32 would need 4 GB, more than the benchmark machines are guaranteed to have
+    for (sz size : std::array<sz, 3>{1'000'000, 10'000'000, 100'000'000})
+    {
+        std::vector<u32> values(size);
+        std::iota(values.begin(), values.end(), 0u);
+
+        auto const suffix = ", " + std::to_string(size) + " u32";
+
+        legacy_engine engine;
+        BENCHMARK("std::shuffle" + suffix)
+        {
+            std::shuffle(values.begin(), values.end(), engine);
+            return values.back();
+        };
+
+        keycap::random::xoroshiro128plus keycap_engine;
+        BENCHMARK("shuffle" + suffix)
+        {
+            keycap::random::shuffle(keycap_engine, std::span{values});
+            return values.back();
+        };
+    }
+}
+
+TEST_CASE("Throwing exceptions", "[keycap.core:error][benchmark]")
+{
+    using namespace keycap;
+
+    BENCHMARK("throw/catch std::runtime_error")
+    {
+        try
+        {
+            throw std::runtime_error{"Benchmark"};
+        }
+        catch (std::runtime_error const& e)
+        {
+            return e.what()[0];
+        }
+    };
+
+    BENCHMARK("throw/catch keycap::exception")
+    {
+        try
+        {
+            throw keycap::exception{error_code::logic_error, module::core, 0, __LINE__, "Benchmark"};
+        }
+        catch (keycap::exception const& e)
+        {
+            return e.stack_trace.size();
+        }
+    };
+
+    // Note: keycap::exception used to resolve its stack-trace in the constructor, so this equals its former cost
+    BENCHMARK("throw/catch keycap::exception + to_string(true)")
+    {
+        try
+        {
+            throw keycap::exception{error_code::logic_error, module::core, 0, __LINE__, "Benchmark"};
+        }
+        catch (keycap::exception const& e)
+        {
+            return e.to_string(true).size();
+        }
+    };
+}
+
+TEST_CASE("Looking up source lines", "[keycap.core:source][benchmark]")
+{
+    auto const path = (std::filesystem::temp_directory_path() / "keycap.benchmark.source.txt").string();
+    {
+        std::ofstream file{path};
+        for (int i = 0; i < 10'000; ++i)
+            file << "    auto const value_" << i << " = compute(" << i << ");\n";
+    }
+
+    // The previous implementation: open the file and scan it up to the wanted line for every stack frame
+    auto const legacy_line = [&](u32 number) {
+        std::ifstream file{path};
+        u32 i = 0;
+        for (std::string line; std::getline(file, line);)
+        {
+            if (++i == number)
+                return line;
+        }
+        return std::string{};
+    };
+
+    BENCHMARK("std::ifstream + std::getline, line 5'000 of 10'000")
+    {
+        return legacy_line(5'000);
+    };
+
+    BENCHMARK("source_cache::line, line 5'000 of 10'000")
+    {
+        return keycap::source_cache::global().line(path, 5'000);
+    };
+
+    keycap::source_cache::global().clear();
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Failing fast", "[keycap.core:result][benchmark]")
+{
+    using namespace keycap;
+
+    std::array<std::byte, 4> const truncated{};
+    std::array<u8, 4> const truncated_buffer{};
+
+    // Note: from_bytes and byte_reader::read report a truncated buffer by throwing a keycap::exception, which includes
+    // capturing a stack-trace
+    BENCHMARK("from_bytes<u64>, throw/catch on a truncated buffer")
+    {
+        try
+        {
+            return from_bytes<u64>(truncated);
+        }
+        catch (keycap::exception const& e)
+        {
+            return static_cast<u64>(e.error);
+        }
+    };
+
+    BENCHMARK("try_from_bytes<u64> on a truncated buffer")
+    {
+        auto const value = try_from_bytes<u64>(truncated);
+        return value ? *value : static_cast<u64>(value.error().error);
+    };
+
+    BENCHMARK("byte_reader::read<u64>, throw/catch on a truncated buffer")
+    {
+        byte_reader<> reader{truncated_buffer};
+        try
+        {
+            return reader.read<u64>();
+        }
+        catch (keycap::exception const& e)
+        {
+            return static_cast<u64>(e.error);
+        }
+    };
+
+    BENCHMARK("byte_reader::try_read<u64> on a truncated buffer")
+    {
+        byte_reader<> reader{truncated_buffer};
+        auto const value = reader.try_read<u64>();
+        return value ? *value : static_cast<u64>(value.error().error);
+    };
+}
+
+TEST_CASE("Counting errors", "[keycap.core:error][benchmark]")
+{
+    using namespace keycap;
+
+    // Note: this is the overhead error_telemetry adds to every keycap::exception
+    BENCHMARK("error_telemetry::record")
+    {
+        error_telemetry::record(module::core, 0, error_code::logic_error);
+    };
+
+    BENCHMARK("error_telemetry::snapshot")
+    {
+        return error_telemetry::snapshot().total();
+    };
+
+    BENCHMARK("error_telemetry::snapshot().to_json()")
+    {
+        return error_telemetry::snapshot().to_json().size();
+    };
+
+    error_telemetry::reset();
+}
+
+TEST_CASE("Guarding scopes", "[keycap.core:scopeguard][benchmark]")
+{
+    using namespace keycap;
+
+    // Every iteration enters a scope, registers the handlers and leaves it again
+    constexpr int iterations = 1'000;
+    u64 counter = 0;
+
+    // Note: scope_exit is inlined entirely, so its loops fold just like the unguarded one
+    BENCHMARK("no guard")
+    {
+        for (int i = 0; i < iterations; ++i)
+            ++counter;
+        return counter;
+    };
+
+    BENCHMARK("scope_guard, 1 handler")
+    {
+        for (int i = 0; i < iterations; ++i)
+            scope_guard guard{[&] { ++counter; }};
+        return counter;
+    };
+
+    BENCHMARK("scope_exit, 1 handler")
+    {
+        for (int i = 0; i < iterations; ++i)
+            scope_exit guard{[&] { ++counter; }};
+        return counter;
+    };
+
+    BENCHMARK("scope_guard, 3 handlers")
+    {
+        for (int i = 0; i < iterations; ++i)
+        {
+            scope_guard guard{[&] { ++counter; }};
+            guard += [&] { counter += 2; };
+            guard += [&] { counter += 3; };
+        }
+        return counter;
+    };
+
+    BENCHMARK("inplace_scope_guard<3>, 3 handlers")
+    {
+        for (int i = 0; i < iterations; ++i)
+        {
+            inplace_scope_guard<3> guard{[&] { ++counter; }};
+            guard += [&] { counter += 2; };
+            guard += [&] { counter += 3; };
+        }
+        return counter;
+    };
+
+    BENCHMARK("3 x scope_exit, 3 handlers")
+    {
+        for (int i = 0; i < iterations; ++i)
+        {
+            scope_exit first{[&] { ++counter; }};
+            scope_exit second{[&] { counter += 2; }};
+            scope_exit third{[&] { counter += 3; }};
+        }
+        return counter;
+    };
+}
+
+TEST_CASE("Converting cell indices", "[keycap.core:math][benchmark]")
+{
+    using keycap::simd::instruction_set;
+
+    // A frame's worth of cells of a 1920 x 1080 grid. The sizes are only known at runtime, as they usually are,
+    // otherwise the compiler would replace the divisions on its own.
+    std::vector<u32> indices(1920 * 1080);
+    auto const cells = static_cast<u32>(indices.size());
+    auto const width = cells / 1080;
+
+    std::iota(indices.begin(), indices.end(), 0u);
+    std::vector<u32> x(cells), y(cells), mapped(cells);
+
+    BENCHMARK("get_coordinates(index, width), 1920 x 1080")
+    {
+        for (sz i = 0; i < cells; ++i)
+            std::tie(x[i], y[i]) = keycap::get_coordinates(indices[i], width);
+        return x.back() + y.back();
+    };
+
+    BENCHMARK("map(value, ...), 1920 x 1080")
+    {
+        for (sz i = 0; i < cells; ++i)
+            mapped[i] = keycap::map<u32>(indices[i], 0, cells, 0, 255);
+        return mapped.back();
+    };
+
+    for (auto set : {instruction_set::scalar, instruction_set::avx2})
+    {
+        if (set > keycap::simd::detected_instruction_set())
+            continue;
+
+        auto const previous = keycap::simd::limit_instruction_set(set);
+        auto const name = instruction_set_name(keycap::simd::max_instruction_set());
+
+        BENCHMARK("get_coordinates(span, fixed_divisor), 1920 x 1080, " + name)
+        {
+            keycap::get_coordinates<u32>(indices, width, x, y);
+            return x.back() + y.back();
+        };
+
+        BENCHMARK("map(span, linear_map), 1920 x 1080, " + name)
+        {
+            keycap::map<u32>(indices, 0, cells, 0, 255, mapped);
+            return mapped.back();
+        };
+
+        keycap::simd::limit_instruction_set(previous);
+    }
+}
+
+namespace
+{
+    // 64 MiB of f32 cells, so that the grids of the sweeping benchmarks do not fit into any cache
+    constexpr u32 swept_grid_size = 4096;
+
+    /// <summary>
+    /// Sums the 5-point stencil of every inner cell of a square grid, visiting the cells row by row. cell(x, y)
+    /// returns the value of a cell.
+    /// </summary>
+    template <typename Cell>
+    f32 sum_stencils(u32 size, Cell const& cell)
+    {
+        f32 sum = 0.0f;
+        for (u32 y = 1; y + 1 < size; ++y)
+        {
+            for (u32 x = 1; x + 1 < size; ++x)
+                sum += cell(x, y) + cell(x - 1, y) + cell(x + 1, y) + cell(x, y - 1) + cell(x, y + 1);
+        }
+        return sum;
+    }
+
+    /// <summary>
+    /// Sums all cells of a square grid, visiting them column by column. cell(x, y) returns the value of a cell.
+    /// </summary>
+    template <typename Cell>
+    f32 sum_columns(u32 size, Cell const& cell)
+    {
+        f32 sum = 0.0f;
+        for (u32 x = 0; x < size; ++x)
+        {
+            for (u32 y = 0; y < size; ++y)
+                sum += cell(x, y);
+        }
+        return sum;
+    }
+}
+
+TEST_CASE("Sweeping grids under different layouts", "[keycap.core:math][benchmark]")
+{
+    constexpr u32 size = swept_grid_size;
+
+    keycap::tiled_index<8> const tiled{size, size};
+    auto const row_major = [](u32 x, u32 y) { return u64{keycap::get_index(x, y, size)}; };
+    auto const tiles = [&](u32 x, u32 y) { return tiled(x, y); };
+    auto const morton = [](u32 x, u32 y) { return keycap::morton_encode(x, y); };
+
+    std::vector<f32> cells(u64{size} * size);
+    std::iota(cells.begin(), cells.end(), 0.0f);
+
+    auto const stencil = [&](auto const& index_of) {
+        return sum_stencils(size, [&](u32 x, u32 y) { return cells[index_of(x, y)]; });
+    };
+    auto const columns = [&](auto const& index_of) {
+        return sum_columns(size, [&](u32 x, u32 y) { return cells[index_of(x, y)]; });
+    };
+
+    // Note: walking row by row favors row-major, since the prefetcher follows the rows and the neighbors are found by
+    // adding constants. Tiled and Morton pay for their index math here, but win as soon as the traversal runs
+    // against the rows.
+    BENCHMARK("5-point stencil, row-major")
+    {
+        return stencil(row_major);
+    };
+
+    BENCHMARK("5-point stencil, tiled 8x8")
+    {
+        return stencil(tiles);
+    };
+
+    BENCHMARK("5-point stencil, Morton")
+    {
+        return stencil(morton);
+    };
+
+    BENCHMARK("Column-wise sweep, row-major")
+    {
+        return columns(row_major);
+    };
+
+    BENCHMARK("Column-wise sweep, tiled 8x8")
+    {
+        return columns(tiles);
+    };
+
+    BENCHMARK("Column-wise sweep, Morton")
+    {
+        return columns(morton);
+    };
+}
+
+TEST_CASE("Computing Morton codes", "[keycap.core:math][benchmark]")
+{
+    using keycap::simd::instruction_set;
+
+    constexpr sz count = 1 << 20;
+    std::vector<u32> x(count), y(count);
+    std::mt19937 engine{1};
+    for (sz i = 0; i < count; ++i)
+    {
+        x[i] = static_cast<u32>(engine());
+        y[i] = static_cast<u32>(engine());
+    }
+    std::vector<u64> codes(count);
+
+    BENCHMARK("morton_encode(x, y), 1M")
+    {
+        for (sz i = 0; i < count; ++i)
+            codes[i] = keycap::morton_encode(x[i], y[i]);
+        return codes.back();
+    };
+
+    // Note: the avx2 run uses BMI2's pdep, the scalar one spreads the bits using shifts and masks
+    for (auto set : {instruction_set::scalar, instruction_set::avx2})
+    {
+        if (set > keycap::simd::detected_instruction_set())
+            continue;
+
+        auto const previous = keycap::simd::limit_instruction_set(set);
+        auto const name = instruction_set_name(keycap::simd::max_instruction_set());
+
+        BENCHMARK("morton_encode(span, span, span), 1M, " + name)
+        {
+            keycap::morton_encode(x, y, codes);
+            return codes.back();
+        };
+
+        BENCHMARK("morton_decode_2d(span, span, span), 1M, " + name)
+        {
+            keycap::morton_decode_2d(codes, x, y);
+            return x.back();
+        };
+
+        keycap::simd::limit_instruction_set(previous);
+    }
+}
+
+TEST_CASE("Sweeping grid<T> layouts", "[keycap.core:grid][benchmark]")
+{
+    constexpr u32 size = swept_grid_size;
+
+    keycap::grid<f32> row_major{size, size};
+    keycap::grid<f32, keycap::tiled_layout<8>> tiled{size, size};
+    keycap::grid<f32, keycap::morton_layout> morton{size, size};
+    std::iota(row_major.begin(), row_major.end(), 0.0f);
+    std::iota(tiled.begin(), tiled.end(), 0.0f);
+    std::iota(morton.begin(), morton.end(), 0.0f);
+
+    // Note: iterating a grid walks its storage in memory order, so every layout streams at the same speed and the
+    // loop vectorizes. Prefer it whenever the order of the cells does not matter.
+    BENCHMARK("Transforming all cells, row-major")
+    {
+        std::ranges::for_each(row_major, [](f32& cell) { cell = 1.0f - cell; });
+        return row_major.data()[1];
+    };
+
+    BENCHMARK("Transforming all cells, tiled 8x8")
+    {
+        std::ranges::for_each(tiled, [](f32& cell) { cell = 1.0f - cell; });
+        return tiled.data()[1];
+    };
+
+    BENCHMARK("Transforming all cells, Morton")
+    {
+        std::ranges::for_each(morton, [](f32& cell) { cell = 1.0f - cell; });
+        return morton.data()[1];
+    };
+
+    BENCHMARK("Summing tile by tile, tiled 8x8")
+    {
+        f32 sum = 0.0f;
+        for (auto const tile : std::as_const(tiled).tiles())
+            sum += std::reduce(tile.begin(), tile.end());
+        return sum;
+    };
+
+    // Note: addressing cells by their coordinates costs as much as the raw index math in "Sweeping grids under
+    // different layouts", so the same trade-offs between the layouts apply
+    BENCHMARK("5-point stencil, row-major")
+    {
+        return sum_stencils(size, row_major);
+    };
+
+    BENCHMARK("5-point stencil, tiled 8x8")
+    {
+        return sum_stencils(size, tiled);
+    };
+
+    BENCHMARK("5-point stencil, Morton")
+    {
+        return sum_stencils(size, morton);
+    };
+
+    BENCHMARK("Column-wise sweep, row-major")
+    {
+        return sum_columns(size, row_major);
+    };
+
+    BENCHMARK("Column-wise sweep, tiled 8x8")
+    {
+        return sum_columns(size, tiled);
+    };
+
+    BENCHMARK("Column-wise sweep, Morton")
+    {
+        return sum_columns(size, morton);
+    };
+}
+
+namespace
+{
+    /// <summary>
+    /// Returns 1, 2, 4, ... up to and including the number of hardware threads
+    /// </summary>
+    std::vector<sz> benchmarked_thread_counts()
+    {
+        auto const hardware = std::max<sz>(1, std::thread::hardware_concurrency());
+
+        std::vector<sz> counts;
+        for (sz count = 1; count < hardware; count *= 2)
+            counts.push_back(count);
+        counts.push_back(hardware);
+        return counts;
+    }
+}
+
+TEST_CASE("Scaling parallel algorithms", "[keycap.core:parallel][benchmark]")
+{
+    constexpr sz size = 1 << 22;
+
+    std::vector<f32> cells(size);
+    std::iota(cells.begin(), cells.end(), 0.0f);
+
+    std::vector<u32> unsorted(size / 4);
+    std::mt19937 engine{3};
+    std::ranges::generate(unsorted, engine);
+
+    auto const transform = [](f32& cell) { cell = std::sqrt(cell * cell + 1.0f); };
+
+    BENCHMARK("Transforming 4M cells, sequential")
+    {
+        std::ranges::for_each(cells, transform);
+        return cells[1];
+    };
+
+    BENCHMARK("Summing 4M cells, sequential")
+    {
+        return std::reduce(cells.begin(), cells.end(), 0.0);
+    };
+
+    BENCHMARK_ADVANCED("Sorting 1M values, sequential")(Catch::Benchmark::Chronometer meter)
+    {
+        std::vector<std::vector<u32>> runs(static_cast<sz>(meter.runs()), unsorted);
+        meter.measure([&](int run) { std::ranges::sort(runs[static_cast<sz>(run)]); });
+    };
+
+    // Note: the speed-up levels off once the memory bandwidth is exhausted, which happens much sooner for the sum
+    // than for the transformation. Sorting is bound by the final merges, which run on a single worker.
+    for (auto const thread_count : benchmarked_thread_counts())
+    {
+        keycap::thread_pool pool{thread_count};
+        auto const threads = fmt::format(", {} thread{}", thread_count, thread_count == 1 ? "" : "s");
+
+        BENCHMARK("Transforming 4M cells" + threads)
+        {
+            keycap::parallel_for(pool, cells, transform);
+            return cells[1];
+        };
+
+        BENCHMARK("Summing 4M cells" + threads)
+        {
+            return keycap::parallel_reduce(pool, cells, 0.0);
+        };
+
+        BENCHMARK_ADVANCED("Sorting 1M values" + threads)(Catch::Benchmark::Chronometer meter)
+        {
+            std::vector<std::vector<u32>> runs(static_cast<sz>(meter.runs()), unsorted);
+            meter.measure([&](int run) { keycap::parallel_sort(pool, runs[static_cast<sz>(run)]); });
+        };
+
+        BENCHMARK("Empty task round trip" + threads)
+        {
+            pool.submit([] {}).wait();
+        };
+    }
+}
+
+TEST_CASE("Passing elements between threads", "[keycap.core:queue][benchmark]")
+{
+    constexpr u64 count = 1 << 18;
+
+    // Moves count elements from the given number of producers to as many consumers and returns their sum
+    auto const transfer = [](auto& queue, u64 threads, sz batch) {
+        std::atomic<u64> sum = 0;
+        std::atomic<i64> unclaimed = count;
+        std::vector<std::thread> workers;
+        for (u64 t = 0; t < threads; ++t)
+        {
+            workers.emplace_back([&, t] {
+                std::vector<u64> values(batch);
+                for (auto i = t * batch; i < count; i += threads * batch)
+                {
+                    std::iota(values.begin(), values.end(), i);
+                    if (batch == 1)
+                        queue.push(i);
+                    else
+                        queue.push_bulk(values);
+                }
+            });
+
+            // Every consumer pops exactly as many elements as it claimed, so none waits for elements that never come
+            workers.emplace_back([&] {
+                std::vector<u64> values(batch);
+                u64 local = 0;
+                auto const claim = static_cast<i64>(batch);
+                for (auto claimed = unclaimed.fetch_sub(claim); claimed > 0; claimed = unclaimed.fetch_sub(claim))
+                {
+                    for (auto pending = std::min(static_cast<sz>(claimed), batch); pending > 0;)
+                    {
+                        auto const popped = pending == 1 ? (values[0] = queue.pop(), sz{1})
+                                                         : queue.pop_bulk(std::span{values}.first(pending));
+                        auto const end = values.begin() + static_cast<std::ptrdiff_t>(popped);
+                        local = std::accumulate(values.begin(), end, local);
+                        pending -= popped;
+                    }
+                }
+                sum += local;
+            });
+        }
+
+        for (auto& worker : workers)
+            worker.join();
+        return sum.load();
+    };
+
+    // The baseline every consumer of keycap used to write
+    struct locked_queue
+    {
+        void push(u64 value)
+        {
+            std::scoped_lock lock{mutex};
+            values.push_back(value);
+        }
+
+        void push_bulk(std::span<u64 const> batch)
+        {
+            std::scoped_lock lock{mutex};
+            values.insert(values.end(), batch.begin(), batch.end());
+        }
+
+        u64 pop()
+        {
+            u64 value;
+            while (pop_bulk({&value, 1}) == 0)
+                std::this_thread::yield();
+            return value;
+        }
+
+        sz pop_bulk(std::span<u64> output)
+        {
+            std::scoped_lock lock{mutex};
+            auto const count = std::min(output.size(), values.size());
+            std::copy_n(values.begin(), count, output.begin());
+            values.erase(values.begin(), values.begin() + static_cast<std::ptrdiff_t>(count));
+            return count;
+        }
+
+        std::mutex mutex;
+        std::deque<u64> values;
+    };
+
+    BENCHMARK("256K elements, std::mutex and std::deque, 1:1")
+    {
+        locked_queue queue;
+        return transfer(queue, 1, 1);
+    };
+
+    BENCHMARK("256K elements, std::mutex and std::deque in batches of 64, 1:1")
+    {
+        locked_queue queue;
+        return transfer(queue, 1, 64);
+    };
+
+    BENCHMARK("256K elements, spsc_queue, 1:1")
+    {
+        keycap::spsc_queue<u64> queue{1024};
+        return transfer(queue, 1, 1);
+    };
+
+    BENCHMARK("256K elements, spsc_queue in batches of 64, 1:1")
+    {
+        keycap::spsc_queue<u64> queue{1024};
+        return transfer(queue, 1, 64);
+    };
+
+    // Note: with more threads than cores, the producers and consumers mostly find the queue full or empty, so the
+    // throughput depends on how quickly a blocked side goes to sleep and wakes up again
+    for (u64 threads : std::array<u64, 3>{1, 2, 4})
+    {
+        BENCHMARK(fmt::format("256K elements, mpmc_queue, {0}:{0}", threads))
+        {
+            keycap::mpmc_queue<u64> queue{1024};
+            return transfer(queue, threads, 1);
+        };
+
+        BENCHMARK(fmt::format("256K elements, mpmc_queue in batches of 64, {0}:{0}", threads))
+        {
+            keycap::mpmc_queue<u64> queue{1024};
+            return transfer(queue, threads, 64);
+        };
+    }
+
+    BENCHMARK_ADVANCED("Round trip latency, spsc_queue")(Catch::Benchmark::Chronometer meter)
+    {
+        keycap::spsc_queue<u64> requests{64};
+        keycap::spsc_queue<u64> responses{64};
+        std::thread echo{[&] {
+            for (auto request = requests.pop(); request != 0; request = requests.pop())
+                responses.push(request);
+        }};
+
+        meter.measure([&](int run) {
+            requests.push(static_cast<u64>(run) + 1);
+            return responses.pop();
+        });
+
+        requests.push(0);
+        echo.join();
+    };
+}
+
+namespace
+{
+    /// <summary>
+    /// Splits a request into its fields, lowercases them and joins them again, allocating like a typical handler
+    /// </summary>
+    sz handle_request(std::string_view request)
+    {
+        auto const fields = keycap::split(request, " ", keycap::split_options::skip_empty);
+
+        std::vector<std::string> lowered;
+        lowered.reserve(fields.size());
+        for (auto const& field : fields)
+            lowered.push_back(keycap::to_lower(field));
+
+        return keycap::join(lowered, ",").size();
+    }
+
+    /// <summary>
+    /// Like handle_request, but allocates everything from the given memory resource
+    /// </summary>
+    sz handle_request(std::string_view request, std::pmr::memory_resource* resource)
+    {
+        auto const fields = keycap::pmr::split(request, " ", keycap::split_options::skip_empty, resource);
+
+        std::pmr::vector<std::pmr::string> lowered{resource};
+        lowered.reserve(fields.size());
+        for (auto const& field : fields)
+            lowered.push_back(keycap::pmr::to_lower(field, resource));
+
+        return keycap::pmr::join(lowered, ",", resource).size();
+    }
+}
+
+TEST_CASE("Allocating per request", "[keycap.core:memory][benchmark]")
+{
+    // Fields are longer than the small string buffer, so every one of them is a separate allocation
+    std::vector<std::string> requests;
+    for (sz i = 0; i < 256; ++i)
+    {
+        std::string request;
+        for (sz field = 0; field < 24; ++field)
+            request += fmt::format("X-Request-Field-{}: Value-Of-Request-{} ", field, i * 24 + field);
+        requests.push_back(std::move(request));
+    }
+
+    BENCHMARK("256 requests, std::allocator")
+    {
+        sz total = 0;
+        for (auto const& request : requests)
+            total += handle_request(request);
+        return total;
+    };
+
+    // Note: the same heap allocations behind a virtual call, i.e. the overhead of going through a memory_resource
+    BENCHMARK("256 requests, new_delete_resource")
+    {
+        sz total = 0;
+        for (auto const& request : requests)
+            total += handle_request(request, std::pmr::new_delete_resource());
+        return total;
+    };
+
+    BENCHMARK("256 requests, std::pmr::monotonic_buffer_resource per request")
+    {
+        sz total = 0;
+        for (auto const& request : requests)
+        {
+            std::pmr::monotonic_buffer_resource arena;
+            total += handle_request(request, &arena);
+        }
+        return total;
+    };
+
+    // Note: once the arena is warmed up, a request does not touch the heap at all and freeing is a single reset
+    BENCHMARK("256 requests, arena_resource reset per request")
+    {
+        keycap::arena_resource arena;
+        sz total = 0;
+        for (auto const& request : requests)
+        {
+            total += handle_request(request, &arena);
+            arena.reset();
+        }
+        return total;
+    };
+
+    BENCHMARK("256 requests, inplace_arena_resource<16 KiB> per request")
+    {
+        sz total = 0;
+        for (auto const& request : requests)
+        {
+            keycap::inplace_arena_resource<16 * 1024> arena;
+            total += handle_request(request, &arena);
+        }
+        return total;
+    };
+
+    std::vector<std::byte> blob(1024 * 1024);
+    for (sz i = 0; i < blob.size(); ++i)
+        blob[i] = static_cast<std::byte>(i * 31);
+
+    BENCHMARK("from_byte_vector, 1 MiB of u32, std::vector")
+    {
+        u32 sum = 0;
+        for (sz i = 0; i < blob.size(); i += sizeof(u32))
+        {
+            auto const* first = reinterpret_cast<u8 const*>(blob.data() + i);
+            sum += keycap::from_byte_vector<u32>(std::vector<u8>{first, first + sizeof(u32)});
+        }
+        return sum;
+    };
+
+    BENCHMARK("from_byte_vector, 1 MiB of u32, std::pmr::vector in an inplace_arena_resource")
+    {
+        keycap::inplace_arena_resource<64> arena;
+        u32 sum = 0;
+        for (sz i = 0; i < blob.size(); i += sizeof(u32))
+        {
+            auto const* first = reinterpret_cast<u8 const*>(blob.data() + i);
+            sum += keycap::from_byte_vector<u32>(std::pmr::vector<u8>{first, first + sizeof(u32), &arena});
+            arena.reset();
+        }
+        return sum;
+    };
+}
+
+TEST_CASE("Allocating fixed-size objects", "[keycap.core:memory][benchmark]")
+{
+    constexpr sz count = 1024;
+    constexpr sz rounds = 64 * 1024;
+
+    // Keeps a window of nodes alive and churns through them like a queue of pending work
+    auto const churn = [](auto& list) {
+        for (sz i = 0; i < count; ++i)
+            list.push_back(i);
+
+        u64 sum = 0;
+        for (sz i = 0; i < rounds; ++i)
+        {
+            sum += list.front();
+            list.pop_front();
+            list.push_back(i);
+        }
+        return sum;
+    };
+
+    BENCHMARK("64K rounds over 1024 list nodes, std::allocator")
+    {
+        std::list<u64> list;
+        return churn(list);
+    };
+
+    BENCHMARK("64K rounds over 1024 list nodes, new_delete_resource")
+    {
+        std::pmr::list<u64> list{std::pmr::new_delete_resource()};
+        return churn(list);
+    };
+
+    BENCHMARK("64K rounds over 1024 list nodes, std::pmr::unsynchronized_pool_resource")
+    {
+        std::pmr::unsynchronized_pool_resource pool;
+        std::pmr::list<u64> list{&pool};
+        return churn(list);
+    };
+
+    // Note: a freed node is the next one handed out again, so the working set stays in the cache
+    BENCHMARK("64K rounds over 1024 list nodes, pool_resource")
+    {
+        keycap::pool_resource pool{4 * sizeof(void*)};
+        std::pmr::list<u64> list{&pool};
+        return churn(list);
+    };
+}
+
+namespace
+{
+    /// <summary>
+    /// Benchmarks inserting, finding and erasing the given number of random u64 keys in flat_map and
+    /// std::unordered_map
+    /// </summary>
+    void benchmark_hash_maps(sz count)
+    {
+        constexpr sz lookups = 1024;
+
+        auto engine = keycap::random::xoroshiro128plus{42};
+        std::vector<u64> keys(count);
+        for (auto& key : keys)
+            key = engine();
+
+        std::vector<u64> hits(lookups);
+        std::vector<u64> misses(lookups);
+        for (sz i = 0; i < lookups; ++i)
+        {
+            hits[i] = keys[engine() % count];
+            misses[i] = engine();
+        }
+
+        auto const name = [count](std::string_view operation, std::string_view container) {
+            return fmt::format("{} {} keys, {}", operation, count, container);
+        };
+
+        auto const benchmark = [&]<typename Map>(std::string_view container) {
+            BENCHMARK(name("Inserting", container))
+            {
+                Map map;
+                for (auto const key : keys)
+                    map.emplace(key, key);
+                return map.size();
+            };
+
+            Map map;
+            map.reserve(count);
+            for (auto const key : keys)
+                map.emplace(key, key);
+
+            BENCHMARK(name("1K hits among", container))
+            {
+                u64 sum = 0;
+                for (auto const key : hits)
+                    sum += map.find(key)->second;
+                return sum;
+            };
+
+            BENCHMARK(name("1K misses among", container))
+            {
+                sz found = 0;
+                for (auto const key : misses)
+                    found += map.contains(key);
+                return found;
+            };
+
+            BENCHMARK_ADVANCED(name("Erasing", container))(Catch::Benchmark::Chronometer meter)
+            {
+                std::vector<Map> copies(static_cast<sz>(meter.runs()), map);
+                meter.measure([&](int run) {
+                    auto& copy = copies[static_cast<sz>(run)];
+                    for (auto const key : keys)
+                        copy.erase(key);
+                    return copy.size();
+                });
+            };
+        };
+
+        // Note: std::unordered_map allocates a node per element and follows a pointer per lookup, flat_map probes 16
+        // control bytes next to each other and usually finds the element in the first slot whose bits match. Both
+        // differences grow as soon as the table no longer fits into the cache.
+        benchmark.template operator()<std::unordered_map<u64, u64>>("std::unordered_map");
+        benchmark.template operator()<keycap::flat_map<u64, u64>>("flat_map");
+    }
+}
+
+TEST_CASE("Hashing into flat_map", "[keycap.core:flatmap][benchmark]")
+{
+    for (sz count : std::array<sz, 4>{1'000, 10'000, 100'000, 1'000'000})
+        benchmark_hash_maps(count);
+
+    std::vector<std::string> words(100'000);
+    for (sz i = 0; i < words.size(); ++i)
+        words[i] = fmt::format("identifier_{}_of_some_length", i);
+
+    std::unordered_map<std::string, sz> unordered;
+    keycap::flat_map<std::string, sz> flat;
+    for (sz i = 0; i < words.size(); ++i)
+    {
+        unordered.emplace(words[i], i);
+        flat.emplace(words[i], i);
+    }
+
+    std::vector<std::string_view> views{words.begin(), words.end()};
+    std::ranges::shuffle(views, keycap::random::xoroshiro128plus{42});
+    views.resize(1024);
+
+    // Note: without a transparent hash, looking up a string_view has to construct a std::string first
+    BENCHMARK("1K string_view hits among 100K strings, std::unordered_map")
+    {
+        sz sum = 0;
+        for (auto const view : views)
+            sum += unordered.find(std::string{view})->second;
+        return sum;
+    };
+
+    BENCHMARK("1K string_view hits among 100K strings, flat_map")
+    {
+        sz sum = 0;
+        for (auto const view : views)
+            sum += flat.find(view)->second;
+        return sum;
+    };
+}
+
+// Hidden by default: the 100M-key runs need several GiB of memory and take minutes. Run with "[.flatmap-large]".
+TEST_CASE("Hashing into large flat_maps", "[.flatmap-large][keycap.core:flatmap][benchmark]")
+{
+    for (sz count : std::array<sz, 2>{10'000'000, 100'000'000})
+        benchmark_hash_maps(count);
+}
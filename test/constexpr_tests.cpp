@@ -1,5 +1,8 @@
 #include <catch2/catch_test_macros.hpp>
 
+#include <iterator>
+#include <string_view>
+
 import keycap.core;
 
 TEST_CASE("Hashing constexpr strings", "[keycap.core:string]")
@@ -8,12 +11,12 @@ TEST_CASE("Hashing constexpr strings", "[keycap.core:string]")
 
     SECTION("Hashing an empty string")
     {
-        STATIC_REQUIRE(""_hash_u64 == 0);
+        STATIC_REQUIRE(""_hash_u64 == 0x93228a4de0eec5a2);
     }
 
     SECTION("Hashing a small string")
     {
-        STATIC_REQUIRE("This is a string!"_hash_u64 == 2414454848);
+        STATIC_REQUIRE("This is a string!"_hash_u64 == 0x7890bbce4494b12d);
     }
 
     SECTION("Hashing a big string")
@@ -31,10 +34,48 @@ Vivamus posuere ultrices augue quis volutpat. Phasellus eu massa porta, faucibus
 
 Curabitur tristique quam commodo, placerat erat eu, scelerisque orci. In eget imperdiet sem. Pellentesque habitant morbi tristique senectus et netus et malesuada fames ac.
 
-)"_hash_u64 == 937791235);
+)"_hash_u64 == 0x664c2d8850640216);
+    }
+}
+
+TEST_CASE("Hashing constexpr strings with a seed", "[keycap.core:string]")
+{
+    using namespace keycap;
+    using namespace std::string_view_literals;
+
+    STATIC_REQUIRE(hash_u64("a"sv, 1) == 0xc5bac3db178713c4);
+    STATIC_REQUIRE(hash_u64("message digest"sv, 3) == 0x786d1f1df3801df4);
+    STATIC_REQUIRE(hash_u64("This is a string!"sv) == "This is a string!"_hash_u64);
+}
+
+TEST_CASE("Splitting constexpr strings", "[keycap.core:string]")
+{
+    SECTION("Counting tokens")
+    {
+        STATIC_REQUIRE(std::ranges::distance(keycap::split_view{"This is a string!"}) == 4);
+        STATIC_REQUIRE(std::ranges::distance(keycap::split_view{"a,,b", ','}) == 3);
+        STATIC_REQUIRE(std::ranges::distance(keycap::split_view{"a,,b", ',', keycap::split_options::skip_empty}) == 2);
+    }
+
+    SECTION("Accessing tokens")
+    {
+        STATIC_REQUIRE(keycap::split_view{"key=value", '='}.front() == "key");
+        STATIC_REQUIRE(*std::ranges::next(keycap::split_view{"key=value", '='}.begin()) == "value");
     }
 }
 
+TEST_CASE("constexpr perfect_hash_map", "[keycap.core:perfecthash]")
+{
+    constexpr auto keywords = keycap::make_perfect_hash_map<int>(
+        {{"if", 0}, {"else", 1}, {"for", 2}, {"while", 3}, {"return", 4}, {"break", 5}, {"continue", 6}});
+
+    STATIC_REQUIRE(keywords.size() == 7);
+    STATIC_REQUIRE(keywords.at("if") == 0);
+    STATIC_REQUIRE(keywords.at("continue") == 6);
+    STATIC_REQUIRE(keywords.contains("while"));
+    STATIC_REQUIRE_FALSE(keywords.contains("do"));
+}
+
 TEST_CASE("Calling constexpr get_index", "[keycap.core:math]")
 {
     STATIC_REQUIRE(keycap::get_index(0, 0, 15) == 0);
@@ -101,3 +142,30 @@ TEST_CASE("is_even", "[keycap.core:algorithm]")
         STATIC_REQUIRE(keycap::is_even(1) == false);
     }
 }
+
+TEST_CASE("xoroshiro128plus::jump", "[keycap.core:random]")
+{
+    constexpr auto jumped = [] {
+        keycap::random::xoroshiro128plus engine{42};
+        engine.jump();
+        return engine();
+    }();
+
+    STATIC_REQUIRE(jumped == 0x4f2de712b4b57c7d);
+}
+
+TEST_CASE("constexpr random engines", "[keycap.core:random]")
+{
+    constexpr auto pcg = [] {
+        keycap::random::pcg64 engine{42, 54};
+        return engine();
+    }();
+
+    constexpr auto xoshiro = [] {
+        keycap::random::xoshiro256starstar engine{42};
+        return engine();
+    }();
+
+    STATIC_REQUIRE(pcg == 0x86b1da1d72062b68);
+    STATIC_REQUIRE(xoshiro == 0x15780b2e0c2ec716);
+}
@@ -1,4 +1,38 @@
+#include <catch2/catch_template_test_macros.hpp>
 #include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <barrier>
+#include <bit>
+#include <cmath>
+#include <compare>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 import keycap.core;
 
@@ -30,6 +64,71 @@ TEST_CASE("Splitting strings", "[keycap.core:string]")
     }
 }
 
+TEST_CASE("split_view", "[keycap.core:string]")
+{
+    SECTION("Consecutive delimiters yield empty tokens by default")
+    {
+        std::vector<std::string_view> const expected_tokens{"a", "", "b", ""};
+        std::vector<std::string_view> tokens;
+        for (auto token : keycap::split_view{"a,,b,", ','})
+        {
+            tokens.push_back(token);
+        }
+
+        REQUIRE(tokens == expected_tokens);
+    }
+
+    SECTION("split_options::skip_empty drops empty tokens")
+    {
+        std::vector<std::string_view> const expected_tokens{"a", "b"};
+        std::vector<std::string_view> tokens;
+        for (auto token : keycap::split_view{",a,,b,", ",", keycap::split_options::skip_empty})
+        {
+            tokens.push_back(token);
+        }
+
+        REQUIRE(tokens == expected_tokens);
+    }
+
+    SECTION("Multi-character delimiters")
+    {
+        std::vector<std::string_view> const expected_tokens{"key", "value", "", "end"};
+        std::vector<std::string_view> tokens;
+        for (auto token : keycap::split_view{"key::value::::end", "::"})
+        {
+            tokens.push_back(token);
+        }
+
+        REQUIRE(tokens == expected_tokens);
+    }
+
+    SECTION("Tokens point into the input string")
+    {
+        std::string const input{"This is a random string, promise!"};
+        auto const view = keycap::split_view{input};
+
+        REQUIRE((*view.begin()).data() == input.data());
+    }
+
+    SECTION("An empty delimiter yields the whole string")
+    {
+        REQUIRE(std::ranges::distance(keycap::split_view{"no delimiter", ""}) == 1);
+        REQUIRE(keycap::split_view{"no delimiter", ""}.front() == "no delimiter");
+    }
+
+    SECTION("Works with std::ranges algorithms")
+    {
+        keycap::split_view const view{"one two three four", ' '};
+
+        REQUIRE(std::ranges::distance(view) == 4);
+        REQUIRE(std::ranges::find(view, "three") != view.end());
+        auto const has_three_characters = [](std::string_view token) {
+            return token.size() == 3;
+        };
+        REQUIRE(std::ranges::count_if(view, has_three_characters) == 2);
+    }
+}
+
 TEST_CASE("Converting strings", "[keycap.core:string]")
 {
     std::string input{"We HaVe UnIt TEsTs!"};
@@ -43,6 +142,94 @@ TEST_CASE("Converting strings", "[keycap.core:string]")
     {
         REQUIRE(keycap::to_upper(input) == "WE HAVE UNIT TESTS!");
     }
+
+    SECTION("Converting in-place")
+    {
+        std::string buffer{input};
+
+        keycap::to_lower(std::span<char>{buffer});
+        REQUIRE(buffer == "we have unit tests!");
+
+        keycap::to_upper(std::span<char>{buffer});
+        REQUIRE(buffer == "WE HAVE UNIT TESTS!");
+    }
+
+    SECTION("Only ASCII letters are converted on every code path")
+    {
+        std::string buffer;
+        for (int i = 0; i < 1000; ++i)
+        {
+            buffer += static_cast<char>(i % 256);
+        }
+
+        std::string expected_lower{buffer};
+        std::string expected_upper{buffer};
+        for (sz i = 0; i < buffer.size(); ++i)
+        {
+            auto const c = static_cast<unsigned char>(buffer[i]);
+            if (c >= 'A' && c <= 'Z')
+                expected_lower[i] = static_cast<char>(c + 32);
+            if (c >= 'a' && c <= 'z')
+                expected_upper[i] = static_cast<char>(c - 32);
+        }
+
+        using keycap::simd::instruction_set;
+        for (auto set : {instruction_set::scalar, instruction_set::sse2, instruction_set::avx2})
+        {
+            auto const previous = keycap::simd::limit_instruction_set(set);
+
+            REQUIRE(keycap::to_lower(buffer) == expected_lower);
+            REQUIRE(keycap::to_upper(buffer) == expected_upper);
+
+            keycap::simd::limit_instruction_set(previous);
+        }
+    }
+}
+
+TEST_CASE("Comparing strings case-insensitively", "[keycap.core:string]")
+{
+    using keycap::simd::instruction_set;
+    auto const set = GENERATE(instruction_set::scalar, instruction_set::sse2, instruction_set::avx2);
+    auto const previous = keycap::simd::limit_instruction_set(set);
+
+    SECTION("iequals")
+    {
+        REQUIRE(keycap::iequals("", ""));
+        REQUIRE(keycap::iequals("We HaVe UnIt TEsTs!", "we have unit tests!"));
+        REQUIRE_FALSE(keycap::iequals("We HaVe UnIt TEsTs!", "we have unit tests?"));
+        REQUIRE_FALSE(keycap::iequals("short", "shorter"));
+        REQUIRE_FALSE(keycap::iequals("[", "{"));
+
+        std::string const long_lhs(1000, 'a');
+        std::string long_rhs(1000, 'A');
+        REQUIRE(keycap::iequals(long_lhs, long_rhs));
+
+        long_rhs[999] = 'b';
+        REQUIRE_FALSE(keycap::iequals(long_lhs, long_rhs));
+    }
+
+    SECTION("icompare")
+    {
+        REQUIRE(keycap::icompare("ABC", "abc") == std::weak_ordering::equivalent);
+        REQUIRE(keycap::icompare("ABC", "abd") == std::weak_ordering::less);
+        REQUIRE(keycap::icompare("abd", "ABC") == std::weak_ordering::greater);
+        REQUIRE(keycap::icompare("ab", "ABC") == std::weak_ordering::less);
+
+        std::string const lhs = std::string(100, 'x') + "A";
+        std::string const rhs = std::string(100, 'X') + "b";
+        REQUIRE(keycap::icompare(lhs, rhs) == std::weak_ordering::less);
+    }
+
+    SECTION("ihash_u64")
+    {
+        std::string const input{"We HaVe UnIt TEsTs!"};
+        auto const lowered = keycap::to_lower(input);
+
+        REQUIRE(keycap::ihash_u64(input) == keycap::ihash_u64("WE HAVE UNIT TESTS!"));
+        REQUIRE(keycap::ihash_u64(input) == keycap::hash_u64(lowered.data(), lowered.size()));
+    }
+
+    keycap::simd::limit_instruction_set(previous);
 }
 
 TEST_CASE("Hashing strings", "[keycap.core:string]")
@@ -50,13 +237,13 @@ TEST_CASE("Hashing strings", "[keycap.core:string]")
     SECTION("Hashing an empty string")
     {
         std::string input;
-        REQUIRE(keycap::hash_u64(input.data(), input.size()) == 0);
+        REQUIRE(keycap::hash_u64(input.data(), input.size()) == 0x93228a4de0eec5a2);
     }
 
     SECTION("Hashing a small string")
     {
         std::string input{"This is a string!"};
-        REQUIRE(keycap::hash_u64(input.data(), input.size()) == 2414454848);
+        REQUIRE(keycap::hash_u64(input.data(), input.size()) == 0x7890bbce4494b12d);
     }
 
     SECTION("Hashing a big string")
@@ -75,324 +262,3462 @@ Vivamus posuere ultrices augue quis volutpat. Phasellus eu massa porta, faucibus
 Curabitur tristique quam commodo, placerat erat eu, scelerisque orci. In eget imperdiet sem. Pellentesque habitant morbi tristique senectus et netus et malesuada fames ac.
 
 )"};
-        REQUIRE(keycap::hash_u64(input.data(), input.size()) == 937791235);
+        REQUIRE(keycap::hash_u64(input.data(), input.size()) == 0x664c2d8850640216);
     }
 }
 
-TEST_CASE("Joining strings", "[keycap.core:string]")
+TEST_CASE("Hashing strings matches the wyhash reference implementation", "[keycap.core:string]")
 {
-    std::string input{"This is a random string, promise!"};
-
-    SECTION("Joining an empty container with an empty delimiter must yield an empty string")
+    // Test vectors of wyhash final version 4, each hashed with its index as seed
+    std::pair<std::string_view, u64> const vectors[] = {
+        {"", 0x93228a4de0eec5a2},
+        {"a", 0xc5bac3db178713c4},
+        {"abc", 0xa97f2f7b1d9b3314},
+        {"message digest", 0x786d1f1df3801df4},
+        {"abcdefghijklmnopqrstuvwxyz", 0xdca5a8138ad37c87},
+        {"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789", 0xb9e734f117cfaf70},
+        {"12345678901234567890123456789012345678901234567890123456789012345678901234567890", 0x6cc5eab49a92d617},
+    };
+
+    for (u64 seed = 0; auto [input, expected] : vectors)
     {
-        REQUIRE(keycap::join(std::vector<std::string>{}, "").empty() == true);
+        REQUIRE(keycap::hash_u64(input, seed++) == expected);
     }
+}
 
-    SECTION("Joining an empty container with a non-empty delimiter must yield an empty string")
+TEST_CASE("Hashing strings yields the same value on every code path", "[keycap.core:string]")
+{
+    std::string input;
+    for (sz i = 0; i < 5000; ++i)
     {
-        REQUIRE(keycap::join(std::vector<std::string>{}, " ").empty() == true);
+        input += static_cast<char>((i * 7919) % 251);
     }
 
-    SECTION("Joining a container of strings with a delimiter must yield a non-empty string")
+    std::vector<u64> expected;
+    auto const previous = keycap::simd::limit_instruction_set(keycap::simd::instruction_set::scalar);
+    for (sz size = 0; size <= input.size(); size += 37)
     {
-        auto&& splits = keycap::split(input, " ");
-        auto&& value = keycap::join(splits, " ");
+        expected.push_back(keycap::hash_u64(input.data(), size, size));
+    }
 
-        REQUIRE(value.empty() == false);
-        REQUIRE(value == input);
+    using keycap::simd::instruction_set;
+    for (auto set : {instruction_set::sse2, instruction_set::avx2, instruction_set::avx512})
+    {
+        keycap::simd::limit_instruction_set(set);
+        for (sz i = 0, size = 0; size <= input.size(); ++i, size += 37)
+        {
+            REQUIRE(keycap::hash_u64(input.data(), size, size) == expected[i]);
+        }
     }
-}
 
-TEST_CASE("Calling get_index", "[keycap.core:math]")
-{
-    REQUIRE(keycap::get_index(0, 0, 15) == 0);
-    REQUIRE(keycap::get_index(0, 1, 15) == 15);
-    REQUIRE(keycap::get_index(1, 0, 15) == 1);
-    REQUIRE(keycap::get_index(10, 10, 0) == 10);
-    REQUIRE(keycap::get_index(10, 10, 15) == 160);
+    keycap::simd::limit_instruction_set(previous);
 }
 
-TEST_CASE("Calling get_coordinates", "[keycap.core:math]")
+TEST_CASE("Hash quality", "[keycap.core:string]")
 {
-    REQUIRE(keycap::get_coordinates(0, 15) == std::pair<int, int>{0, 0});
-    REQUIRE(keycap::get_coordinates(10, 15) == std::pair<int, int>{10, 0});
-}
+    std::vector<std::string> keys;
+    for (int i = 0; i < 100'000; ++i)
+    {
+        keys.push_back("identifier_" + std::to_string(i));
+    }
 
-TEST_CASE("Calling map", "[keycap.core:math]")
-{
-    REQUIRE(keycap::map(0, 0, 10, 0, 100) == 0);
-    REQUIRE(keycap::map(5, 0, 10, 0, 100) == 50);
-    REQUIRE(keycap::map(10, 0, 10, 0, 100) == 100);
-}
+    SECTION("Similar keys do not collide")
+    {
+        std::unordered_set<u64> hashes;
+        for (auto const& key : keys)
+        {
+            hashes.insert(keycap::hash_u64(key));
+        }
 
-#include <array>
+        REQUIRE(hashes.size() == keys.size());
+    }
 
-TEST_CASE("array_index", "[keycap.core:algorithm]")
-{
-    SECTION("c-arrays")
+    SECTION("Long keys differing in a single byte do not collide")
     {
-        constexpr int index = 2;
-        int array[] = {0, 1, 2, 3};
-        REQUIRE(keycap::array_index(array[index], array[0]) == index);
+        std::string input(4096, 'x');
+        std::unordered_set<u64> hashes;
+        for (sz i = 0; i < input.size(); ++i)
+        {
+            input[i] = 'y';
+            hashes.insert(keycap::hash_u64(input));
+            input[i] = 'x';
+        }
+
+        REQUIRE(hashes.size() == input.size());
     }
 
-    SECTION("std::array")
+    SECTION("Low and high bits are uniformly distributed")
     {
-        constexpr int index = 2;
-        std::array<int, 4> array{0, 1, 2, 3};
-        REQUIRE(keycap::array_index(array[index], array[0]) == index);
+        // Chi-squared test over 256 buckets. With 255 degrees of freedom, 330 is exceeded with a probability of ~0.1%
+        constexpr sz buckets = 256;
+        double const expected_per_bucket = static_cast<double>(keys.size()) / buckets;
+
+        std::array<sz, buckets> low{};
+        std::array<sz, buckets> high{};
+        for (auto const& key : keys)
+        {
+            auto const hash = keycap::hash_u64(key);
+            ++low[hash % buckets];
+            ++high[hash >> 56];
+        }
+
+        auto const chi_squared = [&](std::array<sz, buckets> const& counts) {
+            double sum = 0;
+            for (auto count : counts)
+            {
+                double const difference = static_cast<double>(count) - expected_per_bucket;
+                sum += difference * difference / expected_per_bucket;
+            }
+            return sum;
+        };
+
+        REQUIRE(chi_squared(low) < 330);
+        REQUIRE(chi_squared(high) < 330);
     }
 
-    SECTION("std::vector")
+    SECTION("Flipping a single input bit flips about half of the output bits")
     {
-        constexpr int index = 2;
-        std::vector<int> array{0, 1, 2, 3};
-        REQUIRE(keycap::array_index(array[index], array[0]) == index);
+        for (sz size : std::array<sz, 6>{3, 8, 16, 48, 200, 1500})
+        {
+            std::string input(size, '\0');
+            for (sz i = 0; i < size; ++i)
+            {
+                input[i] = static_cast<char>(i * 31);
+            }
+
+            auto const reference = keycap::hash_u64(input);
+
+            double flipped_bits = 0;
+            for (sz bit = 0; bit < size * 8; ++bit)
+            {
+                input[bit / 8] ^= static_cast<char>(1 << (bit % 8));
+                flipped_bits += std::popcount(reference ^ keycap::hash_u64(input));
+                input[bit / 8] ^= static_cast<char>(1 << (bit % 8));
+            }
+
+            auto const average = flipped_bits / static_cast<double>(size * 8);
+            REQUIRE(average > 28);
+            REQUIRE(average < 36);
+        }
     }
 }
 
-TEST_CASE("is_odd", "[keycap.core:algorithm]")
+TEST_CASE("Interning strings", "[keycap.core:string]")
 {
-    SECTION("0 is even")
+    SECTION("Equal strings yield the same symbol")
     {
-        REQUIRE(keycap::is_odd(0u) == false);
+        keycap::symbol_table table;
+
+        auto const first = table.intern("identifier");
+        auto const second = table.intern(std::string{"identifier"});
+        auto const other = table.intern("other_identifier");
+
+        REQUIRE(first == second);
+        REQUIRE(first != other);
+        REQUIRE(first.view() == "identifier");
+        REQUIRE(first.view().data()[first.view().size()] == '\0');
+        REQUIRE(first.hash() == keycap::hash_u64("identifier"));
+        REQUIRE(std::hash<keycap::symbol>{}(first) == first.hash());
+        REQUIRE(table.size() == 2);
     }
 
-    SECTION("1 is odd")
+    SECTION("Finding strings that were not interned yields an empty symbol")
     {
-        REQUIRE(keycap::is_odd(1u) == true);
+        keycap::symbol_table table;
+        auto const symbol = table.intern("identifier");
+
+        REQUIRE(table.find("identifier") == symbol);
+        REQUIRE_FALSE(table.find("unknown"));
+        REQUIRE(table.find("unknown").view().empty());
     }
-}
 
-TEST_CASE("is_even", "[keycap.core:algorithm]")
-{
-    SECTION("0 is even")
+    SECTION("Symbols stay valid while the table grows")
     {
-        REQUIRE(keycap::is_even(0) == true);
+        keycap::symbol_table table{16};
+
+        std::vector<keycap::symbol> symbols;
+        for (sz i = 0; i < 10'000; ++i)
+        {
+            symbols.push_back(table.intern("symbol_" + std::to_string(i)));
+        }
+        symbols.push_back(table.intern(std::string(100'000, 'x')));
+
+        REQUIRE(table.size() == symbols.size());
+        for (sz i = 0; i < 10'000; ++i)
+        {
+            REQUIRE(symbols[i].view() == "symbol_" + std::to_string(i));
+            REQUIRE(table.intern("symbol_" + std::to_string(i)) == symbols[i]);
+        }
+        REQUIRE(symbols.back().view() == std::string(100'000, 'x'));
     }
 
-    SECTION("1 is odd")
+    SECTION("Interning concurrently yields one symbol per string")
     {
-        REQUIRE(keycap::is_even(1) == false);
+        keycap::symbol_table table{16};
+        constexpr sz thread_count = 8;
+        constexpr sz string_count = 5'000;
+
+        std::vector<std::vector<keycap::symbol>> results(thread_count);
+        std::vector<std::thread> threads;
+        for (sz t = 0; t < thread_count; ++t)
+        {
+            threads.emplace_back([&table, &result = results[t], t] {
+                for (sz i = 0; i < string_count; ++i)
+                {
+                    // Every thread walks the strings in a different order
+                    sz const index = (i * 7 + t * 613) % string_count;
+                    result.push_back(table.intern("symbol_" + std::to_string(index)));
+                }
+            });
+        }
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        REQUIRE(table.size() == string_count);
+        for (sz t = 0; t < thread_count; ++t)
+        {
+            for (sz i = 0; i < string_count; ++i)
+            {
+                sz const index = (i * 7 + t * 613) % string_count;
+                REQUIRE(results[t][i] == table.find("symbol_" + std::to_string(index)));
+            }
+        }
     }
-}
 
-#include <fmt/format.h>
+    SECTION("The process-wide table")
+    {
+        REQUIRE(keycap::intern("keycap") == keycap::intern("keycap"));
+        REQUIRE(keycap::intern("keycap").view() == "keycap");
+    }
+}
 
-TEST_CASE("exception::to_string", "[keycap.core:error]")
+TEST_CASE("Joining strings", "[keycap.core:string]")
 {
-    using namespace keycap;
-    auto const line = __LINE__;
-    keycap::exception e{error_code::bad_file_content, module::core, 15, line, "Yo"};
+    std::string input{"This is a random string, promise!"};
 
-    std::string const expected_error_message =
-        fmt::format("Error [{}-{}-15-{}]: \"Yo\"", static_cast<u64>(error_code::bad_file_content),
-                    static_cast<u64>(module::core), line);
+    SECTION("Joining an empty container with an empty delimiter must yield an empty string")
+    {
+        REQUIRE(keycap::join(std::vector<std::string>{}, "").empty() == true);
+    }
 
-    SECTION("exception::to_string(false) must yield only the error-code and error-message")
+    SECTION("Joining an empty container with a non-empty delimiter must yield an empty string")
     {
-        REQUIRE(e.to_string() == expected_error_message);
-        REQUIRE(e.to_string().size() == expected_error_message.size());
+        REQUIRE(keycap::join(std::vector<std::string>{}, " ").empty() == true);
     }
 
-    SECTION("exception::to_string(true) must yield the error-code, the error-message and a stack-trace")
+    SECTION("Joining a container of strings with a delimiter must yield a non-empty string")
     {
-        auto&& error_string = e.to_string(true);
-        auto itr = error_string.find(expected_error_message);
+        auto&& splits = keycap::split(input, " ");
+        auto&& value = keycap::join(splits, " ");
 
-        REQUIRE(itr != std::string::npos);
-        REQUIRE(error_string.size() != expected_error_message.size());
-        REQUIRE(error_string.substr(expected_error_message.size()).starts_with("\nStack-trace:"));
+        REQUIRE(value.empty() == false);
+        REQUIRE(value == input);
     }
 }
 
-TEST_CASE("to_byte_array", "[keycap.core:array]")
+TEST_CASE("join_into", "[keycap.core:string]")
 {
-    SECTION("i16")
+    std::vector<std::string_view> const input{"This", "is", "a", "random", "string,", "promise!"};
+
+    SECTION("Joining into a string appends to it")
     {
-        constexpr i16 value = 0x0BEE;
-        constexpr std::array<u8, 2> expected = {0xEE, 0x0B};
+        std::string target{"> "};
+        keycap::join_into(target, input, ", ");
 
-        REQUIRE(keycap::to_byte_array(value) == expected);
+        REQUIRE(target == "> This, is, a, random, string,, promise!");
+        REQUIRE(target.size() == 2 + 28 + 5 * 2);
     }
 
-    SECTION("u16")
+    SECTION("Joining into an output iterator")
     {
-        constexpr u16 value = 0xBEEF;
-        constexpr std::array<u8, 2> expected = {0xEF, 0xBE};
+        std::array<char, 64> buffer{};
+        auto* end = keycap::join_into(buffer.data(), input, "-");
 
-        REQUIRE(keycap::to_byte_array(value) == expected);
+        REQUIRE(std::string_view{buffer.data(), end} == "This-is-a-random-string,-promise!");
     }
 
-    SECTION("i32")
+    SECTION("Joining an empty range leaves the target untouched")
     {
-        constexpr i32 value = 0x0D15EA5E;
-        constexpr std::array<u8, 4> expected = {0x5E, 0xEA, 0x15, 0x0D};
+        std::string target{"unchanged"};
+        keycap::join_into(target, std::vector<std::string>{}, ", ");
 
-        REQUIRE(keycap::to_byte_array(value) == expected);
+        REQUIRE(target == "unchanged");
     }
 
-    SECTION("u32")
+    SECTION("Joining a lazy range")
     {
-        constexpr u32 value = 0xC0CAC01A;
-        constexpr std::array<u8, 4> expected = {0x1A, 0xC0, 0xCA, 0xC0};
+        std::string target;
+        keycap::join_into(target, keycap::split_view{"a b c"}, "+");
 
-        REQUIRE(keycap::to_byte_array(value) == expected);
+        REQUIRE(target == "a+b+c");
     }
+}
 
-    SECTION("i64")
+TEST_CASE("string_builder", "[keycap.core:string]")
+{
+    SECTION("Building from strings, characters and formatted pieces")
     {
-        constexpr i64 value = 0x0F1CECAFEBADF00D;
-        constexpr std::array<u8, 8> expected = {0x0D, 0xF0, 0xAD, 0xEB, 0xAF, 0xEC, 0x1C, 0x0F};
+        std::string const user{"keycap"};
 
-        REQUIRE(keycap::to_byte_array(value) == expected);
+        keycap::string_builder builder;
+        builder.append("[").format("{:>5}", 42).append(']').append(' ').append(user).format(" took {}ms", 1.5);
+
+        REQUIRE(builder.size() == 25);
+        REQUIRE(builder.build() == "[   42] keycap took 1.5ms");
     }
 
-    SECTION("u64")
+    SECTION("Joined pieces")
     {
-        constexpr u64 value = 0xFACEFEEDBABEBEEF;
-        constexpr std::array<u8, 8> expected = {0xEF, 0xBE, 0xBE, 0xBA, 0xED, 0xFE, 0xCE, 0xFA};
+        std::vector<std::string> const values{"1", "2", "3"};
+        keycap::string_builder builder;
+        builder.append("values: ").append_joined(values, ", ");
+        builder.append(' ').append_joined(keycap::split_view{"4 5"}, "+");
 
-        REQUIRE(keycap::to_byte_array(value) == expected);
+        REQUIRE(builder.build() == "values: 1, 2, 3 4+5");
     }
-}
 
-TEST_CASE("from_byte_array", "[keycap.core:array]")
-{
-    SECTION("Converting bytes to u32 must yield expected result")
+    SECTION("Building into an existing string")
     {
-        constexpr std::array<u8, 4> value = {0x1A, 0xC0, 0xCA, 0xC0};
-        constexpr u32 expected = 0xC0CAC01A;
+        keycap::string_builder builder;
+        builder.format("{}", 1).append(" + ").format("{}", 2);
 
-        REQUIRE(keycap::from_byte_array<u32>(value) == expected);
+        std::string target{"sum: "};
+        builder.build_into(target);
+
+        REQUIRE(target == "sum: 1 + 2");
     }
-}
 
-TEST_CASE("from_byte_vector", "[keycap.core:array]")
-{
-    SECTION("Converting bytes to u32 must yield expected result")
+    SECTION("A cleared builder can be reused")
     {
-        std::vector<u8> const value = {0x1A, 0xC0, 0xCA, 0xC0};
-        constexpr u32 expected = 0xC0CAC01A;
+        keycap::string_builder builder;
+        builder.append("first").format("{}", 1);
+        builder.clear();
 
-        REQUIRE(keycap::from_byte_vector<u32>(value) == expected);
+        REQUIRE(builder.empty());
+
+        builder.format("{}", 2).append("second");
+        REQUIRE(builder.build() == "2second");
     }
 }
 
-TEST_CASE("keycap::random", "keycap.core:random")
+TEST_CASE("perfect_hash_map", "[keycap.core:perfecthash]")
 {
-    // Do not add new tests here! These tests will run back to back, modifying the prng state. Adding tests up here
-    // will make all the tests below fail. Only add to the bottom!
-
-    SECTION("u64")
+    SECTION("Looking up keys")
     {
-        constexpr u64 expected = 0xb0c41f6c3353405d;
-        REQUIRE(keycap::random::random_u64() == expected);
+        constexpr auto commands =
+            keycap::make_perfect_hash_map<int>({{"help", 0}, {"quit", 1}, {"load", 2}, {"save", 3}, {"", 4}});
+
+        REQUIRE(commands.size() == 5);
+        REQUIRE(commands.at("help") == 0);
+        REQUIRE(commands.at("save") == 3);
+        REQUIRE(commands.at("") == 4);
+        REQUIRE(commands.find("exit") == nullptr);
+        REQUIRE_FALSE(commands.contains("Help"));
+        REQUIRE_THROWS_AS(commands.at("exit"), keycap::exception);
     }
 
-    SECTION("i64")
+    SECTION("Building a big map at runtime")
     {
-        constexpr i64 expected = -7376994870862721386;
-        REQUIRE(keycap::random::random_i64() == expected);
+        constexpr sz count = 5000;
+
+        std::vector<std::string> keys;
+        for (sz i = 0; i < count; ++i)
+        {
+            keys.push_back("config.key." + std::to_string(i * 7));
+        }
+
+        std::array<std::pair<std::string_view, sz>, count> entries;
+        for (sz i = 0; i < count; ++i)
+        {
+            entries[i] = {keys[i], i};
+        }
+
+        auto const map = std::make_unique<keycap::perfect_hash_map<sz, count>>(entries);
+        for (sz i = 0; i < count; ++i)
+        {
+            REQUIRE(map->find(keys[i]) != nullptr);
+            REQUIRE(*map->find(keys[i]) == i);
+            REQUIRE_FALSE(map->contains(keys[i] + "x"));
+        }
     }
 
-    SECTION("u32")
+    SECTION("Duplicate keys are rejected")
     {
-        constexpr u32 expected = 0x503b03a4;
+        std::array<std::pair<std::string_view, int>, 3> const entries{{{"a", 0}, {"b", 1}, {"a", 2}}};
+
+        REQUIRE_THROWS_AS((keycap::perfect_hash_map<int, 3>{entries}), keycap::exception);
+    }
+
+    SECTION("An empty map contains nothing")
+    {
+        constexpr keycap::perfect_hash_map<int, 0> empty{std::array<std::pair<std::string_view, int>, 0>{}};
+
+        REQUIRE(empty.empty());
+        REQUIRE_FALSE(empty.contains(""));
+    }
+}
+
+TEST_CASE("Calling get_index", "[keycap.core:math]")
+{
+    REQUIRE(keycap::get_index(0, 0, 15) == 0);
+    REQUIRE(keycap::get_index(0, 1, 15) == 15);
+    REQUIRE(keycap::get_index(1, 0, 15) == 1);
+    REQUIRE(keycap::get_index(10, 10, 0) == 10);
+    REQUIRE(keycap::get_index(10, 10, 15) == 160);
+}
+
+TEST_CASE("Calling get_coordinates", "[keycap.core:math]")
+{
+    REQUIRE(keycap::get_coordinates(0, 15) == std::pair<int, int>{0, 0});
+    REQUIRE(keycap::get_coordinates(10, 15) == std::pair<int, int>{10, 0});
+}
+
+TEST_CASE("Calling map", "[keycap.core:math]")
+{
+    REQUIRE(keycap::map(0, 0, 10, 0, 100) == 0);
+    REQUIRE(keycap::map(5, 0, 10, 0, 100) == 50);
+    REQUIRE(keycap::map(10, 0, 10, 0, 100) == 100);
+}
+
+TEMPLATE_TEST_CASE("fixed_divisor", "[keycap.core:math]", u32, u64)
+{
+    using T = TestType;
+    constexpr auto max = std::numeric_limits<T>::max();
+
+    std::vector<T> divisors{1, 2, 3, 5, 6, 7, 10, 15, 16, 641, 1000, 1920, 65535, 65536, 65537, max / 2, max / 2 + 1,
+                            max / 2 + 2, max - 1, max};
+    std::vector<T> values{0, 1, 2, 3, 1000, 65535, 65536, max / 3, max / 2, max / 2 + 1, max - 2, max - 1, max};
+
+    std::mt19937_64 engine{42};
+    for (int i = 0; i < 200; ++i)
+    {
+        divisors.push_back(static_cast<T>(engine() >> (engine() % (sizeof(T) * 8))) | 1);
+        values.push_back(static_cast<T>(engine()));
+    }
+
+    SECTION("Quotients and remainders match the built-in operators")
+    {
+        for (auto const divisor : divisors)
+        {
+            keycap::fixed_divisor<T> const fixed{divisor};
+            REQUIRE(fixed.divisor() == divisor);
+
+            for (auto const value : values)
+            {
+                INFO(value << " / " << divisor);
+                REQUIRE(value / fixed == value / divisor);
+                REQUIRE(value % fixed == value % divisor);
+            }
+        }
+    }
+
+    SECTION("fixed_divisor can be used at compile time")
+    {
+        constexpr keycap::fixed_divisor<T> seven{7};
+        STATIC_REQUIRE(T{100} / seven == 14);
+        STATIC_REQUIRE(T{100} % seven == 2);
+        STATIC_REQUIRE(keycap::get_coordinates(T{23}, seven) == std::pair<T, T>{2, 3});
+    }
+
+    SECTION("Dividing by zero throws")
+    {
+        REQUIRE_THROWS_AS(keycap::fixed_divisor<T>{0}, keycap::exception);
+    }
+}
+
+TEST_CASE("Morton codes", "[keycap.core:math]")
+{
+    using keycap::simd::instruction_set;
+    auto const set = GENERATE(instruction_set::scalar, instruction_set::avx2);
+    auto const previous = keycap::simd::limit_instruction_set(set);
+
+    SECTION("Bits are interleaved starting with x")
+    {
+        REQUIRE(keycap::morton_encode(0u, 0u) == 0);
+        REQUIRE(keycap::morton_encode(1u, 0u) == 0b01);
+        REQUIRE(keycap::morton_encode(0u, 1u) == 0b10);
+        REQUIRE(keycap::morton_encode(3u, 5u) == 0b100111);
+        REQUIRE(keycap::morton_encode(0xFFFF'FFFFu, 0u) == 0x5555'5555'5555'5555);
+        REQUIRE(keycap::morton_encode(0u, 0xFFFF'FFFFu) == 0xAAAA'AAAA'AAAA'AAAA);
+
+        REQUIRE(keycap::morton_encode(1u, 0u, 0u) == 0b001);
+        REQUIRE(keycap::morton_encode(0u, 1u, 0u) == 0b010);
+        REQUIRE(keycap::morton_encode(0u, 0u, 1u) == 0b100);
+        REQUIRE(keycap::morton_encode(3u, 0u, 1u) == 0b001'101);
+        REQUIRE(keycap::morton_encode(0x1F'FFFFu, 0x1F'FFFFu, 0x1F'FFFFu) == 0x7FFF'FFFF'FFFF'FFFF);
+        REQUIRE(keycap::morton_encode(0xFFE0'0000u, 0u, 0u) == 0);
+    }
+
+    SECTION("Decoding reverses encoding")
+    {
+        std::mt19937_64 engine{3};
+        for (int i = 0; i < 10'000; ++i)
+        {
+            auto const x = static_cast<u32>(engine());
+            auto const y = static_cast<u32>(engine());
+            auto const z = static_cast<u32>(engine());
+
+            REQUIRE(keycap::morton_decode_2d(keycap::morton_encode(x, y)) == std::pair{x, y});
+            REQUIRE(keycap::morton_decode_3d(keycap::morton_encode(x, y, z)) ==
+                    std::array<u32, 3>{x & 0x1F'FFFF, y & 0x1F'FFFF, z & 0x1F'FFFF});
+        }
+    }
+
+    SECTION("Batched encoding and decoding match the single versions")
+    {
+        constexpr sz count = 1'001;
+        std::mt19937_64 engine{5};
+
+        std::vector<u32> x(count), y(count), z(count), decoded_x(count), decoded_y(count), decoded_z(count);
+        for (sz i = 0; i < count; ++i)
+        {
+            x[i] = static_cast<u32>(engine());
+            y[i] = static_cast<u32>(engine());
+            z[i] = static_cast<u32>(engine()) & 0x1F'FFFF;
+        }
+
+        std::vector<u64> codes(count);
+        keycap::morton_encode(x, y, codes);
+        for (sz i = 0; i < count; ++i)
+            REQUIRE(codes[i] == keycap::morton_encode(x[i], y[i]));
+
+        keycap::morton_decode_2d(codes, decoded_x, decoded_y);
+        REQUIRE(decoded_x == x);
+        REQUIRE(decoded_y == y);
+
+        for (sz i = 0; i < count; ++i)
+        {
+            x[i] &= 0x1F'FFFF;
+            y[i] &= 0x1F'FFFF;
+        }
+
+        keycap::morton_encode(x, y, z, codes);
+        for (sz i = 0; i < count; ++i)
+            REQUIRE(codes[i] == keycap::morton_encode(x[i], y[i], z[i]));
+
+        keycap::morton_decode_3d(codes, decoded_x, decoded_y, decoded_z);
+        REQUIRE(decoded_x == x);
+        REQUIRE(decoded_y == y);
+        REQUIRE(decoded_z == z);
+
+        REQUIRE_THROWS_AS(keycap::morton_encode(x, y, std::span{codes}.first(5)), keycap::exception);
+    }
+
+    SECTION("Morton codes can be computed at compile time")
+    {
+        STATIC_REQUIRE(keycap::morton_encode(3u, 5u) == 0b100111);
+        STATIC_REQUIRE(keycap::morton_decode_2d(0b100111) == std::pair<u32, u32>{3, 5});
+        STATIC_REQUIRE(keycap::morton_decode_3d(keycap::morton_encode(7u, 8u, 9u)) == std::array<u32, 3>{7, 8, 9});
+    }
+
+    keycap::simd::limit_instruction_set(previous);
+}
+
+TEST_CASE("tiled_index", "[keycap.core:math]")
+{
+    SECTION("The cells of a tile are stored contiguously")
+    {
+        constexpr keycap::tiled_index<4, 2> index{10, 5};
+
+        STATIC_REQUIRE(index(0, 0) == 0);
+        STATIC_REQUIRE(index(3, 0) == 3);
+        STATIC_REQUIRE(index(0, 1) == 4);
+        STATIC_REQUIRE(index(3, 1) == 7);
+        STATIC_REQUIRE(index(4, 0) == 8);
+        STATIC_REQUIRE(index(0, 2) == 3 * 8);
+        STATIC_REQUIRE(index.size() == 3 * 3 * 8);
+    }
+
+    SECTION("Every cell has a unique index that maps back to it")
+    {
+        keycap::tiled_index<8, 4, 2> const index{13, 9};
+        constexpr u32 width = 13, height = 9, depth = 5;
+
+        std::vector<bool> used(index.size(depth));
+        for (u32 z = 0; z < depth; ++z)
+        {
+            for (u32 y = 0; y < height; ++y)
+            {
+                for (u32 x = 0; x < width; ++x)
+                {
+                    auto const i = index(x, y, z);
+                    REQUIRE(i < used.size());
+                    REQUIRE_FALSE(used[i]);
+                    used[i] = true;
+                    REQUIRE(index.coordinates(i) == std::array{x, y, z});
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("Batched index and coordinate transforms", "[keycap.core:math]")
+{
+    using keycap::simd::instruction_set;
+    auto const set = GENERATE(instruction_set::scalar, instruction_set::avx2);
+    auto const previous = keycap::simd::limit_instruction_set(set);
+
+    constexpr sz count = 1'003;
+    std::mt19937 engine{7};
+
+    SECTION("get_index matches the scalar version")
+    {
+        std::vector<u32> x(count), y(count), indices(count);
+        for (sz i = 0; i < count; ++i)
+        {
+            x[i] = static_cast<u32>(engine() % 1920);
+            y[i] = static_cast<u32>(engine() % 1080);
+        }
+
+        keycap::get_index<u32>(x, y, 1920, indices);
+        for (sz i = 0; i < count; ++i)
+            REQUIRE(indices[i] == keycap::get_index(x[i], y[i], 1920u));
+    }
+
+    SECTION("get_coordinates matches the scalar version")
+    {
+        for (u32 const width : {1u, 3u, 7u, 1920u, 65'536u, 0xFFFF'FFFFu})
+        {
+            std::vector<u32> indices(count), x(count), y(count);
+            for (auto& index : indices)
+                index = static_cast<u32>(engine());
+            indices[0] = 0;
+            indices[1] = 0xFFFF'FFFF;
+
+            keycap::get_coordinates<u32>(indices, width, x, y);
+            for (sz i = 0; i < count; ++i)
+            {
+                INFO(indices[i] << " in a grid of width " << width);
+                REQUIRE(std::pair{x[i], y[i]} == keycap::get_coordinates(indices[i], width));
+            }
+        }
+
+        std::vector<u64> indices{0, 1, 1919, 1920, 5'000'000'000, 0xFFFF'FFFF'FFFF'FFFF}, x(6), y(6);
+        keycap::get_coordinates<u64>(indices, keycap::fixed_divisor<u64>{1920}, x, y);
+        for (sz i = 0; i < indices.size(); ++i)
+            REQUIRE(std::pair{x[i], y[i]} == keycap::get_coordinates<u64>(indices[i], 1920));
+    }
+
+    SECTION("map matches the scalar version for integers")
+    {
+        std::vector<u32> values(count), mapped(count);
+        for (auto& value : values)
+            value = static_cast<u32>(engine() % 1'000);
+
+        keycap::map<u32>(values, 0, 1'000, 200, 65'535, mapped);
+        for (sz i = 0; i < count; ++i)
+            REQUIRE(mapped[i] == keycap::map<u32>(values[i], 0, 1'000, 200, 65'535));
+
+        std::vector<i32> const signed_values{-100, -37, -1, 0, 1, 37, 100};
+        std::vector<i32> signed_mapped(signed_values.size());
+        for (auto const& [in_min, in_max, out_min, out_max] :
+             {std::tuple{-100, 100, 0, 255}, std::tuple{100, -100, 0, 255}, std::tuple{-100, 100, 255, -255}})
+        {
+            keycap::map<i32>(signed_values, in_min, in_max, out_min, out_max, signed_mapped);
+            for (sz i = 0; i < signed_values.size(); ++i)
+                REQUIRE(signed_mapped[i] == keycap::map(signed_values[i], in_min, in_max, out_min, out_max));
+        }
+    }
+
+    SECTION("map matches the scalar version for floating point numbers")
+    {
+        std::vector<f32> values(count), mapped(count);
+        for (auto& value : values)
+            value = static_cast<f32>(engine() % 10'000) / 100.0f;
+
+        keycap::linear_map<f32> const to_unit{0.0f, 100.0f, -1.0f, 1.0f};
+        keycap::map<f32>(values, to_unit, mapped);
+        for (sz i = 0; i < count; ++i)
+        {
+            REQUIRE(mapped[i] == to_unit(values[i]));
+            REQUIRE(std::abs(mapped[i] - keycap::map(values[i], 0.0f, 100.0f, -1.0f, 1.0f)) < 1e-6f);
+        }
+    }
+
+    SECTION("Spans of different sizes and empty input bounds are rejected")
+    {
+        std::vector<u32> values(4), output(3);
+        REQUIRE_THROWS_AS(keycap::map<u32>(values, 0, 10, 0, 100, output), keycap::exception);
+        REQUIRE_THROWS_AS(keycap::get_coordinates<u32>(values, 10, output, output), keycap::exception);
+        REQUIRE_THROWS_AS((keycap::linear_map<u32>{5, 5, 0, 100}), keycap::exception);
+    }
+
+    keycap::simd::limit_instruction_set(previous);
+}
+
+#include <array>
+
+TEST_CASE("array_index", "[keycap.core:algorithm]")
+{
+    SECTION("c-arrays")
+    {
+        constexpr int index = 2;
+        int array[] = {0, 1, 2, 3};
+        REQUIRE(keycap::array_index(array[index], array[0]) == index);
+    }
+
+    SECTION("std::array")
+    {
+        constexpr int index = 2;
+        std::array<int, 4> array{0, 1, 2, 3};
+        REQUIRE(keycap::array_index(array[index], array[0]) == index);
+    }
+
+    SECTION("std::vector")
+    {
+        constexpr int index = 2;
+        std::vector<int> array{0, 1, 2, 3};
+        REQUIRE(keycap::array_index(array[index], array[0]) == index);
+    }
+}
+
+TEST_CASE("is_odd", "[keycap.core:algorithm]")
+{
+    SECTION("0 is even")
+    {
+        REQUIRE(keycap::is_odd(0u) == false);
+    }
+
+    SECTION("1 is odd")
+    {
+        REQUIRE(keycap::is_odd(1u) == true);
+    }
+}
+
+TEST_CASE("is_even", "[keycap.core:algorithm]")
+{
+    SECTION("0 is even")
+    {
+        REQUIRE(keycap::is_even(0) == true);
+    }
+
+    SECTION("1 is odd")
+    {
+        REQUIRE(keycap::is_even(1) == false);
+    }
+}
+
+#include <fmt/format.h>
+
+TEST_CASE("exception::to_string", "[keycap.core:error]")
+{
+    using namespace keycap;
+    auto const line = __LINE__;
+    keycap::exception e{error_code::bad_file_content, module::core, 15, line, "Yo"};
+
+    std::string const expected_error_message =
+        fmt::format("Error [{}-{}-15-{}]: \"Yo\"", static_cast<u64>(error_code::bad_file_content),
+                    static_cast<u64>(module::core), line);
+
+    SECTION("exception::to_string(false) must yield only the error-code and error-message")
+    {
+        REQUIRE(e.to_string() == expected_error_message);
+        REQUIRE(e.to_string().size() == expected_error_message.size());
+    }
+
+    SECTION("exception::to_string(true) must yield the error-code, the error-message and a stack-trace")
+    {
+        auto&& error_string = e.to_string(true);
+        auto itr = error_string.find(expected_error_message);
+
+        REQUIRE(itr != std::string::npos);
+        REQUIRE(error_string.size() != expected_error_message.size());
+        REQUIRE(error_string.substr(expected_error_message.size()).starts_with("\nStack-trace:"));
+    }
+
+    SECTION("The stack-trace is captured as raw addresses and resolved on demand")
+    {
+        REQUIRE(e.stack_trace.size() > 0);
+        REQUIRE(e.stack_trace.size() <= captured_stack_trace::max_frames);
+        REQUIRE(e.stack_trace.addresses().size() == e.stack_trace.size());
+
+        auto const copy = e;
+        REQUIRE(std::ranges::equal(copy.stack_trace.addresses(), e.stack_trace.addresses()));
+        REQUIRE(copy.to_string(true) == e.to_string(true));
+    }
+
+    SECTION("Thrown exceptions keep the stack-trace of the throw site")
+    {
+        try
+        {
+            throw keycap::exception{error_code::logic_error, module::core, 15, __LINE__, "thrown"};
+        }
+        catch (keycap::exception const& thrown)
+        {
+            REQUIRE(thrown.stack_trace.size() > 0);
+            REQUIRE(thrown.to_string(true).starts_with(thrown.to_string()));
+        }
+    }
+}
+
+TEST_CASE("error_telemetry", "[keycap.core:error]")
+{
+    using namespace keycap;
+    error_telemetry::reset();
+
+    SECTION("Every constructed exception is counted by module, fragment and error_code")
+    {
+        keycap::exception{error_code::bad_file_path, module::core, 3, __LINE__, "first"};
+        keycap::exception{error_code::bad_file_path, module::core, 3, __LINE__, "second"};
+        keycap::exception{error_code::logic_error, module::crypto, 1, __LINE__, "third"};
+
+        auto const counts = error_telemetry::snapshot();
+        REQUIRE(counts.count(module::core, 3, error_code::bad_file_path) == 2);
+        REQUIRE(counts.count(module::crypto, 1, error_code::logic_error) == 1);
+        REQUIRE(counts.count(module::core, 3, error_code::logic_error) == 0);
+        REQUIRE(counts.total() == 3);
+        REQUIRE(counts.unclassified() == 0);
+
+        auto const entries = counts.entries();
+        REQUIRE(entries.size() == 2);
+        REQUIRE(entries[0].module == module::core);
+        REQUIRE(entries[0].fragment == 3);
+        REQUIRE(entries[0].error == error_code::bad_file_path);
+        REQUIRE(entries[0].count == 2);
+        REQUIRE(entries[1].module == module::crypto);
+    }
+
+    SECTION("Fragments that are out of range are counted as unclassified")
+    {
+        error_telemetry::record(module::window, error_counts::max_fragments, error_code::invalid_argument);
+        error_telemetry::record(static_cast<module>(100), 0, error_code::invalid_argument);
+
+        auto const counts = error_telemetry::snapshot();
+        REQUIRE(counts.unclassified() == 2);
+        REQUIRE(counts.total() == 2);
+        REQUIRE(counts.entries().empty());
+    }
+
+    SECTION("Counts of all threads are summed up, even after they have exited")
+    {
+        constexpr int threads = 4;
+        constexpr int errors_per_thread = 1'000;
+
+        std::vector<std::thread> workers;
+        for (int i = 0; i < threads; ++i)
+        {
+            workers.emplace_back([] {
+                for (int j = 0; j < errors_per_thread; ++j)
+                    error_telemetry::record(module::core, 8, error_code::buffer_overflow);
+            });
+        }
+        for (auto& worker : workers)
+            worker.join();
+
+        error_telemetry::record(module::core, 8, error_code::buffer_overflow);
+        REQUIRE(error_telemetry::snapshot().count(module::core, 8, error_code::buffer_overflow) ==
+                threads * errors_per_thread + 1);
+    }
+
+    SECTION("snapshot_and_reset starts counting from zero")
+    {
+        error_telemetry::record(module::core, 0, error_code::not_implemented);
+
+        REQUIRE(error_telemetry::snapshot_and_reset().total() == 1);
+        REQUIRE(error_telemetry::snapshot().total() == 0);
+
+        error_telemetry::record(module::core, 0, error_code::not_implemented);
+        REQUIRE(error_telemetry::snapshot().total() == 1);
+    }
+
+    SECTION("Counts can be dumped as text and JSON")
+    {
+        error_telemetry::record(module::core, 8, error_code::buffer_overflow);
+        error_telemetry::record(module::core, 8, error_code::buffer_overflow);
+        error_telemetry::record(module::window, 0, error_code::external_api_error);
+
+        auto const counts = error_telemetry::snapshot();
+        REQUIRE(counts.to_text() ==
+                "# TYPE keycap_errors_total counter\n"
+                "keycap_errors_total{module=\"core\",fragment=\"8\",error=\"buffer_overflow\"} 2\n"
+                "keycap_errors_total{module=\"window\",fragment=\"0\",error=\"external_api_error\"} 1\n");
+        REQUIRE(counts.to_json() ==
+                R"({"total":3,"unclassified":0,"errors":[)"
+                R"({"module":"core","fragment":8,"error":"buffer_overflow","count":2},)"
+                R"({"module":"window","fragment":0,"error":"external_api_error","count":1}]})");
+
+        REQUIRE(error_counts{}.to_json() == R"({"total":0,"unclassified":0,"errors":[]})");
+    }
+
+    error_telemetry::reset();
+}
+
+namespace
+{
+    /// <summary>
+    /// Invokes the given function and returns the error code of the keycap::exception it throws
+    /// </summary>
+    std::optional<keycap::error_code> error_of(auto&& function)
+    {
+        try
+        {
+            function();
+        }
+        catch (keycap::exception const& e)
+        {
+            return e.error;
+        }
+        return std::nullopt;
+    }
+}
+
+TEST_CASE("scope_exit, scope_success and scope_fail", "[keycap.core:scopeguard]")
+{
+    using namespace keycap;
+
+    int runs = 0;
+    auto const count = [&runs] { ++runs; };
+
+    auto const leave = [&](bool throwing) {
+        try
+        {
+            scope_exit exit{count};
+            scope_success success{count};
+            scope_fail fail{[&runs] { runs += 10; }};
+            if (throwing)
+                throw std::runtime_error{"leaving"};
+        }
+        catch (std::runtime_error const&)
+        {
+        }
+    };
+
+    SECTION("Guards store their callable inline")
+    {
+        STATIC_REQUIRE(sizeof(scope_exit<decltype(count)>) <= 2 * sizeof(void*));
+    }
+
+    SECTION("scope_exit and scope_success run when leaving the scope normally")
+    {
+        leave(false);
+        REQUIRE(runs == 2);
+    }
+
+    SECTION("scope_exit and scope_fail run when leaving the scope because of an exception")
+    {
+        leave(true);
+        REQUIRE(runs == 11);
+    }
+
+    SECTION("Dismissed guards do not run")
+    {
+        {
+            scope_exit guard{count};
+            guard.dismiss();
+        }
+        REQUIRE(runs == 0);
+    }
+
+    SECTION("Moved-from guards do not run")
+    {
+        {
+            scope_exit guard{count};
+            auto moved = std::move(guard);
+        }
+        REQUIRE(runs == 1);
+    }
+
+    SECTION("Guards created while unwinding only consider their own scope")
+    {
+        struct unwinding
+        {
+            int& runs;
+
+            ~unwinding()
+            {
+                scope_success success{[this] { ++runs; }};
+                scope_fail fail{[this] { runs += 10; }};
+            }
+        };
+
+        try
+        {
+            unwinding guard{runs};
+            throw std::runtime_error{"unwinding"};
+        }
+        catch (std::runtime_error const&)
+        {
+        }
+        REQUIRE(runs == 1);
+    }
+}
+
+TEST_CASE("inplace_scope_guard", "[keycap.core:scopeguard]")
+{
+    using namespace keycap;
+
+    std::vector<int> order;
+
+    SECTION("Handlers run in reverse order of their addition")
+    {
+        {
+            inplace_scope_guard<4> guard{[&] { order.push_back(1); }};
+            guard += [&] { order.push_back(2); };
+            guard += [&] { order.push_back(3); };
+            REQUIRE(guard.size() == 3);
+        }
+        REQUIRE(order == std::vector{3, 2, 1});
+    }
+
+    SECTION("Handlers run according to the policy")
+    {
+        auto const leave = [&](scope_guard::execution policy, bool throwing) {
+            try
+            {
+                inplace_scope_guard<2> guard{[&] { order.push_back(static_cast<int>(policy)); }, policy};
+                if (throwing)
+                    throw std::runtime_error{"leaving"};
+            }
+            catch (std::runtime_error const&)
+            {
+            }
+        };
+
+        leave(scope_guard::always, false);
+        leave(scope_guard::always, true);
+        leave(scope_guard::no_exception, false);
+        leave(scope_guard::no_exception, true);
+        leave(scope_guard::exception, false);
+        leave(scope_guard::exception, true);
+        REQUIRE(order == std::vector<int>{scope_guard::always, scope_guard::always, scope_guard::no_exception,
+                                          scope_guard::exception});
+    }
+
+    SECTION("Dismissed handlers do not run")
+    {
+        {
+            inplace_scope_guard<2> guard{[&] { order.push_back(1); }};
+            guard.dismiss();
+            REQUIRE(guard.size() == 0);
+        }
+        REQUIRE(order.empty());
+    }
+
+    SECTION("Handlers that do not fit run right away and throw")
+    {
+        inplace_scope_guard<1> guard{[&] { order.push_back(1); }};
+        REQUIRE(error_of([&] { guard += [&] { order.push_back(2); }; }) == error_code::buffer_overflow);
+        REQUIRE(order == std::vector{2});
+        REQUIRE(guard.size() == 1);
+    }
+
+    SECTION("Handlers are destroyed")
+    {
+        auto const shared = std::make_shared<int>(0);
+        {
+            inplace_scope_guard<2, 4 * sizeof(void*)> guard{[shared] { ++*shared; }};
+            guard += [shared] { ++*shared; };
+            REQUIRE(shared.use_count() == 3);
+        }
+        REQUIRE(*shared == 2);
+        REQUIRE(shared.use_count() == 1);
+    }
+}
+
+namespace
+{
+    /// <summary>
+    /// Writes the given contents to a file in the temporary directory and removes it again when going out of scope
+    /// </summary>
+    struct temporary_file
+    {
+        temporary_file(std::string const& name, std::string_view contents)
+          : path{(std::filesystem::temp_directory_path() / name).string()}
+        {
+            std::ofstream{path, std::ios::binary} << contents;
+        }
+
+        ~temporary_file()
+        {
+            std::filesystem::remove(path);
+        }
+
+        std::string path;
+    };
+}
+
+TEST_CASE("source_cache", "[keycap.core:source]")
+{
+    temporary_file const unix_lines{"keycap.source_cache.unix.txt", "first\nsecond\n\nfourth"};
+    temporary_file const windows_lines{"keycap.source_cache.windows.txt", "first\r\nsecond\r\n"};
+    temporary_file const empty{"keycap.source_cache.empty.txt", ""};
+
+    keycap::source_cache cache;
+
+    SECTION("Lines are looked up by their 1-based number")
+    {
+        auto const file = cache.get(unix_lines.path);
+        REQUIRE(file != nullptr);
+        REQUIRE(file->line_count() == 4);
+        REQUIRE(file->line(1) == "first");
+        REQUIRE(file->line(2) == "second");
+        REQUIRE(file->line(3).empty());
+        REQUIRE(file->line(4) == "fourth");
+        REQUIRE(file->line(0).empty());
+        REQUIRE(file->line(5).empty());
+
+        auto const windows = cache.get(windows_lines.path);
+        REQUIRE(windows->line_count() == 2);
+        REQUIRE(windows->line(2) == "second");
+
+        REQUIRE(cache.get(empty.path)->line_count() == 0);
+        REQUIRE(cache.line(unix_lines.path, 4) == "fourth");
+    }
+
+    SECTION("Excerpts mark the given line and are empty for unknown locations")
+    {
+        auto const file = cache.get(unix_lines.path);
+        REQUIRE(file->excerpt(2, 1) == "     1:    first\n"
+                                       "   > 2:    second\n"
+                                       "     3:    \n"
+                                       "     4:    fourth\n");
+        REQUIRE(file->excerpt(4, 0) == "   > 4:    fourth\n");
+
+        // Stack frames without line information point at line 0
+        REQUIRE(file->excerpt(0, 2).empty());
+        REQUIRE(file->excerpt(5, 2).empty());
+    }
+
+    SECTION("Files are loaded only once")
+    {
+        auto const first = cache.get(unix_lines.path);
+        auto const second = cache.get(unix_lines.path);
+        REQUIRE(first == second);
+        REQUIRE(cache.file_count() == 1);
+        REQUIRE(cache.size_bytes() > 0);
+    }
+
+    SECTION("Missing files yield nullptr")
+    {
+        REQUIRE(cache.get("keycap.source_cache.this-file-does-not-exist.txt") == nullptr);
+        REQUIRE(cache.line("keycap.source_cache.this-file-does-not-exist.txt", 1).empty());
+    }
+
+    SECTION("The least recently used files are evicted")
+    {
+        auto const unix_cost = cache.get(unix_lines.path)->size_bytes() + unix_lines.path.size();
+        auto const windows_cost = cache.get(windows_lines.path)->size_bytes() + windows_lines.path.size();
+        auto const empty_cost = cache.get(empty.path)->size_bytes() + empty.path.size();
+        REQUIRE(cache.size_bytes() == unix_cost + windows_cost + empty_cost);
+
+        // Touch unix_lines, so windows_lines becomes the least recently used file
+        auto const kept = cache.get(unix_lines.path);
+        auto const evicted = cache.get(windows_lines.path);
+        (void)cache.get(empty.path);
+        (void)cache.get(unix_lines.path);
+
+        cache.set_capacity(unix_cost + empty_cost);
+        REQUIRE(cache.file_count() == 2);
+        REQUIRE(cache.get(unix_lines.path) == kept);
+
+        // Evicted files stay valid while they are referenced
+        REQUIRE(evicted->line(1) == "first");
+        REQUIRE(cache.get(windows_lines.path) != evicted);
+
+        cache.clear();
+        REQUIRE(cache.file_count() == 0);
+        REQUIRE(cache.size_bytes() == 0);
+    }
+
+    SECTION("Cached files keep their lines when the file is rewritten or truncated")
+    {
+        temporary_file const changing{"keycap.source_cache.changing.txt", "first\nsecond\nthird\n"};
+        auto const file = cache.get(changing.path);
+
+        std::ofstream{changing.path, std::ios::binary | std::ios::trunc} << "1";
+        REQUIRE(cache.line(changing.path, 3) == "third");
+        REQUIRE(file->line(2) == "second");
+
+        std::ofstream{changing.path, std::ios::binary | std::ios::trunc};
+        REQUIRE(file->excerpt(3, 0) == "   > 3:    third\n");
+
+        cache.clear();
+        REQUIRE(cache.line(changing.path, 1).empty());
+    }
+
+    SECTION("Files larger than the capacity are returned but not cached")
+    {
+        cache.set_capacity(4);
+        REQUIRE(cache.get(unix_lines.path)->line(1) == "first");
+        REQUIRE(cache.file_count() == 0);
+    }
+
+    SECTION("The cache can be used from many threads")
+    {
+        std::vector<std::thread> threads;
+        std::vector<std::string> lines(8);
+        for (sz t = 0; t < lines.size(); ++t)
+        {
+            threads.emplace_back([&, t] {
+                cache.set_capacity(t % 2 == 0 ? 1024 : 64);
+                for (int i = 0; i < 1'000; ++i)
+                {
+                    auto const& path = i % 2 == 0 ? unix_lines.path : windows_lines.path;
+                    lines[t] = cache.line(path, 2);
+                }
+            });
+        }
+
+        for (auto& thread : threads)
+            thread.join();
+
+        REQUIRE(std::ranges::all_of(lines, [](auto const& line) { return line == "second"; }));
+    }
+}
+
+TEST_CASE("to_byte_array", "[keycap.core:array]")
+{
+    SECTION("i16")
+    {
+        constexpr i16 value = 0x0BEE;
+        constexpr std::array<u8, 2> expected = {0xEE, 0x0B};
+
+        REQUIRE(keycap::to_byte_array(value) == expected);
+    }
+
+    SECTION("u16")
+    {
+        constexpr u16 value = 0xBEEF;
+        constexpr std::array<u8, 2> expected = {0xEF, 0xBE};
+
+        REQUIRE(keycap::to_byte_array(value) == expected);
+    }
+
+    SECTION("i32")
+    {
+        constexpr i32 value = 0x0D15EA5E;
+        constexpr std::array<u8, 4> expected = {0x5E, 0xEA, 0x15, 0x0D};
+
+        REQUIRE(keycap::to_byte_array(value) == expected);
+    }
+
+    SECTION("u32")
+    {
+        constexpr u32 value = 0xC0CAC01A;
+        constexpr std::array<u8, 4> expected = {0x1A, 0xC0, 0xCA, 0xC0};
+
+        REQUIRE(keycap::to_byte_array(value) == expected);
+    }
+
+    SECTION("i64")
+    {
+        constexpr i64 value = 0x0F1CECAFEBADF00D;
+        constexpr std::array<u8, 8> expected = {0x0D, 0xF0, 0xAD, 0xEB, 0xAF, 0xEC, 0x1C, 0x0F};
+
+        REQUIRE(keycap::to_byte_array(value) == expected);
+    }
+
+    SECTION("u64")
+    {
+        constexpr u64 value = 0xFACEFEEDBABEBEEF;
+        constexpr std::array<u8, 8> expected = {0xEF, 0xBE, 0xBE, 0xBA, 0xED, 0xFE, 0xCE, 0xFA};
+
+        REQUIRE(keycap::to_byte_array(value) == expected);
+    }
+}
+
+TEST_CASE("from_byte_array", "[keycap.core:array]")
+{
+    SECTION("Converting bytes to u32 must yield expected result")
+    {
+        constexpr std::array<u8, 4> value = {0x1A, 0xC0, 0xCA, 0xC0};
+        constexpr u32 expected = 0xC0CAC01A;
+
+        REQUIRE(keycap::from_byte_array<u32>(value) == expected);
+    }
+}
+
+TEST_CASE("from_byte_vector", "[keycap.core:array]")
+{
+    SECTION("Converting bytes to u32 must yield expected result")
+    {
+        std::vector<u8> const value = {0x1A, 0xC0, 0xCA, 0xC0};
+        constexpr u32 expected = 0xC0CAC01A;
+
+        REQUIRE(keycap::from_byte_vector<u32>(value) == expected);
+    }
+}
+
+TEST_CASE("byte_writer", "[keycap.core:array]")
+{
+    enum class opcode : u16
+    {
+        hello = 0x0102,
+    };
+
+    std::array<u8, 16> buffer{};
+
+    SECTION("Scalars are written in the requested byte order")
+    {
+        keycap::byte_writer<std::endian::big> big{buffer};
+        big.write(u32{0xC0CAC01A}).write(opcode::hello).write(u8{0xFF});
+
+        REQUIRE(big.position() == 7);
+        REQUIRE(std::ranges::equal(big.written(), std::array<u8, 7>{0xC0, 0xCA, 0xC0, 0x1A, 0x01, 0x02, 0xFF}));
+
+        keycap::byte_writer<std::endian::little> little{buffer};
+        little.write(u32{0xC0CAC01A}).write(opcode::hello);
+
+        REQUIRE(std::ranges::equal(little.written(), std::array<u8, 6>{0x1A, 0xC0, 0xCA, 0xC0, 0x02, 0x01}));
+    }
+
+    SECTION("Floating point values are written as their bit pattern")
+    {
+        keycap::byte_writer<std::endian::big> writer{buffer};
+        writer.write(1.0f);
+
+        REQUIRE(std::ranges::equal(writer.written(), std::array<u8, 4>{0x3F, 0x80, 0x00, 0x00}));
+    }
+
+    SECTION("Arrays are written element by element in the requested byte order")
+    {
+        std::vector<u16> const values = {0x0102, 0x0304, 0x0506};
+
+        keycap::byte_writer<std::endian::big> writer{buffer};
+        writer.write(values).write_bytes(std::array<u8, 2>{0xAA, 0xBB});
+
+        REQUIRE(std::ranges::equal(writer.written(),
+                                   std::array<u8, 8>{0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0xAA, 0xBB}));
+        REQUIRE(writer.remaining() == 8);
+    }
+
+    SECTION("Writing past the end of the buffer throws buffer_overflow and writes nothing")
+    {
+        keycap::byte_writer writer{std::span<u8>{buffer}.first(6)};
+        writer.write(u32{1});
+
+        REQUIRE(error_of([&] { writer.write(u32{2}); }) == keycap::error_code::buffer_overflow);
+        REQUIRE(writer.position() == 4);
+
+        REQUIRE_THROWS_AS(writer.write(std::array<u16, 2>{}), keycap::exception);
+        REQUIRE(writer.position() == 4);
+    }
+}
+
+TEST_CASE("byte_reader", "[keycap.core:array]")
+{
+    std::array<u8, 8> const buffer = {0xC0, 0xCA, 0xC0, 0x1A, 0x01, 0x02, 0x03, 0x04};
+
+    SECTION("Scalars are read in the requested byte order")
+    {
+        keycap::byte_reader<std::endian::big> big{buffer};
+        REQUIRE(big.read<u32>() == 0xC0CAC01A);
+        REQUIRE(big.read<u16>() == 0x0102);
+        REQUIRE(big.remaining() == 2);
+
+        keycap::byte_reader<std::endian::little> little{buffer};
+        REQUIRE(little.read<u32>() == 0x1AC0CAC0);
+        REQUIRE(little.read<i16>() == 0x0201);
+    }
+
+    SECTION("Arrays are filled in the requested byte order")
+    {
+        keycap::byte_reader<std::endian::big> reader{buffer};
+        std::array<u16, 2> values{};
+        reader.read(values);
+
+        REQUIRE(values == std::array<u16, 2>{0xC0CA, 0xC01A});
+        REQUIRE(std::ranges::equal(reader.read_bytes(2), std::array<u8, 2>{0x01, 0x02}));
+    }
+
+    SECTION("Reading past the end of the buffer throws buffer_overflow and consumes nothing")
+    {
+        keycap::byte_reader reader{buffer};
+        (void)reader.read<u32>();
+
+        REQUIRE(error_of([&] { (void)reader.read<u64>(); }) == keycap::error_code::buffer_overflow);
+        REQUIRE(reader.position() == 4);
+        REQUIRE(reader.read<u32>() == 0x04030201);
+    }
+}
+
+TEST_CASE("from_bytes", "[keycap.core:array]")
+{
+    std::array<std::byte, 4> const bytes = {std::byte{0xC0}, std::byte{0xCA}, std::byte{0xC0}, std::byte{0x1A}};
+
+    SECTION("Decodes in the requested byte order")
+    {
+        REQUIRE(keycap::from_bytes<u32, std::endian::big>(bytes) == 0xC0CAC01A);
+        REQUIRE(keycap::from_bytes<u16>(bytes) == 0xCAC0);
+    }
+
+    SECTION("Short input throws instead of being padded")
+    {
+        REQUIRE(error_of([&] { (void)keycap::from_bytes<u64>(bytes); }) == keycap::error_code::buffer_overflow);
+    }
+}
+
+TEST_CASE("Non-throwing serialization", "[keycap.core:array]")
+{
+    std::array<std::byte, 4> const bytes = {std::byte{0xC0}, std::byte{0xCA}, std::byte{0xC0}, std::byte{0x1A}};
+
+    SECTION("try_from_bytes returns the value or buffer_overflow")
+    {
+        REQUIRE(keycap::try_from_bytes<u32, std::endian::big>(bytes) == 0xC0CAC01A);
+
+        auto const failed = keycap::try_from_bytes<u64>(bytes);
+        REQUIRE_FALSE(failed.has_value());
+        REQUIRE(failed.error().error == keycap::error_code::buffer_overflow);
+        REQUIRE(failed.error().module == keycap::module::core);
+    }
+
+    SECTION("try_write and try_read leave the position unchanged on failure")
+    {
+        std::array<u8, 6> buffer{};
+        keycap::byte_writer writer{buffer};
+
+        REQUIRE(writer.try_write(u32{0xDEADBEEF}).has_value());
+        REQUIRE(writer.try_write(u32{1}).error().error == keycap::error_code::buffer_overflow);
+        REQUIRE(writer.try_write(std::array<u16, 2>{}).error().error == keycap::error_code::buffer_overflow);
+        REQUIRE(writer.position() == 4);
+        REQUIRE(writer.try_write(std::array<u8, 2>{1, 2}).has_value());
+        REQUIRE(writer.remaining() == 0);
+
+        keycap::byte_reader reader{std::span<u8 const>{buffer}};
+        REQUIRE(reader.try_read<u32>() == 0xDEADBEEF);
+        REQUIRE(reader.try_read<u32>().error().error == keycap::error_code::buffer_overflow);
+        REQUIRE(reader.position() == 4);
+
+        std::array<u8, 2> tail{};
+        REQUIRE(reader.try_read(tail).has_value());
+        REQUIRE(tail == std::array<u8, 2>{1, 2});
+        REQUIRE_FALSE(reader.try_read(tail).has_value());
+    }
+}
+
+TEST_CASE("keycap::result", "[keycap.core:result]")
+{
+    using namespace keycap;
+
+    auto const divide = [](i32 dividend, i32 divisor) -> result<i32> {
+        if (divisor == 0)
+            return make_error(error_code::invalid_argument, module::core, 15, 42, "Division by zero");
+        return dividend / divisor;
+    };
+
+    SECTION("Holds either a value or an error_record")
+    {
+        REQUIRE(divide(6, 3) == 2);
+
+        auto const failed = divide(1, 0);
+        REQUIRE_FALSE(failed.has_value());
+        REQUIRE(failed.error() == error_record{error_code::invalid_argument, module::core, 15, 42, "Division by zero"});
+    }
+
+    SECTION("error_record formats like keycap::exception")
+    {
+        auto const record = divide(1, 0).error();
+        exception const e{record.error, record.module, record.fragment, record.line_number, "Division by zero"};
+        REQUIRE(record.to_string() == e.to_string());
+    }
+
+    SECTION("value_or_throw bridges to exceptions")
+    {
+        REQUIRE(value_or_throw(divide(6, 3)) == 2);
+        REQUIRE(error_of([&] { (void)value_or_throw(divide(1, 0)); }) == error_code::invalid_argument);
+
+        try
+        {
+            (void)value_or_throw(divide(1, 0));
+        }
+        catch (exception const& e)
+        {
+            REQUIRE(e.error_message == "Division by zero");
+            REQUIRE(e.line_number == 42);
+        }
+
+        REQUIRE_NOTHROW(value_or_throw(result<void>{}));
+    }
+
+    SECTION("error_record is small and trivially copyable")
+    {
+        STATIC_REQUIRE(std::is_trivially_copyable_v<error_record>);
+        STATIC_REQUIRE(sizeof(result<u32>) <= 64);
+    }
+}
+
+TEST_CASE("packed_view", "[keycap.core:array]")
+{
+    std::vector<std::byte> bytes(12);
+    for (sz i = 0; i < bytes.size(); ++i)
+        bytes[i] = static_cast<std::byte>(i + 1);
+
+    SECTION("Elements are decoded on access")
+    {
+        keycap::packed_view<u16, std::endian::big> view{bytes};
+
+        REQUIRE(view.size() == 6);
+        REQUIRE(view[0] == 0x0102);
+        REQUIRE(view.at(5) == 0x0B0C);
+        REQUIRE(view.back() == 0x0B0C);
+        REQUIRE(std::ranges::equal(view.subview(1, 2), std::array<u16, 2>{0x0304, 0x0506}));
+    }
+
+    SECTION("The view is a random-access range")
+    {
+        keycap::packed_view<u32> view{bytes};
+        STATIC_REQUIRE(std::ranges::random_access_range<decltype(view)>);
+        STATIC_REQUIRE(std::ranges::borrowed_range<decltype(view)>);
+
+        std::vector<u32> values{view.begin(), view.end()};
+        REQUIRE(values == std::vector<u32>{0x04030201, 0x08070605, 0x0C0B0A09});
+        REQUIRE(std::ranges::find(view, 0x08070605u) - view.begin() == 1);
+        REQUIRE(view.end() - view.begin() == 3);
+    }
+
+    SECTION("Strided views access a single field of packed records")
+    {
+        // Records of {u8 tag; u16 value;}, packed without padding
+        keycap::packed_view<u16, std::endian::big> values{std::span{bytes}.subspan(1), 4, 3};
+
+        REQUIRE(std::ranges::equal(values, std::array<u16, 4>{0x0203, 0x0506, 0x0809, 0x0B0C}));
+
+        std::array<u16, 4> decoded{};
+        values.decode_into(decoded);
+        REQUIRE(decoded == std::array<u16, 4>{0x0203, 0x0506, 0x0809, 0x0B0C});
+    }
+
+    SECTION("Truncated buffers fail on construction")
+    {
+        auto const truncated = std::span<std::byte const>{bytes}.first(11);
+
+        REQUIRE(error_of([&] { keycap::packed_view<u32>{truncated}; }) == keycap::error_code::buffer_overflow);
+        REQUIRE(error_of([&] { keycap::packed_view<u32>(truncated, 3); }) == keycap::error_code::buffer_overflow);
+        REQUIRE(error_of([&] { keycap::packed_view<u16>(truncated.subspan(1), 4, 3); }) ==
+                keycap::error_code::buffer_overflow);
+        REQUIRE(error_of([&] { keycap::packed_view<u32>(truncated, 2); }) == std::nullopt);
+    }
+
+    SECTION("Out of bounds access throws")
+    {
+        keycap::packed_view<u32> view{bytes};
+
+        REQUIRE(error_of([&] { (void)view.at(3); }) == keycap::error_code::buffer_overflow);
+        REQUIRE(error_of([&] { (void)view.subview(2, 2); }) == keycap::error_code::buffer_overflow);
+
+        std::array<u32, 2> too_small{};
+        REQUIRE(error_of([&] { view.decode_into(too_small); }) == keycap::error_code::buffer_overflow);
+    }
+
+    SECTION("Bulk decoding matches element-wise decoding on every code path")
+    {
+        std::vector<std::byte> large(8 * 1001);
+        for (sz i = 0; i < large.size(); ++i)
+            large[i] = static_cast<std::byte>(i * 31);
+
+        keycap::packed_view<u64, std::endian::big> view{large};
+        std::vector<u64> const expected{view.begin(), view.end()};
+
+        using keycap::simd::instruction_set;
+        for (auto set : {instruction_set::scalar, instruction_set::sse2, instruction_set::avx2})
+        {
+            auto const previous = keycap::simd::limit_instruction_set(set);
+
+            std::vector<u64> decoded(view.size() + 3);
+            REQUIRE(view.decode_into(decoded).size() == view.size());
+            REQUIRE(std::ranges::equal(std::span{decoded}.first(view.size()), expected));
+
+            keycap::simd::limit_instruction_set(previous);
+        }
+    }
+}
+
+TEMPLATE_TEST_CASE("Bulk byte order conversion", "[keycap.core:array]", u16, i32, u64, float, double)
+{
+    using keycap::simd::instruction_set;
+
+    // Odd sizes make sure the scalar tails are covered
+    std::vector<TestType> values(131);
+    for (sz i = 0; i < values.size(); ++i)
+        values[i] = static_cast<TestType>(i * 7919 + 13);
+
+    std::vector<u8> expected(values.size() * sizeof(TestType));
+    {
+        keycap::byte_writer<std::endian::big> writer{expected};
+        for (auto value : values)
+            writer.write(value);
+    }
+
+    auto const set = GENERATE(instruction_set::scalar, instruction_set::sse2, instruction_set::avx2);
+    auto const previous = keycap::simd::limit_instruction_set(set);
+
+    std::vector<u8> buffer(expected.size());
+    keycap::byte_writer<std::endian::big>{buffer}.write(values);
+
+    std::vector<TestType> round_trip(values.size());
+    keycap::byte_reader<std::endian::big>{buffer}.read(round_trip);
+
+    keycap::simd::limit_instruction_set(previous);
+
+    REQUIRE(buffer == expected);
+    REQUIRE(round_trip == values);
+}
+
+TEST_CASE("keycap::random", "keycap.core:random")
+{
+    // Do not add new tests here! These tests will run back to back, modifying the prng state. Adding tests up here
+    // will make all the tests below fail. Only add to the bottom!
+
+    SECTION("u64")
+    {
+        constexpr u64 expected = 0xb0c41f6c3353405d;
+        REQUIRE(keycap::random::random_u64() == expected);
+    }
+
+    SECTION("i64")
+    {
+        constexpr i64 expected = -7376994870862721386;
+        REQUIRE(keycap::random::random_i64() == expected);
+    }
+
+    SECTION("u32")
+    {
+        constexpr u32 expected = 0x812cda63;
+        REQUIRE(keycap::random::random_u32() == expected);
+    }
+
+    SECTION("i32")
+    {
+        constexpr i32 expected = 0x695776c1;
+        REQUIRE(keycap::random::random_i32() == expected);
+    }
+
+    SECTION("u16")
+    {
+        constexpr u16 expected = 6917;
+        REQUIRE(keycap::random::random_u16() == expected);
+    }
+
+    SECTION("i16")
+    {
+        constexpr i16 expected = 8052;
+        REQUIRE(keycap::random::random_i16() == expected);
+    }
+
+    SECTION("u8")
+    {
+        constexpr u8 expected = 88;
+        REQUIRE((int)keycap::random::random_u8() == (int)expected);
+    }
+
+    SECTION("i8")
+    {
+        constexpr i8 expected = 102;
+        REQUIRE((int)keycap::random::random_i8() == (int)expected);
+    }
+
+    SECTION("seeded u64")
+    {
+        keycap::random::seed(0xABBAB33FAC1D4689);
+
+        constexpr u64 expected = 0x2596b32dc4a79b6a;
+        REQUIRE(keycap::random::random_u64() == expected);
+    }
+
+    SECTION("seeded i64")
+    {
+        keycap::random::seed(0xABBAB33FAC1D4689);
+
+        constexpr i64 expected = -6514822801790624918;
+        REQUIRE(keycap::random::random_i64() == expected);
+    }
+
+    SECTION("seeded u32")
+    {
+        keycap::random::seed(0xABBAB33FAC1D4689);
+
+        constexpr u32 expected = 0x2596b32d;
         REQUIRE(keycap::random::random_u32() == expected);
     }
 
-    SECTION("i32")
+    SECTION("seeded i32")
+    {
+        keycap::random::seed(0xABBAB33FAC1D4689);
+
+        constexpr i32 expected = -1516850387;
+        REQUIRE(keycap::random::random_i32() == expected);
+    }
+
+    SECTION("seeded u16")
+    {
+        keycap::random::seed(0xABBAB33FAC1D4689);
+
+        constexpr u16 expected = 9622;
+        REQUIRE(keycap::random::random_u16() == expected);
+    }
+
+    SECTION("seeded i16")
+    {
+        keycap::random::seed(0xABBAB33FAC1D4689);
+
+        constexpr i16 expected = -23146;
+        REQUIRE(keycap::random::random_i16() == expected);
+    }
+
+    SECTION("seeded u8")
+    {
+        keycap::random::seed(0xABBAB33FAC1D4689);
+
+        constexpr u8 expected = 37;
+        REQUIRE((int)keycap::random::random_u8() == (int)expected);
+    }
+
+    SECTION("seeded i8")
+    {
+        keycap::random::seed(0xABBAB33FAC1D4689);
+
+        constexpr i8 expected = -91;
+        REQUIRE((int)keycap::random::random_i8() == (int)expected);
+    }
+}
+
+TEST_CASE("Bounded random numbers", "[keycap.core:random]")
+{
+    SECTION("Bounded values are identical on every platform")
+    {
+        keycap::random::seed(42);
+
+        std::vector<int> rolls;
+        for (int i = 0; i < 10; ++i)
+            rolls.push_back(keycap::random::random_u8(1, 6));
+
+        REQUIRE(rolls == std::vector<int>{6, 1, 4, 2, 3, 6, 6, 4, 5, 3});
+
+        keycap::random::seed(42);
+        REQUIRE(keycap::random::random_u64(0, 999'999'999'999) == 901475271648);
+        REQUIRE(keycap::random::random_u64(0, 999'999'999'999) == 77005075580);
+    }
+
+    SECTION("Values stay within the bounds and cover all of them")
+    {
+        keycap::random::seed(1);
+
+        std::array<int, 11> counts{};
+        for (int i = 0; i < 110'000; ++i)
+        {
+            auto const value = keycap::random::random_i32(-5, 5);
+            REQUIRE(value >= -5);
+            REQUIRE(value <= 5);
+            ++counts[static_cast<sz>(value + 5)];
+        }
+
+        for (auto count : counts)
+        {
+            REQUIRE(count > 9'500);
+            REQUIRE(count < 10'500);
+        }
+    }
+
+    SECTION("Empty and extreme ranges")
+    {
+        REQUIRE(keycap::random::random_i64(7, 7) == 7);
+        REQUIRE(keycap::random::random_i8(-128, -128) == -128);
+
+        auto const value = keycap::random::random_i64(std::numeric_limits<i64>::max() - 1,
+                                                      std::numeric_limits<i64>::max());
+        REQUIRE(value >= std::numeric_limits<i64>::max() - 1);
+    }
+}
+
+TEST_CASE("Random floating point numbers", "[keycap.core:random]")
+{
+    SECTION("Values are identical on every platform")
+    {
+        keycap::random::seed(42);
+        REQUIRE(keycap::random::random_f64() == 0.9014752716487433);
+    }
+
+    SECTION("Values stay within [min, max)")
+    {
+        keycap::random::seed(3);
+
+        f64 sum = 0;
+        for (int i = 0; i < 100'000; ++i)
+        {
+            auto const unit = keycap::random::random_f64();
+            REQUIRE(unit >= 0.0);
+            REQUIRE(unit < 1.0);
+            sum += unit;
+
+            auto const single = keycap::random::random_f32();
+            REQUIRE(single >= 0.0f);
+            REQUIRE(single < 1.0f);
+
+            auto const ranged = keycap::random::random_f32(-2.5f, 4.0f);
+            REQUIRE(ranged >= -2.5f);
+            REQUIRE(ranged < 4.0f);
+        }
+
+        REQUIRE(sum / 100'000 > 0.49);
+        REQUIRE(sum / 100'000 < 0.51);
+    }
+
+    SECTION("Ranges too narrow to represent still exclude max")
+    {
+        auto const max = std::nextafter(1.0f, 2.0f);
+        for (int i = 0; i < 1'000; ++i)
+            REQUIRE(keycap::random::random_f32(1.0f, max) == 1.0f);
+    }
+}
+
+TEST_CASE("Filling with random numbers", "[keycap.core:random]")
+{
+    using keycap::simd::instruction_set;
+
+    SECTION("The output only depends on the seed, not on the instruction set")
+    {
+        auto const generate = [](instruction_set set) {
+            auto const previous = keycap::simd::limit_instruction_set(set);
+            keycap::random::seed(0xC0FFEE);
+
+            std::vector<u32> integers(1'003);
+            keycap::random::fill(std::span{integers}, 10, 1'000'000);
+
+            // A range just above 2^31 rejects almost every other value
+            std::vector<u32> rejecting(777);
+            keycap::random::fill(std::span{rejecting}, 0, 0x8000'0000);
+
+            std::vector<f64> floats(333);
+            keycap::random::fill(std::span{floats});
+
+            keycap::simd::limit_instruction_set(previous);
+            return std::tuple{integers, rejecting, floats};
+        };
+
+        auto const expected = generate(instruction_set::scalar);
+        for (auto set : {instruction_set::sse2, instruction_set::avx2, instruction_set::avx512})
+            REQUIRE(generate(set) == expected);
+    }
+
+    SECTION("Integers stay within the bounds and cover all of them")
+    {
+        std::vector<i8> values(100'000);
+        keycap::random::fill(std::span{values}, -3, 3);
+
+        std::array<int, 7> counts{};
+        for (auto value : values)
+        {
+            REQUIRE(value >= -3);
+            REQUIRE(value <= 3);
+            ++counts[static_cast<sz>(value + 3)];
+        }
+
+        for (auto count : counts)
+            REQUIRE(count > 13'500);
+
+        std::vector<u64> large(10'000);
+        keycap::random::fill(std::span{large}, 5, 0x8000'0000'0000'0000);
+        REQUIRE(std::ranges::all_of(large, [](u64 value) { return value >= 5 && value <= 0x8000'0000'0000'0000; }));
+    }
+
+    SECTION("Full ranges use every bit")
+    {
+        std::vector<u64> values(1'000);
+        keycap::random::fill(std::span{values});
+
+        u64 any = 0, all = ~u64{0};
+        for (auto value : values)
+        {
+            any |= value;
+            all &= value;
+        }
+
+        REQUIRE(any == ~u64{0});
+        REQUIRE(all == 0);
+    }
+
+    SECTION("Floating point numbers stay within [min, max)")
+    {
+        std::vector<f32> values(100'000);
+        keycap::random::fill(std::span{values}, -1.0f, 1.0f);
+
+        REQUIRE(std::ranges::all_of(values, [](f32 value) { return value >= -1.0f && value < 1.0f; }));
+
+        f64 sum = 0;
+        for (auto value : values)
+            sum += static_cast<f64>(value);
+
+        REQUIRE(sum / static_cast<f64>(values.size()) > -0.01);
+        REQUIRE(sum / static_cast<f64>(values.size()) < 0.01);
+    }
+
+    SECTION("Filling is reproducible")
+    {
+        std::vector<i32> first(4'096), second(4'096);
+
+        keycap::random::seed(11);
+        keycap::random::fill(std::span{first}, -100, 100);
+        keycap::random::seed(11);
+        keycap::random::fill(std::span{second}, -100, 100);
+
+        REQUIRE(first == second);
+    }
+}
+
+TEST_CASE("Random streams", "[keycap.core:random]")
+{
+    using keycap::random::xoroshiro128plus;
+
+    SECTION("jump and long_jump match the reference implementation")
+    {
+        xoroshiro128plus jumped{42};
+        jumped.jump();
+        REQUIRE(jumped.state() == std::array<u64, 2>{0xbbd57edf18ff6512, 0x935868339bb6176b});
+
+        xoroshiro128plus long_jumped{42};
+        long_jumped.long_jump();
+        REQUIRE(long_jumped.state() == std::array<u64, 2>{0xafcc0bcc17905ee9, 0x08dc8cf4dd3ebf9c});
+    }
+
+    SECTION("Every thread draws from its own stream")
+    {
+        std::vector<std::vector<u64>> sequences(4);
+        std::vector<std::thread> threads;
+        for (auto& sequence : sequences)
+        {
+            threads.emplace_back([&sequence] {
+                for (int i = 0; i < 8; ++i)
+                    sequence.push_back(keycap::random::random_u64());
+            });
+        }
+
+        for (auto& thread : threads)
+            thread.join();
+
+        std::unordered_set<u64> values;
+        for (auto const& sequence : sequences)
+            values.insert(sequence.begin(), sequence.end());
+
+        REQUIRE(values.size() == 4 * 8);
+    }
+
+    SECTION("Choosing a stream before the first draw does not use up a default stream")
+    {
+        auto const first_value = [](bool choose_stream) {
+            u64 value = 0;
+            std::thread{[&] {
+                if (choose_stream)
+                    keycap::random::use_stream(xoroshiro128plus{1});
+                value = keycap::random::random_u64();
+            }}.join();
+            return value;
+        };
+
+        auto const before = first_value(false);
+        REQUIRE(first_value(true) == xoroshiro128plus{1}());
+        REQUIRE(first_value(true) == xoroshiro128plus{1}());
+        auto const after = first_value(false);
+
+        // The default streams are handed out in order by a registry with a fixed master seed
+        keycap::random::stream_registry const registry{0x0F1E2D3C4B5A6978};
+        auto stream = registry.stream(0);
+        sz index = 0;
+        while (index < 100'000 && xoroshiro128plus{stream}() != before)
+        {
+            stream.long_jump();
+            ++index;
+        }
+        REQUIRE(index < 100'000);
+
+        stream.long_jump();
+        REQUIRE(xoroshiro128plus{stream}() == after);
+    }
+
+    SECTION("Streams handed out in order equal streams looked up by index")
+    {
+        keycap::random::stream_registry registry{0xDECAFBAD};
+
+        for (u64 index = 0; index < 4; ++index)
+            REQUIRE(registry.next_stream() == registry.stream(index));
+
+        auto expected = registry.stream(1);
+        expected.long_jump();
+        REQUIRE(registry.stream(2) == expected);
+        REQUIRE(registry.stream(0) == xoroshiro128plus{0xDECAFBAD});
+    }
+
+    SECTION("Tasks are reproducible regardless of which thread runs them")
+    {
+        keycap::random::stream_registry const registry{7};
+
+        auto const run_task = [&registry](u64 task) {
+            keycap::random::use_stream(registry.stream(task));
+
+            std::vector<u32> values(100);
+            keycap::random::fill(std::span{values}, 0, 1'000);
+            values.push_back(keycap::random::random_u32());
+            return values;
+        };
+
+        std::array<std::vector<u32>, 3> sequential;
+        for (u64 task = 0; task < sequential.size(); ++task)
+            sequential[task] = run_task(task);
+
+        std::array<std::vector<u32>, 3> parallel;
+        std::vector<std::thread> threads;
+        for (u64 task = sequential.size(); task-- > 0;)
+            threads.emplace_back([&, task] { parallel[task] = run_task(task); });
+
+        for (auto& thread : threads)
+            thread.join();
+
+        REQUIRE(parallel == sequential);
+        REQUIRE(sequential[0] != sequential[1]);
+
+        keycap::random::use_stream(registry.stream(2));
+        auto engine = registry.stream(2);
+        REQUIRE(keycap::random::random_u64() == engine());
+    }
+}
+
+TEST_CASE("Random engines", "[keycap.core:random]")
+{
+    using namespace keycap::random;
+
+    STATIC_REQUIRE(random_engine<xoroshiro128plus>);
+    STATIC_REQUIRE(random_engine<xoshiro256starstar>);
+    STATIC_REQUIRE(random_engine<pcg64>);
+    STATIC_REQUIRE(random_engine<wyrand>);
+    STATIC_REQUIRE_FALSE(random_engine<std::mt19937>);
+
+    SECTION("Engines match their reference implementations")
+    {
+        pcg64 pcg{42, 54};
+        REQUIRE(pcg() == 0x86b1da1d72062b68);
+        REQUIRE(pcg() == 0x1304aa46c9853d39);
+        REQUIRE(pcg() == 0xa3670e9e0dd50358);
+        REQUIRE(pcg() == 0xf9090e529a7dae00);
+        REQUIRE(pcg() == 0xc85b9fd837996f2c);
+
+        wyrand wy{42};
+        REQUIRE(wy() == 0xca71d87c76983989);
+        REQUIRE(wy() == 0x7e5ba61552085fc6);
+        REQUIRE(wy() == 0xcdf101e3bab88b9f);
+
+        xoshiro256starstar xoshiro{42};
+        REQUIRE(xoshiro() == 0x15780b2e0c2ec716);
+
+        xoshiro256starstar jumped{42};
+        jumped.jump();
+        REQUIRE(jumped.state() ==
+                std::array<u64, 4>{0x81746704fde896b5, 0x645e944932dae0ae, 0xf4776829231c282c, 0x2393f9798732dba1});
+    }
+
+    SECTION("Distinct pcg64 streams yield distinct sequences")
+    {
+        pcg64 first{42, 1};
+        pcg64 second{42, 2};
+        REQUIRE(first() != second());
+        REQUIRE(pcg64{42} == pcg64{42});
+        REQUIRE(pcg64{42, 1} != pcg64{42, 2});
+    }
+
+    SECTION("random_* functions produce the same values from an explicit engine as from the thread's engine")
+    {
+        seed(5);
+        xoroshiro128plus engine{5};
+
+        REQUIRE(random_u32() == random_u32(engine));
+        REQUIRE(random_i16(-10, 10) == random_i16(engine, -10, 10));
+        REQUIRE(random_f64(1.0, 2.0) == random_f64(engine, 1.0, 2.0));
+        REQUIRE(random_u64() == random_u64(engine));
+    }
+
+    SECTION("Filling from an explicit engine is deterministic and respects the bounds")
+    {
+        std::vector<i32> first(1'000);
+        std::vector<i32> second(1'000);
+
+        pcg64 engine{3};
+        fill(engine, std::span{first}, -5, 5);
+        engine.seed(3);
+        fill(engine, std::span{second}, -5, 5);
+
+        REQUIRE(first == second);
+        REQUIRE(std::ranges::all_of(first, [](i32 value) { return value >= -5 && value <= 5; }));
+
+        std::vector<f32> floats(1'000);
+        wyrand wy{3};
+        fill(wy, std::span{floats});
+        REQUIRE(std::ranges::all_of(floats, [](f32 value) { return value >= 0.0f && value < 1.0f; }));
+    }
+}
+
+namespace
+{
+    /// <summary>
+    /// A deliberately poor engine: a 64-bit LCG whose lower bits have very short periods
+    /// </summary>
+    struct weak_engine
+    {
+        using result_type = u64;
+
+        u64 operator()() noexcept
+        {
+            state = state * 6364136223846793005 + 1;
+            return state;
+        }
+
+        static constexpr u64 min() noexcept
+        {
+            return 0;
+        }
+
+        static constexpr u64 max() noexcept
+        {
+            return std::numeric_limits<u64>::max();
+        }
+
+        u64 state = 42;
+    };
+}
+
+TEMPLATE_TEST_CASE("Statistical quality of random engines", "[keycap.core:random]", keycap::random::xoroshiro128plus,
+                   keycap::random::xoshiro256starstar, keycap::random::pcg64, keycap::random::wyrand)
+{
+    TestType engine{0xC0FFEE};
+
+    for (auto const& result : keycap::random::run_statistical_battery(engine))
+    {
+        INFO(result.name << ": statistic " << result.statistic << ", p-value " << result.p_value);
+        REQUIRE(result.passed());
+    }
+}
+
+TEST_CASE("The statistical battery detects poor engines", "[keycap.core:random]")
+{
+    weak_engine engine;
+
+    auto const results = keycap::random::run_statistical_battery(engine);
+    REQUIRE(std::ranges::any_of(results, [](auto const& result) { return !result.passed(); }));
+
+    auto const lower_bits = keycap::random::birthday_spacings_test(engine, 0);
+    REQUIRE_FALSE(lower_bits.passed());
+}
+
+TEST_CASE("alias_table", "[keycap.core:sampling]")
+{
+    using keycap::random::alias_table;
+
+    SECTION("Invalid weights are rejected")
+    {
+        REQUIRE(error_of([] { alias_table{std::vector<f64>{}}; }) == keycap::error_code::invalid_argument);
+        REQUIRE(error_of([] { alias_table{1.0, -1.0}; }) == keycap::error_code::invalid_argument);
+        REQUIRE(error_of([] { alias_table{0.0, 0.0}; }) == keycap::error_code::invalid_argument);
+        REQUIRE(error_of([] { alias_table{1.0, std::numeric_limits<f64>::quiet_NaN()}; }) ==
+                keycap::error_code::invalid_argument);
+        REQUIRE(error_of([] { alias_table{1.0, std::numeric_limits<f64>::infinity()}; }) ==
+                keycap::error_code::invalid_argument);
+    }
+
+    SECTION("Indices are drawn proportionally to their weights")
+    {
+        std::vector<int> const weights{1, 0, 2, 3, 4};
+        alias_table const table{weights};
+        REQUIRE(table.size() == weights.size());
+
+        keycap::random::xoshiro256starstar engine{1};
+        std::array<int, 5> counts{};
+        constexpr int draws = 1'000'000;
+        for (int i = 0; i < draws; ++i)
+            ++counts[table(engine)];
+
+        REQUIRE(counts[1] == 0);
+        for (sz i = 0; i < weights.size(); ++i)
+        {
+            auto const expected = draws * weights[i] / 10.0;
+            REQUIRE(std::abs(counts[i] - expected) < 0.01 * draws);
+        }
+    }
+
+    SECTION("A single weight is always drawn")
+    {
+        alias_table const table{0.5};
+        for (int i = 0; i < 100; ++i)
+            REQUIRE(table() == 0);
+    }
+
+    SECTION("Draws only depend on the engine")
+    {
+        alias_table const table{std::views::iota(1, 100)};
+
+        keycap::random::pcg64 first{7};
+        keycap::random::pcg64 second{7};
+        for (int i = 0; i < 100; ++i)
+            REQUIRE(table(first) == table(second));
+    }
+}
+
+TEST_CASE("reservoir_sampler", "[keycap.core:sampling]")
+{
+    using keycap::random::reservoir_sampler;
+    using keycap::random::xoroshiro128plus;
+
+    REQUIRE(error_of([] { reservoir_sampler<int>{0}; }) == keycap::error_code::invalid_argument);
+
+    SECTION("Short streams are kept entirely")
+    {
+        reservoir_sampler<std::string> sampler{5};
+        sampler.push("a");
+        sampler.push(std::string{"b"});
+
+        REQUIRE(sampler.seen() == 2);
+        REQUIRE(std::ranges::equal(sampler.sample(), std::vector<std::string>{"a", "b"}));
+
+        sampler.clear();
+        REQUIRE(sampler.seen() == 0);
+        REQUIRE(sampler.sample().empty());
+    }
+
+    SECTION("Every value is equally likely to be sampled")
+    {
+        constexpr int stream = 20;
+        constexpr int trials = 100'000;
+        std::array<int, stream> counts{};
+
+        reservoir_sampler<int, xoroshiro128plus> sampler{4, xoroshiro128plus{3}};
+        for (int trial = 0; trial < trials; ++trial)
+        {
+            sampler.clear();
+            for (int value = 0; value < stream; ++value)
+                sampler.push(value);
+
+            REQUIRE(sampler.sample().size() == 4);
+            for (auto const value : sampler.sample())
+                ++counts[static_cast<sz>(value)];
+        }
+
+        for (auto const count : counts)
+            REQUIRE(std::abs(count - trials * 4 / stream) < trials / 100);
+    }
+
+    SECTION("push_range skips through random access ranges like pushing every value does")
+    {
+        std::vector<u64> values(100'000);
+        std::iota(values.begin(), values.end(), 0);
+
+        reservoir_sampler<u64, xoroshiro128plus> pushed{16, xoroshiro128plus{9}};
+        for (auto const value : values)
+            pushed.push(value);
+
+        reservoir_sampler<u64, xoroshiro128plus> ranged{16, xoroshiro128plus{9}};
+        ranged.push_range(std::span{values}.first(5));
+        ranged.push_range(std::span{values}.subspan(5));
+
+        REQUIRE(ranged.seen() == values.size());
+        REQUIRE(std::ranges::equal(ranged.sample(), pushed.sample()));
+
+        reservoir_sampler<u64, xoroshiro128plus> streamed{16, xoroshiro128plus{9}};
+        streamed.push_range(values | std::views::filter([](u64) { return true; }));
+        REQUIRE(std::ranges::equal(streamed.sample(), pushed.sample()));
+    }
+}
+
+TEST_CASE("shuffle", "[keycap.core:sampling]")
+{
+    SECTION("Shuffling permutes the values")
+    {
+        for (sz size : std::array<sz, 6>{0, 1, 2, 7, 1'000, 300'000})
+        {
+            std::vector<u32> values(size);
+            std::iota(values.begin(), values.end(), 0u);
+
+            keycap::random::shuffle(std::span{values});
+
+            std::vector<u32> sorted = values;
+            std::ranges::sort(sorted);
+            REQUIRE(std::ranges::equal(sorted, std::views::iota(0u, static_cast<u32>(size))));
+        }
+    }
+
+    SECTION("Shuffles only depend on the engine")
+    {
+        std::vector<int> first(1'000);
+        std::iota(first.begin(), first.end(), 0);
+        auto second = first;
+
+        keycap::random::wyrand engine{5};
+        keycap::random::shuffle(engine, std::span{first});
+        engine.seed(5);
+        keycap::random::shuffle(engine, std::span{second});
+
+        REQUIRE(first == second);
+    }
+
+    SECTION("Every permutation is equally likely")
+    {
+        constexpr int trials = 240'000;
+        std::map<std::array<int, 4>, int> counts;
+
+        keycap::random::xoroshiro128plus engine{11};
+        for (int trial = 0; trial < trials; ++trial)
+        {
+            std::array<int, 4> values{0, 1, 2, 3};
+            keycap::random::shuffle(engine, std::span{values});
+            ++counts[values];
+        }
+
+        REQUIRE(counts.size() == 24);
+        for (auto const& [permutation, count] : counts)
+            REQUIRE(std::abs(count - trials / 24) < trials / 24 / 20);
+    }
+
+    SECTION("Every position is equally likely across batches")
+    {
+        constexpr int size = 200;
+        constexpr int trials = 50'000;
+        std::array<int, size> first_positions{};
+
+        keycap::random::pcg64 engine{13};
+        std::vector<int> values(size);
+        for (int trial = 0; trial < trials; ++trial)
+        {
+            std::iota(values.begin(), values.end(), 0);
+            keycap::random::shuffle(engine, std::span{values});
+            ++first_positions[static_cast<sz>(values[0])];
+        }
+
+        for (auto const count : first_positions)
+            REQUIRE(std::abs(count - trials / size) < 80);
+    }
+}
+
+TEMPLATE_TEST_CASE("grid", "[keycap.core:grid]", keycap::row_major_layout, (keycap::tiled_layout<4, 2>),
+                   (keycap::tiled_layout<4, 4, 2>), keycap::morton_layout)
+{
+    using grid = keycap::grid<int, TestType>;
+    STATIC_REQUIRE(keycap::std_container<grid>);
+
+    SECTION("Every cell can be addressed by its coordinates")
+    {
+        constexpr u32 width = 13, height = 9, depth = 5;
+        grid cells{width, height, depth, -1};
+        REQUIRE(cells.cell_count() == width * height * depth);
+        REQUIRE(cells.size() >= cells.cell_count());
+
+        int value = 0;
+        for (u32 z = 0; z < depth; ++z)
+        {
+            for (u32 y = 0; y < height; ++y)
+            {
+                for (u32 x = 0; x < width; ++x)
+                    cells(x, y, z) = value++;
+            }
+        }
+
+        value = 0;
+        for (u32 z = 0; z < depth; ++z)
+        {
+            for (u32 y = 0; y < height; ++y)
+            {
+                for (u32 x = 0; x < width; ++x)
+                {
+                    REQUIRE(cells.at(x, y, z) == value++);
+                    auto const index = cells.layout().index(x, y, z);
+                    REQUIRE(cells.layout().coordinates(index) == std::array{x, y, z});
+                }
+            }
+        }
+
+        // Everything else is padding
+        REQUIRE(std::ranges::count(cells, -1) == static_cast<std::ptrdiff_t>(cells.size() - cells.cell_count()));
+    }
+
+    SECTION("The storage is aligned to a cache-line")
+    {
+        grid const cells{7, 3};
+        REQUIRE(reinterpret_cast<std::uintptr_t>(cells.data()) % 64 == 0);
+    }
+
+    SECTION("at() throws if the coordinates lie outside of the grid")
+    {
+        grid cells{4, 3};
+        REQUIRE(error_of([&] { (void)cells.at(4, 0); }) == keycap::error_code::buffer_overflow);
+        REQUIRE(error_of([&] { (void)cells.at(0, 3); }) == keycap::error_code::buffer_overflow);
+        REQUIRE(error_of([&] { (void)cells.at(0, 0, 1); }) == keycap::error_code::buffer_overflow);
+        REQUIRE_FALSE(error_of([&] { (void)cells.at(3, 2); }));
+    }
+
+    SECTION("Copies compare equal until either is modified")
+    {
+        grid cells{5, 5};
+        cells(2, 3) = 7;
+
+        auto copy = cells;
+        REQUIRE(copy == cells);
+
+        copy(2, 3) = 8;
+        REQUIRE(copy != cells);
+
+        grid other;
+        REQUIRE(other.empty());
+        swap(other, copy);
+        REQUIRE(copy.empty());
+        REQUIRE(other(2, 3) == 8);
+        REQUIRE(other != grid{5, 6});
+    }
+
+    SECTION("Rows visit the cells of a row in order")
+    {
+        grid cells{6, 4, 2};
+        cells(0, 2, 1) = 1;
+        cells(5, 2, 1) = 2;
+
+        auto const row = cells.row(2, 1);
+        REQUIRE(std::ranges::size(row) == 6);
+        REQUIRE(row[0] == 1);
+        REQUIRE(row[5] == 2);
+
+        int count = 0;
+        for (auto&& r : cells.rows(1))
+        {
+            for (auto& cell : r)
+                cell = count++;
+        }
+        REQUIRE(count == 24);
+        REQUIRE(cells(5, 3, 1) == 23);
+        REQUIRE(cells(5, 3, 0) == 0);
+    }
+
+    SECTION("Neighborhoods stay within the grid")
+    {
+        auto const neighbors = [](grid const& cells, u32 x, u32 y, u32 z, keycap::neighborhood kind) {
+            int count = 0;
+            cells.for_each_neighbor(x, y, z, kind, [&](int const& cell, u32 nx, u32 ny, u32 nz) {
+                REQUIRE(&cell == &cells(nx, ny, nz));
+                REQUIRE(std::max({nx, x}) - std::min({nx, x}) <= 1);
+                REQUIRE(std::max({ny, y}) - std::min({ny, y}) <= 1);
+                REQUIRE(std::max({nz, z}) - std::min({nz, z}) <= 1);
+                ++count;
+            });
+            return count;
+        };
+
+        using enum keycap::neighborhood;
+
+        grid const flat{5, 4};
+        REQUIRE(neighbors(flat, 2, 2, 0, von_neumann) == 4);
+        REQUIRE(neighbors(flat, 2, 2, 0, moore) == 8);
+        REQUIRE(neighbors(flat, 0, 0, 0, von_neumann) == 2);
+        REQUIRE(neighbors(flat, 0, 0, 0, moore) == 3);
+        REQUIRE(neighbors(flat, 4, 2, 0, moore) == 5);
+
+        grid const volume{5, 4, 3};
+        REQUIRE(neighbors(volume, 2, 2, 1, von_neumann) == 6);
+        REQUIRE(neighbors(volume, 2, 2, 1, moore) == 26);
+        REQUIRE(neighbors(volume, 0, 0, 0, moore) == 7);
+        REQUIRE(neighbors(volume, 4, 3, 2, von_neumann) == 3);
+    }
+}
+
+TEST_CASE("grid rows and tiles", "[keycap.core:grid]")
+{
+    SECTION("Rows of a row-major grid are contiguous")
+    {
+        keycap::grid<f32> cells{7, 3};
+        std::span<f32> const row = cells.row(1);
+        REQUIRE(row.data() == &cells(0, 1));
+        REQUIRE(row.size() == 7);
+    }
+
+    SECTION("Tiles are contiguous and cover the whole storage")
+    {
+        keycap::grid<int, keycap::tiled_layout<4, 2>> cells{10, 5};
+        REQUIRE(cells.size() == 3 * 3 * 8);
+
+        auto const tile = cells.tile(5, 3);
+        REQUIRE(tile.size() == 8);
+        REQUIRE(tile.data() == &cells(4, 2));
+        REQUIRE(&tile[7] == &cells(7, 3));
+
+        sz covered = 0;
+        for (auto const t : cells.tiles())
+        {
+            auto const [x, y, z] = cells.layout().coordinates(static_cast<u64>(t.data() - cells.data()));
+            REQUIRE(x % 4 == 0);
+            REQUIRE(y % 2 == 0);
+            REQUIRE(t.data() == cells.tile(x, y, z).data());
+            covered += t.size();
+        }
+        REQUIRE(covered == cells.size());
+    }
+
+    SECTION("Three-dimensional Morton layouts are limited to 2^21 cells per dimension")
+    {
+        REQUIRE(error_of([] { keycap::grid<u8, keycap::morton_layout>{(1u << 21) + 1, 1, 2}; }) ==
+                keycap::error_code::invalid_argument);
+        REQUIRE(keycap::grid<u8, keycap::morton_layout>{4, 4}.size() == 16);
+        REQUIRE(keycap::grid<u8, keycap::morton_layout>{4, 4, 4}.size() == 64);
+    }
+}
+
+TEST_CASE("thread_pool", "[keycap.core:parallel]")
+{
+    auto const thread_count = GENERATE(sz{1}, sz{4});
+    keycap::thread_pool pool{thread_count};
+    REQUIRE(pool.thread_count() == thread_count);
+    REQUIRE_FALSE(pool.worker_index());
+
+    SECTION("Tasks return their results through their handles")
+    {
+        std::vector<keycap::task_handle<int>> handles;
+        for (int i = 0; i < 1'000; ++i)
+            handles.push_back(pool.submit([i] { return i * i; }));
+
+        for (sz i = 0; i < 1'000; ++i)
+            REQUIRE(handles[i].get() == static_cast<int>(i * i));
+    }
+
+    SECTION("Exceptions are rethrown by get")
+    {
+        auto handle = pool.submit([]() -> int { throw std::runtime_error{"task failed"}; });
+        REQUIRE_THROWS_AS(handle.get(), std::runtime_error);
+    }
+
+    SECTION("Tasks run even if their handles are dropped")
     {
-        constexpr i32 expected = 0x67c75170;
-        REQUIRE(keycap::random::random_i32() == expected);
+        std::atomic<int> counter = 0;
+        for (int i = 0; i < 100; ++i)
+            (void)pool.submit([&] { ++counter; });
+
+        pool.submit([] {}).wait();
+        while (counter < 100)
+            std::this_thread::yield();
+        REQUIRE(counter == 100);
     }
 
-    SECTION("u16")
+    SECTION("Tasks can wait for tasks they submitted")
     {
-        constexpr u16 expected = 4669;
-        REQUIRE(keycap::random::random_u16() == expected);
+        auto const fibonacci = [&pool](auto const& self, int n) -> int {
+            if (n < 2)
+                return n;
+
+            auto lower = pool.submit([&] { return self(self, n - 2); });
+            auto const upper = self(self, n - 1);
+            return upper + lower.get();
+        };
+
+        REQUIRE(pool.submit([&] { return fibonacci(fibonacci, 18); }).get() == 2584);
     }
 
-    SECTION("i16")
+    SECTION("Workers know their index")
     {
-        constexpr i16 expected = 3320;
-        REQUIRE(keycap::random::random_i16() == expected);
+        auto const index = pool.submit([&] { return pool.worker_index(); }).get();
+        REQUIRE(index);
+        REQUIRE(*index < thread_count);
     }
 
-    SECTION("u8")
+    SECTION("Queued tasks finish before the pool is destroyed")
     {
-        constexpr u8 expected = 88;
-        REQUIRE((int)keycap::random::random_u8() == (int)expected);
+        std::atomic<int> counter = 0;
+        {
+            keycap::thread_pool local{2};
+            for (int i = 0; i < 1'000; ++i)
+                (void)local.submit([&] { ++counter; });
+        }
+        REQUIRE(counter == 1'000);
     }
 
-    SECTION("i8")
+    REQUIRE(error_of([] { keycap::thread_pool{0}; }) == keycap::error_code::invalid_argument);
+}
+
+TEST_CASE("Every worker draws from its own reproducible stream", "[keycap.core:parallel]")
+{
+    constexpr sz thread_count = 4;
+
+    // Blocks every worker in a barrier, so that each runs exactly one task
+    auto const first_values = [](std::optional<u64> seed) {
+        keycap::thread_pool pool{thread_count, seed};
+        std::barrier barrier{static_cast<std::ptrdiff_t>(thread_count)};
+
+        std::vector<keycap::task_handle<std::pair<sz, u64>>> handles;
+        for (sz i = 0; i < thread_count; ++i)
+        {
+            handles.push_back(pool.submit([&] {
+                barrier.arrive_and_wait();
+                return std::pair{*pool.worker_index(), keycap::random::random_u64()};
+            }));
+        }
+
+        std::map<sz, u64> values;
+        for (auto& handle : handles)
+            values.insert(handle.get());
+        return values;
+    };
+
+    auto const values = first_values(42);
+    REQUIRE(values.size() == thread_count);
+    REQUIRE(first_values(42) == values);
+    REQUIRE(first_values(43) != values);
+
+    // Pools without a seed draw from streams no other pool or thread uses
+    REQUIRE(first_values(std::nullopt) != first_values(std::nullopt));
+
+    std::unordered_set<u64> distinct;
+    for (auto const& [worker, value] : values)
+        distinct.insert(value);
+    REQUIRE(distinct.size() == thread_count);
+}
+
+TEST_CASE("Parallel algorithms", "[keycap.core:parallel]")
+{
+    auto const thread_count = GENERATE(sz{1}, sz{3});
+    keycap::thread_pool pool{thread_count};
+
+    auto const grain = GENERATE(sz{0}, sz{1}, sz{7}, sz{100'000});
+    constexpr sz size = 10'007;
+
+    SECTION("parallel_for visits every element exactly once")
     {
-        constexpr i8 expected = 102;
-        REQUIRE((int)keycap::random::random_i8() == (int)expected);
+        std::vector<std::atomic<int>> visits(size);
+        keycap::parallel_for(pool, visits, [](std::atomic<int>& visit) { ++visit; }, grain);
+        REQUIRE(std::ranges::all_of(visits, [](auto const& visit) { return visit == 1; }));
+
+        std::vector<u64> squares(size);
+        keycap::parallel_for(
+            pool, std::views::iota(sz{0}, size), [&](sz i) { squares[i] = u64{i} * i; }, grain);
+        for (sz i = 0; i < size; ++i)
+            REQUIRE(squares[i] == u64{i} * i);
     }
 
-    SECTION("seeded u64")
+    SECTION("parallel_for rethrows exceptions once every chunk is done")
     {
-        keycap::random::seed(0xABBAB33FAC1D4689);
+        std::atomic<sz> visited = 0;
+        auto const visit = [&](sz i) {
+            ++visited;
+            if (i == 5'000)
+                throw std::runtime_error{"element failed"};
+        };
+        REQUIRE_THROWS_AS(keycap::parallel_for(pool, std::views::iota(sz{0}, size), visit, grain), std::runtime_error);
+    }
 
-        constexpr u64 expected = 0x2596b32dc4a79b6a;
-        REQUIRE(keycap::random::random_u64() == expected);
+    SECTION("parallel_reduce matches std::accumulate")
+    {
+        std::vector<u64> values(size);
+        std::iota(values.begin(), values.end(), u64{1});
+        REQUIRE(keycap::parallel_reduce(pool, values, u64{0}, std::plus<>{}, grain) == u64{size} * (size + 1) / 2);
+
+        auto const maximum = [](u64 a, u64 b) { return std::max(a, b); };
+        REQUIRE(keycap::parallel_reduce(pool, values, u64{0}, maximum, grain) == size);
+        REQUIRE(keycap::parallel_reduce(pool, std::span<u64>{}, u64{3}, std::plus<>{}, grain) == 3);
     }
 
-    SECTION("seeded i64")
+    SECTION("parallel_sort sorts")
     {
-        keycap::random::seed(0xABBAB33FAC1D4689);
+        std::mt19937 engine{11};
+        std::vector<u32> values(size);
+        std::ranges::generate(values, [&] { return engine() % 1'000; });
+
+        auto expected = values;
+        std::ranges::sort(expected, std::greater<>{});
+        keycap::parallel_sort(pool, values, std::greater<>{}, grain);
+        REQUIRE(values == expected);
+    }
+}
 
-        constexpr i64 expected = -6514822801790624918;
-        REQUIRE(keycap::random::random_i64() == expected);
+TEST_CASE("parallel_reduce does not depend on the number of workers", "[keycap.core:parallel]")
+{
+    std::vector<f64> values(100'000);
+    std::mt19937_64 engine{5};
+    std::uniform_real_distribution<f64> distribution{-1e6, 1e6};
+    std::ranges::generate(values, [&] { return distribution(engine); });
+
+    auto const sum = [&](sz thread_count) {
+        keycap::thread_pool pool{thread_count};
+        return keycap::parallel_reduce(pool, values, 0.0, std::plus<>{}, 1'000);
+    };
+
+    auto const expected = sum(1);
+    REQUIRE(sum(2) == expected);
+    REQUIRE(sum(5) == expected);
+    REQUIRE(keycap::parallel_reduce(values, 0.0, std::plus<>{}, 1'000) == expected);
+}
+
+TEMPLATE_TEST_CASE("Bounded queues", "[keycap.core:queue]", keycap::spsc_queue<int>, keycap::mpmc_queue<int>)
+{
+    SECTION("Elements come out in the order they went in")
+    {
+        TestType queue{5};
+        REQUIRE(queue.capacity() == 8);
+        REQUIRE(queue.empty());
+
+        for (int i = 0; i < 8; ++i)
+            REQUIRE(queue.try_push(i));
+        REQUIRE_FALSE(queue.try_push(8));
+        REQUIRE(queue.size() == 8);
+
+        for (int i = 0; i < 8; ++i)
+            REQUIRE(queue.try_pop() == i);
+        REQUIRE_FALSE(queue.try_pop());
+        REQUIRE(queue.empty());
     }
 
-    SECTION("seeded u32")
+    SECTION("Bulk operations transfer as much as possible")
     {
-        keycap::random::seed(0xABBAB33FAC1D4689);
+        TestType queue{8};
+        std::array const values{1, 2, 3, 4, 5, 6};
+        REQUIRE(queue.try_push_bulk(values) == 6);
+        REQUIRE(queue.try_push_bulk(values) == 2);
+        REQUIRE(queue.try_push_bulk(values) == 0);
+
+        std::array<int, 5> output{};
+        REQUIRE(queue.try_pop_bulk(output) == 5);
+        REQUIRE(output == std::array{1, 2, 3, 4, 5});
+        REQUIRE(queue.try_pop_bulk(output) == 3);
+        REQUIRE(std::ranges::equal(std::span{output}.first(3), std::array{6, 1, 2}));
+        REQUIRE(queue.try_pop_bulk(output) == 0);
+    }
 
-        constexpr u32 expected = 0xc4a79b6a;
-        REQUIRE(keycap::random::random_u32() == expected);
+    SECTION("Indices keep working after wrapping around")
+    {
+        TestType queue{4};
+        std::array<int, 3> output{};
+        for (int lap = 0; lap < 1'000; ++lap)
+        {
+            std::array const values{lap, lap + 1, lap + 2};
+            REQUIRE(queue.try_push_bulk(values) == 3);
+            REQUIRE(queue.try_pop() == lap);
+            REQUIRE(queue.try_pop_bulk(output) == 2);
+            REQUIRE(output[1] == lap + 2);
+        }
     }
 
-    SECTION("seeded i32")
+    REQUIRE(error_of([] { TestType{0}; }) == keycap::error_code::invalid_argument);
+}
+
+TEST_CASE("Bounded queues destroy the elements they still hold", "[keycap.core:queue]")
+{
+    auto const counter = std::make_shared<int>();
     {
-        keycap::random::seed(0xABBAB33FAC1D4689);
+        keycap::spsc_queue<std::shared_ptr<int>> spsc{4};
+        keycap::mpmc_queue<std::shared_ptr<int>> mpmc{4};
+        for (int i = 0; i < 3; ++i)
+        {
+            REQUIRE(spsc.try_push(counter));
+            REQUIRE(mpmc.try_emplace(counter));
+        }
+        REQUIRE(spsc.pop() == counter);
+        REQUIRE(mpmc.pop() == counter);
+        REQUIRE(counter.use_count() == 5);
+    }
+    REQUIRE(counter.use_count() == 1);
+}
 
-        constexpr i32 expected = 0x44a79b6a;
-        REQUIRE(keycap::random::random_i32() == expected);
+TEST_CASE("spsc_queue under stress", "[keycap.core:queue]")
+{
+    constexpr u64 count = 200'000;
+    keycap::spsc_queue<u64> queue{64};
+
+    std::thread producer{[&] {
+        std::array<u64, 16> batch{};
+        for (u64 i = 0; i < count;)
+        {
+            if (i % 3 == 0 && count - i >= batch.size())
+            {
+                std::iota(batch.begin(), batch.end(), i);
+                queue.push_bulk(batch);
+                i += batch.size();
+            }
+            else
+            {
+                queue.push(i++);
+            }
+        }
+    }};
+
+    u64 expected = 0;
+    std::array<u64, 10> output{};
+    while (expected < count)
+    {
+        if (expected % 2 == 0)
+        {
+            REQUIRE(queue.pop() == expected);
+            ++expected;
+        }
+        else
+        {
+            auto const popped = queue.pop_bulk(output);
+            for (sz i = 0; i < popped; ++i)
+                REQUIRE(output[i] == expected++);
+        }
     }
 
-    SECTION("seeded u16")
+    producer.join();
+    REQUIRE(queue.empty());
+}
+
+TEST_CASE("mpmc_queue under stress", "[keycap.core:queue]")
+{
+    constexpr u64 producers = 3;
+    constexpr u64 consumers = 3;
+    constexpr u64 per_producer = 50'000;
+    keycap::mpmc_queue<u64> queue{32};
+
+    // Every element encodes its producer in the upper bits and its position in the lower bits
+    std::vector<std::thread> threads;
+    for (u64 p = 0; p < producers; ++p)
     {
-        keycap::random::seed(0xABBAB33FAC1D4689);
+        threads.emplace_back([&, p] {
+            std::array<u64, 8> batch{};
+            for (u64 i = 0; i < per_producer;)
+            {
+                if (i % 5 == 0 && per_producer - i >= batch.size())
+                {
+                    for (auto& value : batch)
+                        value = (p << 32) | i++;
+                    queue.push_bulk(batch);
+                }
+                else
+                {
+                    queue.push((p << 32) | i++);
+                }
+            }
+        });
+    }
 
-        constexpr u16 expected = 39786;
-        REQUIRE(keycap::random::random_u16() == expected);
+    std::vector<std::vector<u64>> received(consumers);
+    std::atomic<u64> remaining = producers * per_producer;
+    for (u64 c = 0; c < consumers; ++c)
+    {
+        threads.emplace_back([&, c] {
+            std::array<u64, 7> output{};
+            while (remaining.load() > 0)
+            {
+                auto const popped = queue.try_pop_bulk(output);
+                if (popped == 0)
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                received[c].insert(received[c].end(), output.begin(), output.begin() + popped);
+                remaining -= popped;
+            }
+        });
     }
 
-    SECTION("seeded i16")
+    for (auto& thread : threads)
+        thread.join();
+
+    std::vector<u64> all;
+    for (auto const& values : received)
     {
-        keycap::random::seed(0xABBAB33FAC1D4689);
+        // Elements of a single producer keep their order
+        std::array<std::optional<u64>, producers> last{};
+        for (auto const value : values)
+        {
+            auto& previous = last[value >> 32];
+            REQUIRE((!previous || *previous < (value & 0xFFFF'FFFF)));
+            previous = value & 0xFFFF'FFFF;
+        }
+        all.insert(all.end(), values.begin(), values.end());
+    }
 
-        constexpr i16 expected = 7018;
-        REQUIRE(keycap::random::random_i16() == expected);
+    std::ranges::sort(all);
+    REQUIRE(all.size() == producers * per_producer);
+    REQUIRE(std::ranges::adjacent_find(all) == all.end());
+    REQUIRE(queue.empty());
+}
+
+TEST_CASE("Blocking on bounded queues", "[keycap.core:queue]")
+{
+    keycap::mpmc_queue<int> requests{1};
+    keycap::spsc_queue<int> responses{1};
+
+    // Both threads spend most of their time asleep on an empty or full queue
+    std::thread server{[&] {
+        while (true)
+        {
+            auto const request = requests.pop();
+            if (request < 0)
+                break;
+            responses.push(request * 2);
+        }
+    }};
+
+    for (int i = 0; i < 2'000; ++i)
+    {
+        requests.push(i);
+        REQUIRE(responses.pop() == i * 2);
     }
 
-    SECTION("seeded u8")
+    requests.push(-1);
+    server.join();
+}
+
+namespace
+{
+    /// <summary>
+    /// Forwards to the default resource and counts the allocations that are still outstanding
+    /// </summary>
+    struct counting_resource : std::pmr::memory_resource
     {
-        keycap::random::seed(0xABBAB33FAC1D4689);
+        int allocations = 0;
+        int outstanding = 0;
 
-        constexpr u8 expected = 37;
-        REQUIRE((int)keycap::random::random_u8() == (int)expected);
+      protected:
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override
+        {
+            ++allocations;
+            ++outstanding;
+            return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        }
+
+        void do_deallocate(void* memory, std::size_t bytes, std::size_t alignment) override
+        {
+            --outstanding;
+            std::pmr::new_delete_resource()->deallocate(memory, bytes, alignment);
+        }
+
+        bool do_is_equal(std::pmr::memory_resource const& other) const noexcept override
+        {
+            return this == &other;
+        }
+    };
+
+    bool is_aligned(void const* memory, std::size_t alignment)
+    {
+        return reinterpret_cast<std::uintptr_t>(memory) % alignment == 0;
     }
+}
 
-    SECTION("seeded i8")
+TEST_CASE("arena_resource", "[keycap.core:memory]")
+{
+    counting_resource upstream;
+
+    SECTION("Allocations are aligned and do not overlap")
     {
-        keycap::random::seed(0xABBAB33FAC1D4689);
+        keycap::arena_resource arena{&upstream};
+        std::vector<std::pair<std::byte*, std::size_t>> blocks;
+        for (std::size_t i = 0; i < 1'000; ++i)
+        {
+            auto const bytes = 1 + i % 37;
+            auto const alignment = std::size_t{1} << (i % 7);
+            auto* memory = static_cast<std::byte*>(arena.allocate(bytes, alignment));
+            REQUIRE(is_aligned(memory, alignment));
+            std::memset(memory, static_cast<int>(i), bytes);
+            blocks.emplace_back(memory, bytes);
+        }
 
-        constexpr i8 expected = -91;
-        REQUIRE((int)keycap::random::random_i8() == (int)expected);
+        std::ranges::sort(blocks);
+        for (std::size_t i = 1; i < blocks.size(); ++i)
+            REQUIRE(blocks[i - 1].first + blocks[i - 1].second <= blocks[i].first);
+    }
+
+    SECTION("The initial buffer is used before the upstream resource")
+    {
+        alignas(std::max_align_t) std::byte buffer[256];
+        keycap::arena_resource arena{buffer, &upstream};
+
+        auto* first = arena.allocate(100);
+        auto* second = arena.allocate(100);
+        REQUIRE(first == buffer);
+        REQUIRE(upstream.allocations == 0);
+        REQUIRE(arena.bytes_allocated() == 200);
+
+        auto* third = arena.allocate(100);
+        REQUIRE(third != nullptr);
+        REQUIRE(second != third);
+        REQUIRE(upstream.allocations == 1);
+        REQUIRE(arena.capacity() > sizeof(buffer));
+    }
+
+    SECTION("Resetting keeps the chunks for reuse")
+    {
+        keycap::arena_resource arena{&upstream};
+        for (int round = 0; round < 10; ++round)
+        {
+            for (int i = 0; i < 100; ++i)
+                (void)arena.allocate(100);
+            arena.reset();
+            REQUIRE(arena.bytes_allocated() == 0);
+        }
+
+        auto const warmed_up = upstream.allocations;
+        REQUIRE(warmed_up > 0);
+        for (int round = 0; round < 10; ++round)
+        {
+            for (int i = 0; i < 100; ++i)
+                (void)arena.allocate(100);
+            arena.reset();
+        }
+        REQUIRE(upstream.allocations == warmed_up);
+    }
+
+    SECTION("Allocations larger than a chunk get their own")
+    {
+        keycap::arena_resource arena{&upstream};
+        auto* large = arena.allocate(1 << 20, 64);
+        REQUIRE(is_aligned(large, 64));
+        std::memset(large, 0, 1 << 20);
+        REQUIRE(arena.capacity() >= (1 << 20));
+    }
+
+    SECTION("Releasing returns all chunks to the upstream resource")
+    {
+        {
+            keycap::arena_resource arena{&upstream};
+            for (int i = 0; i < 1'000; ++i)
+                (void)arena.allocate(100);
+            REQUIRE(upstream.outstanding > 0);
+
+            arena.release();
+            REQUIRE(upstream.outstanding == 0);
+            REQUIRE(arena.capacity() == 0);
+
+            (void)arena.allocate(100);
+        }
+        REQUIRE(upstream.outstanding == 0);
+    }
+
+    SECTION("inplace_arena_resource serves small requests without the upstream resource")
+    {
+        keycap::inplace_arena_resource<1024> arena{&upstream};
+        std::pmr::vector<int> values{&arena};
+        values.reserve(100);
+        std::ranges::fill_n(std::back_inserter(values), 100, 42);
+        REQUIRE(upstream.allocations == 0);
+    }
+}
+
+TEST_CASE("pool_resource", "[keycap.core:memory]")
+{
+    counting_resource upstream;
+
+    SECTION("Blocks are rounded up to the alignment")
+    {
+        keycap::pool_resource pool{20, 16, &upstream};
+        REQUIRE(pool.block_size() == 32);
+        REQUIRE(pool.block_alignment() == alignof(std::max_align_t));
+        REQUIRE(pool.upstream_resource() == &upstream);
+    }
+
+    SECTION("Freed blocks are reused")
+    {
+        keycap::pool_resource pool{32, 16, &upstream};
+        std::vector<void*> blocks;
+        for (int i = 0; i < 100; ++i)
+        {
+            blocks.push_back(pool.allocate(32));
+            REQUIRE(is_aligned(blocks.back(), alignof(std::max_align_t)));
+        }
+        REQUIRE(upstream.allocations == 7);
+
+        auto* last = blocks.back();
+        pool.deallocate(last, 32);
+        REQUIRE(pool.allocate(24) == last);
+
+        for (auto* block : blocks)
+            pool.deallocate(block, 32);
+        for (auto*& block : blocks)
+            block = pool.allocate(32);
+        REQUIRE(upstream.allocations == 7);
+
+        std::ranges::sort(blocks);
+        REQUIRE(std::ranges::adjacent_find(blocks) == blocks.end());
+    }
+
+    SECTION("Larger or stricter aligned allocations are forwarded")
+    {
+        keycap::pool_resource pool{32, 16, &upstream};
+        auto* large = pool.allocate(64);
+        auto* aligned = pool.allocate(32, 64);
+        REQUIRE(is_aligned(aligned, 64));
+        REQUIRE(upstream.allocations == 2);
+
+        pool.deallocate(large, 64);
+        pool.deallocate(aligned, 32, 64);
+        REQUIRE(upstream.outstanding == 0);
+    }
+
+    SECTION("Node-based containers allocate from the pool")
+    {
+        {
+            keycap::pool_resource pool{sizeof(std::map<int, int>::value_type) + 4 * sizeof(void*), 64, &upstream};
+            std::pmr::map<int, int> map{&pool};
+            for (int i = 0; i < 1'000; ++i)
+                map.emplace(i, i);
+            for (int i = 0; i < 1'000; i += 2)
+                map.erase(i);
+            for (int i = 0; i < 1'000; i += 2)
+                map.emplace(i, -i);
+
+            REQUIRE(map.size() == 1'000);
+            REQUIRE(map.at(998) == -998);
+            REQUIRE(upstream.allocations == 16);
+        }
+        REQUIRE(upstream.outstanding == 0);
+    }
+
+    SECTION("Invalid arguments")
+    {
+        REQUIRE(error_of([] { keycap::pool_resource{0}; }) == keycap::error_code::invalid_argument);
+        REQUIRE(error_of([] { keycap::pool_resource{8, 0}; }) == keycap::error_code::invalid_argument);
+        REQUIRE(error_of([&] { keycap::pool_resource{8, 8, &upstream, 3}; }) == keycap::error_code::invalid_argument);
+    }
+}
+
+TEST_CASE("Allocating strings from a memory_resource", "[keycap.core:memory]")
+{
+    counting_resource upstream;
+    keycap::arena_resource arena{&upstream};
+    std::string_view const input{"The Quick  Brown Fox jumps over the lazy dog, again and again and again"};
+
+    SECTION("split")
+    {
+        auto const tokens = keycap::pmr::split(input, " ", keycap::split_options::keep_empty, &arena);
+        auto const expected = keycap::split(input);
+        REQUIRE(std::ranges::equal(tokens, expected, std::equal_to<std::string_view>{}));
+        REQUIRE(tokens.get_allocator().resource() == &arena);
+        REQUIRE(tokens.back().get_allocator().resource() == &arena);
+        REQUIRE(keycap::pmr::split(input, ", ", keycap::split_options::skip_empty, &arena).size() == 2);
+    }
+
+    SECTION("join")
+    {
+        auto const tokens = keycap::pmr::split(input, " ", keycap::split_options::keep_empty, &arena);
+        auto const joined = keycap::pmr::join(tokens, " ", &arena);
+        REQUIRE(joined == input);
+        REQUIRE(joined.get_allocator().resource() == &arena);
+        REQUIRE(keycap::pmr::join(std::vector<std::string>{}, ", ", &arena).empty());
+    }
+
+    SECTION("to_lower and to_upper")
+    {
+        auto const lowered = keycap::pmr::to_lower(input, &arena);
+        auto const uppered = keycap::pmr::to_upper(input, &arena);
+        REQUIRE(std::string_view{lowered} == keycap::to_lower(std::string{input}));
+        REQUIRE(std::string_view{uppered} == keycap::to_upper(std::string{input}));
+        REQUIRE(lowered.get_allocator().resource() == &arena);
+    }
+
+    SECTION("from_byte_vector")
+    {
+        std::pmr::vector<u8> bytes{{0x78, 0x56, 0x34, 0x12}, &arena};
+        REQUIRE(keycap::from_byte_vector<u32>(bytes) == 0x12345678);
+    }
+
+    REQUIRE(arena.bytes_allocated() > 0);
+    REQUIRE(upstream.allocations <= 1);
+}
+
+namespace
+{
+    /// <summary>
+    /// Throws from its copy constructor once the shared number of remaining copies is used up. Its move constructor is
+    /// not noexcept, so containers copy it wherever they need the strong exception guarantee.
+    /// </summary>
+    struct fragile_copy
+    {
+        int value;
+        int* copies_left;
+
+        fragile_copy(int value_, int* copies_left_)
+          : value{value_}
+          , copies_left{copies_left_}
+        {
+        }
+
+        fragile_copy(fragile_copy const& other)
+          : value{other.value}
+          , copies_left{other.copies_left}
+        {
+            if ((*copies_left)-- == 0)
+                throw std::runtime_error{"Copy failed"};
+        }
+
+        fragile_copy(fragile_copy&& other) noexcept(false)
+          : value{other.value}
+          , copies_left{other.copies_left}
+        {
+        }
+    };
+}
+
+TEST_CASE("flat_map", "[keycap.core:flatmap]")
+{
+    using keycap::simd::instruction_set;
+    auto const set = GENERATE(instruction_set::scalar, instruction_set::sse2);
+    auto const previous = keycap::simd::limit_instruction_set(set);
+
+    SECTION("Behaves like std::unordered_map")
+    {
+        keycap::flat_map<u64, u64> map;
+        std::unordered_map<u64, u64> expected;
+
+        auto engine = keycap::random::xoroshiro128plus{42};
+        for (int i = 0; i < 50'000; ++i)
+        {
+            auto const key = engine() % 4'096;
+            switch (engine() % 4)
+            {
+                case 0:
+                case 1:
+                    REQUIRE(map.insert({key, i}).second == expected.insert({key, i}).second);
+                    break;
+                case 2:
+                    REQUIRE(map.erase(key) == expected.erase(key));
+                    break;
+                case 3:
+                    map[key] += 1;
+                    expected[key] += 1;
+                    break;
+            }
+
+            if (i % 5'000 == 0)
+            {
+                REQUIRE(map.size() == expected.size());
+                REQUIRE(std::ranges::distance(map) == static_cast<std::ptrdiff_t>(expected.size()));
+                for (auto const& [k, v] : map)
+                    REQUIRE(expected.at(k) == v);
+            }
+        }
+
+        for (auto const& [k, v] : expected)
+        {
+            REQUIRE(map.contains(k));
+            REQUIRE(map.at(k) == v);
+            REQUIRE(map.find(k)->second == v);
+        }
+        REQUIRE(map.size() == expected.size());
+        REQUIRE(map.load_factor() <= keycap::flat_map<u64, u64>::max_load_factor());
+    }
+
+    SECTION("Looking up strings without allocating")
+    {
+        keycap::flat_map<std::string, int> map{{"alpha", 1}, {"beta", 2}, {"a string that does not fit into SSO", 3}};
+
+        REQUIRE(map.contains("alpha"));
+        REQUIRE(map.contains(std::string_view{"beta"}));
+        REQUIRE(map.at(std::string_view{"a string that does not fit into SSO"}) == 3);
+        REQUIRE(map.find("gamma") == map.end());
+        REQUIRE(map.count(std::string{"beta"}) == 1);
+
+        REQUIRE(map.try_emplace(std::string_view{"gamma"}, 4).second);
+        REQUIRE_FALSE(map.try_emplace(std::string_view{"gamma"}, 5).second);
+        REQUIRE(map["gamma"] == 4);
+        REQUIRE(map["delta"] == 0);
+        REQUIRE(map.insert_or_assign("delta", 6).second == false);
+        REQUIRE(map.at("delta") == 6);
+
+        REQUIRE(map.erase(std::string_view{"alpha"}) == 1);
+        REQUIRE(map.erase("alpha") == 0);
+        REQUIRE(map.size() == 4);
+
+        REQUIRE(keycap::flat_hash<std::string>{}("beta") == keycap::hash_u64("beta"));
+        REQUIRE(keycap::flat_hash<std::string_view>{}("beta") == keycap::hash_u64("beta"));
+
+        // A temporary std::pmr::string key would be allocated from the default resource
+        keycap::flat_map<std::pmr::string, int, keycap::flat_hash<std::string_view>> pmr_map;
+        pmr_map.try_emplace("a string that does not fit into SSO", 1);
+
+        counting_resource resource;
+        auto* const default_resource = std::pmr::set_default_resource(&resource);
+        bool const found = pmr_map.contains("a string that does not fit into SSO") &&
+                           pmr_map.at(std::string_view{"a string that does not fit into SSO"}) == 1 &&
+                           pmr_map.find("another string that does not fit into SSO") == pmr_map.end() &&
+                           pmr_map.erase(std::string_view{"another string that does not fit into SSO"}) == 0;
+        std::pmr::set_default_resource(default_resource);
+
+        REQUIRE(found);
+        REQUIRE(resource.allocations == 0);
+    }
+
+    SECTION("Growing moves elements")
+    {
+        keycap::flat_map<std::string, std::unique_ptr<int>> map;
+        for (int i = 0; i < 10'000; ++i)
+            map.try_emplace(fmt::format("key number {}", i), std::make_unique<int>(i));
+
+        REQUIRE(map.size() == 10'000);
+        for (int i = 0; i < 10'000; ++i)
+            REQUIRE(*map.at(fmt::format("key number {}", i)) == i);
+
+        auto moved = std::move(map);
+        REQUIRE(moved.size() == 10'000);
+        REQUIRE(map.empty());
+        REQUIRE(map.find("key number 1") == map.end());
+        map = std::move(moved);
+        REQUIRE(*map.at("key number 1") == 1);
+    }
+
+    SECTION("Inserting from an element of the same map while growing")
+    {
+        // Longer than any small string buffer, so that reading a moved-from element is caught
+        auto const long_string = [](int i) { return fmt::format("{:>64}", i); };
+
+        // Calls insert(i) for i in [1, 200) and returns how often that grew the map
+        auto const count_growths = [](auto const& map, auto const& insert) {
+            int growths = 0;
+            for (int i = 1; i < 200; ++i)
+            {
+                auto const capacity = map.capacity();
+                insert(i);
+                growths += map.capacity() != capacity;
+            }
+            return growths;
+        };
+
+        keycap::flat_map<int, std::string> copies{{0, long_string(0)}};
+        REQUIRE(count_growths(copies, [&](int i) { copies.try_emplace(i, copies.at(0)); }) > 0);
+        REQUIRE(std::ranges::all_of(copies, [&](auto const& copy) { return copy.second == long_string(0); }));
+
+        keycap::flat_map<int, std::string> assigned{{0, long_string(0)}};
+        REQUIRE(count_growths(assigned, [&](int i) { assigned.insert_or_assign(i, assigned.at(0)); }) > 0);
+        REQUIRE(std::ranges::all_of(assigned, [&](auto const& copy) { return copy.second == long_string(0); }));
+
+        // Every element's value is the key of the next one
+        keycap::flat_map<std::string, std::string> chain{{long_string(0), long_string(1)}};
+        auto const extend = [&](int i) { chain.try_emplace(chain.at(long_string(i - 1)), long_string(i + 1)); };
+        REQUIRE(count_growths(chain, extend) > 0);
+        for (int i = 0; i < 200; ++i)
+            REQUIRE(chain.at(long_string(i)) == long_string(i + 1));
+    }
+
+    SECTION("Growing keeps all elements if copying one throws")
+    {
+        int copies_left = std::numeric_limits<int>::max();
+        keycap::flat_map<int, fragile_copy> map;
+        for (int i = 0; i < 100; ++i)
+            map.try_emplace(i, i, &copies_left);
+
+        auto const capacity = map.capacity();
+        copies_left = 10;
+        int key = 100;
+        REQUIRE_THROWS_AS(([&] {
+                              while (true)
+                                  map.try_emplace(key++, 0, &copies_left);
+                          }()),
+                          std::runtime_error);
+
+        REQUIRE(map.capacity() == capacity);
+        REQUIRE(map.size() == static_cast<sz>(key - 1));
+        for (int i = 0; i < 100; ++i)
+            REQUIRE(map.at(i).value == i);
+
+        copies_left = std::numeric_limits<int>::max();
+        map.try_emplace(key, 0, &copies_left);
+        REQUIRE(map.capacity() > capacity);
+        REQUIRE(map.size() == static_cast<sz>(key));
+    }
+
+    SECTION("Copies compare equal")
+    {
+        keycap::flat_map<std::string, int> map;
+        for (int i = 0; i < 1'000; ++i)
+            map.emplace(std::to_string(i), i);
+
+        auto copy = map;
+        REQUIRE(copy == map);
+        copy["0"] = -1;
+        REQUIRE(copy != map);
+
+        keycap::flat_map<std::string, int> assigned;
+        assigned = map;
+        REQUIRE(assigned == map);
+    }
+
+    SECTION("Erasing while iterating")
+    {
+        keycap::flat_map<int, int> map;
+        for (int i = 0; i < 1'000; ++i)
+            map.emplace(i, i);
+
+        for (auto it = map.begin(); it != map.end();)
+        {
+            if (it->first % 3 == 0)
+                it = map.erase(it);
+            else
+                ++it;
+        }
+
+        REQUIRE(map.size() == 666);
+        REQUIRE(std::ranges::none_of(map, [](auto const& element) { return element.first % 3 == 0; }));
+    }
+
+    SECTION("Erasing and inserting does not grow the table")
+    {
+        keycap::flat_map<int, int> map;
+        map.reserve(1'000);
+        auto const capacity = map.capacity();
+        REQUIRE(static_cast<float>(capacity) * keycap::flat_map<int, int>::max_load_factor() >= 1'000);
+
+        for (int round = 0; round < 100; ++round)
+        {
+            for (int i = 0; i < 1'000; ++i)
+                map.emplace(round * 1'000 + i, i);
+            for (int i = 0; i < 1'000; ++i)
+                map.erase(round * 1'000 + i);
+        }
+
+        REQUIRE(map.empty());
+        REQUIRE(map.capacity() == capacity);
+    }
+
+    SECTION("clear and rehash")
+    {
+        keycap::flat_map<int, std::string> map;
+        for (int i = 0; i < 1'000; ++i)
+            map.emplace(i, std::string(32, 'x'));
+
+        auto const capacity = map.capacity();
+        map.clear();
+        REQUIRE(map.empty());
+        REQUIRE(map.begin() == map.end());
+        REQUIRE(map.capacity() == capacity);
+
+        map[1] = "one";
+        map.rehash(0);
+        REQUIRE(map.capacity() == 15);
+        REQUIRE(map.at(1) == "one");
+
+        map.clear();
+        map.rehash(0);
+        REQUIRE(map.capacity() == 0);
+        REQUIRE_FALSE(map.contains(1));
     }
-}
\ No newline at end of file
+
+    SECTION("at throws for missing keys")
+    {
+        keycap::flat_map<int, int> const map{{1, 2}};
+        REQUIRE(map.at(1) == 2);
+        REQUIRE(error_of([&] { (void)map.at(2); }) == keycap::error_code::invalid_argument);
+    }
+
+    keycap::simd::limit_instruction_set(previous);
+}
+
+TEST_CASE("flat_set", "[keycap.core:flatmap]")
+{
+    using keycap::simd::instruction_set;
+    auto const set = GENERATE(instruction_set::scalar, instruction_set::sse2);
+    auto const previous = keycap::simd::limit_instruction_set(set);
+
+    keycap::flat_set<std::string> words{"lorem", "ipsum", "dolor", "sit", "amet"};
+    REQUIRE(words.size() == 5);
+    REQUIRE(words.contains("dolor"));
+    REQUIRE_FALSE(words.insert("lorem").second);
+    REQUIRE(words.emplace(3, 'x').second);
+    REQUIRE(words.contains(std::string_view{"xxx"}));
+
+    words.erase(words.find("sit"));
+    REQUIRE_FALSE(words.contains("sit"));
+
+    std::vector<std::string> sorted{words.begin(), words.end()};
+    std::ranges::sort(sorted);
+    REQUIRE(sorted == std::vector<std::string>{"amet", "dolor", "ipsum", "lorem", "xxx"});
+
+    keycap::flat_set<std::string> const same{sorted.begin(), sorted.end()};
+    REQUIRE(same == words);
+
+    keycap::flat_set<u64> numbers;
+    for (u64 i = 0; i < 100'000; ++i)
+        numbers.insert(i * 0x1'0000'0000);
+    REQUIRE(numbers.size() == 100'000);
+    REQUIRE(numbers.contains(99'999 * 0x1'0000'0000));
+    REQUIRE_FALSE(numbers.contains(1));
+
+    keycap::simd::limit_instruction_set(previous);
+}
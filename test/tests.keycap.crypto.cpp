@@ -69,4 +69,22 @@ TEST_CASE("OTP", "[keycap.crypto:otp]")
             REQUIRE(totp::validate(key, code) == false);
         }
     }
+
+    SECTION("HOTP - try_generate returns the same passwords and reports invalid digit counts")
+    {
+        REQUIRE(hotp::try_generate(key, 0, num_digits) == hotp::generate(key, 0, num_digits));
+
+        for (sz digits : std::array<sz, 3>{0, 5, 9})
+        {
+            auto const failed = hotp::try_generate(key, 0, digits);
+            REQUIRE_FALSE(failed.has_value());
+            REQUIRE(failed.error().error == keycap::error_code::invalid_argument);
+            REQUIRE(failed.error().module == keycap::module::crypto);
+        }
+
+        REQUIRE(hotp::try_generate(key, 0, 5).error().message.find("`6`") != std::string_view::npos);
+        REQUIRE(hotp::try_generate(key, 0, 9).error().message.find("`8`") != std::string_view::npos);
+
+        REQUIRE_THROWS_AS(hotp::generate(key, 0, 5), keycap::exception);
+    }
 }
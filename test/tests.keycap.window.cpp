@@ -1,5 +1,6 @@
 #include <catch2/catch_test_macros.hpp>
 
+import keycap.core;
 import keycap.window;
 
 struct dummy_input_handler : keycap::input_event_handler
@@ -74,6 +75,25 @@ TEST_CASE("window", "[keycap.window:window]")
         REQUIRE(window.handle() != nullptr);
     }
 
+    SECTION("window_context::try_create_window must yield a window instead of throwing")
+    {
+        auto created = context.try_create_window(params);
+        REQUIRE(created.has_value());
+        REQUIRE(created->handle() != nullptr);
+    }
+
+    SECTION("Moving a window must keep its handle and input events")
+    {
+        auto moved = keycap::value_or_throw(context.try_create_window(params));
+        moved.register_input_events(dummy_handler);
+        REQUIRE(moved.handle() != nullptr);
+
+        auto const handle = moved.handle();
+        keycap::window target = std::move(moved);
+        REQUIRE(target.handle() == handle);
+        REQUIRE(moved.handle() == nullptr);
+    }
+
     SECTION("window::size must yield the given size from the window_creation_parameters if they were non-zero and the "
             "window wasn't resized")
     {